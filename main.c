@@ -1,9 +1,13 @@
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 #include <SDL.h>
 #include <SDL_vulkan.h>
 #include <std/core/memory.h>
 #include "core/input.h"
+#include "core/job.h"
+#include "core/log.h"
 #include "renderer/vulkan.h"
 
 void handle_window_event(SDL_Window *window, SDL_WindowEvent event) {
@@ -22,10 +26,10 @@ bool processEvents(SDL_Window *window) {
                 running = false;
                 break;
             case SDL_KEYDOWN:
-                running = !handle_keyboard_event(&event.key, true);
+                input_push_keyboard(&event.key, true);
                 break;
             case SDL_KEYUP:
-                running = !handle_keyboard_event(&event.key, false);
+                input_push_keyboard(&event.key, false);
                 break;
             case SDL_WINDOWEVENT:
                 handle_window_event(window, event.window);
@@ -36,7 +40,36 @@ bool processEvents(SDL_Window *window) {
     return running;
 }
 
-int main() {
+static PresentSettings present = {.policy = PRESENT_POLICY_TEAR_FREE};
+static bool debug_overlay = false;
+
+// Drains the input queue into the frame being built, P cycles through the present policies and F3 toggles the debug
+// overlay
+bool consumeInput() {
+    bool running = true;
+    InputEvent event;
+    while (input_pop(&event)) {
+        vulkan_input_consumed(&event);
+        if (handle_keyboard_event(&event)) {
+            running = false;
+        }
+
+        if (event.key == SDLK_p && event.pressed) {
+            present.policy = (present.policy + 1) % PRESENT_POLICY_MAX;
+            vulkan_set_present_settings(&present);
+        }
+
+        if (event.key == SDLK_F3 && event.pressed) {
+            debug_overlay = !debug_overlay;
+            vulkan_set_debug_overlay(debug_overlay);
+        }
+    }
+
+    return running;
+}
+
+int main(int argc, char **argv) {
+    log_init();
     if (SDL_Init(SDL_INIT_EVERYTHING) < 0) {
         printf("ERROR: failed to initialize SDL: %s", SDL_GetError());
         return -1;
@@ -55,20 +88,85 @@ int main() {
         return -2;
     }
 
-    if (!vulkan_init(window, "Vulkan Demo")) {
+    // The main thread is the job system's thread 0, so it keeps one core to itself
+    int cpu_count = SDL_GetCPUCount();
+    if (!job_system_init(cpu_count > 1 ? cpu_count - 1 : 0)) {
+        LOG_ERROR("Failed to start the job system! Exiting...");
+        exit(-1);
+    }
+
+    bool low_latency = false;
+    bool gpu_lod = false;
+    // Raw RGBA frames, or y4m when the path ends in .y4m. A leading | pipes them into a command.
+    const char *capture_path = NULL;
+    // Command stream for tools/replay
+    const char *record_path = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--low-latency") == 0) {
+            low_latency = true;
+            present.policy = PRESENT_POLICY_LOW_LATENCY;
+        } else if (strcmp(argv[i], "--power-saving") == 0) {
+            present.policy = PRESENT_POLICY_POWER_SAVING;
+        } else if (strcmp(argv[i], "--benchmark") == 0) {
+            present.policy = PRESENT_POLICY_BENCHMARK;
+        } else if (strcmp(argv[i], "--vrr") == 0) {
+            present.variable_refresh = true;
+        } else if (strncmp(argv[i], "--fps=", 6) == 0) {
+            present.target_fps = (u32) strtoul(argv[i] + 6, NULL, 10);
+        } else if (strncmp(argv[i], "--capture=", 10) == 0) {
+            capture_path = argv[i] + 10;
+        } else if (strncmp(argv[i], "--record=", 9) == 0) {
+            record_path = argv[i] + 9;
+        } else if (strcmp(argv[i], "--overlay") == 0) {
+            debug_overlay = true;
+        } else if (strcmp(argv[i], "--gpu-lod") == 0) {
+            gpu_lod = true;
+        } else if (strncmp(argv[i], "--log=", 6) == 0) {
+            LogLevel level;
+            if (log_level_parse(argv[i] + 6, &level)) {
+                log_set_level(level);
+            } else {
+                LOG_ERROR("Unknown log level %s, expected error, warn, info, debug or trace", argv[i] + 6);
+            }
+        }
+    }
+
+    if (!vulkan_init(window, "Vulkan Demo", &present)) {
         LOG_ERROR("Failed to initialize Vulkan! Exiting...");
         exit(-1);
     }
 
+    if (low_latency) {
+        vulkan_set_frame_pacing(FRAME_PACING_JUST_IN_TIME);
+    }
+    vulkan_set_debug_overlay(debug_overlay);
+    vulkan_set_gpu_lod_selection(gpu_lod);
+
+    if (record_path != NULL) {
+        vulkan_start_command_stream(record_path);
+    }
+
+    if (capture_path != NULL) {
+        size_t length = strlen(capture_path);
+        bool y4m = length >= 4 && strcmp(capture_path + length - 4, ".y4m") == 0;
+        vulkan_start_capture(capture_path, y4m ? CAPTURE_FORMAT_Y4M : CAPTURE_FORMAT_RAW_RGBA,
+                             present.target_fps != 0 ? present.target_fps : 60);
+    }
+
     bool running = true;
     while (running) {
+        vulkan_wait_frame_start();
         running = processEvents(window);
+        running = consumeInput() && running;
         vulkan_render();
     }
 
+    vulkan_stop_capture();
     vulkan_shutdown();
+    job_system_shutdown();
     SDL_DestroyWindow(window);
     SDL_Vulkan_UnloadLibrary();
     SDL_Quit();
+    log_shutdown();
     return 0;
 }
@@ -0,0 +1,39 @@
+#extension GL_EXT_nonuniform_qualifier : require
+
+struct Material {
+    vec4 base_color;
+    uint albedo_texture;
+    uint albedo_sampler;
+    uint padding0;
+    uint padding1;
+};
+
+const uint INVALID_HANDLE = 0xFFFFFFFFu;
+
+layout(set = 0, binding = 0) uniform texture2D textures[];
+layout(set = 0, binding = 1) uniform sampler samplers[];
+layout(std430, set = 0, binding = 2) readonly buffer MaterialBuffer {
+    Material materials[];
+} material_buffers[];
+layout(std430, set = 0, binding = 2) readonly buffer TextureTable {
+    uint handles[];
+} texture_tables[];
+
+// Pipelines with more push constants define EXTRA_DRAW_CONSTANTS before including this file
+layout(push_constant) uniform DrawConstants {
+    uint material_buffer;
+    uint material_index;
+    uint texture_table;
+#ifdef EXTRA_DRAW_CONSTANTS
+    EXTRA_DRAW_CONSTANTS
+#endif
+} draw;
+
+Material current_material() {
+    return material_buffers[draw.material_buffer].materials[draw.material_index];
+}
+
+vec4 sample_texture(uint texture_id, uint sampler_handle, vec2 uv) {
+    uint image = texture_tables[draw.texture_table].handles[texture_id];
+    return texture(sampler2D(textures[nonuniformEXT(image)], samplers[nonuniformEXT(sampler_handle)]), uv);
+}
@@ -0,0 +1,20 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#define EXTRA_DRAW_CONSTANTS \
+    uint atlas; \
+    uint atlas_sampler; \
+    float inverse_width; \
+    float inverse_height;
+
+#include "bindless.glsl"
+
+layout(location = 0) in vec2 in_uv;
+layout(location = 1) in vec4 in_color;
+layout(location = 0) out vec4 out_color;
+
+// The atlas holds coverage only, panels and bars use its solid cell
+void main() {
+    float coverage = texture(sampler2D(textures[draw.atlas], samplers[draw.atlas_sampler]), in_uv).r;
+    out_color = vec4(in_color.rgb, in_color.a * coverage);
+}
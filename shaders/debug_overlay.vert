@@ -0,0 +1,25 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#define EXTRA_DRAW_CONSTANTS \
+    uint atlas; \
+    uint atlas_sampler; \
+    float inverse_width; \
+    float inverse_height;
+
+#include "bindless.glsl"
+
+layout(location = 0) in vec2 in_position;
+layout(location = 1) in vec2 in_uv;
+layout(location = 2) in vec4 in_color;
+
+layout(location = 0) out vec2 out_uv;
+layout(location = 1) out vec4 out_color;
+
+// Positions are in swapchain pixels from the top left, the viewport covers whatever part of the target is rendered
+void main() {
+    vec2 position = in_position * vec2(draw.inverse_width, draw.inverse_height) * 2.0 - 1.0;
+    gl_Position = vec4(position, 0.0, 1.0);
+    out_uv = in_uv;
+    out_color = in_color;
+}
@@ -0,0 +1,50 @@
+#define DEPTH_PYRAMID_GROUP_SIZE 8
+
+layout(local_size_x = DEPTH_PYRAMID_GROUP_SIZE, local_size_y = DEPTH_PYRAMID_GROUP_SIZE) in;
+
+layout(set = 0, binding = 0, r32f) uniform writeonly image2D destination;
+#ifdef DEPTH_PYRAMID_MULTISAMPLED
+layout(set = 0, binding = 1) uniform sampler2DMS source;
+#else
+layout(set = 0, binding = 1) uniform sampler2D source;
+#endif
+
+// Mirrors DepthPyramidConstants in src/renderer/depth_pyramid.h
+layout(push_constant) uniform Constants {
+    uvec2 source_extent;
+    uvec2 extent;
+} constants;
+
+float source_depth(ivec2 texel) {
+#ifdef DEPTH_PYRAMID_MULTISAMPLED
+    float depth = 0.0;
+    for (int i = 0; i < textureSamples(source); ++i) {
+        depth = max(depth, texelFetch(source, texel, i).r);
+    }
+    return depth;
+#else
+    return texelFetch(source, texel, 0).r;
+#endif
+}
+
+// Each texel keeps the farthest depth of every source texel its footprint touches, so anything behind that depth is
+// hidden wherever the texel reaches
+void main() {
+    uvec2 texel = gl_GlobalInvocationID.xy;
+    if (any(greaterThanEqual(texel, constants.extent))) {
+        return;
+    }
+
+    vec2 scale = vec2(constants.source_extent) / vec2(constants.extent);
+    ivec2 first = ivec2(floor(vec2(texel) * scale));
+    ivec2 last = min(ivec2(ceil(vec2(texel + 1u) * scale)) - 1, ivec2(constants.source_extent) - 1);
+    last = max(last, first);
+
+    float depth = 0.0;
+    for (int y = first.y; y <= last.y; ++y) {
+        for (int x = first.x; x <= last.x; ++x) {
+            depth = max(depth, source_depth(ivec2(x, y)));
+        }
+    }
+    imageStore(destination, ivec2(texel), vec4(depth));
+}
@@ -1,8 +1,11 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+#include "bindless.glsl"
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    Material material = current_material();
+    outColor = vec4(fragColor, 1.0) * material.base_color;
 }
\ No newline at end of file
@@ -0,0 +1,64 @@
+// Mirrors the cluster grid in src/renderer/light_clusters.h
+#define LIGHT_CLUSTER_X 16
+#define LIGHT_CLUSTER_Y 9
+#define LIGHT_CLUSTER_Z 24
+#define LIGHT_CLUSTER_COUNT (LIGHT_CLUSTER_X * LIGHT_CLUSTER_Y * LIGHT_CLUSTER_Z)
+#define LIGHT_MAX_INDICES (LIGHT_CLUSTER_COUNT * 64)
+
+// Mirrors LightData in src/renderer/light_clusters.h
+struct LightData {
+    vec4 position_range;    // xyz: world position, w: range
+    vec4 color;             // rgb: color times intensity, w: cosine of the inner cone angle
+    vec4 direction;         // xyz: spot direction, w: cosine of the outer cone angle, below -1 for point lights
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer LightBuffer {
+    mat4 view_projection;
+    vec4 cluster;           // xy: clusters per pixel, z, w: scale and bias from log view depth to the slice
+    uvec4 counts;           // x: lights
+    LightData lights[];
+} light_buffers[];
+
+// Only the assignment pass declares it writable, writable buffers in the fragment stage would need
+// fragmentStoresAndAtomics
+#ifdef LIGHT_CLUSTER_OUTPUT
+layout(std430, set = 0, binding = 2) buffer LightClusterBuffer {
+    uint index_count;
+    uint padding[3];
+    uvec2 ranges[LIGHT_CLUSTER_COUNT];  // first index, light count
+    uint indices[];
+} cluster_buffers[];
+#else
+layout(std430, set = 0, binding = 2) readonly buffer LightClusterBuffer {
+    uint index_count;
+    uint padding[3];
+    uvec2 ranges[LIGHT_CLUSTER_COUNT];
+    uint indices[];
+} cluster_buffers[];
+#endif
+
+// Cluster of a fragment, depth is its view depth
+uint light_cluster_index(vec2 frag_coord, float depth, vec4 cluster) {
+    uint x = min(uint(frag_coord.x * cluster.x), uint(LIGHT_CLUSTER_X - 1));
+    uint y = min(uint(frag_coord.y * cluster.y), uint(LIGHT_CLUSTER_Y - 1));
+    uint z = uint(clamp(log(depth) * cluster.z + cluster.w, 0.0, float(LIGHT_CLUSTER_Z - 1)));
+    return x + (y + z * LIGHT_CLUSTER_Y) * LIGHT_CLUSTER_X;
+}
+
+// Diffuse light reaching a surface, inverse square falloff windowed to reach zero at the range
+vec3 light_shade(LightData light, vec3 position, vec3 normal) {
+    vec3 offset = light.position_range.xyz - position;
+    float distance_squared = dot(offset, offset);
+    float range_squared = light.position_range.w * light.position_range.w;
+    if (distance_squared >= range_squared) {
+        return vec3(0.0);
+    }
+
+    vec3 direction = offset * inversesqrt(max(distance_squared, 1e-8));
+    float window = 1.0 - distance_squared / range_squared;
+    float attenuation = window * window / max(distance_squared, 0.01);
+    if (light.direction.w >= -1.0) {
+        attenuation *= smoothstep(light.direction.w, light.color.w, dot(-direction, light.direction.xyz));
+    }
+    return light.color.rgb * attenuation * max(dot(normal, direction), 0.0);
+}
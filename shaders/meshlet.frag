@@ -0,0 +1,39 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#include "meshlet.glsl"
+#include "lights.glsl"
+
+// Light every surface gets, so geometry outside all light ranges stays visible
+#define LIGHT_AMBIENT 0.03
+
+layout(location = 0) in vec3 in_normal;
+layout(location = 1) in vec2 in_uv;
+layout(location = 2) flat in uint in_material;
+layout(location = 3) in vec3 in_position;
+layout(location = 0) out vec4 out_color;
+
+void main() {
+    Material material = material_buffers[draw.material_buffer].materials[in_material];
+    vec4 color = material.base_color;
+    if (material.albedo_texture != INVALID_HANDLE) {
+        color *= sample_texture(material.albedo_texture, material.albedo_sampler, in_uv);
+    }
+
+    vec3 normal = normalize(in_normal);
+    if (light_buffers[draw.lights].counts.x == 0) {
+        // Simple headlight shading while the frame has no lights
+        float light = 0.25 + 0.75 * max(dot(normal, vec3(0.0, 0.0, 1.0)), 0.0);
+        out_color = vec4(color.rgb * light, color.a);
+        return;
+    }
+
+    // 1 / gl_FragCoord.w is clip space w, the view depth
+    uint cluster = light_cluster_index(gl_FragCoord.xy, 1.0 / gl_FragCoord.w, light_buffers[draw.lights].cluster);
+    uvec2 range = cluster_buffers[draw.clusters].ranges[cluster];
+    vec3 light = vec3(LIGHT_AMBIENT);
+    for (uint i = 0; i < range.y; ++i) {
+        uint index = cluster_buffers[draw.clusters].indices[range.x + i];
+        light += light_shade(light_buffers[draw.lights].lights[index], in_position, normal);
+    }
+    out_color = vec4(color.rgb * light, color.a);
+}
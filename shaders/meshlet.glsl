@@ -0,0 +1,231 @@
+#define MESHLET_GROUP_SIZE 32
+#define MESH_VERTEX_FORMAT_QUANTIZED 1
+
+// Mirrors MeshletConstants in src/renderer/meshlet_renderer.h
+#define EXTRA_DRAW_CONSTANTS \
+    uint vertices; \
+    uint meshlets; \
+    uint meshlet_vertices; \
+    uint meshlet_triangles; \
+    uint commands; \
+    uint instance_count; \
+    uint first_group; \
+    uint command_capacity; \
+    uint compact; \
+    uint lights; \
+    uint clusters; \
+    uint lods;
+
+#include "bindless.glsl"
+
+struct MeshInstance {
+    mat4 transform;
+    vec4 position_scale;
+    vec4 position_offset;
+    uvec4 meshlets;     // first_meshlet, meshlet_count, first_group, material
+    uvec4 geometry;     // vertex_offset, index_type, vertex_format, mesh
+};
+
+// Mirrors GpuMeshLods in src/renderer/mesh.h
+struct MeshLods {
+    float errors[8];
+    uint first_meshlet[8];
+    uint meshlet_count[8];
+    vec4 sphere;
+    uvec4 info;         // level_count, unused
+};
+
+struct Meshlet {
+    vec4 sphere;
+    vec4 cone;
+    uvec4 data;         // vertex_offset, triangle_offset, vertex_count | triangle_count << 8, first_index
+};
+
+struct DrawCommand {
+    uint index_count;
+    uint instance_count;
+    uint first_index;
+    int vertex_offset;
+    uint first_instance;
+};
+
+layout(set = 1, binding = 0) uniform MeshletView {
+    mat4 view_projection;
+    vec4 frustum[6];
+    vec4 camera;
+    mat4 occlusion_view_projection;
+    uvec4 pyramid;      // image, sampler, width, height; the image is INVALID_HANDLE without a pyramid to test
+    vec4 lod;           // distance factor of a unit of level error, unused
+} view;
+
+layout(std430, set = 1, binding = 1) readonly buffer MeshInstances {
+    MeshInstance instances[];
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer MeshletBuffer {
+    Meshlet meshlets[];
+} meshlet_buffers[];
+
+layout(std430, set = 0, binding = 2) readonly buffer MeshLodBuffer {
+    MeshLods meshes[];
+} lod_buffers[];
+
+layout(std430, set = 0, binding = 2) readonly buffer WordBuffer {
+    uint words[];
+} word_buffers[];
+
+// Only the culling pass declares it, writable buffers in vertex stages would need vertexPipelineStoresAndAtomics
+#ifdef MESHLET_COMMAND_OUTPUT
+layout(std430, set = 0, binding = 2) buffer CommandBuffer {
+    uint counts[4];
+    DrawCommand commands[];
+} command_buffers[];
+#endif
+
+struct MeshletVertex {
+    vec3 position;
+    vec3 normal;
+    vec2 uv;
+};
+
+// Finds the instance owning a group through the per instance group prefix
+uint find_instance(uint group) {
+    uint low = 0;
+    uint high = draw.instance_count - 1;
+    while (low < high) {
+        uint middle = (low + high + 1) / 2;
+        if (instances[middle].meshlets.z <= group) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+// First meshlet and meshlet count of the instance's level, picked the way lod_select in src/core/lod.c does when the
+// culling pass owns level selection
+uvec2 meshlet_range(MeshInstance instance) {
+    if (draw.lods == INVALID_HANDLE) {
+        return instance.meshlets.xy;
+    }
+
+    MeshLods lods = lod_buffers[draw.lods].meshes[instance.geometry.w];
+    vec3 center = (instance.transform * vec4(lods.sphere.xyz, 1.0)).xyz;
+    float scale = instance.position_scale.w;
+    float distance = max(length(center - view.camera.xyz) - lods.sphere.w * scale, 1e-4);
+
+    uint level = 0;
+    float threshold = 0.0;
+    for (uint l = 1; l < lods.info.x; ++l) {
+        threshold = max(lods.errors[l] * view.lod.x, threshold);
+        level += threshold * scale <= distance ? 1u : 0u;
+    }
+
+    // Groups were dispatched for the mesh's widest level, the rest of them find nothing to cull
+    return uvec2(lods.first_meshlet[level], min(lods.meshlet_count[level], instance.meshlets.y));
+}
+
+vec3 octahedral_decode(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (normal.z < 0.0) {
+        normal.xy = (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(normal);
+}
+
+// Vertex pulling for both MeshVertex (8 words) and MeshVertexQuantized (4 words)
+MeshletVertex fetch_vertex(MeshInstance instance, uint vertex) {
+    MeshletVertex result;
+    if (instance.geometry.z == MESH_VERTEX_FORMAT_QUANTIZED) {
+        uint base = vertex * 4;
+        uint xy = word_buffers[draw.vertices].words[base];
+        uint zw = word_buffers[draw.vertices].words[base + 1];
+        vec3 position = vec3(xy & 0xFFFFu, xy >> 16, zw & 0xFFFFu);
+        result.position = position * instance.position_scale.xyz + instance.position_offset.xyz;
+        result.normal = octahedral_decode(unpackSnorm4x8(word_buffers[draw.vertices].words[base + 2]).xy);
+        result.uv = unpackHalf2x16(word_buffers[draw.vertices].words[base + 3]);
+    } else {
+        uint base = vertex * 8;
+        result.position = uintBitsToFloat(uvec3(word_buffers[draw.vertices].words[base],
+                                                word_buffers[draw.vertices].words[base + 1],
+                                                word_buffers[draw.vertices].words[base + 2]));
+        result.normal = uintBitsToFloat(uvec3(word_buffers[draw.vertices].words[base + 3],
+                                              word_buffers[draw.vertices].words[base + 4],
+                                              word_buffers[draw.vertices].words[base + 5]));
+        result.uv = uintBitsToFloat(uvec2(word_buffers[draw.vertices].words[base + 6],
+                                          word_buffers[draw.vertices].words[base + 7]));
+    }
+    return result;
+}
+
+uint meshlet_triangle_index(uint byte_offset) {
+    uint word = word_buffers[draw.meshlet_triangles].words[byte_offset / 4];
+    return (word >> ((byte_offset % 4) * 8)) & 0xFFu;
+}
+
+float pyramid_depth(ivec2 texel, int level) {
+    return texelFetch(sampler2D(textures[view.pyramid.x], samplers[view.pyramid.y]), texel, level).r;
+}
+
+// Projects the sphere's bounding box with the view the depth pyramid was rendered with and compares its nearest depth
+// to the farthest depth of the pyramid texels around it. Moving objects may be culled for a frame.
+bool meshlet_occluded(vec3 center, float radius) {
+    if (view.pyramid.x == INVALID_HANDLE) {
+        return false;
+    }
+
+    vec3 low = vec3(1e30);
+    vec3 high = vec3(-1e30);
+    for (int i = 0; i < 8; ++i) {
+        vec3 corner = center + radius * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0,
+                                             (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = view.occlusion_view_projection * vec4(corner, 1.0);
+        // Crossing the near plane, the projection has no bounds
+        if (clip.z <= 0.0 || clip.w <= 0.0) {
+            return false;
+        }
+        vec3 ndc = clip.xyz / clip.w;
+        low = min(low, ndc);
+        high = max(high, ndc);
+    }
+
+    // The pyramid knows nothing about what was off screen
+    if (any(lessThan(low.xy, vec2(-1.0))) || any(greaterThan(high.xy, vec2(1.0)))) {
+        return false;
+    }
+
+    // The level where the rectangle spans at most two texels each way
+    vec2 uv_low = low.xy * 0.5 + 0.5;
+    vec2 uv_high = high.xy * 0.5 + 0.5;
+    vec2 texels = (uv_high - uv_low) * vec2(view.pyramid.zw);
+    int levels = findMSB(max(view.pyramid.z, view.pyramid.w)) + 1;
+    int level = clamp(int(ceil(log2(max(max(texels.x, texels.y), 1.0)))), 0, levels - 1);
+    ivec2 size = max(ivec2(view.pyramid.zw) >> level, ivec2(1));
+    ivec2 first = clamp(ivec2(uv_low * vec2(size)), ivec2(0), size - 1);
+    ivec2 last = clamp(ivec2(uv_high * vec2(size)), ivec2(0), size - 1);
+
+    float depth = max(max(pyramid_depth(first, level), pyramid_depth(ivec2(last.x, first.y), level)),
+                      max(pyramid_depth(ivec2(first.x, last.y), level), pyramid_depth(last, level)));
+    return low.z > depth;
+}
+
+// Frustum, normal cone and occlusion test of one meshlet in world space
+bool meshlet_visible(MeshInstance instance, Meshlet meshlet) {
+    vec3 center = (instance.transform * vec4(meshlet.sphere.xyz, 1.0)).xyz;
+    float radius = meshlet.sphere.w * instance.position_scale.w;
+
+    for (int i = 0; i < 6; ++i) {
+        if (dot(view.frustum[i].xyz, center) + view.frustum[i].w < -radius) {
+            return false;
+        }
+    }
+
+    // Every triangle faces away from any viewpoint inside this cone
+    vec3 axis = normalize(mat3(instance.transform) * meshlet.cone.xyz);
+    vec3 offset = center - view.camera.xyz;
+    if (dot(offset, axis) >= meshlet.cone.w * length(offset) + radius) {
+        return false;
+    }
+    return !meshlet_occluded(center, radius);
+}
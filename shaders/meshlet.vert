@@ -0,0 +1,21 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#include "meshlet.glsl"
+
+layout(location = 0) out vec3 out_normal;
+layout(location = 1) out vec2 out_uv;
+layout(location = 2) flat out uint out_material;
+layout(location = 3) out vec3 out_position;
+
+// Indirect path: every command is one meshlet, firstInstance selects its instance
+void main() {
+    MeshInstance instance = instances[gl_InstanceIndex];
+    MeshletVertex vertex = fetch_vertex(instance, gl_VertexIndex);
+
+    vec4 position = instance.transform * vec4(vertex.position, 1.0);
+    gl_Position = view.view_projection * position;
+    out_normal = normalize(mat3(instance.transform) * vertex.normal);
+    out_uv = vertex.uv;
+    out_material = instance.meshlets.w;
+    out_position = position.xyz;
+}
@@ -0,0 +1,13 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#include "particles.glsl"
+
+layout(location = 0) in vec2 in_corner;
+layout(location = 1) in vec4 in_color;
+layout(location = 0) out vec4 out_color;
+
+// Round soft edged sprites
+void main() {
+    float falloff = 1.0 - smoothstep(0.5, 1.0, length(in_corner));
+    out_color = vec4(in_color.rgb, in_color.a * falloff);
+}
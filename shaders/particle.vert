@@ -0,0 +1,28 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#include "particles.glsl"
+
+layout(location = 0) out vec2 out_corner;
+layout(location = 1) out vec4 out_color;
+
+const vec2 corners[6] = vec2[](
+    vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0)
+);
+
+// One instance per survivor of this frame's update, expanded into a quad facing the camera in clip space
+void main() {
+    uint slot = index_buffers[draw.next_alive].values[gl_InstanceIndex];
+    vec4 position = vector_buffers[draw.positions].values[slot];
+    float lifetime = vector_buffers[draw.velocities].values[slot].w;
+    vec2 corner = corners[gl_VertexIndex];
+
+    vec4 clip = frame.view_projection * vec4(position.xyz, 1.0);
+    clip.xy += corner * 0.5 * frame.billboard.z * frame.billboard.xy;
+    gl_Position = clip;
+
+    vec4 color = unpackUnorm4x8(index_buffers[draw.colors].values[slot]);
+    color.a *= 1.0 - position.w / lifetime;
+    out_corner = corner;
+    out_color = color;
+}
@@ -0,0 +1,54 @@
+#define PARTICLE_GROUP_SIZE 64
+
+#define EXTRA_DRAW_CONSTANTS \
+    uint positions; \
+    uint velocities; \
+    uint colors; \
+    uint alive; \
+    uint next_alive; \
+    uint dead; \
+    uint counters; \
+    uint dispatch; \
+    uint capacity;
+
+#include "bindless.glsl"
+
+layout(set = 1, binding = 0) uniform ParticleFrame {
+    mat4 view_projection;
+    vec4 origin;        // xyz: emitter origin, w: launch speed
+    vec4 billboard;     // xy: clip space size of one world unit at unit depth, z: billboard size, w: time step
+    vec4 motion;        // x: lifetime, y: gravity, z: drag
+    uvec4 emit;         // x: requested emissions, y: random seed
+} frame;
+
+// Only the compute passes declare the writable views, writable buffers in vertex stages would need
+// vertexPipelineStoresAndAtomics
+#ifdef PARTICLE_SIMULATION
+layout(std430, set = 0, binding = 2) buffer ParticleVectors {
+    vec4 values[];
+} vector_buffers[];
+
+layout(std430, set = 0, binding = 2) buffer ParticleIndices {
+    uint values[];
+} index_buffers[];
+
+layout(std430, set = 0, binding = 2) buffer ParticleCounters {
+    uint alive_count;
+    uint dead_count;
+    uint emit_count;
+    uint emit_base;
+    uint draw[4];
+} counter_buffers[];
+
+layout(std430, set = 0, binding = 2) buffer ParticleDispatch {
+    uint groups[3];
+} dispatch_buffers[];
+#else
+layout(std430, set = 0, binding = 2) readonly buffer ParticleVectors {
+    vec4 values[];
+} vector_buffers[];
+
+layout(std430, set = 0, binding = 2) readonly buffer ParticleIndices {
+    uint values[];
+} index_buffers[];
+#endif
@@ -0,0 +1,159 @@
+#include "mesh_file.h"
+#include "core/log.h"
+
+// Checks that the index and meshlet ranges the submeshes, levels and meshlets refer to lie inside their sections
+bool mesh_file_validate_ranges(const char *path, MappedFile *file) {
+    const MeshFileHeader *header = file->data;
+    const u8 *data = file->data;
+    const MeshSubmesh *submeshes = (const MeshSubmesh *) (data + header->sections[MESH_SECTION_SUBMESHES].offset);
+    const MeshLod *lods = (const MeshLod *) (data + header->sections[MESH_SECTION_LODS].offset);
+    const MeshMeshlet *meshlets = (const MeshMeshlet *) (data + header->sections[MESH_SECTION_MESHLETS].offset);
+    const u32 *meshlet_vertices = (const u32 *) (data + header->sections[MESH_SECTION_MESHLET_VERTICES].offset);
+    u64 meshlet_vertex_count = header->sections[MESH_SECTION_MESHLET_VERTICES].size / sizeof(u32);
+    u64 meshlet_triangle_size = header->sections[MESH_SECTION_MESHLET_TRIANGLES].size;
+
+    for (u32 i = 0; i < header->submesh_count; ++i) {
+        const MeshSubmesh *submesh = &submeshes[i];
+        if ((u64) submesh->first_index + submesh->index_count > header->index_count ||
+            (u64) submesh->first_meshlet + submesh->meshlet_count > header->meshlet_count) {
+            LOG_ERROR("Mesh file submesh %u is out of range: %s", i, path);
+            return false;
+        }
+
+        for (u32 level = 0; level < header->lod_count; ++level) {
+            const MeshLod *lod = &lods[i * header->lod_count + level];
+            // The renderer draws a level of all submeshes as one meshlet range
+            const MeshLod *previous = i > 0 ? &lods[(i - 1) * header->lod_count + level] : NULL;
+            if ((u64) lod->first_index + lod->index_count > header->index_count ||
+                (u64) lod->first_meshlet + lod->meshlet_count > header->meshlet_count ||
+                (previous != NULL && previous->first_meshlet + previous->meshlet_count != lod->first_meshlet)) {
+                LOG_ERROR("Mesh file lod %u of submesh %u is out of range: %s", level, i, path);
+                return false;
+            }
+        }
+    }
+
+    for (u32 i = 0; i < header->meshlet_count; ++i) {
+        const MeshMeshlet *meshlet = &meshlets[i];
+        if (meshlet->vertex_count > MESHLET_MAX_VERTICES || meshlet->triangle_count > MESHLET_MAX_TRIANGLES ||
+            (u64) meshlet->vertex_offset + meshlet->vertex_count > meshlet_vertex_count ||
+            (u64) meshlet->triangle_offset + (u64) meshlet->triangle_count * 3 > meshlet_triangle_size) {
+            LOG_ERROR("Mesh file meshlet %u is out of range: %s", i, path);
+            return false;
+        }
+    }
+
+    // Meshlets index the vertex stream through this list, the shaders trust it
+    for (u64 i = 0; i < meshlet_vertex_count; ++i) {
+        if (meshlet_vertices[i] >= header->vertex_count) {
+            LOG_ERROR("Mesh file meshlet vertex %llu is outside the %u vertices: %s", (unsigned long long) i,
+                      header->vertex_count, path);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool mesh_file_validate(const char *path, MappedFile *file) {
+    if (file->size < sizeof(MeshFileHeader)) {
+        LOG_ERROR("Mesh file is truncated: %s", path);
+        return false;
+    }
+
+    const MeshFileHeader *header = file->data;
+    if (header->magic != MESH_FILE_MAGIC) {
+        LOG_ERROR("Not a mesh file: %s", path);
+        return false;
+    }
+
+    if (header->version != MESH_FILE_VERSION) {
+        LOG_ERROR("Unsupported mesh file version %u (expected %u), reconvert %s", header->version,
+                  MESH_FILE_VERSION, path);
+        return false;
+    }
+
+    for (u32 i = 0; i < MESH_SECTION_MAX; ++i) {
+        const MeshRange *range = &header->sections[i];
+        if (range->size == 0) {
+            continue;
+        }
+
+        // Compared without the sum, which a crafted header can overflow
+        if (range->offset % MESH_FILE_ALIGNMENT != 0 || range->offset > file->size ||
+            range->size > file->size - range->offset) {
+            LOG_ERROR("Mesh file section %u is out of bounds or misaligned: %s", i, path);
+            return false;
+        }
+    }
+
+    if (header->vertex_stride == 0) {
+        LOG_ERROR("Mesh file has a zero vertex stride: %s", path);
+        return false;
+    }
+
+    if (header->index_type != MESH_INDEX_TYPE_U16 && header->index_type != MESH_INDEX_TYPE_U32) {
+        LOG_ERROR("Mesh file has an unknown index type %u: %s", header->index_type, path);
+        return false;
+    }
+
+    u32 index_size = header->index_type == MESH_INDEX_TYPE_U16 ? sizeof(u16) : sizeof(u32);
+    if (header->sections[MESH_SECTION_VERTICES].size < (u64) header->vertex_count * header->vertex_stride ||
+        header->sections[MESH_SECTION_INDICES].size < (u64) header->index_count * index_size ||
+        header->sections[MESH_SECTION_SUBMESHES].size < (u64) header->submesh_count * sizeof(MeshSubmesh) ||
+        header->sections[MESH_SECTION_MESHLETS].size < (u64) header->meshlet_count * sizeof(MeshMeshlet) ||
+        header->sections[MESH_SECTION_LODS].size < (u64) header->submesh_count * header->lod_count * sizeof(MeshLod)) {
+        LOG_ERROR("Mesh file sections are smaller than their header counts: %s", path);
+        return false;
+    }
+
+    if (header->lod_count == 0 || header->lod_count > MESH_MAX_LODS) {
+        LOG_ERROR("Mesh file has an invalid lod count %u: %s", header->lod_count, path);
+        return false;
+    }
+
+    return mesh_file_validate_ranges(path, file);
+}
+
+bool mesh_file_open(const char *path, MeshFile *out) {
+    MeshFile result = {0};
+    if (!mapped_file_open(path, &result.file)) {
+        LOG_ERROR("Failed to map mesh file: %s", path);
+        return false;
+    }
+
+    if (!mesh_file_validate(path, &result.file)) {
+        mapped_file_close(&result.file);
+        return false;
+    }
+
+    result.header = result.file.data;
+    result.vertices = mesh_file_section(&result, MESH_SECTION_VERTICES);
+    result.indices = mesh_file_section(&result, MESH_SECTION_INDICES);
+    result.submeshes = mesh_file_section(&result, MESH_SECTION_SUBMESHES);
+    result.meshlets = mesh_file_section(&result, MESH_SECTION_MESHLETS);
+    result.meshlet_vertices = mesh_file_section(&result, MESH_SECTION_MESHLET_VERTICES);
+    result.meshlet_triangles = mesh_file_section(&result, MESH_SECTION_MESHLET_TRIANGLES);
+    result.lods = mesh_file_section(&result, MESH_SECTION_LODS);
+
+    *out = result;
+    return true;
+}
+
+void mesh_file_close(MeshFile *mesh) {
+    mapped_file_close(&mesh->file);
+    mesh->header = NULL;
+}
+
+const void *mesh_file_section(MeshFile *mesh, MeshSection section) {
+    const MeshRange *range = &mesh->header->sections[section];
+    if (range->size == 0) {
+        return NULL;
+    }
+
+    return (const u8 *) mesh->file.data + range->offset;
+}
+
+u64 mesh_file_section_size(MeshFile *mesh, MeshSection section) {
+    return mesh->header->sections[section].size;
+}
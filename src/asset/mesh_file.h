@@ -0,0 +1,27 @@
+#pragma once
+
+#include <std/defines.h>
+#include "asset/mesh_format.h"
+#include "core/mapped_file.h"
+
+// A validated view over a memory-mapped mesh file, the section pointers point straight into the mapping
+typedef struct MeshFile {
+    MappedFile file;
+    const MeshFileHeader *header;
+
+    const void *vertices;
+    const void *indices;
+    const MeshSubmesh *submeshes;
+    const MeshMeshlet *meshlets;
+    const u32 *meshlet_vertices;
+    const u8 *meshlet_triangles;
+    const MeshLod *lods;
+} MeshFile;
+
+bool mesh_file_open(const char *path, MeshFile *out);
+
+void mesh_file_close(MeshFile *mesh);
+
+const void *mesh_file_section(MeshFile *mesh, MeshSection section);
+
+u64 mesh_file_section_size(MeshFile *mesh, MeshSection section);
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <std/defines.h>
+
+// On-disk mesh layout: a header followed by sections, each aligned to MESH_FILE_ALIGNMENT so the mapped file can be
+// handed to the GPU upload path as-is. All values are little endian.
+
+#define MESH_FILE_MAGIC 0x4853454D // "MESH"
+#define MESH_FILE_VERSION 3
+#define MESH_FILE_ALIGNMENT 64
+
+#define MESH_MAX_LODS 8
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+typedef enum MeshVertexFormat {
+    // MeshVertex: float position, normal and uv
+    MESH_VERTEX_FORMAT_FLOAT = 0,
+    // MeshVertexQuantized: unorm16 position in the mesh bounds, octahedral snorm8 normal, half float uv
+    MESH_VERTEX_FORMAT_QUANTIZED = 1,
+} MeshVertexFormat;
+
+typedef enum MeshIndexType {
+    MESH_INDEX_TYPE_U16 = 0,
+    MESH_INDEX_TYPE_U32 = 1,
+} MeshIndexType;
+
+typedef enum MeshSection {
+    MESH_SECTION_VERTICES,
+    MESH_SECTION_INDICES,
+    MESH_SECTION_SUBMESHES,
+    MESH_SECTION_MESHLETS,
+    // u32 indices into the vertex stream, referenced by MeshMeshlet::vertex_offset
+    MESH_SECTION_MESHLET_VERTICES,
+    // u8 triplets of meshlet-local vertex indices, referenced by MeshMeshlet::triangle_offset
+    MESH_SECTION_MESHLET_TRIANGLES,
+    // MeshLod per submesh and level: lods[submesh * lod_count + level]. Meshlets are stored level by level, so the
+    // meshlets of one level of every submesh form one contiguous range.
+    MESH_SECTION_LODS,
+    MESH_SECTION_MAX
+} MeshSection;
+
+typedef struct MeshRange {
+    u64 offset;
+    u64 size;
+} MeshRange;
+
+typedef struct MeshBounds {
+    float min[3];
+    float max[3];
+    float center[3];
+    float radius;
+} MeshBounds;
+
+typedef struct MeshFileHeader {
+    u32 magic;
+    u32 version;
+    u32 vertex_format;
+    u32 index_type;
+
+    u32 vertex_stride;
+    u32 vertex_count;
+    u32 index_count;
+    u32 submesh_count;
+
+    u32 meshlet_count;
+    u32 lod_count;
+    u32 reserved[2];
+
+    // Object space deviation of each level from full detail, level 0 is always 0
+    float lod_errors[MESH_MAX_LODS];
+
+    MeshBounds bounds;
+    MeshRange sections[MESH_SECTION_MAX];
+} MeshFileHeader;
+
+typedef struct MeshVertex {
+    float position[3];
+    float normal[3];
+    float uv[2];
+} MeshVertex;
+
+typedef struct MeshVertexQuantized {
+    u16 position[4];
+    i8 normal[2];
+    u16 padding;
+    u16 uv[2];
+} MeshVertexQuantized;
+
+typedef struct MeshSubmesh {
+    u32 first_index;
+    u32 index_count;
+    u32 first_meshlet;
+    u32 meshlet_count;
+    u32 material;
+    u32 padding[3];
+    MeshBounds bounds;
+} MeshSubmesh;
+
+// Levels index into the same vertex stream as the full detail mesh, only the index and meshlet ranges differ
+typedef struct MeshLod {
+    u32 first_index;
+    u32 index_count;
+    u32 first_meshlet;
+    u32 meshlet_count;
+} MeshLod;
+
+typedef struct MeshMeshlet {
+    u32 vertex_offset;
+    u32 triangle_offset;
+    u32 vertex_count;
+    u32 triangle_count;
+
+    float center[3];
+    float radius;
+
+    // Every triangle faces away from the camera when
+    // dot(center - camera, cone_axis) >= cone_cutoff * length(center - camera) + radius
+    float cone_axis[3];
+    float cone_cutoff;
+} MeshMeshlet;
@@ -0,0 +1,62 @@
+#include "alloc_counter.h"
+#include "log.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+static atomic_ullong alloc_count = 0;
+
+#ifdef ALLOCATION_COUNTER
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *memory, size_t size);
+void *__real_aligned_alloc(size_t alignment, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    atomic_fetch_add_explicit(&alloc_count, 1, memory_order_relaxed);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    atomic_fetch_add_explicit(&alloc_count, 1, memory_order_relaxed);
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *memory, size_t size) {
+    atomic_fetch_add_explicit(&alloc_count, 1, memory_order_relaxed);
+    return __real_realloc(memory, size);
+}
+
+void *__wrap_aligned_alloc(size_t alignment, size_t size) {
+    atomic_fetch_add_explicit(&alloc_count, 1, memory_order_relaxed);
+    return __real_aligned_alloc(alignment, size);
+}
+#endif
+
+void *alloc_counter_untracked_malloc(size_t size) {
+#ifdef ALLOCATION_COUNTER
+    return __real_malloc(size);
+#else
+    return malloc(size);
+#endif
+}
+
+u64 alloc_counter_read() {
+    return atomic_load_explicit(&alloc_count, memory_order_relaxed);
+}
+
+bool alloc_counter_enabled() {
+#ifdef ALLOCATION_COUNTER
+    return true;
+#else
+    return false;
+#endif
+}
+
+void alloc_counter_check(const char *what, u64 start) {
+    u64 count = alloc_counter_read() - start;
+    if (count > 0) {
+        LOG_INFO("%s made %llu heap allocations", what, (unsigned long long) count);
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <std/defines.h>
+#include <stddef.h>
+
+// Heap allocations made through malloc, calloc, realloc and aligned_alloc since startup. Counting needs the linker to
+// wrap those symbols (ALLOCATION_COUNTER), without it the count stays 0.
+u64 alloc_counter_read();
+
+bool alloc_counter_enabled();
+
+// Logs the allocations made since start, a count from alloc_counter_read, when there were any
+void alloc_counter_check(const char *what, u64 start);
+
+// malloc that alloc_counter_read doesn't see, for allocators that keep their own counts like the Vulkan host allocator
+void *alloc_counter_untracked_malloc(size_t size);
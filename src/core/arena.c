@@ -0,0 +1,65 @@
+#include "arena.h"
+#include "log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static _Thread_local Arena scratch = {0};
+
+bool arena_create(size_t capacity, Arena *out) {
+    Arena result = {0};
+    result.memory = malloc(capacity);
+    if (result.memory == NULL) {
+        LOG_ERROR("Failed to allocate an arena of %zu bytes", capacity);
+        return false;
+    }
+    result.capacity = capacity;
+    *out = result;
+    return true;
+}
+
+void arena_destroy(Arena *arena) {
+    free(arena->memory);
+    memset(arena, 0, sizeof(Arena));
+}
+
+void *arena_alloc(Arena *arena, size_t size, size_t alignment) {
+    size_t offset = (arena->offset + alignment - 1) & ~(alignment - 1);
+    if (arena->memory == NULL || offset + size > arena->capacity) {
+        LOG_ERROR("Arena exhausted: %zu of %zu bytes used, %zu more requested", arena->offset, arena->capacity, size);
+        return NULL;
+    }
+
+    arena->offset = offset + size;
+    if (arena->offset > arena->high_water) {
+        arena->high_water = arena->offset;
+    }
+    return arena->memory + offset;
+}
+
+ArenaScope arena_scope_begin(Arena *arena) {
+    ArenaScope scope = {
+            .arena = arena,
+            .offset = arena->offset
+    };
+    return scope;
+}
+
+void arena_scope_end(ArenaScope scope) {
+    scope.arena->offset = scope.offset;
+}
+
+ArenaScope scratch_begin() {
+    if (scratch.memory == NULL) {
+        arena_create(SCRATCH_ARENA_SIZE, &scratch);
+    }
+    return arena_scope_begin(&scratch);
+}
+
+void scratch_end(ArenaScope scope) {
+    arena_scope_end(scope);
+}
+
+void scratch_release() {
+    arena_destroy(&scratch);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include <std/defines.h>
+
+// Size of each thread's scratch arena, enough for every enumeration done during init and swapchain recreation
+#define SCRATCH_ARENA_SIZE (1024 * 1024)
+
+// Linear allocator, everything allocated after a scope began is released together when it ends
+typedef struct Arena {
+    u8 *memory;
+    size_t capacity;
+    size_t offset;
+    size_t high_water;
+} Arena;
+
+typedef struct ArenaScope {
+    Arena *arena;
+    size_t offset;
+} ArenaScope;
+
+bool arena_create(size_t capacity, Arena *out);
+
+void arena_destroy(Arena *arena);
+
+// Uninitialized memory, NULL when the arena is exhausted
+void *arena_alloc(Arena *arena, size_t size, size_t alignment);
+
+#define arena_alloc_array(arena, type, count) ((type *) arena_alloc(arena, sizeof(type) * (count), _Alignof(type)))
+
+ArenaScope arena_scope_begin(Arena *arena);
+
+// Releases everything allocated since the scope began, scopes end in reverse order of beginning
+void arena_scope_end(ArenaScope scope);
+
+// Begins a scope on the calling thread's scratch arena, which is created on first use
+ArenaScope scratch_begin();
+
+void scratch_end(ArenaScope scope);
+
+// Frees the calling thread's scratch arena, for threads that are about to exit
+void scratch_release();
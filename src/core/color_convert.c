@@ -0,0 +1,171 @@
+#include "color_convert.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define COLOR_CONVERT_SSE2
+#endif
+
+// 8 bit fixed point weights in R, G, B order. Luma sums to 256, chroma to 0.
+static const i16 color_convert_y[3] = {77, 150, 29};
+static const i16 color_convert_u[3] = {-43, -85, 128};
+static const i16 color_convert_v[3] = {128, -107, -21};
+
+u8 color_convert_clamp(i32 value) {
+    return value < 0 ? 0 : value > 255 ? 255 : (u8) value;
+}
+
+// Luma of pixels [first, width) of one row
+void color_convert_luma_scalar(const u8 *row, u32 first, u32 width, u32 red, u32 blue, u8 *out) {
+    for (u32 x = first; x < width; ++x) {
+        const u8 *pixel = &row[x * 4];
+        i32 value = color_convert_y[0] * pixel[red] + color_convert_y[1] * pixel[1] + color_convert_y[2] * pixel[blue];
+        out[x] = color_convert_clamp((value + 128) >> 8);
+    }
+}
+
+// Chroma of the 2x2 blocks starting at column pair first. Rows are averaged with rounding up, then the two columns
+// are summed, so the weights carry one extra bit.
+void color_convert_chroma_scalar(const u8 *row0, const u8 *row1, u32 first, u32 width, u32 red, u32 blue, u8 *out_u,
+                                 u8 *out_v) {
+    for (u32 x = first; x < COLOR_CONVERT_CHROMA_SIZE(width); ++x) {
+        u32 left = x * 2;
+        u32 right = left + 1 < width ? left + 1 : left;
+        i32 sum[3];
+        u32 channels[3] = {red, 1, blue};
+        for (u32 c = 0; c < 3; ++c) {
+            u32 offset = channels[c];
+            sum[c] = ((row0[left * 4 + offset] + row1[left * 4 + offset] + 1) >> 1) +
+                     ((row0[right * 4 + offset] + row1[right * 4 + offset] + 1) >> 1);
+        }
+
+        i32 u = color_convert_u[0] * sum[0] + color_convert_u[1] * sum[1] + color_convert_u[2] * sum[2];
+        i32 v = color_convert_v[0] * sum[0] + color_convert_v[1] * sum[1] + color_convert_v[2] * sum[2];
+        out_u[x] = color_convert_clamp(((u + 256) >> 9) + 128);
+        out_v[x] = color_convert_clamp(((v + 256) >> 9) + 128);
+    }
+}
+
+#ifdef COLOR_CONVERT_SSE2
+__m128i color_convert_weights(const i16 *weights, u32 red, u32 blue) {
+    i16 lanes[4] = {0};
+    lanes[red] = weights[0];
+    lanes[1] = weights[1];
+    lanes[blue] = weights[2];
+    return _mm_setr_epi16(lanes[0], lanes[1], lanes[2], lanes[3], lanes[0], lanes[1], lanes[2], lanes[3]);
+}
+
+// _mm_madd_epi16 leaves two partial sums per pixel, adds them up into [a0 + a1, a2 + a3, b0 + b1, b2 + b3]
+__m128i color_convert_pair_sums(__m128i a, __m128i b) {
+    __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(3, 1, 3, 1));
+    return _mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd));
+}
+
+u32 color_convert_luma_sse2(const u8 *row, u32 width, __m128i weights, u8 *out) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi32(128);
+
+    u32 count = width & ~3u;
+    for (u32 x = 0; x < count; x += 4) {
+        __m128i pixels = _mm_loadu_si128((const __m128i *) &row[x * 4]);
+        __m128i low = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), weights);
+        __m128i high = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), weights);
+        __m128i luma = _mm_srai_epi32(_mm_add_epi32(color_convert_pair_sums(low, high), rounding), 8);
+
+        luma = _mm_packs_epi32(luma, luma);
+        luma = _mm_packus_epi16(luma, luma);
+        i32 packed = _mm_cvtsi128_si32(luma);
+        memcpy(&out[x], &packed, sizeof(packed));
+    }
+    return count;
+}
+
+// Two chroma samples per four pixels, returns the number of chroma samples written
+u32 color_convert_chroma_sse2(const u8 *row0, const u8 *row1, u32 width, __m128i weights_u, __m128i weights_v,
+                              u8 *out_u, u8 *out_v) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi32(256);
+    const __m128i offset = _mm_set1_epi32(128);
+
+    u32 count = width & ~3u;
+    for (u32 x = 0; x < count; x += 4) {
+        __m128i rows = _mm_avg_epu8(_mm_loadu_si128((const __m128i *) &row0[x * 4]),
+                                    _mm_loadu_si128((const __m128i *) &row1[x * 4]));
+        __m128i low = _mm_unpacklo_epi8(rows, zero);
+        __m128i high = _mm_unpackhi_epi8(rows, zero);
+        // Neighbouring pixels summed: [p0 + p1, p2 + p3]
+        __m128i pairs = _mm_unpacklo_epi64(_mm_add_epi16(low, _mm_srli_si128(low, 8)),
+                                           _mm_add_epi16(high, _mm_srli_si128(high, 8)));
+
+        __m128i sums = color_convert_pair_sums(_mm_madd_epi16(pairs, weights_u), _mm_madd_epi16(pairs, weights_v));
+        __m128i chroma = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(sums, rounding), 9), offset);
+
+        chroma = _mm_packs_epi32(chroma, chroma);
+        chroma = _mm_packus_epi16(chroma, chroma);
+        u32 packed = (u32) _mm_cvtsi128_si32(chroma);
+        out_u[x / 2] = (u8) packed;
+        out_u[x / 2 + 1] = (u8) (packed >> 8);
+        out_v[x / 2] = (u8) (packed >> 16);
+        out_v[x / 2 + 1] = (u8) (packed >> 24);
+    }
+    return count / 2;
+}
+#endif
+
+void color_convert_yuv420(const u8 *pixels, u32 width, u32 height, u32 stride, bool bgra, u8 *y, u8 *u, u8 *v) {
+    u32 red = bgra ? 2 : 0;
+    u32 blue = bgra ? 0 : 2;
+    u32 chroma_width = COLOR_CONVERT_CHROMA_SIZE(width);
+
+#ifdef COLOR_CONVERT_SSE2
+    __m128i weights_y = color_convert_weights(color_convert_y, red, blue);
+    __m128i weights_u = color_convert_weights(color_convert_u, red, blue);
+    __m128i weights_v = color_convert_weights(color_convert_v, red, blue);
+#endif
+
+    for (u32 row = 0; row < height; row += 2) {
+        const u8 *row0 = &pixels[(size_t) row * stride];
+        const u8 *row1 = row + 1 < height ? row0 + stride : row0;
+        u8 *out_u = &u[(size_t) (row / 2) * chroma_width];
+        u8 *out_v = &v[(size_t) (row / 2) * chroma_width];
+
+        u32 luma0 = 0;
+        u32 luma1 = 0;
+        u32 chroma = 0;
+#ifdef COLOR_CONVERT_SSE2
+        luma0 = color_convert_luma_sse2(row0, width, weights_y, &y[(size_t) row * width]);
+        if (row + 1 < height) {
+            luma1 = color_convert_luma_sse2(row1, width, weights_y, &y[(size_t) (row + 1) * width]);
+        }
+        chroma = color_convert_chroma_sse2(row0, row1, width, weights_u, weights_v, out_u, out_v);
+#endif
+        color_convert_luma_scalar(row0, luma0, width, red, blue, &y[(size_t) row * width]);
+        if (row + 1 < height) {
+            color_convert_luma_scalar(row1, luma1, width, red, blue, &y[(size_t) (row + 1) * width]);
+        }
+        color_convert_chroma_scalar(row0, row1, chroma, width, red, blue, out_u, out_v);
+    }
+}
+
+void color_convert_swap_red_blue(const u8 *pixels, u32 count, u8 *out) {
+    u32 done = 0;
+#ifdef COLOR_CONVERT_SSE2
+    const __m128i red_blue_mask = _mm_set1_epi32(0x00FF00FF);
+    done = count & ~3u;
+    for (u32 i = 0; i < done; i += 4) {
+        __m128i source = _mm_loadu_si128((const __m128i *) &pixels[i * 4]);
+        __m128i red_blue = _mm_and_si128(source, red_blue_mask);
+        __m128i swapped = _mm_or_si128(_mm_slli_epi32(red_blue, 16), _mm_srli_epi32(red_blue, 16));
+        _mm_storeu_si128((__m128i *) &out[i * 4], _mm_or_si128(_mm_andnot_si128(red_blue_mask, source), swapped));
+    }
+#endif
+    for (u32 i = done; i < count; ++i) {
+        u8 red = pixels[i * 4];
+        out[i * 4] = pixels[i * 4 + 2];
+        out[i * 4 + 1] = pixels[i * 4 + 1];
+        out[i * 4 + 2] = red;
+        out[i * 4 + 3] = pixels[i * 4 + 3];
+    }
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <std/defines.h>
+
+// Chroma planes of color_convert_yuv420 are this much smaller on each axis, rounded up
+#define COLOR_CONVERT_CHROMA_SIZE(size) (((size) + 1) / 2)
+
+// 8 bit RGBA, or BGRA when bgra is set, to full range BT.601 4:2:0 planes as y4m's C420jpeg expects. stride is in
+// bytes, alpha is ignored and odd sizes repeat the last row or column into the chroma samples.
+void color_convert_yuv420(const u8 *pixels, u32 width, u32 height, u32 stride, bool bgra, u8 *y, u8 *u, u8 *v);
+
+// Swaps the red and blue channels of count pixels, turning BGRA into RGBA and back
+void color_convert_swap_red_blue(const u8 *pixels, u32 count, u8 *out);
@@ -0,0 +1,223 @@
+#include "cull.h"
+#include "job.h"
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CULL_X86
+#endif
+
+typedef u32 (*CullRangeFunction)(const CullFrustum *frustum, const CullBounds *bounds, CullShape shape, u32 first,
+                                 u32 count, u32 *out_visible);
+
+static CullRangeFunction cull_range_function = NULL;
+static atomic_int cull_init_state = 0;
+
+#ifdef CULL_X86
+// Lane permutation moving the set lanes of each 8 bit mask to the front
+static u32 cull_compact_table[256][8];
+#endif
+
+void cull_frustum_extract(const float *view_projection, CullFrustum *out) {
+    // Planes from the rows of the column major matrix, with a 0..1 depth range for the near plane
+    const float *m = view_projection;
+    for (u32 i = 0; i < 3; ++i) {
+        for (u32 side = 0; side < 2; ++side) {
+            float *plane = out->planes[i * 2 + side];
+            float sign = side == 0 ? 1.0f : -1.0f;
+            for (u32 column = 0; column < 4; ++column) {
+                float row = m[column * 4 + i];
+                if (i == 2 && side == 0) {
+                    plane[column] = row;
+                } else {
+                    plane[column] = m[column * 4 + 3] + sign * row;
+                }
+            }
+
+            float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+            if (length > 0.0f) {
+                for (u32 component = 0; component < 4; ++component) {
+                    plane[component] /= length;
+                }
+            }
+        }
+    }
+}
+
+// Branchless: every index is written and the cursor only advances past visible ones
+u32 cull_range_scalar(const CullFrustum *frustum, const CullBounds *bounds, CullShape shape, u32 first, u32 count,
+                      u32 *out_visible) {
+    u32 visible = 0;
+    for (u32 i = first; i < first + count; ++i) {
+        float x = bounds->center[0][i], y = bounds->center[1][i], z = bounds->center[2][i];
+        bool inside = true;
+        for (u32 p = 0; p < 6; ++p) {
+            const float *plane = frustum->planes[p];
+            float distance = plane[0] * x + plane[1] * y + plane[2] * z + plane[3];
+            if (shape == CULL_SHAPE_SPHERE) {
+                distance += bounds->radius[i];
+            } else {
+                // Distance of the box corner furthest along the plane normal
+                distance += fabsf(plane[0]) * bounds->extent[0][i] + fabsf(plane[1]) * bounds->extent[1][i] +
+                            fabsf(plane[2]) * bounds->extent[2][i];
+            }
+            inside &= distance >= 0.0f;
+        }
+
+        out_visible[visible] = i;
+        visible += inside;
+    }
+    return visible;
+}
+
+#ifdef CULL_X86
+// Eight objects per iteration, visible indices are packed with one permute and stored unconditionally
+__attribute__((target("avx2,fma,popcnt")))
+u32 cull_range_avx2(const CullFrustum *frustum, const CullBounds *bounds, CullShape shape, u32 first, u32 count,
+                    u32 *out_visible) {
+    __m256 planes[6][4];
+    __m256 abs_normals[6][3];
+    for (u32 p = 0; p < 6; ++p) {
+        for (u32 component = 0; component < 4; ++component) {
+            planes[p][component] = _mm256_set1_ps(frustum->planes[p][component]);
+        }
+        for (u32 component = 0; component < 3; ++component) {
+            abs_normals[p][component] = _mm256_set1_ps(fabsf(frustum->planes[p][component]));
+        }
+    }
+
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    u32 visible = 0;
+    u32 end = first + (count & ~7u);
+    for (u32 i = first; i < end; i += 8) {
+        __m256 x = _mm256_loadu_ps(&bounds->center[0][i]);
+        __m256 y = _mm256_loadu_ps(&bounds->center[1][i]);
+        __m256 z = _mm256_loadu_ps(&bounds->center[2][i]);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        if (shape == CULL_SHAPE_SPHERE) {
+            __m256 radius = _mm256_loadu_ps(&bounds->radius[i]);
+            for (u32 p = 0; p < 6; ++p) {
+                __m256 distance = _mm256_fmadd_ps(planes[p][2], z, _mm256_add_ps(planes[p][3], radius));
+                distance = _mm256_fmadd_ps(planes[p][1], y, distance);
+                distance = _mm256_fmadd_ps(planes[p][0], x, distance);
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+            }
+        } else {
+            __m256 ex = _mm256_loadu_ps(&bounds->extent[0][i]);
+            __m256 ey = _mm256_loadu_ps(&bounds->extent[1][i]);
+            __m256 ez = _mm256_loadu_ps(&bounds->extent[2][i]);
+            for (u32 p = 0; p < 6; ++p) {
+                __m256 distance = _mm256_fmadd_ps(planes[p][2], z, planes[p][3]);
+                distance = _mm256_fmadd_ps(planes[p][1], y, distance);
+                distance = _mm256_fmadd_ps(planes[p][0], x, distance);
+                distance = _mm256_fmadd_ps(abs_normals[p][0], ex, distance);
+                distance = _mm256_fmadd_ps(abs_normals[p][1], ey, distance);
+                distance = _mm256_fmadd_ps(abs_normals[p][2], ez, distance);
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+            }
+        }
+
+        // The store writes all eight lanes, which stays inside out_visible because visible <= i - first
+        u32 mask = (u32) _mm256_movemask_ps(inside);
+        __m256i indices = _mm256_add_epi32(_mm256_set1_epi32((i32) i), lanes);
+        __m256i permutation = _mm256_loadu_si256((const __m256i *) cull_compact_table[mask]);
+        _mm256_storeu_si256((__m256i *) &out_visible[visible], _mm256_permutevar8x32_epi32(indices, permutation));
+        visible += (u32) _mm_popcnt_u32(mask);
+    }
+
+    return visible + cull_range_scalar(frustum, bounds, shape, end, first + count - end, &out_visible[visible]);
+}
+#endif
+
+void cull_init() {
+    int expected = 0;
+    if (!atomic_compare_exchange_strong(&cull_init_state, &expected, 1)) {
+        // Another thread is filling the table
+        while (atomic_load(&cull_init_state) != 2) {
+        }
+        return;
+    }
+
+    cull_range_function = cull_range_scalar;
+#ifdef CULL_X86
+    for (u32 mask = 0; mask < 256; ++mask) {
+        u32 packed = 0;
+        for (u32 lane = 0; lane < 8; ++lane) {
+            if (mask & (1u << lane)) {
+                cull_compact_table[mask][packed++] = lane;
+            }
+        }
+        while (packed < 8) {
+            cull_compact_table[mask][packed++] = 0;
+        }
+    }
+
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("popcnt")) {
+        cull_range_function = cull_range_avx2;
+    }
+#endif
+    atomic_store(&cull_init_state, 2);
+}
+
+u32 cull_range(const CullFrustum *frustum, const CullBounds *bounds, CullShape shape, u32 first, u32 count,
+               u32 *out_visible) {
+    if (atomic_load(&cull_init_state) != 2) {
+        cull_init();
+    }
+    return cull_range_function(frustum, bounds, shape, first, count, out_visible);
+}
+
+// Each batch packs into its own slice of the output, culler_run closes the gaps afterwards
+void culler_batch(void *data, u32 first, u32 end) {
+    Culler *culler = data;
+    culler->chunk_counts[first / CULL_CHUNK_SIZE] = cull_range(culler->job_frustum, culler->job_bounds,
+                                                               culler->job_shape, first, end - first,
+                                                               &culler->job_visible[first]);
+}
+
+bool culler_create(Culler *out) {
+    Culler result = {0};
+    *out = result;
+    cull_init();
+    return true;
+}
+
+void culler_destroy(Culler *culler) {
+    free(culler->chunk_counts);
+    memset(culler, 0, sizeof(Culler));
+}
+
+u32 culler_run(Culler *culler, const CullFrustum *frustum, const CullBounds *bounds, CullShape shape,
+               u32 *out_visible) {
+    u32 chunk_count = (bounds->count + CULL_CHUNK_SIZE - 1) / CULL_CHUNK_SIZE;
+    if (job_system_worker_count() == 0 || chunk_count <= 1) {
+        return cull_range(frustum, bounds, shape, 0, bounds->count, out_visible);
+    }
+
+    if (chunk_count > culler->chunk_capacity) {
+        culler->chunk_counts = realloc(culler->chunk_counts, sizeof(u32) * chunk_count);
+        culler->chunk_capacity = chunk_count;
+    }
+
+    culler->job_frustum = frustum;
+    culler->job_bounds = bounds;
+    culler->job_shape = shape;
+    culler->job_visible = out_visible;
+    parallel_for(bounds->count, CULL_CHUNK_SIZE, culler_batch, culler);
+
+    u32 visible = culler->chunk_counts[0];
+    for (u32 chunk = 1; chunk < chunk_count; ++chunk) {
+        memmove(&out_visible[visible], &out_visible[chunk * CULL_CHUNK_SIZE],
+                sizeof(u32) * culler->chunk_counts[chunk]);
+        visible += culler->chunk_counts[chunk];
+    }
+    return visible;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <std/defines.h>
+
+// Objects per parallel_for batch, large enough that a batch outweighs handing it to another thread
+#define CULL_CHUNK_SIZE 16384
+
+typedef enum CullShape {
+    CULL_SHAPE_SPHERE,
+    CULL_SHAPE_BOX,
+} CullShape;
+
+// World space bounds as structure of arrays. Spheres use center and radius, boxes center and half extents.
+typedef struct CullBounds {
+    float *center[3];
+    float *radius;
+    float *extent[3];
+    u32 count;
+} CullBounds;
+
+// Normalized planes facing inwards: left, right, bottom, top, near, far
+typedef struct CullFrustum {
+    float planes[6][4];
+} CullFrustum;
+
+// Scratch for splitting culler_run across the job system
+typedef struct Culler {
+    const CullFrustum *job_frustum;
+    const CullBounds *job_bounds;
+    CullShape job_shape;
+    u32 *job_visible;
+    u32 *chunk_counts;
+    u32 chunk_capacity;
+} Culler;
+
+// Extracts the planes of a column major view projection with a 0..1 depth range
+void cull_frustum_extract(const float *view_projection, CullFrustum *out);
+
+// Writes the indices of visible objects in [first, first + count) to out_visible in order and returns how many
+// there are. out_visible needs room for count indices.
+u32 cull_range(const CullFrustum *frustum, const CullBounds *bounds, CullShape shape, u32 first, u32 count,
+               u32 *out_visible);
+
+// Same as cull_range, forced onto the portable path for comparisons
+u32 cull_range_scalar(const CullFrustum *frustum, const CullBounds *bounds, CullShape shape, u32 first, u32 count,
+                      u32 *out_visible);
+
+bool culler_create(Culler *out);
+
+void culler_destroy(Culler *culler);
+
+// Culls all bounds in batches across the job system, out_visible needs room for bounds->count indices and receives the visible ones in order
+u32 culler_run(Culler *culler, const CullFrustum *frustum, const CullBounds *bounds, CullShape shape,
+               u32 *out_visible);
@@ -1,9 +1,49 @@
 #include "input.h"
 
-bool handle_keyboard_event(SDL_KeyboardEvent *event, bool pressed) {
-    if (event->keysym.sym == SDLK_ESCAPE && pressed) {
+#include <stdatomic.h>
+
+// Lock-free ring for one pumping thread and one consuming thread, laid out like SpscQueue but holding events by value
+typedef struct InputQueue {
+    _Alignas(64) atomic_uint head;
+    _Alignas(64) atomic_uint tail;
+    u64 next_id;
+    InputEvent events[INPUT_QUEUE_CAPACITY];
+} InputQueue;
+
+static InputQueue input_queue = {0};
+
+bool input_push_keyboard(SDL_KeyboardEvent *event, bool pressed) {
+    u32 tail = atomic_load_explicit(&input_queue.tail, memory_order_relaxed);
+    u32 head = atomic_load_explicit(&input_queue.head, memory_order_acquire);
+    if (tail - head >= INPUT_QUEUE_CAPACITY) {
+        return false;
+    }
+
+    InputEvent *slot = &input_queue.events[tail % INPUT_QUEUE_CAPACITY];
+    slot->id = ++input_queue.next_id;
+    slot->timestamp = SDL_GetPerformanceCounter();
+    slot->key = event->keysym.sym;
+    slot->pressed = pressed;
+    atomic_store_explicit(&input_queue.tail, tail + 1, memory_order_release);
+    return true;
+}
+
+bool input_pop(InputEvent *out) {
+    u32 head = atomic_load_explicit(&input_queue.head, memory_order_relaxed);
+    u32 tail = atomic_load_explicit(&input_queue.tail, memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+
+    *out = input_queue.events[head % INPUT_QUEUE_CAPACITY];
+    atomic_store_explicit(&input_queue.head, head + 1, memory_order_release);
+    return true;
+}
+
+bool handle_keyboard_event(const InputEvent *event) {
+    if (event->key == SDLK_ESCAPE && event->pressed) {
         return true;
     }
 
     return false;
-}
\ No newline at end of file
+}
@@ -2,5 +2,24 @@
 
 #include <SDL.h>
 #include <stdbool.h>
+#include <std/defines.h>
 
-bool handle_keyboard_event(SDL_KeyboardEvent *event, bool pressed);
\ No newline at end of file
+// Events waiting between the SDL event pump and the frame that consumes them
+#define INPUT_QUEUE_CAPACITY 256
+
+typedef struct InputEvent {
+    // Increasing from 1, so the events a frame consumed are the range between its first and last id
+    u64 id;
+    // SDL_GetPerformanceCounter when the event was pumped
+    u64 timestamp;
+    SDL_Keycode key;
+    bool pressed;
+} InputEvent;
+
+// Producer side: timestamps the event and queues it, false when the queue is full and the event was dropped
+bool input_push_keyboard(SDL_KeyboardEvent *event, bool pressed);
+
+// Consumer side: the oldest queued event, false when there is none
+bool input_pop(InputEvent *out);
+
+bool handle_keyboard_event(const InputEvent *event);
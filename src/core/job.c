@@ -0,0 +1,395 @@
+#define _GNU_SOURCE
+#include "job.h"
+#include "log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define job_pause() _mm_pause()
+#else
+#define job_pause()
+#endif
+
+#define JOB_NO_THREAD 0xFFFFFFFFu
+// Failed searches before an idle worker goes to sleep
+#define JOB_SPIN_COUNT 1024
+
+typedef struct Job {
+    JobFunction function;
+    void *data;
+    JobCounter *counter;
+} Job;
+
+// Slots are atomics so a thief reading a job the owner is overwriting stays defined, the thief's CAS on top then fails
+typedef struct JobSlot {
+    _Atomic(JobFunction) function;
+    _Atomic(void *) data;
+    _Atomic(JobCounter *) counter;
+} JobSlot;
+
+// Chase-Lev deque: the owner pushes and pops at the bottom, other threads steal from the top
+typedef struct JobDeque {
+    _Alignas(64) _Atomic i64 top;
+    _Alignas(64) _Atomic i64 bottom;
+    JobSlot buffer[JOB_DEQUE_CAPACITY];
+} JobDeque;
+
+typedef struct JobWorker {
+    SDL_Thread *thread;
+    u32 index;
+} JobWorker;
+
+typedef struct JobSystem {
+    JobDeque *deques;
+    // Highest slot in use plus one, thieves look at every deque below it
+    atomic_uint thread_count;
+    // Slots taken by job_system_register_thread, freed again by job_system_unregister_thread
+    atomic_bool registered[JOB_MAX_THREADS];
+    JobWorker workers[JOB_MAX_THREADS];
+    u32 worker_count;
+
+    SDL_sem *wake;
+    atomic_uint sleeping;
+    atomic_bool running;
+} JobSystem;
+
+typedef struct ParallelFor {
+    ParallelForFunction function;
+    void *data;
+    u32 count;
+    u32 batch_size;
+    atomic_uint next;
+} ParallelFor;
+
+static JobSystem job_system = {0};
+static _Thread_local u32 job_thread_index = JOB_NO_THREAD;
+
+void job_slot_write(JobSlot *slot, const Job *job) {
+    atomic_store_explicit(&slot->function, job->function, memory_order_relaxed);
+    atomic_store_explicit(&slot->data, job->data, memory_order_relaxed);
+    atomic_store_explicit(&slot->counter, job->counter, memory_order_relaxed);
+}
+
+void job_slot_read(JobSlot *slot, Job *out) {
+    out->function = atomic_load_explicit(&slot->function, memory_order_relaxed);
+    out->data = atomic_load_explicit(&slot->data, memory_order_relaxed);
+    out->counter = atomic_load_explicit(&slot->counter, memory_order_relaxed);
+}
+
+bool job_deque_push(JobDeque *deque, const Job *job) {
+    i64 bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    i64 top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (bottom - top >= JOB_DEQUE_CAPACITY) {
+        return false;
+    }
+
+    job_slot_write(&deque->buffer[bottom & (JOB_DEQUE_CAPACITY - 1)], job);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+    return true;
+}
+
+bool job_deque_pop(JobDeque *deque, Job *out) {
+    i64 bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    i64 top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom) {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return false;
+    }
+
+    job_slot_read(&deque->buffer[bottom & (JOB_DEQUE_CAPACITY - 1)], out);
+    if (top == bottom) {
+        // Last job, race the thieves for it
+        bool won = atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst,
+                                                           memory_order_relaxed);
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return won;
+    }
+    return true;
+}
+
+bool job_deque_steal(JobDeque *deque, Job *out) {
+    i64 top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    i64 bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (top >= bottom) {
+        return false;
+    }
+
+    job_slot_read(&deque->buffer[top & (JOB_DEQUE_CAPACITY - 1)], out);
+    return atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst,
+                                                   memory_order_relaxed);
+}
+
+// Own deque first, then every other thread starting with the next one
+bool job_find(u32 thread_index, Job *out) {
+    if (job_deque_pop(&job_system.deques[thread_index], out)) {
+        return true;
+    }
+
+    u32 thread_count = atomic_load(&job_system.thread_count);
+    for (u32 i = 1; i < thread_count; ++i) {
+        if (job_deque_steal(&job_system.deques[(thread_index + i) % thread_count], out)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void job_execute(const Job *job) {
+    job->function(job->data);
+    if (job->counter != NULL) {
+        atomic_fetch_sub_explicit(&job->counter->pending, 1, memory_order_release);
+    }
+}
+
+void job_pin_thread(u32 index) {
+#ifdef __linux__
+    int cpu_count = SDL_GetCPUCount();
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(index % cpu_count, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) != 0) {
+        LOG_ERROR("Failed to pin job worker %u to a core", index);
+    }
+#endif
+}
+
+int job_worker_main(void *data) {
+    JobWorker *worker = data;
+    job_thread_index = worker->index;
+    job_pin_thread(worker->index);
+
+    u32 spins = 0;
+    Job job;
+    while (atomic_load(&job_system.running)) {
+        if (job_find(worker->index, &job)) {
+            job_execute(&job);
+            spins = 0;
+            continue;
+        }
+
+        if (++spins < JOB_SPIN_COUNT) {
+            job_pause();
+            continue;
+        }
+
+        // Announce the sleep before the last look, job_run checks sleeping after its push so one side always sees
+        // the other
+        atomic_fetch_add(&job_system.sleeping, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        bool found = job_find(worker->index, &job);
+        if (!found && atomic_load(&job_system.running)) {
+            SDL_SemWait(job_system.wake);
+        }
+        atomic_fetch_sub(&job_system.sleeping, 1);
+
+        if (found) {
+            job_execute(&job);
+        }
+        spins = 0;
+    }
+
+    log_thread_release();
+    return 0;
+}
+
+bool job_system_init(u32 worker_count) {
+    if (atomic_load(&job_system.running)) {
+        LOG_ERROR("The job system is already running");
+        return false;
+    }
+
+    u32 max_workers = JOB_MAX_THREADS - 1 - JOB_RESERVED_THREADS;
+    worker_count = worker_count < max_workers ? worker_count : max_workers;
+    job_system.deques = aligned_alloc(_Alignof(JobDeque), sizeof(JobDeque) * JOB_MAX_THREADS);
+    job_system.wake = SDL_CreateSemaphore(0);
+    if (job_system.deques == NULL || job_system.wake == NULL) {
+        LOG_ERROR("Failed to create the job system");
+        job_system_shutdown();
+        return false;
+    }
+
+    memset(job_system.deques, 0, sizeof(JobDeque) * JOB_MAX_THREADS);
+    for (u32 i = 0; i < JOB_MAX_THREADS; ++i) {
+        atomic_store(&job_system.registered[i], false);
+    }
+    atomic_store(&job_system.thread_count, worker_count + 1);
+    atomic_store(&job_system.sleeping, 0);
+    atomic_store(&job_system.running, true);
+    job_thread_index = 0;
+
+    for (u32 i = 0; i < worker_count; ++i) {
+        JobWorker *worker = &job_system.workers[i];
+        worker->index = i + 1;
+        worker->thread = SDL_CreateThread(job_worker_main, "job_worker", worker);
+        if (worker->thread == NULL) {
+            LOG_ERROR("Failed to create job worker: %s", SDL_GetError());
+            job_system_shutdown();
+            return false;
+        }
+        job_system.worker_count++;
+    }
+
+    LOG_INFO("Job system started with %u workers", job_system.worker_count);
+    return true;
+}
+
+void job_system_shutdown() {
+    atomic_store(&job_system.running, false);
+    for (u32 i = 0; i < job_system.worker_count; ++i) {
+        SDL_SemPost(job_system.wake);
+    }
+    for (u32 i = 0; i < job_system.worker_count; ++i) {
+        SDL_WaitThread(job_system.workers[i].thread, NULL);
+    }
+
+    if (job_system.wake != NULL) {
+        SDL_DestroySemaphore(job_system.wake);
+    }
+    free(job_system.deques);
+    // Clears thread_count and the registered slots too, so the next init starts with every slot free
+    memset(&job_system, 0, sizeof(JobSystem));
+    job_thread_index = JOB_NO_THREAD;
+}
+
+bool job_system_register_thread() {
+    if (job_thread_index != JOB_NO_THREAD) {
+        return true;
+    }
+    if (!atomic_load(&job_system.running)) {
+        LOG_ERROR("The job system is not running");
+        return false;
+    }
+
+    // Slots past the workers, a slot freed by an exited thread is taken again before a new one is opened
+    u32 index = JOB_NO_THREAD;
+    for (u32 i = job_system.worker_count + 1; i < JOB_MAX_THREADS; ++i) {
+        bool expected = false;
+        if (atomic_compare_exchange_strong(&job_system.registered[i], &expected, true)) {
+            index = i;
+            break;
+        }
+    }
+    if (index == JOB_NO_THREAD) {
+        LOG_ERROR("No job system slot left for another thread");
+        return false;
+    }
+
+    u32 thread_count = atomic_load(&job_system.thread_count);
+    while (thread_count < index + 1 &&
+           !atomic_compare_exchange_weak(&job_system.thread_count, &thread_count, index + 1)) {
+    }
+
+    job_thread_index = index;
+    return true;
+}
+
+void job_system_unregister_thread() {
+    if (job_thread_index == JOB_NO_THREAD || job_thread_index == 0) {
+        return;
+    }
+
+    // Nobody pushes to the deque once its owner leaves, so it is drained here and thieves only find it empty
+    Job job;
+    while (atomic_load(&job_system.running) && job_deque_pop(&job_system.deques[job_thread_index], &job)) {
+        job_execute(&job);
+    }
+    atomic_store(&job_system.registered[job_thread_index], false);
+    job_thread_index = JOB_NO_THREAD;
+}
+
+u32 job_system_worker_count() {
+    return job_system.worker_count;
+}
+
+void job_run(JobFunction function, void *data, JobCounter *counter) {
+    if (!atomic_load(&job_system.running) || job_thread_index == JOB_NO_THREAD) {
+        function(data);
+        return;
+    }
+
+    Job job = {
+            .function = function,
+            .data = data,
+            .counter = counter
+    };
+    if (counter != NULL) {
+        atomic_fetch_add_explicit(&counter->pending, 1, memory_order_relaxed);
+    }
+
+    if (!job_deque_push(&job_system.deques[job_thread_index], &job)) {
+        job_execute(&job);
+        return;
+    }
+
+    // The push only releases bottom, the fence orders it before the load the same way the worker orders its side
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&job_system.sleeping) > 0) {
+        SDL_SemPost(job_system.wake);
+    }
+}
+
+void job_wait(JobCounter *counter) {
+    while (atomic_load_explicit(&counter->pending, memory_order_acquire) > 0) {
+        Job job;
+        bool found = job_thread_index != JOB_NO_THREAD && atomic_load(&job_system.running) &&
+                     job_find(job_thread_index, &job);
+        if (found) {
+            job_execute(&job);
+        } else {
+            job_pause();
+        }
+    }
+}
+
+// Every helper pulls batches until the range is exhausted, so uneven batches balance themselves
+void parallel_for_job(void *data) {
+    ParallelFor *range = data;
+    while (true) {
+        u32 first = atomic_fetch_add(&range->next, range->batch_size);
+        if (first >= range->count) {
+            break;
+        }
+
+        u32 end = range->count - first > range->batch_size ? first + range->batch_size : range->count;
+        range->function(range->data, first, end);
+    }
+}
+
+void parallel_for(u32 count, u32 batch_size, ParallelForFunction function, void *data) {
+    batch_size = batch_size == 0 ? 1 : batch_size;
+    u32 batch_count = (count + batch_size - 1) / batch_size;
+    if (batch_count <= 1 || job_system.worker_count == 0 || job_thread_index == JOB_NO_THREAD) {
+        if (count > 0) {
+            function(data, 0, count);
+        }
+        return;
+    }
+
+    ParallelFor range = {
+            .function = function,
+            .data = data,
+            .count = count,
+            .batch_size = batch_size
+    };
+    atomic_init(&range.next, 0);
+
+    JobCounter counter = {0};
+    u32 helpers = job_system.worker_count < batch_count - 1 ? job_system.worker_count : batch_count - 1;
+    for (u32 i = 0; i < helpers; ++i) {
+        job_run(parallel_for_job, &range, &counter);
+    }
+    parallel_for_job(&range);
+    job_wait(&counter);
+}
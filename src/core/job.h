@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <std/defines.h>
+
+// Pending jobs per thread, further jobs run inline until the deque drains
+#define JOB_DEQUE_CAPACITY 4096
+// Workers plus the main thread plus threads added with job_system_register_thread
+#define JOB_MAX_THREADS 32
+// Slots no worker takes, so the render thread and other registered threads find one on any core count
+#define JOB_RESERVED_THREADS 4
+
+typedef void (*JobFunction)(void *data);
+
+// Called with batches [first, end) of a parallel_for range
+typedef void (*ParallelForFunction)(void *data, u32 first, u32 end);
+
+// Counts unfinished jobs for fork/join, zero initialized before the first job_run
+typedef struct JobCounter {
+    atomic_uint pending;
+} JobCounter;
+
+// Starts worker_count threads pinned to their own cores, the calling thread becomes thread 0 and helps while waiting.
+// worker_count is capped so JOB_RESERVED_THREADS slots stay free.
+bool job_system_init(u32 worker_count);
+
+// Waits for the workers to finish their current job and stops them, queued jobs are dropped
+void job_system_shutdown();
+
+// Lets another long lived thread queue and wait for jobs, returns false when all thread slots are taken. Its jobs run
+// inline until then.
+bool job_system_register_thread();
+
+// Runs the calling thread's remaining queued jobs and frees its slot, call before a registered thread exits
+void job_system_unregister_thread();
+
+u32 job_system_worker_count();
+
+// Queues a job on the calling thread's deque, counter may be NULL. Jobs run inline when the system is not running or
+// the deque is full.
+void job_run(JobFunction function, void *data, JobCounter *counter);
+
+// Runs queued jobs until counter reaches zero
+void job_wait(JobCounter *counter);
+
+// Splits [0, count) into batches of batch_size and runs them across all threads, returns when every batch is done
+void parallel_for(u32 count, u32 batch_size, ParallelForFunction function, void *data);
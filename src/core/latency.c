@@ -0,0 +1,181 @@
+#include "latency.h"
+#include "log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define latency_pause() _mm_pause()
+#else
+#define latency_pause()
+#endif
+
+// Headroom for scheduling noise on top of the predicted frame time
+#define FRAME_PACER_MARGIN_US 1000
+// Sleeps are cut short by this much and the rest is spun, OS sleeps tend to overshoot by about a millisecond
+#define LATENCY_SPIN_US 1500
+
+int latency_compare(const void *a, const void *b) {
+    u64 x = *(const u64 *) a, y = *(const u64 *) b;
+    return x < y ? -1 : x > y;
+}
+
+double latency_ticks_to_ms(u64 ticks) {
+    return (double) ticks * 1000.0 / (double) SDL_GetPerformanceFrequency();
+}
+
+void latency_stats_init(const char *name, LatencyStats *out) {
+    LatencyStats result = {0};
+    result.name = name;
+    result.last_report = SDL_GetPerformanceCounter();
+    *out = result;
+}
+
+void latency_stats_add(LatencyStats *stats, u64 ticks) {
+    stats->samples[stats->next] = ticks;
+    stats->next = (stats->next + 1) % LATENCY_SAMPLE_COUNT;
+    if (stats->count < LATENCY_SAMPLE_COUNT) {
+        stats->count++;
+    }
+    if (ticks > stats->max) {
+        stats->max = ticks;
+    }
+}
+
+void latency_stats_report(LatencyStats *stats) {
+    u64 now = SDL_GetPerformanceCounter();
+    if (now - stats->last_report < LATENCY_REPORT_INTERVAL * SDL_GetPerformanceFrequency() || stats->count == 0) {
+        return;
+    }
+
+    u64 sorted[LATENCY_SAMPLE_COUNT];
+    memcpy(sorted, stats->samples, sizeof(u64) * stats->count);
+    qsort(sorted, stats->count, sizeof(u64), latency_compare);
+
+    u64 total = 0;
+    for (u32 i = 0; i < stats->count; ++i) {
+        total += sorted[i];
+    }
+
+    LOG_INFO("%s: avg %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms over %u frames", stats->name,
+             latency_ticks_to_ms(total / stats->count), latency_ticks_to_ms(sorted[stats->count / 2]),
+             latency_ticks_to_ms(sorted[(stats->count * 99) / 100]), latency_ticks_to_ms(stats->max), stats->count);
+
+    stats->count = 0;
+    stats->next = 0;
+    stats->max = 0;
+    stats->last_report = now;
+}
+
+// Follows increases quickly and decreases slowly, a frame that runs long is more expensive than one started early
+u64 frame_pacer_smooth(u64 average, u64 sample) {
+    if (average == 0) {
+        return sample;
+    }
+    if (sample > average) {
+        return average + (sample - average) / 2;
+    }
+    return average - (average - sample) / 16;
+}
+
+// Sleeps most of the way and spins the rest, SDL_Delay alone overshoots by up to a scheduler tick
+void latency_sleep_until(u64 deadline) {
+    u64 frequency = SDL_GetPerformanceFrequency();
+    u64 spin = LATENCY_SPIN_US * frequency / 1000000;
+    u64 now = SDL_GetPerformanceCounter();
+    if (deadline > now + spin) {
+        SDL_Delay((u32) ((deadline - now - spin) * 1000 / frequency));
+    }
+    while (SDL_GetPerformanceCounter() < deadline) {
+        latency_pause();
+    }
+}
+
+void frame_pacer_init(FramePacing mode, FramePacer *out) {
+    memset(out, 0, sizeof(FramePacer));
+    atomic_init(&out->mode, mode);
+    out->margin = FRAME_PACER_MARGIN_US * SDL_GetPerformanceFrequency() / 1000000;
+}
+
+void frame_pacer_set_mode(FramePacer *pacer, FramePacing mode) {
+    atomic_store(&pacer->mode, mode);
+}
+
+void frame_pacer_wait(FramePacer *pacer) {
+    u64 last_present = atomic_load(&pacer->last_present);
+    u64 interval = atomic_load(&pacer->present_interval);
+    if (atomic_load(&pacer->mode) == FRAME_PACING_JUST_IN_TIME && last_present != 0 && interval != 0) {
+        u64 work = pacer->build_time + atomic_load(&pacer->render_time) + atomic_load(&pacer->gpu_time) +
+                   pacer->margin;
+
+        // The first refresh the frame can still make if it started right now, then back off by the work
+        u64 now = SDL_GetPerformanceCounter();
+        u64 earliest = now + work;
+        u64 deadline = last_present + interval;
+        if (earliest > deadline) {
+            deadline += (earliest - deadline + interval - 1) / interval * interval;
+        }
+        latency_sleep_until(deadline - work);
+    }
+
+    pacer->build_start = SDL_GetPerformanceCounter();
+}
+
+void frame_pacer_build_done(FramePacer *pacer) {
+    if (pacer->build_start != 0) {
+        pacer->build_time = frame_pacer_smooth(pacer->build_time, SDL_GetPerformanceCounter() - pacer->build_start);
+    }
+}
+
+void frame_pacer_presented(FramePacer *pacer, u64 timestamp) {
+    u64 last_present = atomic_load(&pacer->last_present);
+    atomic_store(&pacer->last_present, timestamp);
+    if (last_present == 0 || timestamp <= last_present) {
+        return;
+    }
+
+    // Missed refreshes would stretch the interval, only back to back presents measure it
+    u64 sample = timestamp - last_present;
+    u64 interval = atomic_load(&pacer->present_interval);
+    if (interval == 0 || sample < interval + interval / 2) {
+        atomic_store(&pacer->present_interval, interval == 0 ? sample : interval + ((i64) sample - (i64) interval) / 16);
+    }
+}
+
+void frame_pacer_render_time(FramePacer *pacer, u64 ticks) {
+    atomic_store(&pacer->render_time, frame_pacer_smooth(atomic_load(&pacer->render_time), ticks));
+}
+
+void frame_pacer_gpu_time(FramePacer *pacer, u64 ticks) {
+    atomic_store(&pacer->gpu_time, frame_pacer_smooth(atomic_load(&pacer->gpu_time), ticks));
+}
+
+void frame_limiter_init(FrameLimiter *out) {
+    memset(out, 0, sizeof(FrameLimiter));
+    latency_stats_init("Frame limiter jitter", &out->jitter);
+}
+
+void frame_limiter_set_fps(FrameLimiter *limiter, u32 fps) {
+    limiter->interval = fps != 0 ? SDL_GetPerformanceFrequency() / fps : 0;
+    limiter->next = 0;
+}
+
+void frame_limiter_wait(FrameLimiter *limiter) {
+    if (limiter->interval == 0) {
+        return;
+    }
+
+    u64 now = SDL_GetPerformanceCounter();
+    if (limiter->next == 0 || now > limiter->next + limiter->interval) {
+        // First frame, or a frame so late that catching up would run several uncapped
+        limiter->next = now + limiter->interval;
+        return;
+    }
+
+    latency_sleep_until(limiter->next);
+    latency_stats_add(&limiter->jitter, SDL_GetPerformanceCounter() - limiter->next);
+    latency_stats_report(&limiter->jitter);
+    limiter->next += limiter->interval;
+}
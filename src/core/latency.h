@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <std/defines.h>
+
+// Samples kept for the percentiles of one report
+#define LATENCY_SAMPLE_COUNT 256
+// Seconds between two latency reports
+#define LATENCY_REPORT_INTERVAL 2
+
+// Rolling window of durations in SDL_GetPerformanceCounter ticks
+typedef struct LatencyStats {
+    const char *name;
+    u64 samples[LATENCY_SAMPLE_COUNT];
+    u32 count;
+    u32 next;
+    u64 max;
+    u64 last_report;
+} LatencyStats;
+
+typedef enum FramePacing {
+    // Start the next frame as soon as a packet is free, keeps the GPU fed at the cost of queued frames
+    FRAME_PACING_THROUGHPUT,
+    // Delay the start of the next frame until just enough time is left to make the next present
+    FRAME_PACING_JUST_IN_TIME,
+} FramePacing;
+
+// Predicts when the main thread has to start a frame. The render thread feeds in presents and render times, the main
+// thread waits on it. All times are SDL_GetPerformanceCounter ticks.
+typedef struct FramePacer {
+    atomic_int mode;
+
+    // Written by the render thread
+    atomic_ullong last_present;
+    atomic_ullong present_interval;
+    atomic_ullong render_time;
+    atomic_ullong gpu_time;
+
+    // Main thread only
+    u64 build_start;
+    u64 build_time;
+    u64 margin;
+} FramePacer;
+
+// Caps the frame rate with a sleep followed by a spin for the last stretch
+typedef struct FrameLimiter {
+    // Ticks per frame, 0 when uncapped
+    u64 interval;
+    u64 next;
+    // How late each wake up was compared to its slot
+    LatencyStats jitter;
+} FrameLimiter;
+
+void latency_stats_init(const char *name, LatencyStats *out);
+
+void latency_stats_add(LatencyStats *stats, u64 ticks);
+
+// Logs average, median, 99th percentile and maximum once per LATENCY_REPORT_INTERVAL and starts a new window
+void latency_stats_report(LatencyStats *stats);
+
+double latency_ticks_to_ms(u64 ticks);
+
+// Returns at deadline, a SDL_GetPerformanceCounter timestamp, within the spin loop's precision
+void latency_sleep_until(u64 deadline);
+
+void frame_pacer_init(FramePacing mode, FramePacer *out);
+
+void frame_pacer_set_mode(FramePacer *pacer, FramePacing mode);
+
+// Main thread, before sampling input: in FRAME_PACING_JUST_IN_TIME sleeps until the latest start that still makes the
+// next present
+void frame_pacer_wait(FramePacer *pacer);
+
+// Main thread, once the frame is built and about to be submitted
+void frame_pacer_build_done(FramePacer *pacer);
+
+// Render thread: a frame became visible at timestamp
+void frame_pacer_presented(FramePacer *pacer, u64 timestamp);
+
+// Render thread: time spent recording and submitting one frame
+void frame_pacer_render_time(FramePacer *pacer, u64 ticks);
+
+// Render thread: time the GPU spent on one frame
+void frame_pacer_gpu_time(FramePacer *pacer, u64 ticks);
+
+void frame_limiter_init(FrameLimiter *out);
+
+// 0 removes the cap
+void frame_limiter_set_fps(FrameLimiter *limiter, u32 fps);
+
+// Waits for the next frame slot and records the wake up jitter
+void frame_limiter_wait(FrameLimiter *limiter);
@@ -0,0 +1,102 @@
+#include "lod.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LOD_SSE2
+#endif
+
+// Distances closer than this are clamped so objects around the camera always get full detail
+#define LOD_MIN_DISTANCE 1e-4f
+
+void lod_view_init(LodView *view, const float *camera, float fov_y, float viewport_height, float threshold) {
+    memcpy(view->camera, camera, sizeof(view->camera));
+    view->projection_scale = viewport_height / (2.0f * tanf(fov_y * 0.5f));
+    view->threshold = threshold;
+}
+
+void lod_stats_reset(LodStats *stats) {
+    memset(stats, 0, sizeof(LodStats));
+}
+
+// An object uses level i when error_i * scale * projection_scale / distance <= threshold, so each level only needs
+// one multiply and compare against the distance: level = number of levels with error_i * factor <= distance
+u32 lod_select_scalar(const LodView *view, const float *thresholds, u32 level_count, const LodObjects *objects,
+                      u32 first, u8 *out_levels) {
+    for (u32 i = first; i < objects->count; ++i) {
+        float dx = objects->x[i] - view->camera[0];
+        float dy = objects->y[i] - view->camera[1];
+        float dz = objects->z[i] - view->camera[2];
+        float distance = fmaxf(sqrtf(dx * dx + dy * dy + dz * dz) - objects->radius[i], LOD_MIN_DISTANCE);
+
+        u8 level = 0;
+        for (u32 l = 1; l < level_count; ++l) {
+            level += thresholds[l] * objects->scale[i] <= distance;
+        }
+        out_levels[i] = level;
+    }
+    return objects->count;
+}
+
+#ifdef LOD_SSE2
+u32 lod_select_sse2(const LodView *view, const float *thresholds, u32 level_count, const LodObjects *objects,
+                    u8 *out_levels) {
+    const __m128 camera_x = _mm_set1_ps(view->camera[0]);
+    const __m128 camera_y = _mm_set1_ps(view->camera[1]);
+    const __m128 camera_z = _mm_set1_ps(view->camera[2]);
+    const __m128 min_distance = _mm_set1_ps(LOD_MIN_DISTANCE);
+
+    u32 count = objects->count & ~3u;
+    for (u32 i = 0; i < count; i += 4) {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(&objects->x[i]), camera_x);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(&objects->y[i]), camera_y);
+        __m128 dz = _mm_sub_ps(_mm_loadu_ps(&objects->z[i]), camera_z);
+        __m128 length_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        __m128 distance = _mm_sub_ps(_mm_sqrt_ps(length_squared), _mm_loadu_ps(&objects->radius[i]));
+        distance = _mm_max_ps(distance, min_distance);
+
+        __m128 scale = _mm_loadu_ps(&objects->scale[i]);
+        // Compare masks are all ones, subtracting them counts the passing levels
+        __m128i level = _mm_setzero_si128();
+        for (u32 l = 1; l < level_count; ++l) {
+            __m128 error = _mm_mul_ps(_mm_set1_ps(thresholds[l]), scale);
+            level = _mm_sub_epi32(level, _mm_castps_si128(_mm_cmple_ps(error, distance)));
+        }
+
+        level = _mm_packs_epi32(level, level);
+        level = _mm_packus_epi16(level, level);
+        i32 packed = _mm_cvtsi128_si32(level);
+        memcpy(&out_levels[i], &packed, sizeof(packed));
+    }
+    return count;
+}
+#endif
+
+void lod_select(const LodView *view, const float *level_errors, const u32 *level_triangles, u32 level_count,
+                const LodObjects *objects, u8 *out_levels, LodStats *stats) {
+    level_count = level_count > LOD_MAX_LEVELS ? LOD_MAX_LEVELS : level_count;
+
+    // Per level distance factors, forced non-decreasing so the level count stays a valid index
+    float thresholds[LOD_MAX_LEVELS] = {0};
+    float factor = view->projection_scale / view->threshold;
+    for (u32 l = 1; l < level_count; ++l) {
+        thresholds[l] = fmaxf(level_errors[l] * factor, thresholds[l - 1]);
+    }
+
+    u32 done = 0;
+#ifdef LOD_SSE2
+    done = lod_select_sse2(view, thresholds, level_count, objects, out_levels);
+#endif
+    lod_select_scalar(view, thresholds, level_count, objects, done, out_levels);
+
+    if (stats != NULL) {
+        stats->objects += objects->count;
+        for (u32 i = 0; i < objects->count; ++i) {
+            stats->levels[out_levels[i]]++;
+            stats->triangles_submitted += level_triangles[out_levels[i]];
+        }
+        stats->triangles_full += (u64) level_triangles[0] * objects->count;
+    }
+}
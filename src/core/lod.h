@@ -0,0 +1,39 @@
+#pragma once
+
+#include <std/defines.h>
+
+#define LOD_MAX_LEVELS 8
+
+typedef struct LodView {
+    float camera[3];
+    // viewport_height / (2 * tan(fov_y / 2)): pixels covered by one unit at distance one
+    float projection_scale;
+    // Largest acceptable screen space error in pixels
+    float threshold;
+} LodView;
+
+// Instances of one mesh as structure of arrays, positions are the world space bounds centers
+typedef struct LodObjects {
+    const float *x;
+    const float *y;
+    const float *z;
+    const float *radius;
+    const float *scale;
+    u32 count;
+} LodObjects;
+
+typedef struct LodStats {
+    u64 objects;
+    u64 triangles_submitted;
+    u64 triangles_full;
+    u64 levels[LOD_MAX_LEVELS];
+} LodStats;
+
+void lod_view_init(LodView *view, const float *camera, float fov_y, float viewport_height, float threshold);
+
+// Picks the coarsest level whose object space error projects to at most view->threshold pixels for every object.
+// level_errors and level_triangles describe the mesh, level_errors[0] is full detail.
+void lod_select(const LodView *view, const float *level_errors, const u32 *level_triangles, u32 level_count,
+                const LodObjects *objects, u8 *out_levels, LodStats *stats);
+
+void lod_stats_reset(LodStats *stats);
@@ -0,0 +1,636 @@
+#include "log.h"
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+
+// Longest line the writer produces, the rest of a line is cut off
+#define LOG_LINE_SIZE 1024
+// Longest single conversion, with '*' replaced by the width or precision it stands for
+#define LOG_SPEC_SIZE 48
+
+typedef enum LogSlotState {
+    LOG_SLOT_FREE,
+    LOG_SLOT_CLAIMED,
+    LOG_SLOT_OWNED,
+    // The owning thread exited, the ring is handed out again once the writer emptied it
+    LOG_SLOT_RELEASED,
+} LogSlotState;
+
+// What a conversion takes from the argument list, signedness doesn't matter for storing it
+typedef enum LogArgument {
+    LOG_ARGUMENT_NONE,
+    LOG_ARGUMENT_INT,
+    LOG_ARGUMENT_LONG,
+    LOG_ARGUMENT_LONG_LONG,
+    LOG_ARGUMENT_SIZE,
+    LOG_ARGUMENT_INTMAX,
+    LOG_ARGUMENT_PTRDIFF,
+    LOG_ARGUMENT_DOUBLE,
+    LOG_ARGUMENT_LONG_DOUBLE,
+    LOG_ARGUMENT_STRING,
+    LOG_ARGUMENT_POINTER,
+} LogArgument;
+
+// One conversion in a format string, from the % up to and including the conversion character
+typedef struct LogSpec {
+    const char *start;
+    u32 length;
+    LogArgument argument;
+    // Widths and precisions given as '*', each takes an int before the value
+    u32 stars;
+} LogSpec;
+
+typedef struct LogBackend {
+    LogRing *rings;
+    atomic_int states[LOG_MAX_THREADS];
+    SDL_Thread *writer;
+    SDL_sem *wake;
+    atomic_bool running;
+    // Bumped by every init, so threads drop rings they kept from an earlier one
+    atomic_uint generation;
+    bool exit_handler;
+} LogBackend;
+
+static LogBackend log_backend = {0};
+static atomic_int log_level = LOG_LEVEL_INFO;
+static _Thread_local LogRing *log_thread_ring = NULL;
+static _Thread_local u32 log_thread_slot = LOG_MAX_THREADS;
+static _Thread_local u32 log_thread_generation = 0;
+
+const char *log_level_name(LogLevel level) {
+    switch (level) {
+        case LOG_LEVEL_ERROR:
+            return "ERROR";
+        case LOG_LEVEL_WARN:
+            return "WARN";
+        case LOG_LEVEL_INFO:
+            return "INFO";
+        case LOG_LEVEL_DEBUG:
+            return "DEBUG";
+        case LOG_LEVEL_TRACE:
+            return "TRACE";
+        default:
+            return "?";
+    }
+}
+
+bool log_level_parse(const char *name, LogLevel *out) {
+    const char *names[] = {"error", "warn", "info", "debug", "trace"};
+    for (u32 i = 0; i < LOG_LEVEL_MAX; ++i) {
+        if (strcmp(name, names[i]) == 0) {
+            *out = (LogLevel) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void log_set_level(LogLevel level) {
+    atomic_store_explicit(&log_level, (int) level, memory_order_relaxed);
+}
+
+bool log_enabled(LogLevel level) {
+    return (int) level <= atomic_load_explicit(&log_level, memory_order_relaxed);
+}
+
+// Finds the next conversion in format, false when there is none
+bool log_next_spec(const char *format, LogSpec *out) {
+    const char *start = strchr(format, '%');
+    if (start == NULL) {
+        return false;
+    }
+
+    LogSpec result = {.start = start, .argument = LOG_ARGUMENT_NONE};
+    const char *c = start + 1;
+    while (*c != '\0' && strchr("-+ #0'", *c) != NULL) {
+        c++;
+    }
+    if (*c == '*') {
+        result.stars++;
+        c++;
+    }
+    while (*c >= '0' && *c <= '9') {
+        c++;
+    }
+    if (*c == '.') {
+        c++;
+        if (*c == '*') {
+            result.stars++;
+            c++;
+        }
+        while (*c >= '0' && *c <= '9') {
+            c++;
+        }
+    }
+
+    u32 longs = 0;
+    char modifier = '\0';
+    while (*c != '\0' && strchr("hlzjtL", *c) != NULL) {
+        if (*c == 'l') {
+            longs++;
+        } else {
+            modifier = *c;
+        }
+        c++;
+    }
+
+    switch (*c) {
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+        case 'c':
+            if (modifier == 'z') {
+                result.argument = LOG_ARGUMENT_SIZE;
+            } else if (modifier == 'j') {
+                result.argument = LOG_ARGUMENT_INTMAX;
+            } else if (modifier == 't') {
+                result.argument = LOG_ARGUMENT_PTRDIFF;
+            } else if (longs >= 2) {
+                result.argument = LOG_ARGUMENT_LONG_LONG;
+            } else if (longs == 1) {
+                result.argument = LOG_ARGUMENT_LONG;
+            } else {
+                result.argument = LOG_ARGUMENT_INT;
+            }
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            result.argument = modifier == 'L' ? LOG_ARGUMENT_LONG_DOUBLE : LOG_ARGUMENT_DOUBLE;
+            break;
+        case 's':
+            result.argument = LOG_ARGUMENT_STRING;
+            break;
+        case 'p':
+        case 'n':
+            result.argument = LOG_ARGUMENT_POINTER;
+            break;
+        default:
+            break;
+    }
+
+    result.length = (u32) (c - start) + (*c != '\0' ? 1 : 0);
+    *out = result;
+    return true;
+}
+
+bool log_pack_bytes(LogRecord *record, const void *value, size_t size) {
+    if (record->size + size > LOG_RECORD_ARGS) {
+        return false;
+    }
+    memcpy(record->args + record->size, value, size);
+    record->size += (u16) size;
+    return true;
+}
+
+// Strings are copied with their terminator, as much as still fits
+bool log_pack_string(LogRecord *record, const char *string) {
+    size_t space = LOG_RECORD_ARGS - record->size;
+    if (space == 0) {
+        return false;
+    }
+
+    string = string != NULL ? string : "(null)";
+    size_t length = strlen(string);
+    length = length < space - 1 ? length : space - 1;
+    memcpy(record->args + record->size, string, length);
+    record->args[record->size + length] = '\0';
+    record->size += (u16) (length + 1);
+    return true;
+}
+
+bool log_pack_argument(LogRecord *record, LogArgument argument, va_list *args) {
+    switch (argument) {
+        case LOG_ARGUMENT_INT: {
+            int value = va_arg(*args, int);
+            return log_pack_bytes(record, &value, sizeof(value));
+        }
+        case LOG_ARGUMENT_LONG: {
+            long value = va_arg(*args, long);
+            return log_pack_bytes(record, &value, sizeof(value));
+        }
+        case LOG_ARGUMENT_LONG_LONG: {
+            long long value = va_arg(*args, long long);
+            return log_pack_bytes(record, &value, sizeof(value));
+        }
+        case LOG_ARGUMENT_SIZE: {
+            size_t value = va_arg(*args, size_t);
+            return log_pack_bytes(record, &value, sizeof(value));
+        }
+        case LOG_ARGUMENT_INTMAX: {
+            intmax_t value = va_arg(*args, intmax_t);
+            return log_pack_bytes(record, &value, sizeof(value));
+        }
+        case LOG_ARGUMENT_PTRDIFF: {
+            ptrdiff_t value = va_arg(*args, ptrdiff_t);
+            return log_pack_bytes(record, &value, sizeof(value));
+        }
+        case LOG_ARGUMENT_DOUBLE: {
+            double value = va_arg(*args, double);
+            return log_pack_bytes(record, &value, sizeof(value));
+        }
+        case LOG_ARGUMENT_LONG_DOUBLE: {
+            long double value = va_arg(*args, long double);
+            return log_pack_bytes(record, &value, sizeof(value));
+        }
+        case LOG_ARGUMENT_STRING:
+            return log_pack_string(record, va_arg(*args, const char *));
+        case LOG_ARGUMENT_POINTER: {
+            void *value = va_arg(*args, void *);
+            return log_pack_bytes(record, &value, sizeof(value));
+        }
+        default:
+            return true;
+    }
+}
+
+// Walks the format the same way the writer will, copying each argument as the conversion reads it
+void log_pack(LogRecord *record, const char *format, va_list *args) {
+    LogSpec spec;
+    const char *cursor = format;
+    while (log_next_spec(cursor, &spec)) {
+        cursor = spec.start + spec.length;
+        if (spec.argument == LOG_ARGUMENT_NONE) {
+            continue;
+        }
+        for (u32 i = 0; i < spec.stars; ++i) {
+            int value = va_arg(*args, int);
+            if (!log_pack_bytes(record, &value, sizeof(value))) {
+                record->truncated = true;
+                return;
+            }
+        }
+        if (!log_pack_argument(record, spec.argument, args)) {
+            record->truncated = true;
+            return;
+        }
+    }
+}
+
+void log_append(char *line, size_t capacity, size_t *length, const char *text, size_t count) {
+    size_t space = capacity - 1 - *length;
+    count = count < space ? count : space;
+    memcpy(line + *length, text, count);
+    *length += count;
+    line[*length] = '\0';
+}
+
+void log_append_written(size_t capacity, size_t *length, int written) {
+    if (written > 0) {
+        *length += (size_t) written;
+        *length = *length < capacity - 1 ? *length : capacity - 1;
+    }
+}
+
+// Reads the next packed value, false when it was left out of the record
+bool log_unpack(const LogRecord *record, u32 *offset, void *out, size_t size) {
+    if (*offset + size > record->size) {
+        return false;
+    }
+    memcpy(out, record->args + *offset, size);
+    *offset += (u32) size;
+    return true;
+}
+
+// Formats one value with the conversion text, the '*' already replaced
+bool log_format_argument(const LogRecord *record, u32 *offset, LogArgument argument, const char *spec, char *line,
+                         size_t capacity, size_t *length) {
+    char *out = line + *length;
+    size_t space = capacity - *length;
+    int written = 0;
+
+#define LOG_FORMAT_VALUE(type)                                      \
+    {                                                               \
+        type value;                                                 \
+        if (!log_unpack(record, offset, &value, sizeof(value))) {   \
+            return false;                                           \
+        }                                                           \
+        written = snprintf(out, space, spec, value);                \
+        break;                                                      \
+    }
+
+    switch (argument) {
+        case LOG_ARGUMENT_INT:
+            LOG_FORMAT_VALUE(int)
+        case LOG_ARGUMENT_LONG:
+            LOG_FORMAT_VALUE(long)
+        case LOG_ARGUMENT_LONG_LONG:
+            LOG_FORMAT_VALUE(long long)
+        case LOG_ARGUMENT_SIZE:
+            LOG_FORMAT_VALUE(size_t)
+        case LOG_ARGUMENT_INTMAX:
+            LOG_FORMAT_VALUE(intmax_t)
+        case LOG_ARGUMENT_PTRDIFF:
+            LOG_FORMAT_VALUE(ptrdiff_t)
+        case LOG_ARGUMENT_DOUBLE:
+            LOG_FORMAT_VALUE(double)
+        case LOG_ARGUMENT_LONG_DOUBLE:
+            LOG_FORMAT_VALUE(long double)
+        case LOG_ARGUMENT_STRING: {
+            if (*offset >= record->size) {
+                return false;
+            }
+            const char *value = (const char *) record->args + *offset;
+            *offset += (u32) strlen(value) + 1;
+            written = snprintf(out, space, spec, value);
+            break;
+        }
+        case LOG_ARGUMENT_POINTER: {
+            void *value;
+            if (!log_unpack(record, offset, &value, sizeof(value))) {
+                return false;
+            }
+            // %n would write through a pointer of the logging thread, it's consumed and skipped
+            if (spec[strlen(spec) - 1] != 'n') {
+                written = snprintf(out, space, spec, value);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+#undef LOG_FORMAT_VALUE
+
+    log_append_written(capacity, length, written);
+    return true;
+}
+
+// Builds the conversion text with each '*' replaced by its packed int, false when those were left out
+bool log_spec_text(const LogRecord *record, u32 *offset, const LogSpec *spec, char *out) {
+    // Room for the longest int in place of each '*'
+    if (spec->length + spec->stars * 11 >= LOG_SPEC_SIZE) {
+        return false;
+    }
+
+    size_t length = 0;
+    for (u32 i = 0; i < spec->length; ++i) {
+        if (spec->start[i] != '*') {
+            out[length++] = spec->start[i];
+            continue;
+        }
+
+        int value;
+        if (!log_unpack(record, offset, &value, sizeof(value))) {
+            return false;
+        }
+        length += (size_t) snprintf(out + length, LOG_SPEC_SIZE - length, "%d", value);
+    }
+    out[length] = '\0';
+    return true;
+}
+
+size_t log_format(const LogRecord *record, char *line, size_t capacity) {
+    size_t length = 0;
+    line[0] = '\0';
+    log_append_written(capacity, &length,
+                       snprintf(line, capacity, "[%s] ", log_level_name((LogLevel) record->level)));
+
+    LogSpec spec;
+    const char *cursor = record->format;
+    u32 offset = 0;
+    bool complete = true;
+    while (log_next_spec(cursor, &spec)) {
+        log_append(line, capacity, &length, cursor, (size_t) (spec.start - cursor));
+        cursor = spec.start + spec.length;
+
+        char last = spec.start[spec.length - 1];
+        if (spec.argument == LOG_ARGUMENT_NONE) {
+            // %% or something printf doesn't know, which is printed as written
+            log_append(line, capacity, &length, last == '%' && spec.length > 1 ? "%" : spec.start,
+                       last == '%' && spec.length > 1 ? 1 : spec.length);
+            continue;
+        }
+
+        char text[LOG_SPEC_SIZE];
+        if (!log_spec_text(record, &offset, &spec, text) ||
+            !log_format_argument(record, &offset, spec.argument, text, line, capacity, &length)) {
+            complete = false;
+            break;
+        }
+    }
+
+    if (complete) {
+        log_append(line, capacity, &length, cursor, strlen(cursor));
+    }
+    if (!complete || record->truncated) {
+        log_append(line, capacity, &length, "...", 3);
+    }
+    log_append(line, capacity, &length, "\n", 1);
+    return length;
+}
+
+// Used before the writer runs, when no ring is left and for records logged during shutdown
+void log_write_now(LogLevel level, const char *format, va_list args) {
+    char line[LOG_LINE_SIZE];
+    size_t length = 0;
+    log_append_written(sizeof(line), &length, snprintf(line, sizeof(line), "[%s] ", log_level_name(level)));
+    log_append_written(sizeof(line), &length, vsnprintf(line + length, sizeof(line) - length, format, args));
+    log_append(line, sizeof(line), &length, "\n", 1);
+    fputs(line, stdout);
+}
+
+LogRing *log_thread_ring_acquire() {
+    u32 generation = atomic_load_explicit(&log_backend.generation, memory_order_acquire);
+    if (log_thread_ring != NULL && log_thread_generation == generation) {
+        return log_thread_ring;
+    }
+
+    log_thread_ring = NULL;
+    for (u32 i = 0; i < LOG_MAX_THREADS; ++i) {
+        int expected = LOG_SLOT_FREE;
+        if (atomic_compare_exchange_strong(&log_backend.states[i], &expected, LOG_SLOT_CLAIMED)) {
+            atomic_store_explicit(&log_backend.states[i], LOG_SLOT_OWNED, memory_order_release);
+            log_thread_ring = &log_backend.rings[i];
+            log_thread_slot = i;
+            log_thread_generation = generation;
+            break;
+        }
+    }
+    return log_thread_ring;
+}
+
+void log_write(LogLevel level, const char *format, ...) {
+    if (!log_enabled(level)) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    LogRing *ring = atomic_load_explicit(&log_backend.running, memory_order_acquire) ? log_thread_ring_acquire()
+                                                                                      : NULL;
+    if (ring == NULL) {
+        log_write_now(level, format, args);
+        va_end(args);
+        return;
+    }
+
+    u32 tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    u32 head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - head == LOG_RING_SIZE / 2) {
+        SDL_SemPost(log_backend.wake);
+    }
+    while (tail - head >= LOG_RING_SIZE) {
+        // Nobody empties the ring anymore once the writer stopped
+        if (!atomic_load_explicit(&log_backend.running, memory_order_acquire)) {
+            log_write_now(level, format, args);
+            va_end(args);
+            return;
+        }
+        if (level >= LOG_LEVEL_DEBUG) {
+            atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+            va_end(args);
+            return;
+        }
+        SDL_SemPost(log_backend.wake);
+        SDL_Delay(1);
+        head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    }
+
+    LogRecord *record = &ring->records[tail & (LOG_RING_SIZE - 1)];
+    record->format = format;
+    record->timestamp = SDL_GetPerformanceCounter();
+    record->level = (u16) level;
+    record->size = 0;
+    record->truncated = false;
+    log_pack(record, format, &args);
+    va_end(args);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+    if (level == LOG_LEVEL_ERROR) {
+        SDL_SemPost(log_backend.wake);
+    }
+}
+
+void log_thread_release() {
+    if (log_thread_ring != NULL &&
+        log_thread_generation == atomic_load_explicit(&log_backend.generation, memory_order_acquire)) {
+        atomic_store_explicit(&log_backend.states[log_thread_slot], LOG_SLOT_RELEASED, memory_order_release);
+    }
+    log_thread_ring = NULL;
+    log_thread_slot = LOG_MAX_THREADS;
+}
+
+// Writes the queued records of all rings merged by timestamp, so lines from different threads stay in order
+void log_drain() {
+    char line[LOG_LINE_SIZE];
+    while (true) {
+        LogRing *oldest = NULL;
+        LogRecord *record = NULL;
+        for (u32 i = 0; i < LOG_MAX_THREADS; ++i) {
+            int state = atomic_load_explicit(&log_backend.states[i], memory_order_acquire);
+            if (state != LOG_SLOT_OWNED && state != LOG_SLOT_RELEASED) {
+                continue;
+            }
+
+            LogRing *ring = &log_backend.rings[i];
+            u32 head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+            if (head == atomic_load_explicit(&ring->tail, memory_order_acquire)) {
+                continue;
+            }
+            LogRecord *candidate = &ring->records[head & (LOG_RING_SIZE - 1)];
+            if (record == NULL || candidate->timestamp < record->timestamp) {
+                record = candidate;
+                oldest = ring;
+            }
+        }
+        if (record == NULL) {
+            break;
+        }
+
+        log_format(record, line, sizeof(line));
+        fputs(line, stdout);
+        u32 head = atomic_load_explicit(&oldest->head, memory_order_relaxed);
+        atomic_store_explicit(&oldest->head, head + 1, memory_order_release);
+    }
+
+    for (u32 i = 0; i < LOG_MAX_THREADS; ++i) {
+        int state = atomic_load_explicit(&log_backend.states[i], memory_order_acquire);
+        if (state != LOG_SLOT_OWNED && state != LOG_SLOT_RELEASED) {
+            continue;
+        }
+
+        LogRing *ring = &log_backend.rings[i];
+        u32 dropped = atomic_exchange_explicit(&ring->dropped, 0, memory_order_relaxed);
+        if (dropped > 0) {
+            fprintf(stdout, "[%s] %u log records dropped, the ring was full\n", log_level_name(LOG_LEVEL_WARN),
+                    dropped);
+        }
+        // A released ring gets no more records, once it's empty it can go to the next thread
+        if (state == LOG_SLOT_RELEASED && atomic_load_explicit(&ring->head, memory_order_relaxed) ==
+                                          atomic_load_explicit(&ring->tail, memory_order_acquire)) {
+            atomic_store_explicit(&log_backend.states[i], LOG_SLOT_FREE, memory_order_release);
+        }
+    }
+    fflush(stdout);
+}
+
+int log_writer_main(void *data) {
+    while (atomic_load_explicit(&log_backend.running, memory_order_acquire)) {
+        SDL_SemWaitTimeout(log_backend.wake, LOG_FLUSH_INTERVAL_MS);
+        log_drain();
+    }
+    return 0;
+}
+
+bool log_init() {
+    if (atomic_load(&log_backend.running)) {
+        return true;
+    }
+
+    // Rings and the semaphore are never freed, threads still inside log_write at exit may be using them
+    if (log_backend.rings == NULL) {
+        log_backend.rings = aligned_alloc(_Alignof(LogRing), sizeof(LogRing) * LOG_MAX_THREADS);
+    }
+    if (log_backend.wake == NULL) {
+        log_backend.wake = SDL_CreateSemaphore(0);
+    }
+    if (log_backend.rings == NULL || log_backend.wake == NULL) {
+        LOG_ERROR("Failed to create the log rings: %s", SDL_GetError());
+        log_shutdown();
+        return false;
+    }
+    memset(log_backend.rings, 0, sizeof(LogRing) * LOG_MAX_THREADS);
+    for (u32 i = 0; i < LOG_MAX_THREADS; ++i) {
+        atomic_store(&log_backend.states[i], LOG_SLOT_FREE);
+    }
+    atomic_fetch_add(&log_backend.generation, 1);
+
+    atomic_store(&log_backend.running, true);
+    log_backend.writer = SDL_CreateThread(log_writer_main, "log", NULL);
+    if (log_backend.writer == NULL) {
+        atomic_store(&log_backend.running, false);
+        LOG_ERROR("Failed to start the log writer: %s", SDL_GetError());
+        log_shutdown();
+        return false;
+    }
+
+    // Fatal errors exit from wherever they happen, what was logged before them still gets written
+    if (!log_backend.exit_handler) {
+        log_backend.exit_handler = atexit(log_shutdown) == 0;
+    }
+    return true;
+}
+
+void log_shutdown() {
+    atomic_store(&log_backend.running, false);
+    if (log_backend.writer != NULL) {
+        SDL_SemPost(log_backend.wake);
+        SDL_WaitThread(log_backend.writer, NULL);
+        log_backend.writer = NULL;
+        // Records pushed while the writer was stopping
+        log_drain();
+    }
+}
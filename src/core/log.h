@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <std/defines.h>
+// The std logger's macros are replaced below. Including it first keeps it from redefining them when a file pulls it
+// in again later.
+#include <std/core/logger.h>
+
+// Record slots in each thread's ring, a power of two. Debug and trace records logged while it's full are dropped and
+// counted, the others wait for the writer.
+#define LOG_RING_SIZE 256
+// Rings are allocated up front so logging never allocates, threads beyond this write synchronously
+#define LOG_MAX_THREADS 32
+// Packed arguments of one record, which fills 256 bytes. Strings are copied in and cut short when they don't fit.
+#define LOG_RECORD_ARGS 232
+// The writer wakes at least this often, errors wake it right away
+#define LOG_FLUSH_INTERVAL_MS 10
+
+typedef enum LogLevel {
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_TRACE,
+    LOG_LEVEL_MAX
+} LogLevel;
+
+// Format pointer and arguments as they were passed, formatting waits for the writer thread
+typedef struct LogRecord {
+    const char *format;
+    u64 timestamp;
+    u16 level;
+    u16 size;
+    // Arguments past size didn't fit and are left out
+    bool truncated;
+    u8 args[LOG_RECORD_ARGS];
+} LogRecord;
+
+// Records from exactly one producer thread to the writer thread
+typedef struct LogRing {
+    _Alignas(64) atomic_uint head;
+    _Alignas(64) atomic_uint tail;
+    atomic_uint dropped;
+    LogRecord records[LOG_RING_SIZE];
+} LogRing;
+
+// Starts the writer thread. Before it and after log_shutdown, records are written on the logging thread.
+bool log_init();
+
+// Stops the writer thread and writes everything still queued. The rings stay allocated, so threads logging meanwhile
+// are safe and fall back to writing synchronously.
+void log_shutdown();
+
+void log_set_level(LogLevel level);
+
+bool log_enabled(LogLevel level);
+
+// Accepts error, warn, info, debug and trace
+bool log_level_parse(const char *name, LogLevel *out);
+
+// format has to outlive the writer thread, which in practice means a string literal
+void log_write(LogLevel level, const char *format, ...);
+
+// Hands the calling thread's ring back once the writer has emptied it, for threads that are about to exit
+void log_thread_release();
+
+// Arguments are only evaluated when the level is enabled, so debug and trace logging can stay in hot paths
+#define LOG_AT(level, ...)                      \
+    do {                                        \
+        if (log_enabled(level)) {               \
+            log_write(level, __VA_ARGS__);      \
+        }                                       \
+    } while (0)
+
+#undef LOG_ERROR
+#undef LOG_WARN
+#undef LOG_INFO
+#undef LOG_DEBUG
+#undef LOG_TRACE
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_TRACE(...) LOG_AT(LOG_LEVEL_TRACE, __VA_ARGS__)
@@ -0,0 +1,109 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool mapped_file_open(const char *path, MappedFile *out) {
+    MappedFile result = {0};
+
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        CloseHandle(file);
+        return false;
+    }
+
+    result.data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (result.data == NULL) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    result.size = (size_t) size.QuadPart;
+    result.file_handle = file;
+    result.mapping_handle = mapping;
+    *out = result;
+    return true;
+}
+
+void mapped_file_prefetch(MappedFile *file, size_t offset, size_t size) {
+    WIN32_MEMORY_RANGE_ENTRY range = {(char *) file->data + offset, size};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+void mapped_file_close(MappedFile *file) {
+    if (file->data) {
+        UnmapViewOfFile(file->data);
+        CloseHandle(file->mapping_handle);
+        CloseHandle(file->file_handle);
+    }
+
+    file->data = NULL;
+    file->size = 0;
+}
+
+#else
+
+bool mapped_file_open(const char *path, MappedFile *out) {
+    MappedFile result = {0};
+
+    result.fd = open(path, O_RDONLY);
+    if (result.fd < 0) {
+        return false;
+    }
+
+    struct stat stats;
+    if (fstat(result.fd, &stats) != 0 || stats.st_size == 0) {
+        close(result.fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, (size_t) stats.st_size, PROT_READ, MAP_PRIVATE, result.fd, 0);
+    if (data == MAP_FAILED) {
+        close(result.fd);
+        return false;
+    }
+
+    result.data = data;
+    result.size = (size_t) stats.st_size;
+    *out = result;
+    return true;
+}
+
+void mapped_file_prefetch(MappedFile *file, size_t offset, size_t size) {
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    size_t start = offset & ~(page_size - 1);
+    posix_madvise((char *) file->data + start, size + (offset - start), POSIX_MADV_WILLNEED);
+}
+
+void mapped_file_close(MappedFile *file) {
+    if (file->data) {
+        munmap((void *) file->data, file->size);
+        close(file->fd);
+    }
+
+    file->data = NULL;
+    file->size = 0;
+}
+
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct MappedFile {
+    const void *data;
+    size_t size;
+
+#ifdef _WIN32
+    void *file_handle;
+    void *mapping_handle;
+#else
+    int fd;
+#endif
+} MappedFile;
+
+bool mapped_file_open(const char *path, MappedFile *out);
+
+// Hints the OS to start reading a range in, so a later copy doesn't stall on page faults
+void mapped_file_prefetch(MappedFile *file, size_t offset, size_t size);
+
+void mapped_file_close(MappedFile *file);
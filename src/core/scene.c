@@ -0,0 +1,328 @@
+#include "scene.h"
+#include "job.h"
+#include "log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Levels smaller than this are not worth waking the workers for
+#define SCENE_PARALLEL_THRESHOLD (SCENE_CHUNK_SIZE * 2)
+
+void scene_process(Scene *scene, u32 first, u32 end) {
+    for (u32 i = first; i < end; ++i) {
+        if (scene->parent[i] != SCENE_NO_NODE) {
+            scene->dirty[i] |= scene->dirty[scene->parent[i]];
+        }
+    }
+
+    // Dirty nodes come in runs of siblings, each run is composed four at a time
+    u32 i = first;
+    while (i < end) {
+        if (!scene->dirty[i]) {
+            ++i;
+            continue;
+        }
+
+        u32 run_end = i;
+        while (run_end < end && scene->dirty[run_end]) {
+            ++run_end;
+        }
+
+        transform_compose(&scene->locals, i, run_end - i, scene->world);
+        for (u32 node = i; node < run_end; ++node) {
+            if (scene->parent[node] != SCENE_NO_NODE) {
+                matrix_multiply(&scene->world[scene->parent[node]], &scene->world[node], &scene->world[node]);
+            }
+        }
+        i = run_end;
+    }
+
+    if (scene->output == NULL) {
+        return;
+    }
+
+    for (u32 node = first; node < end; ++node) {
+        if (scene->instance[node] != SCENE_NO_INSTANCE) {
+            memcpy(scene->output + (u64) scene->instance[node] * scene->output_stride, &scene->world[node],
+                   sizeof(Matrix4));
+        }
+    }
+}
+
+void scene_level_batch(void *data, u32 first, u32 end) {
+    Scene *scene = data;
+    scene_process(scene, scene->level_first + first, scene->level_first + end);
+}
+
+bool scene_create(Scene *out) {
+    Scene result = {0};
+    *out = result;
+    return true;
+}
+
+void scene_free_arrays(Scene *scene) {
+    for (u32 i = 0; i < 3; ++i) {
+        free(scene->locals.position[i]);
+        free(scene->locals.scale[i]);
+    }
+    for (u32 i = 0; i < 4; ++i) {
+        free(scene->locals.rotation[i]);
+    }
+    free(scene->world);
+    free(scene->parent);
+    free(scene->depth);
+    free(scene->instance);
+    free(scene->nodes);
+    free(scene->dirty);
+    free(scene->removed);
+    free(scene->level_start);
+}
+
+void scene_destroy(Scene *scene) {
+    scene_free_arrays(scene);
+    free(scene->node_index);
+    free(scene->free_nodes);
+    memset(scene, 0, sizeof(Scene));
+}
+
+void scene_reserve(Scene *scene, u32 capacity) {
+    if (capacity <= scene->capacity) {
+        return;
+    }
+
+    capacity = capacity < 2 * scene->capacity ? 2 * scene->capacity : capacity;
+    capacity = capacity < 64 ? 64 : capacity;
+
+    for (u32 i = 0; i < 3; ++i) {
+        scene->locals.position[i] = realloc(scene->locals.position[i], sizeof(float) * capacity);
+        scene->locals.scale[i] = realloc(scene->locals.scale[i], sizeof(float) * capacity);
+    }
+    for (u32 i = 0; i < 4; ++i) {
+        scene->locals.rotation[i] = realloc(scene->locals.rotation[i], sizeof(float) * capacity);
+    }
+    scene->world = realloc(scene->world, sizeof(Matrix4) * capacity);
+    scene->parent = realloc(scene->parent, sizeof(u32) * capacity);
+    scene->depth = realloc(scene->depth, sizeof(u32) * capacity);
+    scene->instance = realloc(scene->instance, sizeof(u32) * capacity);
+    scene->nodes = realloc(scene->nodes, sizeof(SceneNode) * capacity);
+    scene->dirty = realloc(scene->dirty, capacity);
+    scene->removed = realloc(scene->removed, capacity);
+    scene->level_start = realloc(scene->level_start, sizeof(u32) * (capacity + 1));
+    scene->capacity = capacity;
+}
+
+u32 scene_node_lookup(const Scene *scene, SceneNode node) {
+    if (node >= scene->node_capacity || scene->node_index[node] == SCENE_NO_NODE) {
+        LOG_ERROR("Invalid scene node %u", node);
+        return SCENE_NO_NODE;
+    }
+    return scene->node_index[node];
+}
+
+SceneNode scene_node_allocate(Scene *scene) {
+    if (scene->free_count == 0) {
+        u32 capacity = scene->node_capacity == 0 ? 64 : scene->node_capacity * 2;
+        scene->node_index = realloc(scene->node_index, sizeof(u32) * capacity);
+        scene->free_nodes = realloc(scene->free_nodes, sizeof(SceneNode) * capacity);
+        // Pushed highest first so new ids are handed out in order
+        for (u32 id = capacity; id > scene->node_capacity; --id) {
+            scene->node_index[id - 1] = SCENE_NO_NODE;
+            scene->free_nodes[scene->free_count++] = id - 1;
+        }
+        scene->node_capacity = capacity;
+    }
+
+    return scene->free_nodes[--scene->free_count];
+}
+
+void scene_write_local(Scene *scene, u32 index, const SceneTransform *local) {
+    for (u32 i = 0; i < 3; ++i) {
+        scene->locals.position[i][index] = local->position[i];
+        scene->locals.scale[i][index] = local->scale[i];
+    }
+    for (u32 i = 0; i < 4; ++i) {
+        scene->locals.rotation[i][index] = local->rotation[i];
+    }
+    scene->dirty[index] = 1;
+}
+
+SceneNode scene_node_create(Scene *scene, SceneNode parent, const SceneTransform *local) {
+    u32 parent_index = SCENE_NO_NODE;
+    if (parent != SCENE_NO_NODE) {
+        parent_index = scene_node_lookup(scene, parent);
+        if (parent_index == SCENE_NO_NODE) {
+            return SCENE_NO_NODE;
+        }
+    }
+
+    scene_reserve(scene, scene->count + 1);
+    SceneNode node = scene_node_allocate(scene);
+
+    // Appended nodes always come after their parent, which is all scene_sort needs
+    u32 index = scene->count++;
+    scene->node_index[node] = index;
+    scene->nodes[index] = node;
+    scene->parent[index] = parent_index;
+    scene->depth[index] = parent_index == SCENE_NO_NODE ? 0 : scene->depth[parent_index] + 1;
+    scene->instance[index] = SCENE_NO_INSTANCE;
+    scene->removed[index] = 0;
+    scene_write_local(scene, index, local);
+
+    scene->order_dirty = true;
+    return node;
+}
+
+void scene_node_destroy(Scene *scene, SceneNode node) {
+    u32 index = scene_node_lookup(scene, node);
+    if (index == SCENE_NO_NODE) {
+        return;
+    }
+
+    // Descendants are found when the order is rebuilt
+    scene->removed[index] = 1;
+    scene->order_dirty = true;
+}
+
+void scene_node_set_local(Scene *scene, SceneNode node, const SceneTransform *local) {
+    u32 index = scene_node_lookup(scene, node);
+    if (index != SCENE_NO_NODE) {
+        scene_write_local(scene, index, local);
+    }
+}
+
+void scene_node_set_instance(Scene *scene, SceneNode node, u32 slot) {
+    u32 index = scene_node_lookup(scene, node);
+    if (index != SCENE_NO_NODE) {
+        scene->instance[index] = slot;
+    }
+}
+
+const Matrix4 *scene_node_world(const Scene *scene, SceneNode node) {
+    u32 index = scene_node_lookup(scene, node);
+    return index == SCENE_NO_NODE ? NULL : &scene->world[index];
+}
+
+void scene_gather(void **array, u32 element_size, const u32 *order, u32 count, u32 capacity) {
+    u8 *source = *array;
+    u8 *gathered = malloc((u64) element_size * capacity);
+    for (u32 i = 0; i < count; ++i) {
+        memcpy(gathered + (u64) i * element_size, source + (u64) order[i] * element_size, element_size);
+    }
+    free(source);
+    *array = gathered;
+}
+
+// Drops removed subtrees and rebuilds the breadth first order: depth levels are contiguous and children of one
+// parent sit next to each other in the same order as their parents
+void scene_sort(Scene *scene) {
+    u32 count = scene->count;
+    u32 *child_start = calloc(count + 1, sizeof(u32));
+    u32 *children = malloc(sizeof(u32) * (count > 0 ? count : 1));
+    u32 *order = malloc(sizeof(u32) * (count > 0 ? count : 1));
+    u32 *new_index = malloc(sizeof(u32) * (count > 0 ? count : 1));
+
+    // Parents always precede their children here, so one pass propagates removal down every subtree
+    for (u32 i = 0; i < count; ++i) {
+        u32 parent = scene->parent[i];
+        if (parent != SCENE_NO_NODE && scene->removed[parent]) {
+            scene->removed[i] = 1;
+        }
+        if (scene->removed[i]) {
+            scene->node_index[scene->nodes[i]] = SCENE_NO_NODE;
+            scene->free_nodes[scene->free_count++] = scene->nodes[i];
+        } else if (parent != SCENE_NO_NODE) {
+            child_start[parent + 1]++;
+        }
+    }
+
+    for (u32 i = 0; i < count; ++i) {
+        child_start[i + 1] += child_start[i];
+    }
+
+    u32 *cursor = malloc(sizeof(u32) * (count > 0 ? count : 1));
+    memcpy(cursor, child_start, sizeof(u32) * count);
+    u32 tail = 0;
+    for (u32 i = 0; i < count; ++i) {
+        if (scene->removed[i]) {
+            continue;
+        }
+        if (scene->parent[i] == SCENE_NO_NODE) {
+            order[tail++] = i;
+        } else {
+            children[cursor[scene->parent[i]]++] = i;
+        }
+    }
+    free(cursor);
+
+    for (u32 head = 0; head < tail; ++head) {
+        u32 node = order[head];
+        for (u32 child = child_start[node]; child < child_start[node + 1]; ++child) {
+            order[tail++] = children[child];
+        }
+    }
+
+    for (u32 i = 0; i < tail; ++i) {
+        new_index[order[i]] = i;
+    }
+
+    u32 capacity = scene->capacity;
+    for (u32 i = 0; i < 3; ++i) {
+        scene_gather((void **) &scene->locals.position[i], sizeof(float), order, tail, capacity);
+        scene_gather((void **) &scene->locals.scale[i], sizeof(float), order, tail, capacity);
+    }
+    for (u32 i = 0; i < 4; ++i) {
+        scene_gather((void **) &scene->locals.rotation[i], sizeof(float), order, tail, capacity);
+    }
+    scene_gather((void **) &scene->world, sizeof(Matrix4), order, tail, capacity);
+    scene_gather((void **) &scene->parent, sizeof(u32), order, tail, capacity);
+    scene_gather((void **) &scene->depth, sizeof(u32), order, tail, capacity);
+    scene_gather((void **) &scene->instance, sizeof(u32), order, tail, capacity);
+    scene_gather((void **) &scene->nodes, sizeof(SceneNode), order, tail, capacity);
+    scene_gather((void **) &scene->dirty, 1, order, tail, capacity);
+    memset(scene->removed, 0, tail);
+
+    scene->level_count = 0;
+    for (u32 i = 0; i < tail; ++i) {
+        if (scene->parent[i] != SCENE_NO_NODE) {
+            scene->parent[i] = new_index[scene->parent[i]];
+        }
+        scene->node_index[scene->nodes[i]] = i;
+        if (i == 0 || scene->depth[i] != scene->depth[i - 1]) {
+            scene->level_start[scene->level_count++] = i;
+        }
+    }
+    scene->level_start[scene->level_count] = tail;
+    scene->count = tail;
+    scene->order_dirty = false;
+
+    free(child_start);
+    free(children);
+    free(order);
+    free(new_index);
+}
+
+void scene_update(Scene *scene, void *output, u32 stride) {
+    if (scene->order_dirty) {
+        scene_sort(scene);
+    }
+
+    scene->output = output;
+    scene->output_stride = stride;
+
+    for (u32 level = 0; level < scene->level_count; ++level) {
+        u32 first = scene->level_start[level];
+        u32 end = scene->level_start[level + 1];
+
+        if (end - first < SCENE_PARALLEL_THRESHOLD) {
+            scene_process(scene, first, end);
+            continue;
+        }
+
+        // parallel_for returns once the whole level is written, before the next level reads its parents
+        scene->level_first = first;
+        parallel_for(end - first, SCENE_CHUNK_SIZE, scene_level_batch, scene);
+    }
+
+    memset(scene->dirty, 0, scene->count);
+    scene->output = NULL;
+}
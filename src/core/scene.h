@@ -0,0 +1,73 @@
+#pragma once
+
+#include <std/defines.h>
+#include "transform.h"
+
+#define SCENE_NO_NODE 0xFFFFFFFFu
+#define SCENE_NO_INSTANCE 0xFFFFFFFFu
+// Nodes per parallel_for batch when a depth level is split across the job system
+#define SCENE_CHUNK_SIZE 256
+
+typedef u32 SceneNode;
+
+typedef struct SceneTransform {
+    float position[3];
+    // Unit quaternion x, y, z, w
+    float rotation[4];
+    float scale[3];
+} SceneTransform;
+
+// Nodes are kept sorted by depth so every level is one contiguous range whose parents are all finished before it
+// starts, siblings are contiguous within a level
+typedef struct Scene {
+    u32 count;
+    u32 capacity;
+
+    // Indexed by sorted position
+    TransformArrays locals;
+    Matrix4 *world;
+    u32 *parent;
+    u32 *depth;
+    u32 *instance;
+    SceneNode *nodes;
+    u8 *dirty;
+    u8 *removed;
+
+    // Indexed by SceneNode, SCENE_NO_NODE for free ids
+    u32 *node_index;
+    u32 node_capacity;
+    SceneNode *free_nodes;
+    u32 free_count;
+
+    // level i covers [level_start[i], level_start[i + 1])
+    u32 *level_start;
+    u32 level_count;
+    bool order_dirty;
+
+    // Level currently being processed by scene_update
+    u32 level_first;
+    u8 *output;
+    u32 output_stride;
+} Scene;
+
+bool scene_create(Scene *out);
+
+void scene_destroy(Scene *scene);
+
+// parent is SCENE_NO_NODE for roots
+SceneNode scene_node_create(Scene *scene, SceneNode parent, const SceneTransform *local);
+
+// Destroys the node and all of its descendants
+void scene_node_destroy(Scene *scene, SceneNode node);
+
+void scene_node_set_local(Scene *scene, SceneNode node, const SceneTransform *local);
+
+// World matrices of nodes with an instance slot are written to output + slot * stride by scene_update
+void scene_node_set_instance(Scene *scene, SceneNode node, u32 slot);
+
+// Valid after the last scene_update, NULL for unknown nodes
+const Matrix4 *scene_node_world(const Scene *scene, SceneNode node);
+
+// Recomputes world matrices of changed subtrees and writes every instanced node's matrix to output. output may be
+// NULL when nothing is instanced.
+void scene_update(Scene *scene, void *output, u32 stride);
@@ -0,0 +1,51 @@
+#include "spsc_queue.h"
+#include "log.h"
+
+#include <stdlib.h>
+
+bool spsc_queue_create(u32 capacity, SpscQueue *out) {
+    u32 size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    SpscQueue result = {0};
+    result.items = calloc(size, sizeof(void *));
+    if (result.items == NULL) {
+        LOG_ERROR("Failed to allocate a queue of %u items", size);
+        return false;
+    }
+    result.mask = size - 1;
+    *out = result;
+    return true;
+}
+
+void spsc_queue_destroy(SpscQueue *queue) {
+    free(queue->items);
+    queue->items = NULL;
+}
+
+// head is only written by the consumer and tail only by the producer, each reads the other's index with acquire
+bool spsc_queue_push(SpscQueue *queue, void *item) {
+    u32 tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    u32 head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail - head > queue->mask) {
+        return false;
+    }
+
+    queue->items[tail & queue->mask] = item;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+bool spsc_queue_pop(SpscQueue *queue, void **out) {
+    u32 head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    u32 tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+
+    *out = queue->items[head & queue->mask];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <std/defines.h>
+
+// Lock-free ring of pointers for exactly one producer thread and one consumer thread
+typedef struct SpscQueue {
+    _Alignas(64) atomic_uint head;
+    _Alignas(64) atomic_uint tail;
+    _Alignas(64) void **items;
+    u32 mask;
+} SpscQueue;
+
+// capacity is rounded up to a power of two
+bool spsc_queue_create(u32 capacity, SpscQueue *out);
+
+void spsc_queue_destroy(SpscQueue *queue);
+
+// Producer side, false when the queue is full
+bool spsc_queue_push(SpscQueue *queue, void *item);
+
+// Consumer side, false when the queue is empty
+bool spsc_queue_pop(SpscQueue *queue, void **out);
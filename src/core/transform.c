@@ -0,0 +1,190 @@
+#include "transform.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define TRANSFORM_X86
+#endif
+
+typedef void (*MatrixMultiplyFunction)(const Matrix4 *a, const Matrix4 *b, Matrix4 *out);
+
+void matrix_identity(Matrix4 *out) {
+    memset(out, 0, sizeof(Matrix4));
+    out->m[0] = out->m[5] = out->m[10] = out->m[15] = 1.0f;
+}
+
+void transform_compose_scalar(const TransformArrays *locals, u32 first, u32 count, Matrix4 *out) {
+    for (u32 i = first; i < first + count; ++i) {
+        float x = locals->rotation[0][i], y = locals->rotation[1][i], z = locals->rotation[2][i];
+        float w = locals->rotation[3][i];
+        float sx = locals->scale[0][i], sy = locals->scale[1][i], sz = locals->scale[2][i];
+        float *m = out[i].m;
+
+        m[0] = (1.0f - 2.0f * (y * y + z * z)) * sx;
+        m[1] = 2.0f * (x * y + w * z) * sx;
+        m[2] = 2.0f * (x * z - w * y) * sx;
+        m[3] = 0.0f;
+        m[4] = 2.0f * (x * y - w * z) * sy;
+        m[5] = (1.0f - 2.0f * (x * x + z * z)) * sy;
+        m[6] = 2.0f * (y * z + w * x) * sy;
+        m[7] = 0.0f;
+        m[8] = 2.0f * (x * z + w * y) * sz;
+        m[9] = 2.0f * (y * z - w * x) * sz;
+        m[10] = (1.0f - 2.0f * (x * x + y * y)) * sz;
+        m[11] = 0.0f;
+        m[12] = locals->position[0][i];
+        m[13] = locals->position[1][i];
+        m[14] = locals->position[2][i];
+        m[15] = 1.0f;
+    }
+}
+
+void matrix_multiply_scalar(const Matrix4 *a, const Matrix4 *b, Matrix4 *out) {
+    Matrix4 result;
+    for (u32 column = 0; column < 4; ++column) {
+        for (u32 row = 0; row < 4; ++row) {
+            result.m[column * 4 + row] = a->m[row] * b->m[column * 4] +
+                                         a->m[4 + row] * b->m[column * 4 + 1] +
+                                         a->m[8 + row] * b->m[column * 4 + 2] +
+                                         a->m[12 + row] * b->m[column * 4 + 3];
+        }
+    }
+    *out = result;
+}
+
+#ifdef TRANSFORM_X86
+// Four nodes per iteration straight from the arrays, then transposed into one column per node
+void transform_compose_sse(const TransformArrays *locals, u32 first, u32 count, Matrix4 *out) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 zero = _mm_setzero_ps();
+
+    u32 end = first + (count & ~3u);
+    for (u32 i = first; i < end; i += 4) {
+        __m128 x = _mm_loadu_ps(&locals->rotation[0][i]);
+        __m128 y = _mm_loadu_ps(&locals->rotation[1][i]);
+        __m128 z = _mm_loadu_ps(&locals->rotation[2][i]);
+        __m128 w = _mm_loadu_ps(&locals->rotation[3][i]);
+        __m128 sx = _mm_loadu_ps(&locals->scale[0][i]);
+        __m128 sy = _mm_loadu_ps(&locals->scale[1][i]);
+        __m128 sz = _mm_loadu_ps(&locals->scale[2][i]);
+
+        __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+        __m128 columns[4][4] = {
+                {
+                        _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+                        _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+                        _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+                        zero
+                },
+                {
+                        _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+                        _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+                        _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+                        zero
+                },
+                {
+                        _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+                        _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+                        _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+                        zero
+                },
+                {
+                        _mm_loadu_ps(&locals->position[0][i]),
+                        _mm_loadu_ps(&locals->position[1][i]),
+                        _mm_loadu_ps(&locals->position[2][i]),
+                        one
+                }
+        };
+
+        for (u32 column = 0; column < 4; ++column) {
+            __m128 *c = columns[column];
+            _MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+            for (u32 lane = 0; lane < 4; ++lane) {
+                _mm_storeu_ps(&out[i + lane].m[column * 4], c[lane]);
+            }
+        }
+    }
+
+    transform_compose_scalar(locals, end, first + count - end, out);
+}
+
+void matrix_multiply_sse(const Matrix4 *a, const Matrix4 *b, Matrix4 *out) {
+    __m128 a0 = _mm_loadu_ps(&a->m[0]);
+    __m128 a1 = _mm_loadu_ps(&a->m[4]);
+    __m128 a2 = _mm_loadu_ps(&a->m[8]);
+    __m128 a3 = _mm_loadu_ps(&a->m[12]);
+
+    __m128 result[4];
+    for (u32 column = 0; column < 4; ++column) {
+        __m128 b_column = _mm_loadu_ps(&b->m[column * 4]);
+        __m128 r = _mm_mul_ps(a0, _mm_shuffle_ps(b_column, b_column, _MM_SHUFFLE(0, 0, 0, 0)));
+        r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_shuffle_ps(b_column, b_column, _MM_SHUFFLE(1, 1, 1, 1))));
+        r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_shuffle_ps(b_column, b_column, _MM_SHUFFLE(2, 2, 2, 2))));
+        r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_shuffle_ps(b_column, b_column, _MM_SHUFFLE(3, 3, 3, 3))));
+        result[column] = r;
+    }
+
+    for (u32 column = 0; column < 4; ++column) {
+        _mm_storeu_ps(&out->m[column * 4], result[column]);
+    }
+}
+
+// Two columns of b per instruction: in-lane shuffles broadcast one element of each column into its half
+__attribute__((target("avx,fma")))
+void matrix_multiply_avx(const Matrix4 *a, const Matrix4 *b, Matrix4 *out) {
+    __m256 a0 = _mm256_broadcast_ps((const __m128 *) &a->m[0]);
+    __m256 a1 = _mm256_broadcast_ps((const __m128 *) &a->m[4]);
+    __m256 a2 = _mm256_broadcast_ps((const __m128 *) &a->m[8]);
+    __m256 a3 = _mm256_broadcast_ps((const __m128 *) &a->m[12]);
+
+    __m256 b01 = _mm256_loadu_ps(&b->m[0]);
+    __m256 b23 = _mm256_loadu_ps(&b->m[8]);
+
+    __m256 r01 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b01, b01, _MM_SHUFFLE(0, 0, 0, 0)));
+    r01 = _mm256_fmadd_ps(a1, _mm256_shuffle_ps(b01, b01, _MM_SHUFFLE(1, 1, 1, 1)), r01);
+    r01 = _mm256_fmadd_ps(a2, _mm256_shuffle_ps(b01, b01, _MM_SHUFFLE(2, 2, 2, 2)), r01);
+    r01 = _mm256_fmadd_ps(a3, _mm256_shuffle_ps(b01, b01, _MM_SHUFFLE(3, 3, 3, 3)), r01);
+
+    __m256 r23 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b23, b23, _MM_SHUFFLE(0, 0, 0, 0)));
+    r23 = _mm256_fmadd_ps(a1, _mm256_shuffle_ps(b23, b23, _MM_SHUFFLE(1, 1, 1, 1)), r23);
+    r23 = _mm256_fmadd_ps(a2, _mm256_shuffle_ps(b23, b23, _MM_SHUFFLE(2, 2, 2, 2)), r23);
+    r23 = _mm256_fmadd_ps(a3, _mm256_shuffle_ps(b23, b23, _MM_SHUFFLE(3, 3, 3, 3)), r23);
+
+    _mm256_storeu_ps(&out->m[0], r01);
+    _mm256_storeu_ps(&out->m[8], r23);
+}
+#endif
+
+MatrixMultiplyFunction matrix_multiply_select() {
+#ifdef TRANSFORM_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx") && __builtin_cpu_supports("fma")) {
+        return matrix_multiply_avx;
+    }
+    return matrix_multiply_sse;
+#else
+    return matrix_multiply_scalar;
+#endif
+}
+
+void transform_compose(const TransformArrays *locals, u32 first, u32 count, Matrix4 *out) {
+#ifdef TRANSFORM_X86
+    transform_compose_sse(locals, first, count, out);
+#else
+    transform_compose_scalar(locals, first, count, out);
+#endif
+}
+
+void matrix_multiply(const Matrix4 *a, const Matrix4 *b, Matrix4 *out) {
+    // Resolved on first use, racing threads all store the same pointer
+    static MatrixMultiplyFunction multiply = NULL;
+    if (multiply == NULL) {
+        multiply = matrix_multiply_select();
+    }
+    multiply(a, b, out);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <std/defines.h>
+
+// Local transforms as structure of arrays, indexed by node
+typedef struct TransformArrays {
+    float *position[3];
+    float *rotation[4];
+    float *scale[3];
+} TransformArrays;
+
+// Column major 4x4 matrices
+typedef struct Matrix4 {
+    float m[16];
+} Matrix4;
+
+// Builds local matrices from translation, rotation quaternion and scale for nodes [first, first + count)
+void transform_compose(const TransformArrays *locals, u32 first, u32 count, Matrix4 *out);
+
+// out = a * b, out may alias b but not a
+void matrix_multiply(const Matrix4 *a, const Matrix4 *b, Matrix4 *out);
+
+void matrix_identity(Matrix4 *out);
@@ -0,0 +1,209 @@
+#include "bindless.h"
+#include "host_allocator.h"
+
+static const VkDescriptorType binding_types[BINDLESS_BINDING_MAX] = {
+        VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+        VK_DESCRIPTOR_TYPE_SAMPLER,
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+};
+
+static const char *binding_names[BINDLESS_BINDING_MAX] = {
+        "sampled image",
+        "sampler",
+        "storage buffer",
+};
+
+u32 bindless_min(u32 a, u32 b) {
+    return a < b ? a : b;
+}
+
+void bindless_slots_init(BindlessSlots *slots, u32 capacity) {
+    slots->capacity = capacity;
+    slots->next = 0;
+    slots->free = malloc(sizeof(u32) * capacity);
+    slots->free_count = 0;
+    slots->pending = malloc(sizeof(BindlessRelease) * capacity);
+    slots->pending_count = 0;
+}
+
+void bindless_slots_destroy(BindlessSlots *slots) {
+    free(slots->free);
+    slots->free = NULL;
+    free(slots->pending);
+    slots->pending = NULL;
+}
+
+u32 bindless_slots_acquire(BindlessSlots *slots) {
+    if (slots->free_count > 0) {
+        return slots->free[--slots->free_count];
+    }
+
+    if (slots->next < slots->capacity) {
+        return slots->next++;
+    }
+
+    return BINDLESS_INVALID_HANDLE;
+}
+
+bool bindless_create(PhysicalDevice *physical_device, Device *device, BindlessTable *out) {
+    if (!device->descriptor_indexing) {
+        LOG_ERROR("Bindless resources require descriptor indexing support!");
+        return false;
+    }
+
+    BindlessTable result = {0};
+    VkPhysicalDeviceVulkan12Properties *limits = &physical_device->properties_12;
+    u32 capacities[BINDLESS_BINDING_MAX] = {
+            bindless_min(BINDLESS_MAX_SAMPLED_IMAGES, limits->maxDescriptorSetUpdateAfterBindSampledImages),
+            bindless_min(BINDLESS_MAX_SAMPLERS, limits->maxDescriptorSetUpdateAfterBindSamplers),
+            bindless_min(BINDLESS_MAX_STORAGE_BUFFERS, limits->maxDescriptorSetUpdateAfterBindStorageBuffers),
+    };
+
+    VkDescriptorSetLayoutBinding bindings[BINDLESS_BINDING_MAX] = {0};
+    VkDescriptorBindingFlags binding_flags[BINDLESS_BINDING_MAX] = {0};
+    VkDescriptorPoolSize pool_sizes[BINDLESS_BINDING_MAX] = {0};
+    for (u32 i = 0; i < BINDLESS_BINDING_MAX; ++i) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = binding_types[i];
+        bindings[i].descriptorCount = capacities[i];
+        bindings[i].stageFlags = VK_SHADER_STAGE_ALL;
+
+        binding_flags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                           VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                           VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+        pool_sizes[i].type = binding_types[i];
+        pool_sizes[i].descriptorCount = capacities[i];
+
+        bindless_slots_init(&result.slots[i], capacities[i]);
+        LOG_INFO("Bindless %s capacity: %u", binding_names[i], capacities[i]);
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_create_info = {
+            VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO};
+    binding_flags_create_info.bindingCount = BINDLESS_BINDING_MAX;
+    binding_flags_create_info.pBindingFlags = binding_flags;
+
+    VkDescriptorSetLayoutCreateInfo layout_create_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    layout_create_info.pNext = &binding_flags_create_info;
+    layout_create_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layout_create_info.bindingCount = BINDLESS_BINDING_MAX;
+    layout_create_info.pBindings = bindings;
+    VK_CHECK(vkCreateDescriptorSetLayout(device->vk_device, &layout_create_info, host_allocator(), &result.layout));
+
+    VkDescriptorPoolCreateInfo pool_create_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    pool_create_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    pool_create_info.maxSets = 1;
+    pool_create_info.poolSizeCount = BINDLESS_BINDING_MAX;
+    pool_create_info.pPoolSizes = pool_sizes;
+    VK_CHECK(vkCreateDescriptorPool(device->vk_device, &pool_create_info, host_allocator(), &result.pool));
+
+    VkDescriptorSetAllocateInfo allocate_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    allocate_info.descriptorPool = result.pool;
+    allocate_info.descriptorSetCount = 1;
+    allocate_info.pSetLayouts = &result.layout;
+    VK_CHECK(vkAllocateDescriptorSets(device->vk_device, &allocate_info, &result.set));
+
+    *out = result;
+    LOG_INFO("Successfully created bindless resource table.");
+    return true;
+}
+
+void bindless_destroy(Device *device, BindlessTable *table) {
+    for (u32 i = 0; i < BINDLESS_BINDING_MAX; ++i) {
+        bindless_slots_destroy(&table->slots[i]);
+    }
+
+    vkDestroyDescriptorPool(device->vk_device, table->pool, host_allocator());
+    table->pool = NULL;
+    table->set = NULL;
+
+    vkDestroyDescriptorSetLayout(device->vk_device, table->layout, host_allocator());
+    table->layout = NULL;
+}
+
+u32 bindless_acquire(BindlessTable *table, BindlessBinding binding) {
+    u32 handle = bindless_slots_acquire(&table->slots[binding]);
+    if (handle == BINDLESS_INVALID_HANDLE) {
+        LOG_ERROR("Bindless %s table is full!", binding_names[binding]);
+    }
+
+    return handle;
+}
+
+void bindless_write(Device *device, BindlessTable *table, BindlessBinding binding, u32 handle,
+                    VkDescriptorImageInfo *image_info, VkDescriptorBufferInfo *buffer_info) {
+    VkWriteDescriptorSet write = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstSet = table->set;
+    write.dstBinding = binding;
+    write.dstArrayElement = handle;
+    write.descriptorCount = 1;
+    write.descriptorType = binding_types[binding];
+    write.pImageInfo = image_info;
+    write.pBufferInfo = buffer_info;
+
+    vkUpdateDescriptorSets(device->vk_device, 1, &write, 0, NULL);
+}
+
+u32 bindless_register_sampled_image(Device *device, BindlessTable *table, VkImageView view, VkImageLayout layout) {
+    u32 handle = bindless_acquire(table, BINDLESS_BINDING_SAMPLED_IMAGES);
+    if (handle != BINDLESS_INVALID_HANDLE) {
+        VkDescriptorImageInfo image_info = {.imageView = view, .imageLayout = layout};
+        bindless_write(device, table, BINDLESS_BINDING_SAMPLED_IMAGES, handle, &image_info, NULL);
+    }
+
+    return handle;
+}
+
+u32 bindless_register_sampler(Device *device, BindlessTable *table, VkSampler sampler) {
+    u32 handle = bindless_acquire(table, BINDLESS_BINDING_SAMPLERS);
+    if (handle != BINDLESS_INVALID_HANDLE) {
+        VkDescriptorImageInfo image_info = {.sampler = sampler};
+        bindless_write(device, table, BINDLESS_BINDING_SAMPLERS, handle, &image_info, NULL);
+    }
+
+    return handle;
+}
+
+u32 bindless_register_storage_buffer(Device *device, BindlessTable *table, VkBuffer buffer, VkDeviceSize offset,
+                                     VkDeviceSize range) {
+    u32 handle = bindless_acquire(table, BINDLESS_BINDING_STORAGE_BUFFERS);
+    if (handle != BINDLESS_INVALID_HANDLE) {
+        VkDescriptorBufferInfo buffer_info = {.buffer = buffer, .offset = offset, .range = range};
+        bindless_write(device, table, BINDLESS_BINDING_STORAGE_BUFFERS, handle, NULL, &buffer_info);
+    }
+
+    return handle;
+}
+
+void bindless_release(BindlessTable *table, BindlessBinding binding, u32 handle, u64 frame) {
+    BindlessSlots *slots = &table->slots[binding];
+    if (handle >= slots->next) {
+        LOG_ERROR("Releasing invalid bindless %s handle: %u", binding_names[binding], handle);
+        return;
+    }
+
+    BindlessRelease release = {.handle = handle, .frame = frame + BINDLESS_RELEASE_DELAY};
+    slots->pending[slots->pending_count++] = release;
+}
+
+void bindless_begin_frame(BindlessTable *table, u64 frame) {
+    for (u32 i = 0; i < BINDLESS_BINDING_MAX; ++i) {
+        BindlessSlots *slots = &table->slots[i];
+
+        u32 kept = 0;
+        for (u32 j = 0; j < slots->pending_count; ++j) {
+            if (slots->pending[j].frame <= frame) {
+                slots->free[slots->free_count++] = slots->pending[j].handle;
+            } else {
+                slots->pending[kept++] = slots->pending[j];
+            }
+        }
+        slots->pending_count = kept;
+    }
+}
+
+void bindless_bind(BindlessTable *table, VkCommandBuffer command_buffer, VkPipelineBindPoint bind_point,
+                   VkPipelineLayout layout) {
+    vkCmdBindDescriptorSets(command_buffer, bind_point, layout, 0, 1, &table->set, 0, NULL);
+}
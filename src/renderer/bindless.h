@@ -0,0 +1,70 @@
+#pragma once
+
+#include <std/defines.h>
+#include "vulkan_types.h"
+#include "physical_device.h"
+#include "device.h"
+
+#define BINDLESS_MAX_SAMPLED_IMAGES 16384
+#define BINDLESS_MAX_SAMPLERS 256
+#define BINDLESS_MAX_STORAGE_BUFFERS 16384
+#define BINDLESS_INVALID_HANDLE UINT32_MAX
+
+// Released handles are only recycled once every frame that could still reference them has retired
+#define BINDLESS_RELEASE_DELAY 4
+
+typedef enum BindlessBinding {
+    BINDLESS_BINDING_SAMPLED_IMAGES,
+    BINDLESS_BINDING_SAMPLERS,
+    BINDLESS_BINDING_STORAGE_BUFFERS,
+    BINDLESS_BINDING_MAX
+} BindlessBinding;
+
+typedef struct BindlessRelease {
+    u32 handle;
+    u64 frame;
+} BindlessRelease;
+
+typedef struct BindlessSlots {
+    u32 capacity;
+    u32 next;
+
+    u32 *free;
+    u32 free_count;
+
+    BindlessRelease *pending;
+    u32 pending_count;
+} BindlessSlots;
+
+typedef struct BindlessTable {
+    VkDescriptorSetLayout layout;
+    VkDescriptorPool pool;
+    VkDescriptorSet set;
+
+    BindlessSlots slots[BINDLESS_BINDING_MAX];
+} BindlessTable;
+
+// Push constants shared by every pipeline built on top of the bindless set
+typedef struct BindlessDrawConstants {
+    u32 material_buffer;
+    u32 material_index;
+    u32 texture_table;
+} BindlessDrawConstants;
+
+bool bindless_create(PhysicalDevice *physical_device, Device *device, BindlessTable *out);
+
+void bindless_destroy(Device *device, BindlessTable *table);
+
+u32 bindless_register_sampled_image(Device *device, BindlessTable *table, VkImageView view, VkImageLayout layout);
+
+u32 bindless_register_sampler(Device *device, BindlessTable *table, VkSampler sampler);
+
+u32 bindless_register_storage_buffer(Device *device, BindlessTable *table, VkBuffer buffer, VkDeviceSize offset,
+                                     VkDeviceSize range);
+
+void bindless_release(BindlessTable *table, BindlessBinding binding, u32 handle, u64 frame);
+
+void bindless_begin_frame(BindlessTable *table, u64 frame);
+
+void bindless_bind(BindlessTable *table, VkCommandBuffer command_buffer, VkPipelineBindPoint bind_point,
+                   VkPipelineLayout layout);
@@ -0,0 +1,48 @@
+#include "buffer.h"
+#include "host_allocator.h"
+
+bool buffer_create(PhysicalDevice *physical_device, Device *device, VkDeviceSize size, VkBufferUsageFlags usage,
+                   VkMemoryPropertyFlags properties, Buffer *out) {
+    Buffer result = {.size = size};
+
+    VkBufferCreateInfo create_info = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    create_info.size = size;
+    create_info.usage = usage;
+    create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VK_CHECK(vkCreateBuffer(device->vk_device, &create_info, host_allocator(), &result.vk_buffer));
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device->vk_device, result.vk_buffer, &requirements);
+
+    u32 memory_type;
+    if (!physical_device_find_memory_type(physical_device, requirements.memoryTypeBits, properties, &memory_type)) {
+        LOG_ERROR("No suitable memory type for buffer of size %llu", (unsigned long long) size);
+        vkDestroyBuffer(device->vk_device, result.vk_buffer, host_allocator());
+        return false;
+    }
+
+    VkMemoryAllocateInfo allocate_info = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+    allocate_info.allocationSize = requirements.size;
+    allocate_info.memoryTypeIndex = memory_type;
+    VK_CHECK(vkAllocateMemory(device->vk_device, &allocate_info, host_allocator(), &result.memory));
+    VK_CHECK(vkBindBufferMemory(device->vk_device, result.vk_buffer, result.memory, 0));
+
+    if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        VK_CHECK(vkMapMemory(device->vk_device, result.memory, 0, VK_WHOLE_SIZE, 0, &result.mapped));
+    }
+
+    *out = result;
+    return true;
+}
+
+void buffer_destroy(Device *device, Buffer *buffer) {
+    if (buffer->mapped) {
+        vkUnmapMemory(device->vk_device, buffer->memory);
+        buffer->mapped = NULL;
+    }
+
+    vkDestroyBuffer(device->vk_device, buffer->vk_buffer, host_allocator());
+    buffer->vk_buffer = NULL;
+    vkFreeMemory(device->vk_device, buffer->memory, host_allocator());
+    buffer->memory = NULL;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <std/defines.h>
+#include "vulkan_types.h"
+#include "physical_device.h"
+#include "device.h"
+
+typedef struct Buffer {
+    VkBuffer vk_buffer;
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+
+    // Host visible buffers stay mapped for their whole lifetime
+    void *mapped;
+} Buffer;
+
+bool buffer_create(PhysicalDevice *physical_device, Device *device, VkDeviceSize size, VkBufferUsageFlags usage,
+                   VkMemoryPropertyFlags properties, Buffer *out);
+
+void buffer_destroy(Device *device, Buffer *buffer);
@@ -0,0 +1,341 @@
+#include "command_stream.h"
+#include "core/log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+
+bool command_stream_writer_open(const char *path, CommandStreamWriter *out) {
+    CommandStreamWriter result = {0};
+    result.file = fopen(path, "wb");
+    if (result.file == NULL) {
+        LOG_ERROR("Couldn't open command stream %s", path);
+        return false;
+    }
+
+    CommandStreamHeader header = {.magic = COMMAND_STREAM_MAGIC, .version = COMMAND_STREAM_VERSION};
+    fwrite(&header, sizeof(header), 1, result.file);
+    result.start = SDL_GetPerformanceCounter();
+    *out = result;
+    return true;
+}
+
+void command_stream_writer_close(CommandStreamWriter *writer) {
+    if (writer->file != NULL) {
+        fclose(writer->file);
+        LOG_INFO("Command stream closed after %llu frames", (unsigned long long) writer->frames);
+    }
+    free(writer->draws.elements);
+    free(writer->lights.elements);
+    memset(writer, 0, sizeof(CommandStreamWriter));
+}
+
+void command_stream_write_record(CommandStreamWriter *writer, CommandStreamType type, const void *data, u32 size) {
+    CommandStreamRecord record = {.type = type, .size = size};
+    fwrite(&record, sizeof(record), 1, writer->file);
+    if (size > 0) {
+        fwrite(data, size, 1, writer->file);
+    }
+}
+
+void command_stream_write_init(CommandStreamWriter *writer, const PresentSettings *present, u32 width, u32 height) {
+    u32 data[5] = {present->policy, present->target_fps, present->variable_refresh, width, height};
+    command_stream_write_record(writer, COMMAND_STREAM_INIT, data, sizeof(data));
+}
+
+void command_stream_write_load_mesh(CommandStreamWriter *writer, u32 mesh, const char *path) {
+    u32 length = (u32) strlen(path);
+    CommandStreamRecord record = {.type = COMMAND_STREAM_LOAD_MESH, .size = sizeof(mesh) + length};
+    fwrite(&record, sizeof(record), 1, writer->file);
+    fwrite(&mesh, sizeof(mesh), 1, writer->file);
+    fwrite(path, 1, length, writer->file);
+}
+
+void command_stream_write_load_texture(CommandStreamWriter *writer, u32 texture, const char *path) {
+    u32 length = (u32) strlen(path);
+    CommandStreamRecord record = {.type = COMMAND_STREAM_LOAD_TEXTURE, .size = sizeof(texture) + length};
+    fwrite(&record, sizeof(record), 1, writer->file);
+    fwrite(&texture, sizeof(texture), 1, writer->file);
+    fwrite(path, 1, length, writer->file);
+}
+
+void command_stream_write_material(CommandStreamWriter *writer, u32 material, const float *base_color,
+                                   u32 albedo_texture) {
+    u32 data[6] = {material, 0, 0, 0, 0, albedo_texture};
+    memcpy(&data[1], base_color, sizeof(float) * 4);
+    command_stream_write_record(writer, COMMAND_STREAM_MATERIAL, data, sizeof(data));
+}
+
+void command_stream_write_view(CommandStreamWriter *writer, const float *view_projection, const float *camera) {
+    float data[19];
+    memcpy(data, view_projection, sizeof(float) * 16);
+    memcpy(&data[16], camera, sizeof(float) * 3);
+    command_stream_write_record(writer, COMMAND_STREAM_VIEW, data, sizeof(data));
+}
+
+void command_stream_write_present(CommandStreamWriter *writer, const PresentSettings *present) {
+    u32 data[3] = {present->policy, present->target_fps, present->variable_refresh};
+    command_stream_write_record(writer, COMMAND_STREAM_PRESENT, data, sizeof(data));
+}
+
+void command_stream_write_resize(CommandStreamWriter *writer, u32 width, u32 height) {
+    u32 data[2] = {width, height};
+    command_stream_write_record(writer, COMMAND_STREAM_RESIZE, data, sizeof(data));
+}
+
+void command_stream_write_frame_budget(CommandStreamWriter *writer, double milliseconds) {
+    command_stream_write_record(writer, COMMAND_STREAM_FRAME_BUDGET, &milliseconds, sizeof(milliseconds));
+}
+
+// ParticleSettings is all 4 byte fields, so it's written as is like MeshletDraw
+void command_stream_write_particles(CommandStreamWriter *writer, const ParticleSettings *settings) {
+    command_stream_write_record(writer, COMMAND_STREAM_PARTICLES, settings, sizeof(ParticleSettings));
+}
+
+// Finds the next run of elements at or after *cursor that differ from the previous frame, false when there is none
+bool command_stream_next_range(const CommandStreamList *previous, const void *elements, u32 count, u32 stride,
+                               u32 *cursor, u32 *first, u32 *run) {
+    const u8 *current = elements;
+    const u8 *last = previous->elements;
+    u32 common = count < previous->count ? count : previous->count;
+    u32 i = *cursor;
+    while (i < common && memcmp(current + (size_t) i * stride, last + (size_t) i * stride, stride) == 0) {
+        ++i;
+    }
+    if (i == count) {
+        *cursor = i;
+        return false;
+    }
+
+    *first = i;
+    while (i < count && (i >= common || memcmp(current + (size_t) i * stride, last + (size_t) i * stride,
+                                               stride) != 0)) {
+        ++i;
+    }
+    *run = i - *first;
+    *cursor = i;
+    return true;
+}
+
+// Scenes mostly move a few objects per frame, so only runs of changed elements are written as (first, count,
+// elements)
+void command_stream_write_list(CommandStreamWriter *writer, CommandStreamType type, CommandStreamList *previous,
+                               const void *elements, u32 count, u32 stride) {
+    u32 range_count = 0;
+    u32 size = sizeof(u32) * 2;
+    u32 cursor = 0;
+    u32 first, run;
+    while (command_stream_next_range(previous, elements, count, stride, &cursor, &first, &run)) {
+        range_count++;
+        size += sizeof(u32) * 2 + stride * run;
+    }
+
+    if (range_count == 0 && count == previous->count) {
+        return;
+    }
+
+    CommandStreamRecord record = {.type = type, .size = size};
+    fwrite(&record, sizeof(record), 1, writer->file);
+    fwrite(&count, sizeof(u32), 1, writer->file);
+    fwrite(&range_count, sizeof(u32), 1, writer->file);
+    cursor = 0;
+    while (command_stream_next_range(previous, elements, count, stride, &cursor, &first, &run)) {
+        fwrite(&first, sizeof(u32), 1, writer->file);
+        fwrite(&run, sizeof(u32), 1, writer->file);
+        fwrite((const u8 *) elements + (size_t) first * stride, stride, run, writer->file);
+    }
+
+    if (count > previous->capacity) {
+        previous->capacity = count;
+        previous->elements = realloc(previous->elements, (size_t) stride * previous->capacity);
+    }
+    if (count > 0) {
+        memcpy(previous->elements, elements, (size_t) stride * count);
+    }
+    previous->count = count;
+}
+
+void command_stream_write_frame(CommandStreamWriter *writer, const MeshletDrawList *draws, const LightList *lights) {
+    command_stream_write_list(writer, COMMAND_STREAM_DRAWS, &writer->draws, draws->draws, draws->count,
+                              sizeof(MeshletDraw));
+    command_stream_write_list(writer, COMMAND_STREAM_LIGHTS, &writer->lights, lights->lights, lights->count,
+                              sizeof(Light));
+
+    u64 elapsed = SDL_GetPerformanceCounter() - writer->start;
+    u64 nanoseconds = (u64) ((double) elapsed * 1e9 / (double) SDL_GetPerformanceFrequency());
+    command_stream_write_record(writer, COMMAND_STREAM_FRAME, &nanoseconds, sizeof(nanoseconds));
+    writer->frames++;
+}
+
+bool command_stream_reader_open(const char *path, CommandStreamReader *out) {
+    CommandStreamReader result = {0};
+    if (!mapped_file_open(path, &result.file)) {
+        LOG_ERROR("Failed to map command stream %s", path);
+        return false;
+    }
+
+    const CommandStreamHeader *header = result.file.data;
+    if (result.file.size < sizeof(CommandStreamHeader) || header->magic != COMMAND_STREAM_MAGIC) {
+        LOG_ERROR("Not a command stream: %s", path);
+        mapped_file_close(&result.file);
+        return false;
+    }
+    if (header->version != COMMAND_STREAM_VERSION) {
+        LOG_ERROR("Unsupported command stream version %u (expected %u): %s", header->version,
+                  COMMAND_STREAM_VERSION, path);
+        mapped_file_close(&result.file);
+        return false;
+    }
+
+    result.cursor = (const u8 *) result.file.data + sizeof(CommandStreamHeader);
+    result.end = (const u8 *) result.file.data + result.file.size;
+    *out = result;
+    return true;
+}
+
+void command_stream_reader_close(CommandStreamReader *reader) {
+    mapped_file_close(&reader->file);
+    free(reader->draws.elements);
+    free(reader->lights.elements);
+    memset(reader, 0, sizeof(CommandStreamReader));
+}
+
+bool command_stream_read_list(CommandStreamList *list, u32 stride, const u8 *data, u32 size) {
+    u32 header[2];
+    if (size < sizeof(header)) {
+        return false;
+    }
+    memcpy(header, data, sizeof(header));
+    const u8 *cursor = data + sizeof(header);
+    const u8 *end = data + size;
+
+    u32 count = header[0];
+    if (count > list->capacity) {
+        list->capacity = count;
+        list->elements = realloc(list->elements, (size_t) stride * list->capacity);
+    }
+    list->count = count;
+
+    for (u32 r = 0; r < header[1]; ++r) {
+        u32 range[2];
+        if (end - cursor < (ptrdiff_t) sizeof(range)) {
+            return false;
+        }
+        memcpy(range, cursor, sizeof(range));
+        cursor += sizeof(range);
+
+        size_t bytes = (size_t) stride * range[1];
+        if (range[0] > count || range[1] > count - range[0] || (size_t) (end - cursor) < bytes) {
+            return false;
+        }
+        memcpy((u8 *) list->elements + (size_t) stride * range[0], cursor, bytes);
+        cursor += bytes;
+    }
+    return true;
+}
+
+bool command_stream_read(CommandStreamReader *reader, CommandStreamCommand *out) {
+    CommandStreamRecord record;
+    if (reader->end - reader->cursor < (ptrdiff_t) sizeof(record)) {
+        return false;
+    }
+    memcpy(&record, reader->cursor, sizeof(record));
+    const u8 *data = reader->cursor + sizeof(record);
+    if ((size_t) (reader->end - data) < record.size) {
+        LOG_ERROR("Command stream is truncated");
+        return false;
+    }
+    reader->cursor = data + record.size;
+
+    memset(out, 0, sizeof(CommandStreamCommand));
+    out->type = record.type;
+    u32 values[5] = {0};
+    bool valid = true;
+    switch (record.type) {
+        case COMMAND_STREAM_INIT:
+        case COMMAND_STREAM_PRESENT: {
+            u32 count = record.type == COMMAND_STREAM_INIT ? 5 : 3;
+            valid = record.size == sizeof(u32) * count;
+            if (valid) {
+                memcpy(values, data, sizeof(u32) * count);
+                out->present.policy = values[0] < PRESENT_POLICY_MAX ? values[0] : PRESENT_POLICY_TEAR_FREE;
+                out->present.target_fps = values[1];
+                out->present.variable_refresh = values[2] != 0;
+                out->width = values[3];
+                out->height = values[4];
+            }
+            break;
+        }
+        case COMMAND_STREAM_LOAD_MESH:
+            valid = record.size >= sizeof(u32);
+            if (valid) {
+                memcpy(&out->mesh, data, sizeof(u32));
+                out->path = (const char *) data + sizeof(u32);
+                out->path_length = record.size - sizeof(u32);
+            }
+            break;
+        case COMMAND_STREAM_LOAD_TEXTURE:
+            valid = record.size >= sizeof(u32);
+            if (valid) {
+                memcpy(&out->texture, data, sizeof(u32));
+                out->path = (const char *) data + sizeof(u32);
+                out->path_length = record.size - sizeof(u32);
+            }
+            break;
+        case COMMAND_STREAM_MATERIAL:
+            valid = record.size == sizeof(u32) * 6;
+            if (valid) {
+                memcpy(&out->material, data, sizeof(u32));
+                memcpy(out->base_color, data + sizeof(u32), sizeof(float) * 4);
+                memcpy(&out->texture, data + sizeof(u32) * 5, sizeof(u32));
+            }
+            break;
+        case COMMAND_STREAM_VIEW:
+            valid = record.size == sizeof(float) * 19;
+            if (valid) {
+                memcpy(out->view_projection, data, sizeof(float) * 16);
+                memcpy(out->camera, data + sizeof(float) * 16, sizeof(float) * 3);
+            }
+            break;
+        case COMMAND_STREAM_RESIZE:
+            valid = record.size == sizeof(u32) * 2;
+            if (valid) {
+                memcpy(values, data, sizeof(u32) * 2);
+                out->width = values[0];
+                out->height = values[1];
+            }
+            break;
+        case COMMAND_STREAM_FRAME_BUDGET:
+            valid = record.size == sizeof(double);
+            if (valid) {
+                memcpy(&out->milliseconds, data, sizeof(double));
+            }
+            break;
+        case COMMAND_STREAM_DRAWS:
+            valid = command_stream_read_list(&reader->draws, sizeof(MeshletDraw), data, record.size);
+            break;
+        case COMMAND_STREAM_LIGHTS:
+            valid = command_stream_read_list(&reader->lights, sizeof(Light), data, record.size);
+            break;
+        case COMMAND_STREAM_FRAME:
+            valid = record.size == sizeof(u64);
+            if (valid) {
+                memcpy(&out->timestamp, data, sizeof(u64));
+            }
+            break;
+        case COMMAND_STREAM_PARTICLES:
+            valid = record.size == sizeof(ParticleSettings);
+            if (valid) {
+                memcpy(&out->particles, data, sizeof(ParticleSettings));
+            }
+            break;
+        default:
+            // Newer record types are skipped
+            return command_stream_read(reader, out);
+    }
+
+    if (!valid) {
+        LOG_ERROR("Malformed command stream record of type %u", record.type);
+    }
+    return valid;
+}
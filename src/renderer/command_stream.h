@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stdio.h>
+#include <std/defines.h>
+#include "core/mapped_file.h"
+#include "light_clusters.h"
+#include "meshlet_renderer.h"
+#include "particles.h"
+#include "swapchain.h"
+
+#define COMMAND_STREAM_MAGIC 0x53434b56u // "VKCS"
+#define COMMAND_STREAM_VERSION 1
+
+// Every record starts with its type and the size of what follows, so readers can skip types they don't know
+typedef enum CommandStreamType {
+    // Present settings and drawable size when recording started
+    COMMAND_STREAM_INIT,
+    COMMAND_STREAM_LOAD_MESH,
+    COMMAND_STREAM_VIEW,
+    COMMAND_STREAM_PRESENT,
+    COMMAND_STREAM_RESIZE,
+    COMMAND_STREAM_FRAME_BUDGET,
+    // Ranges of the draw list that changed since the previous frame
+    COMMAND_STREAM_DRAWS,
+    // Ends a frame, carries nanoseconds since recording started
+    COMMAND_STREAM_FRAME,
+    // ParticleSettings the particle system was restarted with
+    COMMAND_STREAM_PARTICLES,
+    // Ranges of the light list that changed since the previous frame, laid out like DRAWS
+    COMMAND_STREAM_LIGHTS,
+    COMMAND_STREAM_LOAD_TEXTURE,
+    // Material index, base color and albedo texture id
+    COMMAND_STREAM_MATERIAL,
+} CommandStreamType;
+
+typedef struct CommandStreamHeader {
+    u32 magic;
+    u32 version;
+} CommandStreamHeader;
+
+typedef struct CommandStreamRecord {
+    u32 type;
+    u32 size;
+} CommandStreamRecord;
+
+// One per frame list written as changed ranges: what the last frame wrote, or what a reader has patched together
+typedef struct CommandStreamList {
+    void *elements;
+    u32 count;
+    u32 capacity;
+} CommandStreamList;
+
+// Renderer level work of a session, written at the vulkan_* API boundary on the main thread
+typedef struct CommandStreamWriter {
+    FILE *file;
+    u64 start;
+    u64 frames;
+    // Lists of the last frame, unchanged elements are not written again
+    CommandStreamList draws;
+    CommandStreamList lights;
+} CommandStreamWriter;
+
+bool command_stream_writer_open(const char *path, CommandStreamWriter *out);
+
+void command_stream_writer_close(CommandStreamWriter *writer);
+
+void command_stream_write_init(CommandStreamWriter *writer, const PresentSettings *present, u32 width, u32 height);
+
+void command_stream_write_load_mesh(CommandStreamWriter *writer, u32 mesh, const char *path);
+
+void command_stream_write_load_texture(CommandStreamWriter *writer, u32 texture, const char *path);
+
+void command_stream_write_material(CommandStreamWriter *writer, u32 material, const float *base_color,
+                                   u32 albedo_texture);
+
+void command_stream_write_view(CommandStreamWriter *writer, const float *view_projection, const float *camera);
+
+void command_stream_write_present(CommandStreamWriter *writer, const PresentSettings *present);
+
+void command_stream_write_resize(CommandStreamWriter *writer, u32 width, u32 height);
+
+void command_stream_write_frame_budget(CommandStreamWriter *writer, double milliseconds);
+
+void command_stream_write_particles(CommandStreamWriter *writer, const ParticleSettings *settings);
+
+// Closes the frame built since the last call with its draw and light lists
+void command_stream_write_frame(CommandStreamWriter *writer, const MeshletDrawList *draws, const LightList *lights);
+
+typedef struct CommandStreamCommand {
+    CommandStreamType type;
+    PresentSettings present;
+    u32 width;
+    u32 height;
+    u32 mesh;
+    u32 texture;
+    u32 material;
+    float base_color[4];
+    // Points into the mapped file, not terminated
+    const char *path;
+    u32 path_length;
+    float view_projection[16];
+    float camera[3];
+    double milliseconds;
+    u64 timestamp;
+    ParticleSettings particles;
+} CommandStreamCommand;
+
+typedef struct CommandStreamReader {
+    MappedFile file;
+    const u8 *cursor;
+    const u8 *end;
+    // Current MeshletDraw and Light lists, DRAWS and LIGHTS records patch them in place
+    CommandStreamList draws;
+    CommandStreamList lights;
+} CommandStreamReader;
+
+bool command_stream_reader_open(const char *path, CommandStreamReader *out);
+
+void command_stream_reader_close(CommandStreamReader *reader);
+
+// False at the end of the stream or on a malformed record. DRAWS and LIGHTS records update reader->draws and
+// reader->lights and are returned too.
+bool command_stream_read(CommandStreamReader *reader, CommandStreamCommand *out);
@@ -0,0 +1,620 @@
+#include "debug_overlay.h"
+#include "host_allocator.h"
+#include "vulkan.h"
+#include "shader.h"
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <std/containers/darray.h>
+
+// Glyphs sit in padded cells so linear filtering never reaches into a neighbour
+#define DEBUG_OVERLAY_CELL_WIDTH (DEBUG_OVERLAY_GLYPH_WIDTH + 2)
+#define DEBUG_OVERLAY_CELL_HEIGHT (DEBUG_OVERLAY_GLYPH_HEIGHT + 2)
+#define DEBUG_OVERLAY_ATLAS_WIDTH (DEBUG_OVERLAY_ATLAS_COLUMNS * DEBUG_OVERLAY_CELL_WIDTH)
+#define DEBUG_OVERLAY_ATLAS_HEIGHT (DEBUG_OVERLAY_GLYPH_COUNT / DEBUG_OVERLAY_ATLAS_COLUMNS * DEBUG_OVERLAY_CELL_HEIGHT)
+#define DEBUG_OVERLAY_SOLID_GLYPH (DEBUG_OVERLAY_GLYPH_COUNT - 1)
+#define DEBUG_OVERLAY_MARGIN 8.0f
+#define DEBUG_OVERLAY_GRAPH_HEIGHT 48.0f
+#define DEBUG_OVERLAY_BAR_WIDTH 2.0f
+
+#define DEBUG_OVERLAY_RGBA(r, g, b, a) ((u32) (r) | (u32) (g) << 8 | (u32) (b) << 16 | (u32) (a) << 24)
+#define DEBUG_OVERLAY_PANEL DEBUG_OVERLAY_RGBA(0, 0, 0, 176)
+#define DEBUG_OVERLAY_TEXT DEBUG_OVERLAY_RGBA(230, 230, 230, 255)
+#define DEBUG_OVERLAY_DIM DEBUG_OVERLAY_RGBA(150, 150, 150, 255)
+#define DEBUG_OVERLAY_WARNING DEBUG_OVERLAY_RGBA(255, 80, 64, 255)
+#define DEBUG_OVERLAY_FRAME_BAR DEBUG_OVERLAY_RGBA(96, 200, 96, 255)
+#define DEBUG_OVERLAY_GPU_BAR DEBUG_OVERLAY_RGBA(255, 170, 40, 255)
+
+// DejaVu Sans Mono rendered by FreeType at 12 pixels in monochrome, baseline on row 11. One row per byte, bit 0 is the
+// leftmost pixel.
+const u8 debug_overlay_font[DEBUG_OVERLAY_GLYPH_COUNT - 1][DEBUG_OVERLAY_GLYPH_HEIGHT] = {
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // space
+        {0x00, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x08, 0x08, 0x00, 0x00, 0x00}, // !
+        {0x00, 0x00, 0x14, 0x14, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // "
+        {0x00, 0x00, 0x00, 0x28, 0x24, 0x7e, 0x14, 0x14, 0x3f, 0x12, 0x0a, 0x00, 0x00, 0x00}, // #
+        {0x00, 0x00, 0x08, 0x1c, 0x2a, 0x0a, 0x0e, 0x38, 0x28, 0x2a, 0x1c, 0x08, 0x08, 0x00}, // $
+        {0x00, 0x00, 0x06, 0x09, 0x09, 0x26, 0x18, 0x36, 0x48, 0x48, 0x30, 0x00, 0x00, 0x00}, // %
+        {0x00, 0x00, 0x38, 0x04, 0x04, 0x0c, 0x0c, 0x52, 0x72, 0x26, 0x5c, 0x00, 0x00, 0x00}, // &
+        {0x00, 0x00, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // '
+        {0x00, 0x30, 0x10, 0x10, 0x08, 0x08, 0x08, 0x08, 0x08, 0x10, 0x10, 0x30, 0x00, 0x00}, // (
+        {0x00, 0x0c, 0x08, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x08, 0x08, 0x0c, 0x00, 0x00}, // )
+        {0x00, 0x00, 0x08, 0x2a, 0x1c, 0x1c, 0x2a, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // *
+        {0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x08, 0x7f, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00}, // +
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x04, 0x00, 0x00}, // ,
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // -
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x00, 0x00, 0x00}, // .
+        {0x00, 0x00, 0x40, 0x20, 0x20, 0x10, 0x10, 0x08, 0x08, 0x04, 0x04, 0x02, 0x00, 0x00}, // /
+        {0x00, 0x00, 0x3c, 0x24, 0x42, 0x42, 0x52, 0x42, 0x42, 0x24, 0x3c, 0x00, 0x00, 0x00}, // 0
+        {0x00, 0x00, 0x0e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x3e, 0x00, 0x00, 0x00}, // 1
+        {0x00, 0x00, 0x3c, 0x42, 0x40, 0x40, 0x20, 0x10, 0x08, 0x04, 0x7e, 0x00, 0x00, 0x00}, // 2
+        {0x00, 0x00, 0x3c, 0x42, 0x40, 0x40, 0x38, 0x40, 0x40, 0x42, 0x3c, 0x00, 0x00, 0x00}, // 3
+        {0x00, 0x00, 0x30, 0x30, 0x28, 0x2c, 0x24, 0x22, 0x7e, 0x20, 0x20, 0x00, 0x00, 0x00}, // 4
+        {0x00, 0x00, 0x3e, 0x02, 0x02, 0x3e, 0x60, 0x40, 0x40, 0x62, 0x3c, 0x00, 0x00, 0x00}, // 5
+        {0x00, 0x00, 0x38, 0x44, 0x02, 0x3a, 0x66, 0x42, 0x42, 0x64, 0x3c, 0x00, 0x00, 0x00}, // 6
+        {0x00, 0x00, 0x7e, 0x60, 0x20, 0x20, 0x10, 0x10, 0x08, 0x08, 0x04, 0x00, 0x00, 0x00}, // 7
+        {0x00, 0x00, 0x3c, 0x42, 0x42, 0x42, 0x3c, 0x42, 0x42, 0x42, 0x3c, 0x00, 0x00, 0x00}, // 8
+        {0x00, 0x00, 0x3c, 0x26, 0x42, 0x42, 0x62, 0x5c, 0x40, 0x22, 0x1c, 0x00, 0x00, 0x00}, // 9
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x00, 0x00, 0x08, 0x08, 0x00, 0x00, 0x00}, // :
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x00, 0x00, 0x08, 0x08, 0x04, 0x00, 0x00}, // ;
+        {0x00, 0x00, 0x00, 0x00, 0x40, 0x38, 0x06, 0x06, 0x38, 0x40, 0x00, 0x00, 0x00, 0x00}, // <
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7e, 0x00, 0x7e, 0x00, 0x00, 0x00, 0x00, 0x00}, // =
+        {0x00, 0x00, 0x00, 0x00, 0x02, 0x1c, 0x60, 0x60, 0x1c, 0x02, 0x00, 0x00, 0x00, 0x00}, // >
+        {0x00, 0x00, 0x38, 0x44, 0x40, 0x30, 0x18, 0x08, 0x00, 0x08, 0x08, 0x00, 0x00, 0x00}, // ?
+        {0x00, 0x00, 0x00, 0x38, 0x64, 0x42, 0x72, 0x4a, 0x4a, 0x72, 0x06, 0x04, 0x38, 0x00}, // @
+        {0x00, 0x00, 0x18, 0x18, 0x18, 0x24, 0x24, 0x24, 0x3c, 0x42, 0x42, 0x00, 0x00, 0x00}, // A
+        {0x00, 0x00, 0x3e, 0x42, 0x42, 0x42, 0x3e, 0x42, 0x42, 0x42, 0x3e, 0x00, 0x00, 0x00}, // B
+        {0x00, 0x00, 0x38, 0x44, 0x02, 0x02, 0x02, 0x02, 0x02, 0x44, 0x38, 0x00, 0x00, 0x00}, // C
+        {0x00, 0x00, 0x1e, 0x22, 0x42, 0x42, 0x42, 0x42, 0x42, 0x22, 0x1e, 0x00, 0x00, 0x00}, // D
+        {0x00, 0x00, 0x7e, 0x02, 0x02, 0x02, 0x7e, 0x02, 0x02, 0x02, 0x7e, 0x00, 0x00, 0x00}, // E
+        {0x00, 0x00, 0x7e, 0x02, 0x02, 0x02, 0x7e, 0x02, 0x02, 0x02, 0x02, 0x00, 0x00, 0x00}, // F
+        {0x00, 0x00, 0x38, 0x44, 0x02, 0x02, 0x62, 0x42, 0x42, 0x44, 0x38, 0x00, 0x00, 0x00}, // G
+        {0x00, 0x00, 0x42, 0x42, 0x42, 0x42, 0x7e, 0x42, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00}, // H
+        {0x00, 0x00, 0x3e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x3e, 0x00, 0x00, 0x00}, // I
+        {0x00, 0x00, 0x38, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x1c, 0x00, 0x00, 0x00}, // J
+        {0x00, 0x00, 0x42, 0x22, 0x12, 0x0a, 0x0e, 0x12, 0x32, 0x22, 0x42, 0x00, 0x00, 0x00}, // K
+        {0x00, 0x00, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x7e, 0x00, 0x00, 0x00}, // L
+        {0x00, 0x00, 0x42, 0x66, 0x66, 0x5a, 0x5a, 0x5a, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00}, // M
+        {0x00, 0x00, 0x46, 0x46, 0x4a, 0x4a, 0x5a, 0x52, 0x52, 0x62, 0x62, 0x00, 0x00, 0x00}, // N
+        {0x00, 0x00, 0x3c, 0x24, 0x42, 0x42, 0x42, 0x42, 0x42, 0x24, 0x3c, 0x00, 0x00, 0x00}, // O
+        {0x00, 0x00, 0x3e, 0x42, 0x42, 0x42, 0x3e, 0x02, 0x02, 0x02, 0x02, 0x00, 0x00, 0x00}, // P
+        {0x00, 0x00, 0x3c, 0x24, 0x42, 0x42, 0x42, 0x42, 0x42, 0x64, 0x3c, 0x20, 0x20, 0x00}, // Q
+        {0x00, 0x00, 0x3e, 0x42, 0x42, 0x42, 0x3e, 0x22, 0x42, 0x42, 0x02, 0x00, 0x00, 0x00}, // R
+        {0x00, 0x00, 0x3c, 0x42, 0x02, 0x06, 0x3c, 0x40, 0x40, 0x42, 0x3c, 0x00, 0x00, 0x00}, // S
+        {0x00, 0x00, 0x7f, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00}, // T
+        {0x00, 0x00, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x3c, 0x00, 0x00, 0x00}, // U
+        {0x00, 0x00, 0x42, 0x42, 0x24, 0x24, 0x24, 0x24, 0x18, 0x18, 0x18, 0x00, 0x00, 0x00}, // V
+        {0x00, 0x00, 0x41, 0x49, 0x49, 0x55, 0x55, 0x55, 0x36, 0x22, 0x22, 0x00, 0x00, 0x00}, // W
+        {0x00, 0x00, 0x42, 0x24, 0x24, 0x18, 0x18, 0x18, 0x24, 0x24, 0x42, 0x00, 0x00, 0x00}, // X
+        {0x00, 0x00, 0x41, 0x22, 0x14, 0x14, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00}, // Y
+        {0x00, 0x00, 0x7e, 0x60, 0x20, 0x10, 0x18, 0x08, 0x04, 0x06, 0x7e, 0x00, 0x00, 0x00}, // Z
+        {0x00, 0x18, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x18, 0x00, 0x00}, // [
+        {0x00, 0x00, 0x02, 0x04, 0x04, 0x08, 0x08, 0x10, 0x10, 0x20, 0x20, 0x40, 0x00, 0x00}, // backslash
+        {0x00, 0x0c, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0c, 0x00, 0x00}, // ]
+        {0x00, 0x00, 0x0c, 0x12, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // ^
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7f}, // _
+        {0x00, 0x08, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // `
+        {0x00, 0x00, 0x00, 0x00, 0x1c, 0x22, 0x20, 0x3c, 0x22, 0x22, 0x3c, 0x00, 0x00, 0x00}, // a
+        {0x00, 0x02, 0x02, 0x02, 0x1e, 0x22, 0x22, 0x22, 0x22, 0x22, 0x1e, 0x00, 0x00, 0x00}, // b
+        {0x00, 0x00, 0x00, 0x00, 0x1c, 0x26, 0x02, 0x02, 0x02, 0x06, 0x3c, 0x00, 0x00, 0x00}, // c
+        {0x00, 0x20, 0x20, 0x20, 0x3c, 0x22, 0x22, 0x22, 0x22, 0x22, 0x3c, 0x00, 0x00, 0x00}, // d
+        {0x00, 0x00, 0x00, 0x00, 0x1c, 0x26, 0x22, 0x3e, 0x02, 0x22, 0x1c, 0x00, 0x00, 0x00}, // e
+        {0x00, 0x30, 0x08, 0x08, 0x3e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00}, // f
+        {0x00, 0x00, 0x00, 0x00, 0x3c, 0x22, 0x22, 0x22, 0x22, 0x22, 0x3c, 0x20, 0x24, 0x18}, // g
+        {0x00, 0x02, 0x02, 0x02, 0x1a, 0x26, 0x22, 0x22, 0x22, 0x22, 0x22, 0x00, 0x00, 0x00}, // h
+        {0x00, 0x08, 0x00, 0x00, 0x0e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x3e, 0x00, 0x00, 0x00}, // i
+        {0x00, 0x10, 0x00, 0x00, 0x1c, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x0c}, // j
+        {0x00, 0x02, 0x02, 0x02, 0x22, 0x12, 0x0a, 0x06, 0x0a, 0x12, 0x22, 0x00, 0x00, 0x00}, // k
+        {0x00, 0x0e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x30, 0x00, 0x00, 0x00}, // l
+        {0x00, 0x00, 0x00, 0x00, 0x3e, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x00, 0x00, 0x00}, // m
+        {0x00, 0x00, 0x00, 0x00, 0x1a, 0x26, 0x22, 0x22, 0x22, 0x22, 0x22, 0x00, 0x00, 0x00}, // n
+        {0x00, 0x00, 0x00, 0x00, 0x1c, 0x22, 0x22, 0x22, 0x22, 0x22, 0x1c, 0x00, 0x00, 0x00}, // o
+        {0x00, 0x00, 0x00, 0x00, 0x1e, 0x22, 0x22, 0x22, 0x22, 0x22, 0x1e, 0x02, 0x02, 0x02}, // p
+        {0x00, 0x00, 0x00, 0x00, 0x3c, 0x22, 0x22, 0x22, 0x22, 0x22, 0x3c, 0x20, 0x20, 0x20}, // q
+        {0x00, 0x00, 0x00, 0x00, 0x3c, 0x4c, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x00, 0x00}, // r
+        {0x00, 0x00, 0x00, 0x00, 0x1c, 0x22, 0x02, 0x1c, 0x20, 0x22, 0x1c, 0x00, 0x00, 0x00}, // s
+        {0x00, 0x00, 0x08, 0x08, 0x3e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x38, 0x00, 0x00, 0x00}, // t
+        {0x00, 0x00, 0x00, 0x00, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x3c, 0x00, 0x00, 0x00}, // u
+        {0x00, 0x00, 0x00, 0x00, 0x22, 0x22, 0x14, 0x14, 0x14, 0x08, 0x08, 0x00, 0x00, 0x00}, // v
+        {0x00, 0x00, 0x00, 0x00, 0x41, 0x41, 0x2a, 0x2a, 0x36, 0x14, 0x14, 0x00, 0x00, 0x00}, // w
+        {0x00, 0x00, 0x00, 0x00, 0x22, 0x14, 0x14, 0x08, 0x14, 0x14, 0x22, 0x00, 0x00, 0x00}, // x
+        {0x00, 0x00, 0x00, 0x00, 0x22, 0x22, 0x14, 0x14, 0x14, 0x0c, 0x08, 0x08, 0x04, 0x06}, // y
+        {0x00, 0x00, 0x00, 0x00, 0x3e, 0x20, 0x10, 0x08, 0x04, 0x02, 0x3e, 0x00, 0x00, 0x00}, // z
+        {0x00, 0x38, 0x08, 0x08, 0x08, 0x08, 0x06, 0x08, 0x08, 0x08, 0x08, 0x38, 0x00, 0x00}, // {
+        {0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00}, // |
+        {0x00, 0x0e, 0x08, 0x08, 0x08, 0x08, 0x30, 0x08, 0x08, 0x08, 0x08, 0x0e, 0x00, 0x00}, // }
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0e, 0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // ~
+};
+
+typedef struct DebugOverlayBuilder {
+    DebugOverlayVertex *vertices;
+    u32 quad_count;
+    float scale;
+    // Pen position, the top left of the next line
+    float x;
+    float y;
+    float right;
+} DebugOverlayBuilder;
+
+bool debug_overlay_atlas_upload(VulkanContext *context, DebugOverlay *overlay, Buffer *staging) {
+    u8 *pixels = staging->mapped;
+    memset(pixels, 0, DEBUG_OVERLAY_ATLAS_WIDTH * DEBUG_OVERLAY_ATLAS_HEIGHT);
+    for (u32 glyph = 0; glyph < DEBUG_OVERLAY_GLYPH_COUNT; ++glyph) {
+        u32 cell_x = glyph % DEBUG_OVERLAY_ATLAS_COLUMNS * DEBUG_OVERLAY_CELL_WIDTH;
+        u32 cell_y = glyph / DEBUG_OVERLAY_ATLAS_COLUMNS * DEBUG_OVERLAY_CELL_HEIGHT;
+        for (u32 y = 0; y < DEBUG_OVERLAY_CELL_HEIGHT; ++y) {
+            u8 *row = &pixels[(cell_y + y) * DEBUG_OVERLAY_ATLAS_WIDTH + cell_x];
+            if (glyph == DEBUG_OVERLAY_SOLID_GLYPH) {
+                memset(row, 255, DEBUG_OVERLAY_CELL_WIDTH);
+                continue;
+            }
+            if (y == 0 || y > DEBUG_OVERLAY_GLYPH_HEIGHT) {
+                continue;
+            }
+
+            u8 bits = debug_overlay_font[glyph][y - 1];
+            for (u32 x = 0; x < DEBUG_OVERLAY_GLYPH_WIDTH; ++x) {
+                row[x + 1] = bits & (1u << x) ? 255 : 0;
+            }
+        }
+    }
+
+    VkCommandBufferAllocateInfo allocate_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    allocate_info.commandPool = context->command_pool;
+    allocate_info.commandBufferCount = 1;
+    allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    VkCommandBuffer command_buffer;
+    VK_CHECK(vkAllocateCommandBuffers(context->device.vk_device, &allocate_info, &command_buffer));
+
+    VkCommandBufferBeginInfo begin_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK(vkBeginCommandBuffer(command_buffer, &begin_info));
+
+    image_transition(command_buffer, overlay->atlas.vk_image, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1,
+                     VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                     VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    VkBufferImageCopy region = {0};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent.width = DEBUG_OVERLAY_ATLAS_WIDTH;
+    region.imageExtent.height = DEBUG_OVERLAY_ATLAS_HEIGHT;
+    region.imageExtent.depth = 1;
+    vkCmdCopyBufferToImage(command_buffer, staging->vk_buffer, overlay->atlas.vk_image,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    image_transition(command_buffer, overlay->atlas.vk_image, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1,
+                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                     VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    VK_CHECK(vkEndCommandBuffer(command_buffer));
+
+    VkFenceCreateInfo fence_create_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    VkFence fence;
+    VK_CHECK(vkCreateFence(context->device.vk_device, &fence_create_info, host_allocator(), &fence));
+
+    VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &command_buffer;
+    VK_CHECK(vkQueueSubmit(context->device.queues[QUEUE_FEATURE_GRAPHICS].vk_queue, 1, &submit_info, fence));
+    VK_CHECK(vkWaitForFences(context->device.vk_device, 1, &fence, VK_TRUE, UINT64_MAX));
+
+    vkDestroyFence(context->device.vk_device, fence, host_allocator());
+    vkFreeCommandBuffers(context->device.vk_device, context->command_pool, 1, &command_buffer);
+    return true;
+}
+
+bool debug_overlay_atlas_create(VulkanContext *context, DebugOverlay *overlay) {
+    ImageConfig config = {
+            .format = VK_FORMAT_R8_UNORM,
+            .extent = {DEBUG_OVERLAY_ATLAS_WIDTH, DEBUG_OVERLAY_ATLAS_HEIGHT},
+            .mip_levels = 1,
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            .aspect = VK_IMAGE_ASPECT_COLOR_BIT,
+            .memory_properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    };
+    if (!image_create(&context->physical_device, &context->device, &config, &overlay->atlas)) {
+        return false;
+    }
+
+    Buffer staging;
+    if (!buffer_create(&context->physical_device, &context->device,
+                       DEBUG_OVERLAY_ATLAS_WIDTH * DEBUG_OVERLAY_ATLAS_HEIGHT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &staging)) {
+        return false;
+    }
+    bool uploaded = debug_overlay_atlas_upload(context, overlay, &staging);
+    buffer_destroy(&context->device, &staging);
+    if (!uploaded) {
+        return false;
+    }
+
+    // Linear, so text stays readable while the scene renders below full resolution and is scaled up
+    sampler_create(&context->physical_device, &context->device, VK_FILTER_LINEAR,
+                   VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, &overlay->sampler);
+    overlay->sampler_handle = bindless_register_sampler(&context->device, &context->bindless, overlay->sampler);
+    overlay->atlas_handle = bindless_register_sampled_image(&context->device, &context->bindless,
+                                                            overlay->atlas.view,
+                                                            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    return overlay->atlas_handle != BINDLESS_INVALID_HANDLE && overlay->sampler_handle != BINDLESS_INVALID_HANDLE;
+}
+
+bool debug_overlay_pipeline_create(VulkanContext *context, DebugOverlay *overlay) {
+    Device *device = &context->device;
+    VkPushConstantRange push_constant_range = {0};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_ALL;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(DebugOverlayConstants);
+
+    VkPipelineLayoutCreateInfo layout_create_info = {VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    layout_create_info.setLayoutCount = 1;
+    layout_create_info.pSetLayouts = &context->bindless.layout;
+    layout_create_info.pushConstantRangeCount = 1;
+    layout_create_info.pPushConstantRanges = &push_constant_range;
+    VK_CHECK(vkCreatePipelineLayout(device->vk_device, &layout_create_info, host_allocator(), &overlay->layout));
+
+    Shader shader = {0};
+    if (!shader_load(device, "debug_overlay.vert.spv", "debug_overlay.frag.spv", &shader)) {
+        return false;
+    }
+
+    VkPipelineShaderStageCreateInfo stage_create_infos[2] = {
+            {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO},
+            {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO}
+    };
+    stage_create_infos[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stage_create_infos[0].module = shader.vertex;
+    stage_create_infos[0].pName = "main";
+    stage_create_infos[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stage_create_infos[1].module = shader.fragment;
+    stage_create_infos[1].pName = "main";
+
+    VkVertexInputBindingDescription binding = {0};
+    binding.binding = 0;
+    binding.stride = sizeof(DebugOverlayVertex);
+    binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    VkVertexInputAttributeDescription attributes[3] = {
+            {0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(DebugOverlayVertex, position)},
+            {1, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(DebugOverlayVertex, uv)},
+            {2, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(DebugOverlayVertex, color)}
+    };
+
+    VkPipelineVertexInputStateCreateInfo vertex_input_create_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+    vertex_input_create_info.vertexBindingDescriptionCount = 1;
+    vertex_input_create_info.pVertexBindingDescriptions = &binding;
+    vertex_input_create_info.vertexAttributeDescriptionCount = 3;
+    vertex_input_create_info.pVertexAttributeDescriptions = attributes;
+
+    VkPipelineInputAssemblyStateCreateInfo input_assembly_create_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
+    input_assembly_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkDynamicState dynamic_states[] = {
+            VK_DYNAMIC_STATE_VIEWPORT,
+            VK_DYNAMIC_STATE_SCISSOR
+    };
+    VkPipelineDynamicStateCreateInfo dynamic_state_create_info = {VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
+    dynamic_state_create_info.dynamicStateCount = sizeof(dynamic_states) / sizeof(VkDynamicState);
+    dynamic_state_create_info.pDynamicStates = dynamic_states;
+
+    VkPipelineViewportStateCreateInfo viewport_state_create_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO};
+    viewport_state_create_info.viewportCount = 1;
+    viewport_state_create_info.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterization_create_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO};
+    rasterization_create_info.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterization_create_info.lineWidth = 1.0f;
+    rasterization_create_info.cullMode = VK_CULL_MODE_NONE;
+
+    VkPipelineMultisampleStateCreateInfo multisample_create_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO};
+    multisample_create_info.rasterizationSamples = context->graphics_pipeline.samples;
+    multisample_create_info.minSampleShading = 1.0f;
+
+    // Drawn last over whatever the scene left in the depth buffer
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_create_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO};
+    depth_stencil_create_info.depthTestEnable = VK_FALSE;
+    depth_stencil_create_info.depthWriteEnable = VK_FALSE;
+
+    VkPipelineColorBlendAttachmentState color_blend_attachment_state = {0};
+    color_blend_attachment_state.colorWriteMask =
+            VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    color_blend_attachment_state.blendEnable = VK_TRUE;
+    color_blend_attachment_state.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    color_blend_attachment_state.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    color_blend_attachment_state.colorBlendOp = VK_BLEND_OP_ADD;
+    color_blend_attachment_state.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    color_blend_attachment_state.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    color_blend_attachment_state.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    VkPipelineColorBlendStateCreateInfo color_blend_create_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO};
+    color_blend_create_info.attachmentCount = 1;
+    color_blend_create_info.pAttachments = &color_blend_attachment_state;
+
+    VkGraphicsPipelineCreateInfo pipeline_create_info = {VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
+    pipeline_create_info.stageCount = 2;
+    pipeline_create_info.pStages = stage_create_infos;
+    pipeline_create_info.pVertexInputState = &vertex_input_create_info;
+    pipeline_create_info.pInputAssemblyState = &input_assembly_create_info;
+    pipeline_create_info.pViewportState = &viewport_state_create_info;
+    pipeline_create_info.pRasterizationState = &rasterization_create_info;
+    pipeline_create_info.pMultisampleState = &multisample_create_info;
+    pipeline_create_info.pDepthStencilState = &depth_stencil_create_info;
+    pipeline_create_info.pColorBlendState = &color_blend_create_info;
+    pipeline_create_info.pDynamicState = &dynamic_state_create_info;
+    pipeline_create_info.layout = overlay->layout;
+    pipeline_create_info.renderPass = context->graphics_pipeline.render_pass;
+    pipeline_create_info.subpass = 0;
+    pipeline_create_info.basePipelineIndex = -1;
+    VK_CHECK(vkCreateGraphicsPipelines(device->vk_device, device->pipeline_cache, 1, &pipeline_create_info, host_allocator(),
+                                       &overlay->pipeline));
+
+    shader_destroy(device, &shader);
+    return true;
+}
+
+bool debug_overlay_create(VulkanContext *context, DebugOverlay *out) {
+    DebugOverlay result = {0};
+    atomic_init(&result.enabled, false);
+
+    VkDeviceSize size = sizeof(DebugOverlayVertex) * 6 * DEBUG_OVERLAY_MAX_QUADS *
+                        darray_length(context->renderer_instances);
+    if (!buffer_create(&context->physical_device, &context->device, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                       &result.vertices)) {
+        LOG_ERROR("Couldn't create the debug overlay vertex buffer!");
+        return false;
+    }
+
+    if (!debug_overlay_atlas_create(context, &result)) {
+        LOG_ERROR("Couldn't create the debug overlay glyph atlas!");
+        debug_overlay_destroy(context, &result);
+        return false;
+    }
+
+    if (!debug_overlay_pipeline_create(context, &result)) {
+        LOG_ERROR("Couldn't create the debug overlay pipeline!");
+        debug_overlay_destroy(context, &result);
+        return false;
+    }
+
+    *out = result;
+    return true;
+}
+
+void debug_overlay_destroy(VulkanContext *context, DebugOverlay *overlay) {
+    Device *device = &context->device;
+    vkDestroyPipeline(device->vk_device, overlay->pipeline, host_allocator());
+    overlay->pipeline = NULL;
+    vkDestroyPipelineLayout(device->vk_device, overlay->layout, host_allocator());
+    overlay->layout = NULL;
+
+    sampler_destroy(device, &overlay->sampler);
+    image_destroy(device, &overlay->atlas);
+    buffer_destroy(device, &overlay->vertices);
+}
+
+void debug_overlay_quad(DebugOverlayBuilder *builder, u32 quad, float x0, float y0, float x1, float y1, u32 glyph,
+                        u32 color) {
+    float u0 = (float) (glyph % DEBUG_OVERLAY_ATLAS_COLUMNS * DEBUG_OVERLAY_CELL_WIDTH + 1);
+    float v0 = (float) (glyph / DEBUG_OVERLAY_ATLAS_COLUMNS * DEBUG_OVERLAY_CELL_HEIGHT + 1);
+    float u1 = u0 + DEBUG_OVERLAY_GLYPH_WIDTH;
+    float v1 = v0 + DEBUG_OVERLAY_GLYPH_HEIGHT;
+    if (glyph == DEBUG_OVERLAY_SOLID_GLYPH) {
+        // Every sample lands inside the solid cell however the quad is stretched
+        u0 = u1 = u0 + DEBUG_OVERLAY_GLYPH_WIDTH * 0.5f;
+        v0 = v1 = v0 + DEBUG_OVERLAY_GLYPH_HEIGHT * 0.5f;
+    }
+    u0 /= DEBUG_OVERLAY_ATLAS_WIDTH;
+    u1 /= DEBUG_OVERLAY_ATLAS_WIDTH;
+    v0 /= DEBUG_OVERLAY_ATLAS_HEIGHT;
+    v1 /= DEBUG_OVERLAY_ATLAS_HEIGHT;
+
+    DebugOverlayVertex corners[4] = {
+            {{x0, y0}, {u0, v0}, color},
+            {{x1, y0}, {u1, v0}, color},
+            {{x1, y1}, {u1, v1}, color},
+            {{x0, y1}, {u0, v1}, color}
+    };
+    DebugOverlayVertex *vertices = &builder->vertices[quad * 6];
+    vertices[0] = corners[0];
+    vertices[1] = corners[1];
+    vertices[2] = corners[2];
+    vertices[3] = corners[0];
+    vertices[4] = corners[2];
+    vertices[5] = corners[3];
+}
+
+void debug_overlay_rect(DebugOverlayBuilder *builder, float x, float y, float width, float height, u32 color) {
+    if (builder->quad_count < DEBUG_OVERLAY_MAX_QUADS) {
+        debug_overlay_quad(builder, builder->quad_count++, x, y, x + width, y + height, DEBUG_OVERLAY_SOLID_GLYPH,
+                           color);
+    }
+}
+
+// Prints one line at the pen and moves it down
+void debug_overlay_line(DebugOverlayBuilder *builder, u32 color, const char *format, ...) {
+    char text[128];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    float width = DEBUG_OVERLAY_GLYPH_WIDTH * builder->scale;
+    float height = DEBUG_OVERLAY_GLYPH_HEIGHT * builder->scale;
+    float x = builder->x;
+    for (const char *c = text; *c != '\0'; ++c, x += width) {
+        u32 glyph = (u8) *c - DEBUG_OVERLAY_FIRST_GLYPH;
+        if (glyph >= DEBUG_OVERLAY_SOLID_GLYPH) {
+            glyph = '?' - DEBUG_OVERLAY_FIRST_GLYPH;
+        }
+        if (glyph == 0 || builder->quad_count == DEBUG_OVERLAY_MAX_QUADS) {
+            continue;
+        }
+        debug_overlay_quad(builder, builder->quad_count++, x, builder->y, x + width, builder->y + height, glyph,
+                           color);
+    }
+
+    builder->right = x > builder->right ? x : builder->right;
+    builder->y += height;
+}
+
+// Frame and GPU times of the last DEBUG_OVERLAY_HISTORY frames, newest on the right, with the frame budget as a line
+void debug_overlay_graph(DebugOverlayBuilder *builder, DebugOverlay *overlay, double budget_ms) {
+    float height = DEBUG_OVERLAY_GRAPH_HEIGHT * builder->scale;
+    float bar_width = DEBUG_OVERLAY_BAR_WIDTH * builder->scale;
+    float top_ms = budget_ms > 0.0 ? (float) budget_ms * 2.0f : 33.3f;
+    float bottom = builder->y + height;
+
+    for (u32 i = 0; i < DEBUG_OVERLAY_HISTORY; ++i) {
+        u32 sample = (overlay->history_next + i) % DEBUG_OVERLAY_HISTORY;
+        float x = builder->x + (float) i * bar_width;
+        float frame = overlay->frame_ms[sample] < top_ms ? overlay->frame_ms[sample] : top_ms;
+        float gpu = overlay->gpu_ms[sample] < top_ms ? overlay->gpu_ms[sample] : top_ms;
+        debug_overlay_rect(builder, x, bottom - frame / top_ms * height, bar_width, frame / top_ms * height,
+                           DEBUG_OVERLAY_FRAME_BAR);
+        debug_overlay_rect(builder, x, bottom - gpu / top_ms * height, bar_width * 0.5f, gpu / top_ms * height,
+                           DEBUG_OVERLAY_GPU_BAR);
+    }
+    if (budget_ms > 0.0) {
+        debug_overlay_rect(builder, builder->x, bottom - height * 0.5f, bar_width * DEBUG_OVERLAY_HISTORY,
+                           builder->scale, DEBUG_OVERLAY_WARNING);
+    }
+
+    float right = builder->x + bar_width * DEBUG_OVERLAY_HISTORY;
+    builder->right = right > builder->right ? right : builder->right;
+    builder->y = bottom;
+}
+
+void debug_overlay_build(VulkanContext *context, DebugOverlay *overlay, DebugOverlayBuilder *builder) {
+    // The panel goes first so everything blends over it, its size is known once the rest is laid out
+    u32 panel = builder->quad_count++;
+    float panel_x = builder->x;
+    float panel_y = builder->y;
+    float padding = 4.0f * builder->scale;
+    builder->x += padding;
+    builder->y += padding;
+
+    float frame_sum = 0.0f;
+    float frame_max = 0.0f;
+    for (u32 i = 0; i < overlay->history_count; ++i) {
+        frame_sum += overlay->frame_ms[i];
+        frame_max = overlay->frame_ms[i] > frame_max ? overlay->frame_ms[i] : frame_max;
+    }
+    float frame_average = overlay->history_count > 0 ? frame_sum / (float) overlay->history_count : 0.0f;
+    double render_ms, gpu_ms;
+    vulkan_frame_times(&render_ms, &gpu_ms);
+    double budget_ms = latency_ticks_to_ms(atomic_load(&context->resolution.budget));
+
+    debug_overlay_line(builder, DEBUG_OVERLAY_TEXT, "frame %6.2f ms  max %6.2f ms  %5.0f fps", frame_average,
+                       frame_max, frame_average > 0.0f ? 1000.0f / frame_average : 0.0f);
+    debug_overlay_line(builder, DEBUG_OVERLAY_TEXT, "render %5.2f ms  gpu %5.2f ms  budget %5.2f ms", render_ms,
+                       gpu_ms, budget_ms);
+    debug_overlay_line(builder, DEBUG_OVERLAY_TEXT, "resolution %ux%u (%.0f%%)", context->resolution.extent.width,
+                       context->resolution.extent.height, context->resolution.scale * 100.0f);
+
+    FrameTiming *timing = &context->timing;
+    if (timing->timestamp_pool != VK_NULL_HANDLE) {
+        debug_overlay_line(builder, DEBUG_OVERLAY_DIM, "  %-16s %7.3f ms", "setup", timing->setup_ms);
+        RenderGraph *graph = &context->render_graph;
+        for (u32 p = 0; p < graph->pass_count && p < timing->pass_count; ++p) {
+            if (!graph->passes[p].culled) {
+                debug_overlay_line(builder, DEBUG_OVERLAY_DIM, "  %-16s %7.3f ms", graph->passes[p].name,
+                                   timing->pass_ms[p]);
+            }
+        }
+    } else {
+        debug_overlay_line(builder, DEBUG_OVERLAY_DIM, "  no timestamp queries on this device");
+    }
+
+    MemoryBudgetStats *memory = &context->memory_budget.stats;
+    if (memory->supported) {
+        debug_overlay_line(builder, memory->pressure == MEMORY_PRESSURE_NONE ? DEBUG_OVERLAY_TEXT
+                                                                              : DEBUG_OVERLAY_WARNING,
+                           "memory %llu / %llu MiB  pressure %s", (unsigned long long) (memory->device_usage >> 20),
+                           (unsigned long long) (memory->device_budget >> 20), memory_pressure_name(memory->pressure));
+    } else {
+        debug_overlay_line(builder, DEBUG_OVERLAY_TEXT, "memory budget unavailable");
+    }
+
+    MeshletRenderer *meshlets = &context->meshlet_renderer;
+    debug_overlay_line(builder, DEBUG_OVERLAY_TEXT, "draws %u  visible %u  meshlet groups %u  lights %u",
+                       meshlets->draw_count, meshlets->instance_count, meshlets->group_count,
+                       context->lights.light_count);
+    LodStats *lods = &meshlets->lod_stats;
+    if (meshlets->gpu_lod) {
+        debug_overlay_line(builder, DEBUG_OVERLAY_TEXT, "levels of detail picked on the GPU");
+    } else {
+        debug_overlay_line(builder, DEBUG_OVERLAY_TEXT, "triangles %llu of %llu at full detail",
+                           (unsigned long long) lods->triangles_submitted, (unsigned long long) lods->triangles_full);
+    }
+
+    bool over_budget = overlay->cpu_ms > DEBUG_OVERLAY_COST_BUDGET_MS ||
+                       timing->overlay_ms > DEBUG_OVERLAY_COST_BUDGET_MS;
+    debug_overlay_line(builder, over_budget ? DEBUG_OVERLAY_WARNING : DEBUG_OVERLAY_DIM,
+                       "overlay cpu %.3f ms  gpu %.3f ms", overlay->cpu_ms, timing->overlay_ms);
+
+    builder->y += padding;
+    debug_overlay_graph(builder, overlay, budget_ms);
+
+    debug_overlay_quad(builder, panel, panel_x, panel_y, builder->right + padding, builder->y + padding,
+                       DEBUG_OVERLAY_SOLID_GLYPH, DEBUG_OVERLAY_PANEL);
+}
+
+void debug_overlay_draw(VulkanContext *context, DebugOverlay *overlay) {
+    if (!atomic_load(&overlay->enabled) || overlay->pipeline == NULL) {
+        overlay->last_frame = 0;
+        return;
+    }
+
+    u64 start = SDL_GetPerformanceCounter();
+    if (overlay->last_frame != 0) {
+        overlay->frame_ms[overlay->history_next] = (float) latency_ticks_to_ms(start - overlay->last_frame);
+        overlay->gpu_ms[overlay->history_next] = (float) context->timing.frame_ms;
+        overlay->history_next = (overlay->history_next + 1) % DEBUG_OVERLAY_HISTORY;
+        overlay->history_count += overlay->history_count < DEBUG_OVERLAY_HISTORY;
+    }
+    overlay->last_frame = start;
+
+    u32 first_vertex = context->current_renderer_index * DEBUG_OVERLAY_MAX_QUADS * 6;
+    DebugOverlayBuilder builder = {0};
+    builder.vertices = (DebugOverlayVertex *) overlay->vertices.mapped + first_vertex;
+    builder.scale = context->swapchain.extent.height >= 1440 ? 2.0f : 1.0f;
+    builder.x = DEBUG_OVERLAY_MARGIN * builder.scale;
+    builder.y = DEBUG_OVERLAY_MARGIN * builder.scale;
+    debug_overlay_build(context, overlay, &builder);
+
+    VkCommandBuffer command_buffer = context->current_renderer->command_buffer;
+    frame_timing_overlay_begin(&context->timing, context->current_renderer_index, command_buffer);
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, overlay->pipeline);
+    bindless_bind(&context->bindless, command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, overlay->layout);
+
+    // Positions are in swapchain pixels, the scaled scene maps onto the whole swapchain image
+    DebugOverlayConstants constants = {
+            .material_buffer = context->materials.buffer_handle,
+            .material_index = context->default_material,
+            .texture_table = context->textures.handle_table_handle,
+            .atlas = overlay->atlas_handle,
+            .atlas_sampler = overlay->sampler_handle,
+            .inverse_width = 1.0f / (float) context->swapchain.extent.width,
+            .inverse_height = 1.0f / (float) context->swapchain.extent.height
+    };
+    vkCmdPushConstants(command_buffer, overlay->layout, VK_SHADER_STAGE_ALL, 0, sizeof(DebugOverlayConstants),
+                       &constants);
+
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, &overlay->vertices.vk_buffer, &offset);
+    vkCmdDraw(command_buffer, builder.quad_count * 6, 1, first_vertex, 0);
+    frame_timing_overlay_end(&context->timing, context->current_renderer_index, command_buffer);
+
+    overlay->cpu_ms = frame_timing_smooth(overlay->cpu_ms,
+                                          latency_ticks_to_ms(SDL_GetPerformanceCounter() - start));
+}
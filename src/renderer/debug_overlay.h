@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <std/defines.h>
+#include "vulkan_types.h"
+#include "buffer.h"
+#include "image.h"
+
+// Cells of the baked font, printable ASCII from DEBUG_OVERLAY_FIRST_GLYPH on and one solid cell for panels and bars
+#define DEBUG_OVERLAY_GLYPH_WIDTH 7
+#define DEBUG_OVERLAY_GLYPH_HEIGHT 14
+#define DEBUG_OVERLAY_FIRST_GLYPH 32
+#define DEBUG_OVERLAY_GLYPH_COUNT 96
+#define DEBUG_OVERLAY_ATLAS_COLUMNS 16
+// Quads of one frame, anything past it is dropped
+#define DEBUG_OVERLAY_MAX_QUADS 2048
+// Frames shown in the frame time graph, one bar each
+#define DEBUG_OVERLAY_HISTORY 128
+// What the overlay may cost per frame on either the render thread or the GPU, above it its own line turns red
+#define DEBUG_OVERLAY_COST_BUDGET_MS 0.1
+
+typedef struct VulkanContext VulkanContext;
+
+// Mirrors the vertex input of shaders/debug_overlay.vert, color is RGBA8 with red in the lowest byte
+typedef struct DebugOverlayVertex {
+    float position[2];
+    float uv[2];
+    u32 color;
+} DebugOverlayVertex;
+
+// Starts with the BindlessDrawConstants fields so the bindless helpers work unchanged
+typedef struct DebugOverlayConstants {
+    u32 material_buffer;
+    u32 material_index;
+    u32 texture_table;
+    u32 atlas;
+    u32 atlas_sampler;
+    float inverse_width;
+    float inverse_height;
+} DebugOverlayConstants;
+
+// Frame times, GPU pass timings, memory and draw counts drawn over the scene with a single draw call at the end of the
+// main pass
+typedef struct DebugOverlay {
+    // Set from any thread
+    atomic_bool enabled;
+
+    VkPipelineLayout layout;
+    VkPipeline pipeline;
+    Image atlas;
+    VkSampler sampler;
+    u32 atlas_handle;
+    u32 sampler_handle;
+    // DEBUG_OVERLAY_MAX_QUADS quads per renderer instance, rewritten once its fence has signaled
+    Buffer vertices;
+
+    // Render thread only. Frame times are measured between two overlay draws.
+    float frame_ms[DEBUG_OVERLAY_HISTORY];
+    float gpu_ms[DEBUG_OVERLAY_HISTORY];
+    u32 history_next;
+    u32 history_count;
+    u64 last_frame;
+    // Smoothed render thread time of building and recording the overlay
+    double cpu_ms;
+} DebugOverlay;
+
+bool debug_overlay_create(VulkanContext *context, DebugOverlay *out);
+
+void debug_overlay_destroy(VulkanContext *context, DebugOverlay *overlay);
+
+// Builds this frame's quads and draws them, inside the render pass and with its viewport set. Does nothing while the
+// overlay is disabled.
+void debug_overlay_draw(VulkanContext *context, DebugOverlay *overlay);
@@ -0,0 +1,272 @@
+#include "depth_pyramid.h"
+#include "host_allocator.h"
+#include "vulkan.h"
+
+#include <string.h>
+
+typedef enum DepthPyramidBinding {
+    DEPTH_PYRAMID_BINDING_DESTINATION,
+    DEPTH_PYRAMID_BINDING_SOURCE,
+    DEPTH_PYRAMID_BINDING_MAX
+} DepthPyramidBinding;
+
+u32 depth_pyramid_floor_pow2(u32 value) {
+    u32 result = 1;
+    while (result <= value / 2) {
+        result *= 2;
+    }
+    return result;
+}
+
+void depth_pyramid_layouts_create(VulkanContext *context, DepthPyramid *pyramid) {
+    VkDescriptorSetLayoutBinding bindings[DEPTH_PYRAMID_BINDING_MAX] = {0};
+    bindings[DEPTH_PYRAMID_BINDING_DESTINATION].binding = DEPTH_PYRAMID_BINDING_DESTINATION;
+    bindings[DEPTH_PYRAMID_BINDING_DESTINATION].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[DEPTH_PYRAMID_BINDING_DESTINATION].descriptorCount = 1;
+    bindings[DEPTH_PYRAMID_BINDING_DESTINATION].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[DEPTH_PYRAMID_BINDING_SOURCE].binding = DEPTH_PYRAMID_BINDING_SOURCE;
+    bindings[DEPTH_PYRAMID_BINDING_SOURCE].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[DEPTH_PYRAMID_BINDING_SOURCE].descriptorCount = 1;
+    bindings[DEPTH_PYRAMID_BINDING_SOURCE].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo set_create_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    set_create_info.bindingCount = DEPTH_PYRAMID_BINDING_MAX;
+    set_create_info.pBindings = bindings;
+    VK_CHECK(vkCreateDescriptorSetLayout(context->device.vk_device, &set_create_info, host_allocator(),
+                                         &pyramid->set_layout));
+
+    // One set per level, rewritten when the pyramid is resized while the device is idle
+    VkDescriptorPoolSize pool_sizes[] = {
+            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, DEPTH_PYRAMID_MAX_LEVELS},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, DEPTH_PYRAMID_MAX_LEVELS},
+    };
+    VkDescriptorPoolCreateInfo pool_create_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    pool_create_info.maxSets = DEPTH_PYRAMID_MAX_LEVELS;
+    pool_create_info.poolSizeCount = sizeof(pool_sizes) / sizeof(VkDescriptorPoolSize);
+    pool_create_info.pPoolSizes = pool_sizes;
+    VK_CHECK(vkCreateDescriptorPool(context->device.vk_device, &pool_create_info, host_allocator(), &pyramid->pool));
+
+    VkDescriptorSetLayout set_layouts[DEPTH_PYRAMID_MAX_LEVELS];
+    for (u32 i = 0; i < DEPTH_PYRAMID_MAX_LEVELS; ++i) {
+        set_layouts[i] = pyramid->set_layout;
+    }
+    VkDescriptorSetAllocateInfo allocate_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    allocate_info.descriptorPool = pyramid->pool;
+    allocate_info.descriptorSetCount = DEPTH_PYRAMID_MAX_LEVELS;
+    allocate_info.pSetLayouts = set_layouts;
+    VK_CHECK(vkAllocateDescriptorSets(context->device.vk_device, &allocate_info, pyramid->sets));
+
+    VkPushConstantRange push_constant_range = {0};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(DepthPyramidConstants);
+
+    VkPipelineLayoutCreateInfo layout_create_info = {VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    layout_create_info.setLayoutCount = 1;
+    layout_create_info.pSetLayouts = &pyramid->set_layout;
+    layout_create_info.pushConstantRangeCount = 1;
+    layout_create_info.pPushConstantRanges = &push_constant_range;
+    VK_CHECK(vkCreatePipelineLayout(context->device.vk_device, &layout_create_info, host_allocator(),
+                                    &pyramid->layout));
+}
+
+bool depth_pyramid_create(VulkanContext *context, DepthPyramid *out) {
+    DepthPyramid result = {0};
+    result.image_handle = BINDLESS_INVALID_HANDLE;
+    depth_pyramid_layouts_create(context, &result);
+
+    if (!compute_pipeline_create(&context->device, result.layout, "depth_pyramid.comp.spv", &result.pipeline) ||
+        !compute_pipeline_create(&context->device, result.layout, "depth_pyramid_ms.comp.spv",
+                                 &result.multisampled_pipeline)) {
+        LOG_ERROR("Couldn't create the depth pyramid pipelines!");
+        depth_pyramid_destroy(context, &result);
+        return false;
+    }
+
+    // Only fetched from, filtering would blend depths of unrelated surfaces
+    sampler_create(&context->physical_device, &context->device, VK_FILTER_NEAREST,
+                   VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, &result.sampler);
+    result.sampler_handle = bindless_register_sampler(&context->device, &context->bindless, result.sampler);
+    if (result.sampler_handle == BINDLESS_INVALID_HANDLE || !depth_pyramid_resize(context, &result)) {
+        LOG_ERROR("Couldn't create the depth pyramid!");
+        depth_pyramid_destroy(context, &result);
+        return false;
+    }
+
+    *out = result;
+    return true;
+}
+
+void depth_pyramid_release(VulkanContext *context, DepthPyramid *pyramid) {
+    if (pyramid->image_handle != BINDLESS_INVALID_HANDLE) {
+        bindless_release(&context->bindless, BINDLESS_BINDING_SAMPLED_IMAGES, pyramid->image_handle,
+                         context->frame_number);
+        pyramid->image_handle = BINDLESS_INVALID_HANDLE;
+    }
+
+    for (u32 i = 0; i < DEPTH_PYRAMID_MAX_LEVELS; ++i) {
+        vkDestroyImageView(context->device.vk_device, pyramid->level_views[i], host_allocator());
+        pyramid->level_views[i] = NULL;
+    }
+    vkDestroyImageView(context->device.vk_device, pyramid->depth_view, host_allocator());
+    pyramid->depth_view = NULL;
+
+    if (pyramid->image.vk_image != NULL) {
+        image_destroy(&context->device, &pyramid->image);
+    }
+    pyramid->levels = 0;
+    pyramid->valid = false;
+}
+
+void depth_pyramid_destroy(VulkanContext *context, DepthPyramid *pyramid) {
+    depth_pyramid_release(context, pyramid);
+
+    if (pyramid->sampler != NULL) {
+        if (pyramid->sampler_handle != BINDLESS_INVALID_HANDLE) {
+            bindless_release(&context->bindless, BINDLESS_BINDING_SAMPLERS, pyramid->sampler_handle,
+                             context->frame_number);
+        }
+        sampler_destroy(&context->device, &pyramid->sampler);
+    }
+
+    vkDestroyPipeline(context->device.vk_device, pyramid->pipeline, host_allocator());
+    pyramid->pipeline = NULL;
+    vkDestroyPipeline(context->device.vk_device, pyramid->multisampled_pipeline, host_allocator());
+    pyramid->multisampled_pipeline = NULL;
+    vkDestroyPipelineLayout(context->device.vk_device, pyramid->layout, host_allocator());
+    pyramid->layout = NULL;
+    vkDestroyDescriptorPool(context->device.vk_device, pyramid->pool, host_allocator());
+    pyramid->pool = NULL;
+    vkDestroyDescriptorSetLayout(context->device.vk_device, pyramid->set_layout, host_allocator());
+    pyramid->set_layout = NULL;
+}
+
+VkImageView depth_pyramid_view_create(VulkanContext *context, VkImage image, VkFormat format,
+                                      VkImageAspectFlags aspect, u32 level) {
+    VkImageViewCreateInfo create_info = {VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+    create_info.image = image;
+    create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    create_info.format = format;
+    create_info.subresourceRange.aspectMask = aspect;
+    create_info.subresourceRange.baseMipLevel = level;
+    create_info.subresourceRange.levelCount = 1;
+    create_info.subresourceRange.layerCount = 1;
+
+    VkImageView view;
+    VK_CHECK(vkCreateImageView(context->device.vk_device, &create_info, host_allocator(), &view));
+    return view;
+}
+
+bool depth_pyramid_resize(VulkanContext *context, DepthPyramid *pyramid) {
+    depth_pyramid_release(context, pyramid);
+
+    // Rounded down, so each level 0 texel covers at most two depth texels across when nothing is scaled down
+    VkExtent2D extent = {depth_pyramid_floor_pow2(context->swapchain.extent.width),
+                         depth_pyramid_floor_pow2(context->swapchain.extent.height)};
+    u32 largest = extent.width > extent.height ? extent.width : extent.height;
+    u32 levels = 0;
+    while (levels < DEPTH_PYRAMID_MAX_LEVELS && (largest >> levels) != 0) {
+        ++levels;
+    }
+
+    ImageConfig config = {0};
+    config.format = VK_FORMAT_R32_SFLOAT;
+    config.extent = extent;
+    config.mip_levels = levels;
+    config.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    config.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    config.memory_properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    if (!image_create(&context->physical_device, &context->device, &config, &pyramid->image)) {
+        return false;
+    }
+    pyramid->levels = levels;
+
+    // Stencil can't be sampled together with depth, the attachment's own view has both aspects
+    pyramid->depth_view = depth_pyramid_view_create(context, context->depth_attachment.vk_image,
+                                                    context->graphics_pipeline.depth_format,
+                                                    VK_IMAGE_ASPECT_DEPTH_BIT, 0);
+    for (u32 level = 0; level < levels; ++level) {
+        pyramid->level_views[level] = depth_pyramid_view_create(context, pyramid->image.vk_image,
+                                                                VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT,
+                                                                level);
+    }
+
+    // Level 0 reads the depth attachment the render graph leaves in the read only layout, the others the level before
+    for (u32 level = 0; level < levels; ++level) {
+        VkDescriptorImageInfo destination = {NULL, pyramid->level_views[level], VK_IMAGE_LAYOUT_GENERAL};
+        VkDescriptorImageInfo source = {pyramid->sampler, pyramid->depth_view,
+                                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+        if (level > 0) {
+            source.imageView = pyramid->level_views[level - 1];
+            source.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        }
+
+        VkWriteDescriptorSet writes[DEPTH_PYRAMID_BINDING_MAX] = {0};
+        for (u32 i = 0; i < DEPTH_PYRAMID_BINDING_MAX; ++i) {
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = pyramid->sets[level];
+            writes[i].dstBinding = i;
+            writes[i].descriptorCount = 1;
+        }
+        writes[DEPTH_PYRAMID_BINDING_DESTINATION].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        writes[DEPTH_PYRAMID_BINDING_DESTINATION].pImageInfo = &destination;
+        writes[DEPTH_PYRAMID_BINDING_SOURCE].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[DEPTH_PYRAMID_BINDING_SOURCE].pImageInfo = &source;
+        vkUpdateDescriptorSets(context->device.vk_device, DEPTH_PYRAMID_BINDING_MAX, writes, 0, NULL);
+    }
+
+    pyramid->image_handle = bindless_register_sampled_image(&context->device, &context->bindless,
+                                                            pyramid->image.view, VK_IMAGE_LAYOUT_GENERAL);
+    pyramid->undefined = true;
+    LOG_DEBUG("Depth pyramid is %ux%u with %u levels", extent.width, extent.height, levels);
+    return pyramid->image_handle != BINDLESS_INVALID_HANDLE;
+}
+
+void depth_pyramid_begin_frame(DepthPyramid *pyramid, VkCommandBuffer command_buffer) {
+    if (!pyramid->undefined) {
+        return;
+    }
+
+    // The render graph waits for compute before the first read, like after a build in the frame before
+    image_transition(command_buffer, pyramid->image.vk_image, VK_IMAGE_ASPECT_COLOR_BIT, 0, pyramid->levels,
+                     VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0);
+    pyramid->undefined = false;
+}
+
+void depth_pyramid_build_pass(VulkanContext *context, VkCommandBuffer command_buffer, void *data) {
+    DepthPyramid *pyramid = data;
+    bool multisampled = context->graphics_pipeline.samples != VK_SAMPLE_COUNT_1_BIT;
+
+    // Level 0 only covers the part of the attachment the scaler rendered into
+    VkExtent2D source = context->resolution.extent;
+    for (u32 level = 0; level < pyramid->levels; ++level) {
+        if (level <= 1) {
+            VkPipeline pipeline = level == 0 && multisampled ? pyramid->multisampled_pipeline : pyramid->pipeline;
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+        }
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pyramid->layout, 0, 1,
+                                &pyramid->sets[level], 0, NULL);
+
+        u32 width = pyramid->image.extent.width >> level;
+        u32 height = pyramid->image.extent.height >> level;
+        DepthPyramidConstants constants = {
+                .source_extent = {source.width, source.height},
+                .extent = {width > 0 ? width : 1, height > 0 ? height : 1}
+        };
+        vkCmdPushConstants(command_buffer, pyramid->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                           sizeof(DepthPyramidConstants), &constants);
+        vkCmdDispatch(command_buffer, (constants.extent[0] + DEPTH_PYRAMID_GROUP_SIZE - 1) / DEPTH_PYRAMID_GROUP_SIZE,
+                      (constants.extent[1] + DEPTH_PYRAMID_GROUP_SIZE - 1) / DEPTH_PYRAMID_GROUP_SIZE, 1);
+
+        // Read by the next level, and by the culling of the next frame once the render graph waits for compute
+        image_transition(command_buffer, pyramid->image.vk_image, VK_IMAGE_ASPECT_COLOR_BIT, level, 1,
+                         VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+        source = (VkExtent2D) {constants.extent[0], constants.extent[1]};
+    }
+
+    memcpy(pyramid->view_projection, context->meshlet_renderer.view.view_projection,
+           sizeof(pyramid->view_projection));
+    pyramid->valid = true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <std/defines.h>
+#include "vulkan_types.h"
+#include "image.h"
+
+// Enough mips for a 32768 texel wide pyramid
+#define DEPTH_PYRAMID_MAX_LEVELS 16
+// Texels per workgroup side of the reduction, shaders/depth_pyramid.glsl has the same value
+#define DEPTH_PYRAMID_GROUP_SIZE 8
+
+typedef struct VulkanContext VulkanContext;
+
+// Mirrors the push constants in shaders/depth_pyramid.glsl
+typedef struct DepthPyramidConstants {
+    u32 source_extent[2];
+    u32 extent[2];
+} DepthPyramidConstants;
+
+// Farthest depth of the frame before, reduced into a power of two mip chain that culling passes test bounding
+// spheres against. Level 0 covers the rendered part of the depth attachment, each level after halves the one before.
+typedef struct DepthPyramid {
+    VkDescriptorSetLayout set_layout;
+    VkDescriptorPool pool;
+    VkPipelineLayout layout;
+    VkPipeline pipeline;
+    // Reads a multisampled depth attachment into level 0
+    VkPipeline multisampled_pipeline;
+    VkSampler sampler;
+    u32 sampler_handle;
+
+    // Recreated with the swapchain
+    Image image;
+    u32 image_handle;
+    u32 levels;
+    VkImageView depth_view;
+    VkImageView level_views[DEPTH_PYRAMID_MAX_LEVELS];
+    VkDescriptorSet sets[DEPTH_PYRAMID_MAX_LEVELS];
+    // The image is still undefined, the next frame moves it into the general layout it stays in
+    bool undefined;
+
+    // Set once a frame built the pyramid, with the view it rendered. Culling against it before then or with another
+    // view's matrix would hide visible meshlets.
+    bool valid;
+    float view_projection[16];
+} DepthPyramid;
+
+bool depth_pyramid_create(VulkanContext *context, DepthPyramid *out);
+
+void depth_pyramid_destroy(VulkanContext *context, DepthPyramid *pyramid);
+
+// Recreates the pyramid for the current depth attachment, after the framebuffer. The device has to be idle.
+bool depth_pyramid_resize(VulkanContext *context, DepthPyramid *pyramid);
+
+// Records the first layout transition after a resize, before the render graph runs
+void depth_pyramid_begin_frame(DepthPyramid *pyramid, VkCommandBuffer command_buffer);
+
+// Render graph pass reducing the depth attachment into the pyramid. data is the depth pyramid.
+void depth_pyramid_build_pass(VulkanContext *context, VkCommandBuffer command_buffer, void *data);
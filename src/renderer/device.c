@@ -1,20 +1,23 @@
 #include "device.h"
+#include "host_allocator.h"
+
+#include "core/arena.h"
+#include "core/log.h"
 
 #include <std/containers/darray.h>
-#include <std/core/logger.h>
 
 int queue_family_compare(const void *a, const void *b) {
     return (int) ((QueueFamily *) a)->index - (int) ((QueueFamily *) b)->index;
 }
 
-QueueFamily *device_get_queue_families(PhysicalDevice *physical_device, VkSurfaceKHR *surface) {
+QueueFamily *device_get_queue_families(PhysicalDevice *physical_device, VkSurfaceKHR *surface, Arena *scratch) {
     u32 queue_family_count = 0;
     vkGetPhysicalDeviceQueueFamilyProperties(physical_device->device, &queue_family_count, 0);
-    VkQueueFamilyProperties *queue_families = darray_reserve(VkQueueFamilyProperties, queue_family_count);
+    VkQueueFamilyProperties *queue_families = arena_alloc_array(scratch, VkQueueFamilyProperties, queue_family_count);
     vkGetPhysicalDeviceQueueFamilyProperties(physical_device->device, &queue_family_count, queue_families);
 
-    QueueFamily *result = darray_create(QueueFamily);
-    for (u32 i = 0; i < darray_length(queue_families); ++i) {
+    QueueFamily *result = darray_reserve(QueueFamily, queue_family_count);
+    for (u32 i = 0; i < queue_family_count; ++i) {
         QueueFamily family = {.index = i};
 
         family.features[QUEUE_FEATURE_GRAPHICS] = queue_families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT;
@@ -27,10 +30,9 @@ QueueFamily *device_get_queue_families(PhysicalDevice *physical_device, VkSurfac
         VkBool32 supported;
         VK_CHECK(vkGetPhysicalDeviceSurfaceSupportKHR(physical_device->device, i, *surface, &supported))
         family.features[QUEUE_FEATURE_PRESENT] = supported;
-        darray_push(result, family)
+        result[i] = family;
     }
 
-    darray_destroy(queue_families);
     qsort(result, darray_length(result), sizeof(QueueFamily), queue_family_compare);
     return result;
 }
@@ -47,41 +49,61 @@ QueueFamily *device_find_queue_family(Device *device, QueueFeature feature) {
     return NULL;
 }
 
-VkDeviceQueueCreateInfo *device_queue_create_infos(Device *device) {
-    // TODO a hashmap would be nice here
+// Queue priorities outlive device_queue_create_infos, vkCreateDevice reads them
+static const float device_queue_priority = 1.0f;
 
+VkDeviceQueueCreateInfo *device_queue_create_infos(Device *device, Arena *scratch, u32 *out_count) {
     // Collect unique queue indexes
-    u32 *unique_indexes = darray_create(u32);
+    u32 *unique_indexes = arena_alloc_array(scratch, u32, QUEUE_FEATURE_MAX);
+    u32 unique_count = 0;
     for (int i = 0; i < QUEUE_FEATURE_MAX; ++i) {
         Queue queue = device->queues[i];
         if (queue.queue_family == NULL) {
             continue;
         }
 
-        if (darray_length(unique_indexes) == 0) {
-            darray_push(unique_indexes, queue.queue_family->index);
-        } else if (unique_indexes[darray_length(unique_indexes) - 1] != queue.queue_family->index) {
-            darray_push(unique_indexes, queue.queue_family->index);
+        bool seen = false;
+        for (u32 j = 0; j < unique_count; ++j) {
+            seen |= unique_indexes[j] == queue.queue_family->index;
+        }
+        if (!seen) {
+            unique_indexes[unique_count++] = queue.queue_family->index;
         }
     }
 
-    VkDeviceQueueCreateInfo *queue_create_infos = darray_create(VkDeviceQueueCreateInfo);
-    float priority = 1.0f;
-    for (int i = 0; i < darray_length(unique_indexes); ++i) {
+    VkDeviceQueueCreateInfo *queue_create_infos = arena_alloc_array(scratch, VkDeviceQueueCreateInfo, unique_count);
+    for (u32 i = 0; i < unique_count; ++i) {
         VkDeviceQueueCreateInfo queueCreateInfo = {VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO};
-        queueCreateInfo.pQueuePriorities = &priority;
+        queueCreateInfo.pQueuePriorities = &device_queue_priority;
         queueCreateInfo.queueCount = 1;
         queueCreateInfo.queueFamilyIndex = unique_indexes[i];
-        darray_push(queue_create_infos, queueCreateInfo);
+        queue_create_infos[i] = queueCreateInfo;
     }
 
-    darray_destroy(unique_indexes);
+    *out_count = unique_count;
     return queue_create_infos;
 }
 
+bool device_supports_descriptor_indexing(PhysicalDevice *physical_device) {
+    if (physical_device->properties.apiVersion < VK_API_VERSION_1_2) {
+        return false;
+    }
+
+    VkPhysicalDeviceVulkan12Features *features = &physical_device->features_12;
+    return features->descriptorIndexing &&
+           features->runtimeDescriptorArray &&
+           features->descriptorBindingPartiallyBound &&
+           features->descriptorBindingUpdateUnusedWhilePending &&
+           features->descriptorBindingSampledImageUpdateAfterBind &&
+           features->descriptorBindingStorageBufferUpdateAfterBind &&
+           features->shaderSampledImageArrayNonUniformIndexing &&
+           features->shaderStorageBufferArrayNonUniformIndexing;
+}
+
 bool device_create(PhysicalDevice *physical_device, VkSurfaceKHR *surface, Device *out) {
     Device result = {0};
-    QueueFamily *queue_families = device_get_queue_families(physical_device, surface);
+    ArenaScope scratch = scratch_begin();
+    QueueFamily *queue_families = device_get_queue_families(physical_device, surface, scratch.arena);
     result.queue_families = queue_families;
 
     for (int i = 0; i < QUEUE_FEATURE_MAX; ++i) {
@@ -90,30 +112,120 @@ bool device_create(PhysicalDevice *physical_device, VkSurfaceKHR *surface, Devic
         result.queues[i].queue_family = family;
     }
 
-    VkDeviceQueueCreateInfo *queue_create_infos = device_queue_create_infos(&result);
+    u32 queue_create_info_count = 0;
+    VkDeviceQueueCreateInfo *queue_create_infos = device_queue_create_infos(&result, scratch.arena,
+                                                                            &queue_create_info_count);
 
-    const char **extensions = darray_create(const char *);
     if (!physical_device_is_extension_available(physical_device, VK_KHR_SWAPCHAIN_EXTENSION_NAME)) {
         LOG_ERROR("Vulkan Swapchain extension unavailable: %s", VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        darray_destroy(queue_families);
+        scratch_end(scratch);
         return false;
     }
-    darray_push(extensions, &VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    const char **extensions = arena_alloc_array(scratch.arena, const char *, DEVICE_MAX_EXTENSIONS);
+    u32 extension_count = 0;
+    extensions[extension_count++] = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
 
     if (physical_device_is_extension_available(physical_device, "VK_KHR_portability_subset")) {
-        darray_push(extensions, &"VK_KHR_portability_subset");
+        extensions[extension_count++] = "VK_KHR_portability_subset";
+    }
+
+    VkPhysicalDeviceMeshShaderFeaturesEXT mesh_shader_features = {
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT};
+    result.mesh_shader = physical_device->mesh_shader_features.taskShader &&
+                         physical_device->mesh_shader_features.meshShader;
+    if (result.mesh_shader) {
+        mesh_shader_features.taskShader = VK_TRUE;
+        mesh_shader_features.meshShader = VK_TRUE;
+        extensions[extension_count++] = VK_EXT_MESH_SHADER_EXTENSION_NAME;
+    }
+
+    VkPhysicalDevicePresentIdFeaturesKHR present_id_features = {
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR};
+    VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features = {
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR};
+    result.present_id = physical_device->present_id_features.presentId;
+    result.present_wait = result.present_id && physical_device->present_wait_features.presentWait;
+    if (result.present_id) {
+        present_id_features.presentId = VK_TRUE;
+        extensions[extension_count++] = VK_KHR_PRESENT_ID_EXTENSION_NAME;
+    }
+    if (result.present_wait) {
+        present_wait_features.presentWait = VK_TRUE;
+        extensions[extension_count++] = VK_KHR_PRESENT_WAIT_EXTENSION_NAME;
     }
 
-    VkPhysicalDeviceFeatures features = {};
+    result.memory_budget = physical_device_is_extension_available(physical_device,
+                                                                  VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (result.memory_budget) {
+        extensions[extension_count++] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+    }
+
+    VkPhysicalDeviceVulkan12Features features_12 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+    result.descriptor_indexing = device_supports_descriptor_indexing(physical_device);
+    if (result.descriptor_indexing) {
+        features_12.descriptorIndexing = VK_TRUE;
+        features_12.runtimeDescriptorArray = VK_TRUE;
+        features_12.descriptorBindingPartiallyBound = VK_TRUE;
+        features_12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        features_12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        features_12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        features_12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        features_12.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+    } else {
+        LOG_ERROR("Descriptor indexing is not supported by the selected device.");
+    }
+
+    result.draw_indirect_count = physical_device->properties.apiVersion >= VK_API_VERSION_1_2 &&
+                                 physical_device->features_12.drawIndirectCount;
+    features_12.drawIndirectCount = result.draw_indirect_count;
+    void **next = &features_12.pNext;
+
+    VkPhysicalDeviceVulkan13Features features_13 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES};
+    result.synchronization2 = physical_device->properties.apiVersion >= VK_API_VERSION_1_3 &&
+                              physical_device->features_13.synchronization2;
+    if (result.synchronization2) {
+        features_13.synchronization2 = VK_TRUE;
+        *next = &features_13;
+        next = &features_13.pNext;
+    }
+    if (result.mesh_shader) {
+        *next = &mesh_shader_features;
+        next = &mesh_shader_features.pNext;
+    }
+    if (result.present_id) {
+        *next = &present_id_features;
+        next = &present_id_features.pNext;
+    }
+    if (result.present_wait) {
+        *next = &present_wait_features;
+        next = &present_wait_features.pNext;
+    }
+
+    VkPhysicalDeviceFeatures2 features = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+    features.pNext = &features_12;
+
+    result.multi_draw_indirect = physical_device->features.multiDrawIndirect &&
+                                 physical_device->features.drawIndirectFirstInstance;
+    features.features.multiDrawIndirect = result.multi_draw_indirect;
+    features.features.drawIndirectFirstInstance = result.multi_draw_indirect;
+
+    result.sampler_anisotropy = physical_device->features.samplerAnisotropy;
+    features.features.samplerAnisotropy = result.sampler_anisotropy;
+    features.features.textureCompressionBC = physical_device->features.textureCompressionBC;
+    features.features.textureCompressionETC2 = physical_device->features.textureCompressionETC2;
+    features.features.textureCompressionASTC_LDR = physical_device->features.textureCompressionASTC_LDR;
 
     VkDeviceCreateInfo createInfo = {VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
-    createInfo.queueCreateInfoCount = darray_length(queue_create_infos);
+    createInfo.pNext = &features;
+    createInfo.queueCreateInfoCount = queue_create_info_count;
     createInfo.pQueueCreateInfos = queue_create_infos;
     createInfo.ppEnabledExtensionNames = extensions;
-    createInfo.enabledExtensionCount = darray_length(extensions);
-    createInfo.pEnabledFeatures = &features;
+    createInfo.enabledExtensionCount = extension_count;
+    createInfo.pEnabledFeatures = NULL;
 
     VkDevice device;
-    VK_CHECK(vkCreateDevice(physical_device->device, &createInfo, 0, &device))
+    VK_CHECK(vkCreateDevice(physical_device->device, &createInfo, host_allocator(), &device))
     result.vk_device = device;
 
     for (int i = 0; i < QUEUE_FEATURE_MAX; ++i) {
@@ -124,8 +236,7 @@ bool device_create(PhysicalDevice *physical_device, VkSurfaceKHR *surface, Devic
         }
     }
 
-    darray_destroy(queue_create_infos);
-    darray_destroy(extensions);
+    scratch_end(scratch);
 
     *out = result;
     LOG_INFO("Successfully initialized Vulkan device.");
@@ -140,6 +251,6 @@ void device_destroy(Device *device) {
     darray_destroy(device->queue_families);
     device->queue_families = 0;
 
-    vkDestroyDevice(device->vk_device, NULL);
+    vkDestroyDevice(device->vk_device, host_allocator());
     device->vk_device = 0;
 }
\ No newline at end of file
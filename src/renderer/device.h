@@ -4,6 +4,9 @@
 #include "vulkan_types.h"
 #include "physical_device.h"
 
+// Extensions device_create may enable
+#define DEVICE_MAX_EXTENSIONS 8
+
 typedef enum QueueFeature {
     QUEUE_FEATURE_GRAPHICS,
     QUEUE_FEATURE_PRESENT,
@@ -27,8 +30,24 @@ typedef struct Queue {
 
 typedef struct Device {
     VkDevice vk_device;
+    // Every pipeline is created through it, see pipeline_cache.h
+    VkPipelineCache pipeline_cache;
     QueueFamily *queue_families;
     Queue queues[QUEUE_FEATURE_MAX];
+
+    bool descriptor_indexing;
+    bool sampler_anisotropy;
+    // Indirect draws with many commands, each selecting its instance through firstInstance
+    bool multi_draw_indirect;
+    bool draw_indirect_count;
+    bool mesh_shader;
+    // Present ids on every present, and waiting for one to become visible
+    bool present_id;
+    bool present_wait;
+    // vkCmdPipelineBarrier2, render graph barriers fall back to vkCmdPipelineBarrier without it
+    bool synchronization2;
+    // Per heap budget and usage through vkGetPhysicalDeviceMemoryProperties2
+    bool memory_budget;
 } Device;
 
 bool device_create(PhysicalDevice *physical_device, VkSurfaceKHR *surface, Device *out);
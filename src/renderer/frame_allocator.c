@@ -0,0 +1,202 @@
+#include "frame_allocator.h"
+#include "host_allocator.h"
+#include "vulkan.h"
+
+VkDeviceSize frame_allocator_align(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void frame_allocator_layout_create(VulkanContext *context) {
+    VkDescriptorSetLayoutBinding bindings[FRAME_ALLOCATOR_BINDING_MAX] = {0};
+    bindings[FRAME_ALLOCATOR_BINDING_UNIFORM].binding = FRAME_ALLOCATOR_BINDING_UNIFORM;
+    bindings[FRAME_ALLOCATOR_BINDING_UNIFORM].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    bindings[FRAME_ALLOCATOR_BINDING_UNIFORM].descriptorCount = 1;
+    bindings[FRAME_ALLOCATOR_BINDING_UNIFORM].stageFlags = VK_SHADER_STAGE_ALL;
+    bindings[FRAME_ALLOCATOR_BINDING_STORAGE].binding = FRAME_ALLOCATOR_BINDING_STORAGE;
+    bindings[FRAME_ALLOCATOR_BINDING_STORAGE].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    bindings[FRAME_ALLOCATOR_BINDING_STORAGE].descriptorCount = 1;
+    bindings[FRAME_ALLOCATOR_BINDING_STORAGE].stageFlags = VK_SHADER_STAGE_ALL;
+
+    VkDescriptorSetLayoutCreateInfo create_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    create_info.bindingCount = FRAME_ALLOCATOR_BINDING_MAX;
+    create_info.pBindings = bindings;
+    VK_CHECK(vkCreateDescriptorSetLayout(context->device.vk_device, &create_info, host_allocator(),
+                                         &context->frame_allocator_layout));
+}
+
+void frame_allocator_layout_destroy(VulkanContext *context) {
+    vkDestroyDescriptorSetLayout(context->device.vk_device, context->frame_allocator_layout, host_allocator());
+    context->frame_allocator_layout = NULL;
+}
+
+void frame_allocator_create_descriptor_pools(VulkanContext *context, FrameAllocator *allocator) {
+    VkDescriptorPoolSize pool_sizes[] = {
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, FRAME_DESCRIPTOR_POOL_SETS},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, FRAME_DESCRIPTOR_POOL_SETS},
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, FRAME_DESCRIPTOR_POOL_SETS},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, FRAME_DESCRIPTOR_POOL_SETS},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, FRAME_DESCRIPTOR_POOL_SETS},
+    };
+
+    // No FREE_DESCRIPTOR_SET bit: sets are never freed individually, the pool is reset as a whole
+    VkDescriptorPoolCreateInfo create_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    create_info.maxSets = FRAME_DESCRIPTOR_POOL_SETS;
+    create_info.poolSizeCount = sizeof(pool_sizes) / sizeof(VkDescriptorPoolSize);
+    create_info.pPoolSizes = pool_sizes;
+    VK_CHECK(vkCreateDescriptorPool(context->device.vk_device, &create_info, host_allocator(),
+                                    &allocator->descriptor_pool));
+
+    VkDescriptorPoolSize static_sizes[] = {
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1},
+    };
+    VkDescriptorPoolCreateInfo static_create_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    static_create_info.maxSets = 1;
+    static_create_info.poolSizeCount = sizeof(static_sizes) / sizeof(VkDescriptorPoolSize);
+    static_create_info.pPoolSizes = static_sizes;
+    VK_CHECK(vkCreateDescriptorPool(context->device.vk_device, &static_create_info, host_allocator(),
+                                    &allocator->static_pool));
+}
+
+void frame_allocator_write_set(VulkanContext *context, FrameAllocator *allocator, VkDescriptorSet set,
+                               VkBuffer storage, VkDeviceSize storage_range) {
+    VkDescriptorBufferInfo uniform_info = {
+            .buffer = allocator->buffer.vk_buffer,
+            .offset = 0,
+            .range = allocator->uniform_range
+    };
+    VkDescriptorBufferInfo storage_info = {
+            .buffer = storage,
+            .offset = 0,
+            .range = storage_range
+    };
+
+    VkWriteDescriptorSet writes[FRAME_ALLOCATOR_BINDING_MAX] = {0};
+    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[0].dstSet = set;
+    writes[0].dstBinding = FRAME_ALLOCATOR_BINDING_UNIFORM;
+    writes[0].descriptorCount = 1;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    writes[0].pBufferInfo = &uniform_info;
+    writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[1].dstSet = set;
+    writes[1].dstBinding = FRAME_ALLOCATOR_BINDING_STORAGE;
+    writes[1].descriptorCount = 1;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    writes[1].pBufferInfo = &storage_info;
+
+    vkUpdateDescriptorSets(context->device.vk_device, FRAME_ALLOCATOR_BINDING_MAX, writes, 0, NULL);
+}
+
+void frame_allocator_write_dynamic_set(VulkanContext *context, FrameAllocator *allocator) {
+    VkDescriptorSetAllocateInfo allocate_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    allocate_info.descriptorPool = allocator->static_pool;
+    allocate_info.descriptorSetCount = 1;
+    allocate_info.pSetLayouts = &context->frame_allocator_layout;
+    VK_CHECK(vkAllocateDescriptorSets(context->device.vk_device, &allocate_info, &allocator->dynamic_set));
+
+    frame_allocator_write_set(context, allocator, allocator->dynamic_set, allocator->buffer.vk_buffer,
+                              allocator->storage_range);
+}
+
+bool frame_allocator_create(VulkanContext *context, FrameAllocator *out) {
+    FrameAllocator result = {0};
+
+    VkPhysicalDeviceLimits *limits = &context->physical_device.properties.limits;
+    result.alignment = limits->minUniformBufferOffsetAlignment;
+    if (limits->minStorageBufferOffsetAlignment > result.alignment) {
+        result.alignment = limits->minStorageBufferOffsetAlignment;
+    }
+
+    result.uniform_range = FRAME_ALLOCATOR_UNIFORM_RANGE;
+    if (limits->maxUniformBufferRange < result.uniform_range) {
+        result.uniform_range = limits->maxUniformBufferRange;
+    }
+
+    result.storage_range = FRAME_ALLOCATOR_STORAGE_RANGE;
+    if (limits->maxStorageBufferRange < result.storage_range) {
+        result.storage_range = limits->maxStorageBufferRange;
+    }
+
+    // Padded by the larger range so a dynamic offset near the end never reads past the buffer
+    result.capacity = FRAME_ALLOCATOR_SIZE;
+    VkDeviceSize padding = result.storage_range > result.uniform_range ? result.storage_range : result.uniform_range;
+    if (!buffer_create(&context->physical_device, &context->device, result.capacity + padding,
+                       VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &result.buffer)) {
+        LOG_ERROR("Couldn't create frame allocator buffer!");
+        return false;
+    }
+
+    frame_allocator_create_descriptor_pools(context, &result);
+    frame_allocator_write_dynamic_set(context, &result);
+
+    *out = result;
+    return true;
+}
+
+void frame_allocator_destroy(VulkanContext *context, FrameAllocator *allocator) {
+    vkDestroyDescriptorPool(context->device.vk_device, allocator->descriptor_pool, host_allocator());
+    allocator->descriptor_pool = NULL;
+    vkDestroyDescriptorPool(context->device.vk_device, allocator->static_pool, host_allocator());
+    allocator->static_pool = NULL;
+    allocator->dynamic_set = NULL;
+
+    buffer_destroy(&context->device, &allocator->buffer);
+}
+
+void frame_allocator_reset(VulkanContext *context, FrameAllocator *allocator) {
+    if (allocator->offset > allocator->high_water) {
+        allocator->high_water = allocator->offset;
+    }
+
+    allocator->offset = 0;
+    VK_CHECK(vkResetDescriptorPool(context->device.vk_device, allocator->descriptor_pool, 0));
+}
+
+bool frame_allocator_alloc(FrameAllocator *allocator, VkDeviceSize size, FrameAllocation *out) {
+    if (size > allocator->storage_range) {
+        LOG_ERROR("Frame allocation of %llu bytes is larger than the %llu bytes a dynamic descriptor covers",
+                  (unsigned long long) size, (unsigned long long) allocator->storage_range);
+        return false;
+    }
+
+    VkDeviceSize offset = frame_allocator_align(allocator->offset, allocator->alignment);
+    if (offset + size > allocator->capacity) {
+        LOG_ERROR("Frame allocator exhausted: requested %llu bytes with %llu of %llu in use",
+                  (unsigned long long) size, (unsigned long long) allocator->offset,
+                  (unsigned long long) allocator->capacity);
+        return false;
+    }
+
+    allocator->offset = offset + size;
+    out->data = (u8 *) allocator->buffer.mapped + offset;
+    out->dynamic_offset = (u32) offset;
+    return true;
+}
+
+VkDescriptorSet frame_allocator_descriptor_set(VulkanContext *context, FrameAllocator *allocator,
+                                               VkDescriptorSetLayout layout) {
+    VkDescriptorSetAllocateInfo allocate_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    allocate_info.descriptorPool = allocator->descriptor_pool;
+    allocate_info.descriptorSetCount = 1;
+    allocate_info.pSetLayouts = &layout;
+
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    VkResult result = vkAllocateDescriptorSets(context->device.vk_device, &allocate_info, &set);
+    if (result != VK_SUCCESS) {
+        LOG_ERROR("Frame descriptor pool exhausted: %s", string_VkResult(result));
+        return VK_NULL_HANDLE;
+    }
+
+    return set;
+}
+
+VkDescriptorSet frame_allocator_storage_set(VulkanContext *context, FrameAllocator *allocator, VkBuffer buffer,
+                                            VkDeviceSize range) {
+    VkDescriptorSet set = frame_allocator_descriptor_set(context, allocator, context->frame_allocator_layout);
+    if (set != VK_NULL_HANDLE) {
+        frame_allocator_write_set(context, allocator, set, buffer, range);
+    }
+    return set;
+}
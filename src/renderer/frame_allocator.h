@@ -0,0 +1,63 @@
+#pragma once
+
+#include <std/defines.h>
+#include "vulkan_types.h"
+#include "buffer.h"
+
+#define FRAME_ALLOCATOR_SIZE (4 * 1024 * 1024)
+#define FRAME_ALLOCATOR_UNIFORM_RANGE (64 * 1024)
+// Dynamic storage descriptors need a fixed range to take non-zero offsets, no single allocation may exceed it
+#define FRAME_ALLOCATOR_STORAGE_RANGE (2 * 1024 * 1024)
+#define FRAME_DESCRIPTOR_POOL_SETS 1024
+
+typedef struct VulkanContext VulkanContext;
+
+typedef enum FrameAllocatorBinding {
+    FRAME_ALLOCATOR_BINDING_UNIFORM,
+    FRAME_ALLOCATOR_BINDING_STORAGE,
+    FRAME_ALLOCATOR_BINDING_MAX
+} FrameAllocatorBinding;
+
+typedef struct FrameAllocator {
+    Buffer buffer;
+    VkDeviceSize offset;
+    VkDeviceSize capacity;
+    VkDeviceSize alignment;
+    VkDeviceSize uniform_range;
+    VkDeviceSize storage_range;
+    VkDeviceSize high_water;
+
+    // Reset wholesale once the owning frame's fence has signaled
+    VkDescriptorPool descriptor_pool;
+
+    // Dynamic uniform/storage descriptors over the whole buffer, selected per draw with dynamic offsets
+    VkDescriptorPool static_pool;
+    VkDescriptorSet dynamic_set;
+} FrameAllocator;
+
+typedef struct FrameAllocation {
+    void *data;
+    u32 dynamic_offset;
+} FrameAllocation;
+
+void frame_allocator_layout_create(VulkanContext *context);
+
+void frame_allocator_layout_destroy(VulkanContext *context);
+
+bool frame_allocator_create(VulkanContext *context, FrameAllocator *out);
+
+void frame_allocator_destroy(VulkanContext *context, FrameAllocator *allocator);
+
+void frame_allocator_reset(VulkanContext *context, FrameAllocator *allocator);
+
+// Fails for sizes above storage_range, which is what the dynamic storage descriptor can see from one offset
+bool frame_allocator_alloc(FrameAllocator *allocator, VkDeviceSize size, FrameAllocation *out);
+
+// Allocates a set from this frame's pool, VK_NULL_HANDLE when the pool is exhausted
+VkDescriptorSet frame_allocator_descriptor_set(VulkanContext *context, FrameAllocator *allocator,
+                                               VkDescriptorSetLayout layout);
+
+// A set with the layout of dynamic_set for storage data larger than storage_range: the uniform binding still covers
+// this allocator, the storage binding covers range bytes of buffer. Valid until the frame's pool is reset.
+VkDescriptorSet frame_allocator_storage_set(VulkanContext *context, FrameAllocator *allocator, VkBuffer buffer,
+                                            VkDeviceSize range);
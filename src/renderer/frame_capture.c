@@ -0,0 +1,280 @@
+#include "frame_capture.h"
+#include "host_allocator.h"
+#include "vulkan.h"
+#include "core/color_convert.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+// Writer thread: blanks what the copy didn't cover, so frames from before a resize don't show through
+void frame_capture_clear_outside(FrameCapture *capture, CaptureSlot *slot) {
+    u8 *pixels = slot->buffer.mapped;
+    u32 row_size = capture->extent.width * 4;
+    if (slot->extent.width < capture->extent.width) {
+        for (u32 row = 0; row < slot->extent.height; ++row) {
+            memset(&pixels[(size_t) row * row_size + slot->extent.width * 4], 0,
+                   (capture->extent.width - slot->extent.width) * 4);
+        }
+    }
+    if (slot->extent.height < capture->extent.height) {
+        memset(&pixels[(size_t) slot->extent.height * row_size], 0,
+               (size_t) (capture->extent.height - slot->extent.height) * row_size);
+    }
+}
+
+bool frame_capture_write(FrameCapture *capture, CaptureSlot *slot) {
+    frame_capture_clear_outside(capture, slot);
+
+    u32 width = capture->extent.width;
+    u32 height = capture->extent.height;
+    const u8 *pixels = slot->buffer.mapped;
+    size_t pixel_count = (size_t) width * height;
+
+    if (capture->format == CAPTURE_FORMAT_Y4M) {
+        size_t chroma_size = (size_t) COLOR_CONVERT_CHROMA_SIZE(width) * COLOR_CONVERT_CHROMA_SIZE(height);
+        u8 *y = capture->staging;
+        u8 *u = y + pixel_count;
+        u8 *v = u + chroma_size;
+        color_convert_yuv420(pixels, width, height, width * 4, capture->bgra, y, u, v);
+        return fputs("FRAME\n", capture->output) >= 0 &&
+               fwrite(capture->staging, 1, pixel_count + 2 * chroma_size, capture->output) ==
+               pixel_count + 2 * chroma_size;
+    }
+
+    if (capture->bgra) {
+        color_convert_swap_red_blue(pixels, (u32) pixel_count, capture->staging);
+        pixels = capture->staging;
+    }
+    return fwrite(pixels, 4, pixel_count, capture->output) == pixel_count;
+}
+
+int frame_capture_writer_main(void *data) {
+    FrameCapture *capture = data;
+    while (true) {
+        SDL_SemWait(capture->ready_count);
+
+        CaptureSlot *slot = NULL;
+        if (!spsc_queue_pop(&capture->ready, (void **) &slot)) {
+            // Woken without a frame only to stop
+            break;
+        }
+
+        // After a failed write frames are only released, the render thread keeps running either way
+        if (!atomic_load(&capture->failed)) {
+            if (frame_capture_write(capture, slot)) {
+                atomic_fetch_add(&capture->written, 1);
+            } else {
+                LOG_ERROR("Writing a captured frame failed, dropping the rest of the capture");
+                atomic_store(&capture->failed, true);
+            }
+        }
+        atomic_store(&slot->state, CAPTURE_SLOT_FREE);
+    }
+
+    fflush(capture->output);
+    log_thread_release();
+    return 0;
+}
+
+bool frame_capture_open(FrameCapture *capture, const char *path) {
+    if (strcmp(path, "-") == 0) {
+        capture->output = stdout;
+    } else if (path[0] == '|') {
+        capture->output = popen(path + 1, "w");
+        capture->pipe = true;
+    } else {
+        capture->output = fopen(path, "wb");
+    }
+
+    if (capture->output == NULL) {
+        LOG_ERROR("Couldn't open capture output %s", path);
+        return false;
+    }
+    return true;
+}
+
+void frame_capture_close(FrameCapture *capture) {
+    if (capture->output == NULL || capture->output == stdout) {
+        return;
+    }
+    if (capture->pipe) {
+        pclose(capture->output);
+    } else {
+        fclose(capture->output);
+    }
+}
+
+void frame_capture_destroy(VulkanContext *context, FrameCapture *capture) {
+    if (capture->ready_count != NULL) {
+        SDL_DestroySemaphore(capture->ready_count);
+    }
+    spsc_queue_destroy(&capture->ready);
+    for (u32 i = 0; i < FRAME_CAPTURE_DEPTH; ++i) {
+        if (capture->slots[i].buffer.vk_buffer != NULL) {
+            buffer_destroy(&context->device, &capture->slots[i].buffer);
+        }
+    }
+    free(capture->staging);
+    frame_capture_close(capture);
+    memset(capture, 0, sizeof(FrameCapture));
+}
+
+bool frame_capture_start(VulkanContext *context, FrameCapture *capture, const char *path, CaptureFormat format,
+                         u32 fps) {
+    if (capture->active) {
+        LOG_ERROR("A capture is already running");
+        return false;
+    }
+
+    Swapchain *swapchain = &context->swapchain;
+    if (!(swapchain->usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
+        LOG_ERROR("Swapchain images can't be copied from, capture is unavailable");
+        return false;
+    }
+
+    VkFormat image_format = swapchain->surface_format.format;
+    bool bgra = image_format == VK_FORMAT_B8G8R8A8_UNORM || image_format == VK_FORMAT_B8G8R8A8_SRGB;
+    bool rgba = image_format == VK_FORMAT_R8G8B8A8_UNORM || image_format == VK_FORMAT_R8G8B8A8_SRGB;
+    if (!bgra && !rgba) {
+        LOG_ERROR("Can't capture swapchain format %s", string_VkFormat(image_format));
+        return false;
+    }
+
+    if (swapchain->extent.width == 0 || swapchain->extent.height == 0) {
+        LOG_ERROR("Can't capture an empty swapchain");
+        return false;
+    }
+
+    FrameCapture result = {0};
+    result.format = format;
+    result.extent = swapchain->extent;
+    result.bgra = bgra;
+    atomic_init(&result.written, 0);
+    atomic_init(&result.failed, false);
+    *capture = result;
+
+    // Cached memory makes the writer's reads fast, uncached readback memory is read at a fraction of the speed
+    VkDeviceSize size = (VkDeviceSize) capture->extent.width * capture->extent.height * 4;
+    for (u32 i = 0; i < FRAME_CAPTURE_DEPTH; ++i) {
+        CaptureSlot *slot = &capture->slots[i];
+        atomic_init(&slot->state, CAPTURE_SLOT_FREE);
+        if (buffer_create(&context->physical_device, &context->device, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, &slot->buffer)) {
+            continue;
+        }
+        slot->coherent = true;
+        if (!buffer_create(&context->physical_device, &context->device, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                           &slot->buffer)) {
+            LOG_ERROR("Couldn't create the capture readback buffers");
+            frame_capture_destroy(context, capture);
+            return false;
+        }
+    }
+
+    capture->staging = malloc(size);
+    if (capture->staging == NULL || !spsc_queue_create(FRAME_CAPTURE_DEPTH, &capture->ready) ||
+        (capture->ready_count = SDL_CreateSemaphore(0)) == NULL || !frame_capture_open(capture, path)) {
+        frame_capture_destroy(context, capture);
+        return false;
+    }
+
+    if (format == CAPTURE_FORMAT_Y4M) {
+        fprintf(capture->output, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", capture->extent.width,
+                capture->extent.height, fps != 0 ? fps : 60);
+    }
+
+    capture->writer = SDL_CreateThread(frame_capture_writer_main, "capture", capture);
+    if (capture->writer == NULL) {
+        LOG_ERROR("Failed to create the capture writer thread: %s", SDL_GetError());
+        frame_capture_destroy(context, capture);
+        return false;
+    }
+
+    capture->active = true;
+    LOG_INFO("Capturing %ux%u frames to %s", capture->extent.width, capture->extent.height, path);
+    return true;
+}
+
+void frame_capture_stop(VulkanContext *context, FrameCapture *capture) {
+    if (!capture->active) {
+        return;
+    }
+
+    // Every fence has signaled on an idle device, so this hands over all pending copies
+    frame_capture_poll(context, capture);
+    SDL_SemPost(capture->ready_count);
+    SDL_WaitThread(capture->writer, NULL);
+
+    LOG_INFO("Capture finished: %llu frames written, %llu dropped", (unsigned long long) atomic_load(&capture->written),
+             (unsigned long long) (capture->dropped + capture->captured - atomic_load(&capture->written)));
+    frame_capture_destroy(context, capture);
+}
+
+void frame_capture_pass(VulkanContext *context, VkCommandBuffer command_buffer, void *data) {
+    FrameCapture *capture = data;
+    CaptureSlot *slot = &capture->slots[capture->next];
+    if (atomic_load(&slot->state) != CAPTURE_SLOT_FREE) {
+        capture->dropped++;
+        return;
+    }
+
+    VkExtent2D extent = context->swapchain.extent;
+    if (extent.width == 0 || extent.height == 0) {
+        return;
+    }
+    slot->extent.width = extent.width < capture->extent.width ? extent.width : capture->extent.width;
+    slot->extent.height = extent.height < capture->extent.height ? extent.height : capture->extent.height;
+
+    VkBufferImageCopy region = {0};
+    region.bufferRowLength = capture->extent.width;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = (VkExtent3D) {slot->extent.width, slot->extent.height, 1};
+    vkCmdCopyImageToBuffer(command_buffer, context->swapchain.images[context->image_index],
+                           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot->buffer.vk_buffer, 1, &region);
+
+    // The fence alone makes the copy available but not visible to host reads
+    VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier,
+                         0, NULL, 0, NULL);
+
+    slot->fence = context->current_renderer->in_flight_fence;
+    atomic_store(&slot->state, CAPTURE_SLOT_PENDING);
+    capture->next = (capture->next + 1) % FRAME_CAPTURE_DEPTH;
+    capture->captured++;
+}
+
+void frame_capture_poll(VulkanContext *context, FrameCapture *capture) {
+    if (!capture->active) {
+        return;
+    }
+
+    // Slots are filled in ring order, handing them over in the same order keeps the frames in sequence
+    while (true) {
+        CaptureSlot *slot = &capture->slots[capture->oldest];
+        if (atomic_load(&slot->state) != CAPTURE_SLOT_PENDING ||
+            vkGetFenceStatus(context->device.vk_device, slot->fence) != VK_SUCCESS) {
+            break;
+        }
+
+        if (!slot->coherent) {
+            VkMappedMemoryRange range = {VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE};
+            range.memory = slot->buffer.memory;
+            range.size = VK_WHOLE_SIZE;
+            VK_CHECK(vkInvalidateMappedMemoryRanges(context->device.vk_device, 1, &range));
+        }
+
+        atomic_store(&slot->state, CAPTURE_SLOT_WRITING);
+        spsc_queue_push(&capture->ready, slot);
+        SDL_SemPost(capture->ready_count);
+        capture->oldest = (capture->oldest + 1) % FRAME_CAPTURE_DEPTH;
+    }
+}
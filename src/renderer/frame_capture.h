@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <SDL.h>
+#include <std/defines.h>
+#include "vulkan_types.h"
+#include "buffer.h"
+#include "core/spsc_queue.h"
+
+// Readback buffers in flight. A frame finding none free is dropped instead of stalling the renderer.
+#define FRAME_CAPTURE_DEPTH 4
+
+typedef struct VulkanContext VulkanContext;
+
+typedef enum CaptureFormat {
+    // Packed 8 bit RGBA rows without any header
+    CAPTURE_FORMAT_RAW_RGBA,
+    // YUV4MPEG2 with 4:2:0 full range chroma, readable by ffmpeg and most encoders
+    CAPTURE_FORMAT_Y4M,
+} CaptureFormat;
+
+typedef enum CaptureSlotState {
+    CAPTURE_SLOT_FREE,
+    // Copy recorded, waiting for the GPU
+    CAPTURE_SLOT_PENDING,
+    // Handed to the writer thread, which frees it again
+    CAPTURE_SLOT_WRITING,
+} CaptureSlotState;
+
+typedef struct CaptureSlot {
+    Buffer buffer;
+    atomic_int state;
+    // Fence of the frame that copied into it
+    VkFence fence;
+    // Part of the buffer the copy wrote, smaller than the capture after shrinking the window
+    VkExtent2D extent;
+    // Readback memory is cached where possible, which needs invalidating before the host reads it
+    bool coherent;
+} CaptureSlot;
+
+// Copies presented frames into a ring of host visible buffers and streams them from a writer thread. The render
+// thread records copies and polls their fences, it never waits for the GPU or the output.
+typedef struct FrameCapture {
+    bool active;
+    CaptureFormat format;
+    // Size of every output frame, fixed when the capture starts
+    VkExtent2D extent;
+    bool bgra;
+
+    CaptureSlot slots[FRAME_CAPTURE_DEPTH];
+    // Render thread: the slot the next copy goes into, and the oldest pending one
+    u32 next;
+    u32 oldest;
+
+    FILE *output;
+    bool pipe;
+    SDL_Thread *writer;
+    SpscQueue ready;
+    SDL_sem *ready_count;
+    // Writer thread: converted frame before it is written
+    u8 *staging;
+
+    u64 captured;
+    u64 dropped;
+    atomic_ullong written;
+    atomic_bool failed;
+} FrameCapture;
+
+// path is a file, "-" for stdout or "|command" to pipe into a process. Needs the swapchain to support transfer
+// source usage and an 8 bit RGBA or BGRA format.
+bool frame_capture_start(VulkanContext *context, FrameCapture *capture, const char *path, CaptureFormat format,
+                         u32 fps);
+
+// The device has to be idle, writes out the frames still pending before closing the output
+void frame_capture_stop(VulkanContext *context, FrameCapture *capture);
+
+// Render graph pass after the backbuffer is final, copies it into the next free slot
+void frame_capture_pass(VulkanContext *context, VkCommandBuffer command_buffer, void *data);
+
+// Render thread, after waiting for the frame's fence and before resetting it: hands completed copies to the writer
+void frame_capture_poll(VulkanContext *context, FrameCapture *capture);
@@ -0,0 +1,215 @@
+#include "frame_timing.h"
+#include "host_allocator.h"
+#include "vulkan.h"
+
+#include <string.h>
+#include <SDL.h>
+#include <std/containers/darray.h>
+
+bool frame_timing_create(VulkanContext *context, FramePacer *pacer, FrameTiming *out) {
+    FrameTiming result = {0};
+    result.pacer = pacer;
+    result.present_id = context->device.present_id;
+    latency_stats_init("Input to photon latency", &result.input_to_photon);
+
+    if (context->device.present_wait) {
+        result.wait_for_present = (PFN_vkWaitForPresentKHR) vkGetDeviceProcAddr(context->device.vk_device,
+                                                                                 "vkWaitForPresentKHR");
+    }
+    if (result.wait_for_present == NULL) {
+        LOG_INFO("VK_KHR_present_wait unavailable, latency is measured up to vkQueuePresentKHR");
+    }
+
+    VkPhysicalDeviceLimits *limits = &context->physical_device.properties.limits;
+    if (limits->timestampComputeAndGraphics && limits->timestampPeriod > 0.0f) {
+        VkQueryPoolCreateInfo create_info = {VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+        create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        create_info.queryCount = FRAME_TIMING_QUERY_COUNT * darray_length(context->renderer_instances);
+        VK_CHECK(vkCreateQueryPool(context->device.vk_device, &create_info, host_allocator(), &result.timestamp_pool));
+        result.timestamp_period = limits->timestampPeriod;
+    }
+
+    *out = result;
+    return true;
+}
+
+void frame_timing_destroy(VulkanContext *context, FrameTiming *timing) {
+    if (timing->timestamp_pool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(context->device.vk_device, timing->timestamp_pool, host_allocator());
+    }
+    memset(timing, 0, sizeof(FrameTiming));
+}
+
+double frame_timing_ms(FrameTiming *timing, u64 start, u64 end) {
+    return end > start ? (double) (end - start) * timing->timestamp_period / 1e6 : 0.0;
+}
+
+double frame_timing_smooth(double smoothed, double sample) {
+    return smoothed + (sample - smoothed) * FRAME_TIMING_PASS_SMOOTHING;
+}
+
+void frame_timing_begin(VulkanContext *context, FrameTiming *timing, u32 instance, VkCommandBuffer command_buffer) {
+    if (timing->timestamp_pool == VK_NULL_HANDLE) {
+        return;
+    }
+
+    u32 first = instance * FRAME_TIMING_QUERY_COUNT;
+    if (timing->written & (1u << instance)) {
+        // Passes added since the graph was rebuilt have no timestamp yet, which fails the read for one frame
+        u64 timestamps[FRAME_TIMING_QUERY_OVERLAY];
+        u32 count = FRAME_TIMING_QUERY_PASSES + timing->pass_count;
+        VkResult result = vkGetQueryPoolResults(context->device.vk_device, timing->timestamp_pool, first, count,
+                                                sizeof(timestamps), timestamps, sizeof(u64), VK_QUERY_RESULT_64_BIT);
+        if (result == VK_SUCCESS && timestamps[1] > timestamps[0]) {
+            double nanoseconds = (double) (timestamps[1] - timestamps[0]) * timing->timestamp_period;
+            frame_pacer_gpu_time(timing->pacer, (u64) (nanoseconds * (double) SDL_GetPerformanceFrequency() / 1e9));
+            timing->frame_ms = nanoseconds / 1e6;
+
+            timing->setup_ms = frame_timing_smooth(timing->setup_ms,
+                                                   frame_timing_ms(timing, timestamps[0],
+                                                                   timestamps[FRAME_TIMING_QUERY_GRAPH]));
+            for (u32 p = 0; p < timing->pass_count; ++p) {
+                u32 query = FRAME_TIMING_QUERY_PASSES + p;
+                timing->pass_ms[p] = frame_timing_smooth(timing->pass_ms[p],
+                                                         frame_timing_ms(timing, timestamps[query - 1],
+                                                                         timestamps[query]));
+            }
+        }
+    }
+
+    if (timing->overlay_written & (1u << instance)) {
+        u64 timestamps[2];
+        VkResult result = vkGetQueryPoolResults(context->device.vk_device, timing->timestamp_pool,
+                                                first + FRAME_TIMING_QUERY_OVERLAY, 2, sizeof(timestamps), timestamps,
+                                                sizeof(u64), VK_QUERY_RESULT_64_BIT);
+        if (result == VK_SUCCESS) {
+            timing->overlay_ms = frame_timing_smooth(timing->overlay_ms,
+                                                     frame_timing_ms(timing, timestamps[0], timestamps[1]));
+        }
+    }
+
+    vkCmdResetQueryPool(command_buffer, timing->timestamp_pool, first, FRAME_TIMING_QUERY_COUNT);
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timing->timestamp_pool,
+                        first + FRAME_TIMING_QUERY_FRAME);
+    timing->written |= 1u << instance;
+    timing->overlay_written &= ~(1u << instance);
+}
+
+void frame_timing_end(FrameTiming *timing, u32 instance, VkCommandBuffer command_buffer) {
+    if (timing->timestamp_pool != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timing->timestamp_pool,
+                            instance * FRAME_TIMING_QUERY_COUNT + FRAME_TIMING_QUERY_FRAME + 1);
+    }
+}
+
+void frame_timing_graph(FrameTiming *timing, u32 instance, RenderGraph *graph, VkCommandBuffer command_buffer) {
+    if (timing->timestamp_pool == VK_NULL_HANDLE) {
+        return;
+    }
+
+    u32 first = instance * FRAME_TIMING_QUERY_COUNT;
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timing->timestamp_pool,
+                        first + FRAME_TIMING_QUERY_GRAPH);
+    render_graph_set_timestamps(graph, timing->timestamp_pool, first + FRAME_TIMING_QUERY_PASSES);
+    if (timing->pass_count != graph->pass_count) {
+        memset(timing->pass_ms, 0, sizeof(timing->pass_ms));
+        timing->pass_count = graph->pass_count;
+    }
+}
+
+void frame_timing_overlay_begin(FrameTiming *timing, u32 instance, VkCommandBuffer command_buffer) {
+    if (timing->timestamp_pool != VK_NULL_HANDLE) {
+        // Once the draws before it are done, so their tail isn't counted towards the overlay
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timing->timestamp_pool,
+                            instance * FRAME_TIMING_QUERY_COUNT + FRAME_TIMING_QUERY_OVERLAY);
+    }
+}
+
+void frame_timing_overlay_end(FrameTiming *timing, u32 instance, VkCommandBuffer command_buffer) {
+    if (timing->timestamp_pool != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timing->timestamp_pool,
+                            instance * FRAME_TIMING_QUERY_COUNT + FRAME_TIMING_QUERY_OVERLAY + 1);
+        timing->overlay_written |= 1u << instance;
+    }
+}
+
+void frame_timing_submitted(FrameTiming *timing) {
+    if (timing->record_start != 0) {
+        frame_pacer_render_time(timing->pacer, SDL_GetPerformanceCounter() - timing->record_start);
+    }
+}
+
+void frame_timing_sample(FrameTiming *timing, const PendingPresent *present, u64 photon) {
+    frame_pacer_presented(timing->pacer, photon);
+    if (present->input.timestamp != 0 && photon > present->input.timestamp) {
+        latency_stats_add(&timing->input_to_photon, photon - present->input.timestamp);
+    }
+}
+
+const void *frame_timing_present(FrameTiming *timing, const FrameInput *input, VkPresentIdKHR *present_id) {
+    if (timing->pending_count == FRAME_TIMING_PENDING_COUNT) {
+        timing->pending_first = (timing->pending_first + 1) % FRAME_TIMING_PENDING_COUNT;
+        timing->pending_count--;
+    }
+
+    PendingPresent *pending =
+            &timing->pending[(timing->pending_first + timing->pending_count) % FRAME_TIMING_PENDING_COUNT];
+    pending->present_id = ++timing->next_present_id;
+    pending->input = *input;
+    pending->submitted = SDL_GetPerformanceCounter();
+    timing->pending_count++;
+
+    if (!timing->present_id) {
+        return NULL;
+    }
+
+    VkPresentIdKHR result = {VK_STRUCTURE_TYPE_PRESENT_ID_KHR};
+    result.swapchainCount = 1;
+    result.pPresentIds = &pending->present_id;
+    *present_id = result;
+    return present_id;
+}
+
+void frame_timing_presented(VulkanContext *context, FrameTiming *timing, VkSwapchainKHR swapchain) {
+    if (timing->wait_for_present == NULL) {
+        u64 now = SDL_GetPerformanceCounter();
+        while (timing->pending_count > 0) {
+            frame_timing_sample(timing, &timing->pending[timing->pending_first], now);
+            timing->pending_first = (timing->pending_first + 1) % FRAME_TIMING_PENDING_COUNT;
+            timing->pending_count--;
+        }
+        latency_stats_report(&timing->input_to_photon);
+        return;
+    }
+
+    // Older presents are checked without blocking. Just in time pacing blocks on the newest one too: the next packet is
+    // not due before it is visible, and the pacer needs the exact time to aim for the following refresh.
+    bool block = atomic_load(&timing->pacer->mode) == FRAME_PACING_JUST_IN_TIME;
+    while (timing->pending_count > 0) {
+        PendingPresent *present = &timing->pending[timing->pending_first];
+        bool newest = timing->pending_count == 1;
+        u64 timeout = 0;
+        if (block && newest) {
+            // Two refreshes, a present that takes longer is collected with the next frame instead
+            u64 interval = atomic_load(&timing->pacer->present_interval);
+            timeout = interval != 0 ? (u64) (2e9 * (double) interval / (double) SDL_GetPerformanceFrequency())
+                                    : 100000000;
+        }
+
+        VkResult result = timing->wait_for_present(context->device.vk_device, swapchain, present->present_id, timeout);
+        if (result == VK_TIMEOUT) {
+            break;
+        }
+        if (result == VK_SUCCESS) {
+            frame_timing_sample(timing, present, SDL_GetPerformanceCounter());
+        }
+        timing->pending_first = (timing->pending_first + 1) % FRAME_TIMING_PENDING_COUNT;
+        timing->pending_count--;
+    }
+    latency_stats_report(&timing->input_to_photon);
+}
+
+void frame_timing_reset(FrameTiming *timing) {
+    timing->pending_first = 0;
+    timing->pending_count = 0;
+}
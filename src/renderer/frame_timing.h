@@ -0,0 +1,101 @@
+#pragma once
+
+#include <std/defines.h>
+#include "vulkan_types.h"
+#include "render_graph.h"
+#include "core/latency.h"
+
+// Presents waiting for their photon timestamp, older ones are dropped without a sample
+#define FRAME_TIMING_PENDING_COUNT 8
+
+// Timestamp queries of one renderer instance: around its command buffer, before the render graph, after each pass
+// and around the debug overlay draw
+#define FRAME_TIMING_QUERY_FRAME 0
+#define FRAME_TIMING_QUERY_GRAPH 2
+#define FRAME_TIMING_QUERY_PASSES 3
+#define FRAME_TIMING_QUERY_OVERLAY (FRAME_TIMING_QUERY_PASSES + RENDER_GRAPH_MAX_PASSES)
+#define FRAME_TIMING_QUERY_COUNT (FRAME_TIMING_QUERY_OVERLAY + 2)
+// Weight of a new sample in the smoothed per pass times
+#define FRAME_TIMING_PASS_SMOOTHING 0.1
+
+typedef struct VulkanContext VulkanContext;
+
+// Input consumed by one frame, carried from the render packet to its present
+typedef struct FrameInput {
+    u64 first_id;
+    u64 last_id;
+    // Pump time of the oldest event, 0 when the frame consumed no input
+    u64 timestamp;
+} FrameInput;
+
+typedef struct PendingPresent {
+    u64 present_id;
+    FrameInput input;
+    u64 submitted;
+} PendingPresent;
+
+// Render thread side of latency measurement: present ids, GPU timestamps and input-to-photon stats
+typedef struct FrameTiming {
+    // NULL without VK_KHR_present_wait, photons are then approximated by the return of vkQueuePresentKHR
+    PFN_vkWaitForPresentKHR wait_for_present;
+    bool present_id;
+
+    // FRAME_TIMING_QUERY_COUNT timestamps per renderer instance
+    VkQueryPool timestamp_pool;
+    double timestamp_period;
+    u32 written;
+    u32 overlay_written;
+
+    // GPU times in milliseconds, read back once an instance's fence has signaled. The last frame's total is kept as
+    // is, passes are smoothed. setup_ms is the work recorded ahead of the graph.
+    double frame_ms;
+    double setup_ms;
+    double pass_ms[RENDER_GRAPH_MAX_PASSES];
+    u32 pass_count;
+    double overlay_ms;
+
+    // Set once the image is acquired, up to the submit is counted as render thread work
+    u64 record_start;
+
+    u64 next_present_id;
+    PendingPresent pending[FRAME_TIMING_PENDING_COUNT];
+    u32 pending_first;
+    u32 pending_count;
+
+    LatencyStats input_to_photon;
+    FramePacer *pacer;
+} FrameTiming;
+
+bool frame_timing_create(VulkanContext *context, FramePacer *pacer, FrameTiming *out);
+
+void frame_timing_destroy(VulkanContext *context, FrameTiming *timing);
+
+// After the instance's fence has signaled: reads its last GPU time and records the first timestamp of the next one
+void frame_timing_begin(VulkanContext *context, FrameTiming *timing, u32 instance, VkCommandBuffer command_buffer);
+
+void frame_timing_end(FrameTiming *timing, u32 instance, VkCommandBuffer command_buffer);
+
+// Moves a smoothed time towards a new sample by FRAME_TIMING_PASS_SMOOTHING
+double frame_timing_smooth(double smoothed, double sample);
+
+// Right before the graph executes, has it write a timestamp after each of its passes
+void frame_timing_graph(FrameTiming *timing, u32 instance, RenderGraph *graph, VkCommandBuffer command_buffer);
+
+// Around the debug overlay draw, inside the render pass
+void frame_timing_overlay_begin(FrameTiming *timing, u32 instance, VkCommandBuffer command_buffer);
+
+void frame_timing_overlay_end(FrameTiming *timing, u32 instance, VkCommandBuffer command_buffer);
+
+// After vkQueueSubmit, feeds the time since record_start to the pacer
+void frame_timing_submitted(FrameTiming *timing);
+
+// Fills present_id for the present of the frame that consumed input, returns the struct to chain into
+// VkPresentInfoKHR or NULL when present ids are not supported
+const void *frame_timing_present(FrameTiming *timing, const FrameInput *input, VkPresentIdKHR *present_id);
+
+// After vkQueuePresentKHR. Collects the presents that became visible, and blocks on this one when just in time
+// pacing needs its exact timestamp.
+void frame_timing_presented(VulkanContext *context, FrameTiming *timing, VkSwapchainKHR swapchain);
+
+// Before the swapchain is destroyed, pending present ids die with it
+void frame_timing_reset(FrameTiming *timing);
@@ -1,34 +1,134 @@
 #include "framebuffer.h"
-#include <std/containers/darray.h>
+#include "host_allocator.h"
 
+bool framebuffer_depth_format(PhysicalDevice *physical_device, VkFormat *out) {
+    VkFormat candidates[] = {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D16_UNORM};
+    for (u32 i = 0; i < sizeof(candidates) / sizeof(candidates[0]); ++i) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(physical_device->device, candidates[i], &properties);
+        // The depth pyramid samples it
+        VkFormatFeatureFlags features = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                        VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+        if ((properties.optimalTilingFeatures & features) == features) {
+            *out = candidates[i];
+            return true;
+        }
+    }
 
-bool framebuffer_create(VulkanContext *context) {
-    context->framebuffers = darray_create(VkFramebuffer);
+    return false;
+}
 
-    for (int i = 0; i < darray_length(context->swapchain.image_views); ++i) {
-        VkImageView *image_view = &context->swapchain.image_views[i];
+VkImageAspectFlags framebuffer_depth_aspect(VkFormat format) {
+    VkImageAspectFlags aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    if (format == VK_FORMAT_D24_UNORM_S8_UINT) {
+        aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+    return aspect;
+}
+
+VkSampleCountFlagBits framebuffer_sample_count(PhysicalDevice *physical_device, VkSampleCountFlagBits requested) {
+    VkPhysicalDeviceLimits *limits = &physical_device->properties.limits;
+    VkSampleCountFlags supported = limits->framebufferColorSampleCounts & limits->framebufferDepthSampleCounts &
+                                   limits->sampledImageDepthSampleCounts;
+    for (VkSampleCountFlagBits samples = requested; samples > VK_SAMPLE_COUNT_1_BIT; samples >>= 1) {
+        if (supported & samples) {
+            return samples;
+        }
+    }
 
-        VkFramebufferCreateInfo create_info = {VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
-        create_info.pAttachments = image_view;
-        create_info.attachmentCount = 1;
-        create_info.renderPass = context->graphics_pipeline.render_pass;
-        create_info.width = context->swapchain.extent.width;
-        create_info.height = context->swapchain.extent.height;
-        create_info.layers = 1;
+    return VK_SAMPLE_COUNT_1_BIT;
+}
 
-        VkFramebuffer framebuffer;
-        VK_CHECK(vkCreateFramebuffer(context->device.vk_device, &create_info, NULL, &framebuffer));
-        darray_push(context->framebuffers, framebuffer);
+// Attachments only touched inside the render pass can live in lazily allocated memory on tilers that never gets
+// backed. Desktop GPUs have no such memory type and get plain device local images, as do attachments read later.
+bool framebuffer_attachment_create(VulkanContext *context, VkFormat format, VkImageUsageFlags usage,
+                                   VkImageAspectFlags aspect, Image *out) {
+    bool transient = (usage & ~(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)) == 0;
+    ImageConfig config = {0};
+    config.format = format;
+    config.extent = context->swapchain.extent;
+    config.mip_levels = 1;
+    config.samples = context->graphics_pipeline.samples;
+    config.usage = usage | (transient ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+    config.aspect = aspect;
+    config.memory_properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    config.preferred_memory_properties = transient ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0;
+    if (!image_create(&context->physical_device, &context->device, &config, out)) {
+        return false;
     }
 
+    if (out->memory_properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+        LOG_INFO("%s attachment is lazily allocated", string_VkFormat(format));
+    }
+    return true;
+}
+
+bool framebuffer_create(VulkanContext *context) {
+    GraphicsPipeline *pipeline = &context->graphics_pipeline;
+    bool resolve = pipeline->samples != VK_SAMPLE_COUNT_1_BIT;
+
+    // Depth outlives the pass, the depth pyramid is built from it
+    if (!framebuffer_attachment_create(context, pipeline->depth_format,
+                                       VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                       framebuffer_depth_aspect(pipeline->depth_format), &context->depth_attachment)) {
+        return false;
+    }
+    if (resolve && !framebuffer_attachment_create(context, context->swapchain.surface_format.format,
+                                                  VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
+                                                  &context->color_attachment)) {
+        return false;
+    }
+
+    // Full size so any render scale fits, it outlives the pass and is read by the upscale blit
+    ImageConfig scene_config = {0};
+    scene_config.format = context->swapchain.surface_format.format;
+    scene_config.extent = context->swapchain.extent;
+    scene_config.mip_levels = 1;
+    scene_config.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    scene_config.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    scene_config.memory_properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    if (!image_create(&context->physical_device, &context->device, &scene_config, &context->scene_color)) {
+        return false;
+    }
+
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(context->physical_device.device, scene_config.format, &properties);
+    context->upscale_filter = properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT
+                                      ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+    VkImageView attachments[FRAMEBUFFER_MAX_ATTACHMENTS] = {0};
+    attachments[FRAMEBUFFER_ATTACHMENT_COLOR] = resolve ? context->color_attachment.view : context->scene_color.view;
+    attachments[FRAMEBUFFER_ATTACHMENT_DEPTH] = context->depth_attachment.view;
+    attachments[FRAMEBUFFER_ATTACHMENT_RESOLVE] = context->scene_color.view;
+
+    VkFramebufferCreateInfo create_info = {VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
+    create_info.pAttachments = attachments;
+    create_info.attachmentCount = resolve ? FRAMEBUFFER_MAX_ATTACHMENTS : FRAMEBUFFER_ATTACHMENT_RESOLVE;
+    create_info.renderPass = pipeline->render_pass;
+    create_info.width = context->swapchain.extent.width;
+    create_info.height = context->swapchain.extent.height;
+    create_info.layers = 1;
+    VK_CHECK(vkCreateFramebuffer(context->device.vk_device, &create_info, host_allocator(), &context->framebuffer));
+
+    resolution_scaler_resize(&context->resolution, context->swapchain.extent);
     return true;
 }
 
 void framebuffer_destroy(VulkanContext *context) {
-    for (int i = 0; i < darray_length(context->framebuffers); ++i) {
-        vkDestroyFramebuffer(context->device.vk_device, context->framebuffers[i], NULL);
+    if (context->framebuffer != VK_NULL_HANDLE) {
+        vkDestroyFramebuffer(context->device.vk_device, context->framebuffer, host_allocator());
+        context->framebuffer = VK_NULL_HANDLE;
+    }
+
+    if (context->scene_color.vk_image != NULL) {
+        image_destroy(&context->device, &context->scene_color);
     }
 
-    darray_destroy(context->framebuffers)
-    context->framebuffers = NULL;
-}
\ No newline at end of file
+    if (context->depth_attachment.vk_image != NULL) {
+        image_destroy(&context->device, &context->depth_attachment);
+    }
+    if (context->color_attachment.vk_image != NULL) {
+        image_destroy(&context->device, &context->color_attachment);
+    }
+}
@@ -3,6 +3,23 @@
 #include "vulkan_types.h"
 #include "vulkan.h"
 
+// Requested multisampling, lowered to what the device supports for both color and depth and for sampling depth
+#define FRAMEBUFFER_MSAA_SAMPLES VK_SAMPLE_COUNT_4_BIT
+
+typedef enum FramebufferAttachment {
+    FRAMEBUFFER_ATTACHMENT_COLOR,
+    FRAMEBUFFER_ATTACHMENT_DEPTH,
+    // Only present with multisampling
+    FRAMEBUFFER_ATTACHMENT_RESOLVE,
+    FRAMEBUFFER_MAX_ATTACHMENTS
+} FramebufferAttachment;
+
+bool framebuffer_depth_format(PhysicalDevice *physical_device, VkFormat *out);
+
+VkImageAspectFlags framebuffer_depth_aspect(VkFormat format);
+
+VkSampleCountFlagBits framebuffer_sample_count(PhysicalDevice *physical_device, VkSampleCountFlagBits requested);
+
 bool framebuffer_create(VulkanContext *context);
 
-void framebuffer_destroy(VulkanContext *context);
\ No newline at end of file
+void framebuffer_destroy(VulkanContext *context);
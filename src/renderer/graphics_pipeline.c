@@ -1,48 +1,110 @@
 #include "graphics_pipeline.h"
+#include "host_allocator.h"
+#include "framebuffer.h"
 #include "vulkan.h"
 #include <std/containers/darray.h>
 
-void render_pass_create(Device *device, Swapchain *swapchain, VkRenderPass *render_pass) {
-    VkAttachmentDescription color_attachment = {0};
-    color_attachment.format = swapchain->formats[swapchain->selected_format].format;
-    color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+// Attachments in order: color, depth and with multisampling the scene color image the color is resolved into.
+// Multisampled color never leaves the pass and is not stored so tilers can keep it on chip. Depth is stored for the
+// depth pyramid, the render graph orders it against the pyramid build of the frame before.
+void render_pass_create(Device *device, Swapchain *swapchain, VkSampleCountFlagBits samples, VkFormat depth_format,
+                        VkRenderPass *render_pass) {
+    bool resolve = samples != VK_SAMPLE_COUNT_1_BIT;
+    VkAttachmentDescription attachments[FRAMEBUFFER_MAX_ATTACHMENTS] = {0};
+
+    VkAttachmentDescription *color_attachment = &attachments[FRAMEBUFFER_ATTACHMENT_COLOR];
+    color_attachment->format = swapchain->surface_format.format;
+    color_attachment->samples = samples;
+    color_attachment->loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    color_attachment->storeOp = resolve ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+    color_attachment->stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    color_attachment->stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    // The render graph transitions the scene color image around the pass and orders it against the passes before
+    color_attachment->initialLayout = resolve ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    color_attachment->finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentDescription *depth_attachment = &attachments[FRAMEBUFFER_ATTACHMENT_DEPTH];
+    depth_attachment->format = depth_format;
+    depth_attachment->samples = samples;
+    depth_attachment->loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depth_attachment->storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    depth_attachment->stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depth_attachment->stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depth_attachment->initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depth_attachment->finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentDescription *resolve_attachment = &attachments[FRAMEBUFFER_ATTACHMENT_RESOLVE];
+    resolve_attachment->format = swapchain->surface_format.format;
+    resolve_attachment->samples = VK_SAMPLE_COUNT_1_BIT;
+    resolve_attachment->loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    resolve_attachment->storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    resolve_attachment->stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    resolve_attachment->stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    resolve_attachment->initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    resolve_attachment->finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
     VkAttachmentReference color_attachment_ref = {0};
-    color_attachment_ref.attachment = 0;
+    color_attachment_ref.attachment = FRAMEBUFFER_ATTACHMENT_COLOR;
     color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+    VkAttachmentReference depth_attachment_ref = {0};
+    depth_attachment_ref.attachment = FRAMEBUFFER_ATTACHMENT_DEPTH;
+    depth_attachment_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference resolve_attachment_ref = {0};
+    resolve_attachment_ref.attachment = FRAMEBUFFER_ATTACHMENT_RESOLVE;
+    resolve_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
     VkSubpassDescription subpass = {0};
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &color_attachment_ref;
+    subpass.pDepthStencilAttachment = &depth_attachment_ref;
+    subpass.pResolveAttachments = resolve ? &resolve_attachment_ref : NULL;
 
+    // Frames in flight share the depth and multisampled color images, the render graph only sees depth while meshlets
+    // are culled against it
     VkSubpassDependency dependency = {0};
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+                              VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependency.dstStageMask = dependency.srcStageMask;
+    dependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                               VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+                               VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 
     VkRenderPassCreateInfo render_pass_create_info = {VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
-    render_pass_create_info.attachmentCount = 1;
-    render_pass_create_info.pAttachments = &color_attachment;
+    render_pass_create_info.attachmentCount = resolve ? FRAMEBUFFER_MAX_ATTACHMENTS : FRAMEBUFFER_ATTACHMENT_RESOLVE;
+    render_pass_create_info.pAttachments = attachments;
     render_pass_create_info.subpassCount = 1;
     render_pass_create_info.pSubpasses = &subpass;
     render_pass_create_info.dependencyCount = 1;
     render_pass_create_info.pDependencies = &dependency;
 
-    VK_CHECK(vkCreateRenderPass(device->vk_device, &render_pass_create_info, NULL, render_pass));
+    VK_CHECK(vkCreateRenderPass(device->vk_device, &render_pass_create_info, host_allocator(), render_pass));
+}
+
+VkPipelineDepthStencilStateCreateInfo graphics_pipeline_depth_state() {
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_create_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO};
+    depth_stencil_create_info.depthTestEnable = VK_TRUE;
+    depth_stencil_create_info.depthWriteEnable = VK_TRUE;
+    depth_stencil_create_info.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    depth_stencil_create_info.minDepthBounds = 0.0f;
+    depth_stencil_create_info.maxDepthBounds = 1.0f;
+    return depth_stencil_create_info;
 }
 
-bool graphics_pipeline_create(Device *device, Swapchain *swapchain, GraphicsPipeline *out) {
-    render_pass_create(device, swapchain, &out->render_pass);
+bool graphics_pipeline_create(PhysicalDevice *physical_device, Device *device, Swapchain *swapchain,
+                              BindlessTable *bindless, GraphicsPipeline *out) {
+    out->samples = framebuffer_sample_count(physical_device, FRAMEBUFFER_MSAA_SAMPLES);
+    if (!framebuffer_depth_format(physical_device, &out->depth_format)) {
+        LOG_ERROR("No supported depth attachment format!");
+        return false;
+    }
+    render_pass_create(device, swapchain, out->samples, out->depth_format, &out->render_pass);
 
     Shader shader = {0};
     shader_load(device, "vertex.vert.spv", "fragment.frag.spv", &shader);
@@ -113,7 +175,7 @@ bool graphics_pipeline_create(Device *device, Swapchain *swapchain, GraphicsPipe
     VkPipelineMultisampleStateCreateInfo multisample_create_info = {
             VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO};
     multisample_create_info.sampleShadingEnable = VK_FALSE;
-    multisample_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisample_create_info.rasterizationSamples = out->samples;
     multisample_create_info.minSampleShading = 1.0f;
     multisample_create_info.pSampleMask = NULL;
     multisample_create_info.alphaToCoverageEnable = VK_FALSE;
@@ -141,10 +203,20 @@ bool graphics_pipeline_create(Device *device, Swapchain *swapchain, GraphicsPipe
     color_blend_create_info.blendConstants[2] = 0;
     color_blend_create_info.blendConstants[3] = 0;
 
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_create_info = graphics_pipeline_depth_state();
+
+    VkPushConstantRange push_constant_range = {0};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_ALL;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(BindlessDrawConstants);
+
     VkPipelineLayoutCreateInfo layout_create_info = {VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
-    layout_create_info.setLayoutCount = 0;
+    layout_create_info.setLayoutCount = 1;
+    layout_create_info.pSetLayouts = &bindless->layout;
+    layout_create_info.pushConstantRangeCount = 1;
+    layout_create_info.pPushConstantRanges = &push_constant_range;
 
-    VK_CHECK(vkCreatePipelineLayout(device->vk_device, &layout_create_info, NULL, &out->layout));
+    VK_CHECK(vkCreatePipelineLayout(device->vk_device, &layout_create_info, host_allocator(), &out->layout));
 
     VkGraphicsPipelineCreateInfo pipeline_create_info = {VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
     pipeline_create_info.stageCount = 2;
@@ -154,7 +226,7 @@ bool graphics_pipeline_create(Device *device, Swapchain *swapchain, GraphicsPipe
     pipeline_create_info.pViewportState = &viewport_state_create_info;
     pipeline_create_info.pRasterizationState = &raterization_create_info;
     pipeline_create_info.pMultisampleState = &multisample_create_info;
-    pipeline_create_info.pDepthStencilState = NULL;
+    pipeline_create_info.pDepthStencilState = &depth_stencil_create_info;
     pipeline_create_info.pColorBlendState = &color_blend_create_info;
     pipeline_create_info.pDynamicState = &dynamic_state_create_info;
     pipeline_create_info.layout = out->layout;
@@ -163,34 +235,56 @@ bool graphics_pipeline_create(Device *device, Swapchain *swapchain, GraphicsPipe
     pipeline_create_info.basePipelineHandle = NULL;
     pipeline_create_info.basePipelineIndex = -1;
 
-    VK_CHECK(vkCreateGraphicsPipelines(device->vk_device, VK_NULL_HANDLE, 1, &pipeline_create_info, NULL, &out->vk_pipeline));
+    VK_CHECK(vkCreateGraphicsPipelines(device->vk_device, device->pipeline_cache, 1, &pipeline_create_info, host_allocator(),
+                                       &out->vk_pipeline));
 
     shader_destroy(device, &shader);
     return true;
 }
 
+bool compute_pipeline_create(Device *device, VkPipelineLayout layout, const char *path, VkPipeline *out) {
+    VkShaderModule module;
+    if (!shader_module_load(device, path, &module)) {
+        return false;
+    }
+
+    VkComputePipelineCreateInfo create_info = {VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+    create_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    create_info.stage.module = module;
+    create_info.stage.pName = "main";
+    create_info.layout = layout;
+    VK_CHECK(vkCreateComputePipelines(device->vk_device, device->pipeline_cache, 1, &create_info, host_allocator(), out));
+
+    vkDestroyShaderModule(device->vk_device, module, host_allocator());
+    return true;
+}
+
 void graphics_pipeline_destroy(Device *device, GraphicsPipeline *pipeline) {
-    vkDestroyRenderPass(device->vk_device, pipeline->render_pass, NULL);
+    vkDestroyRenderPass(device->vk_device, pipeline->render_pass, host_allocator());
     pipeline->render_pass = NULL;
 
-    vkDestroyPipeline(device->vk_device, pipeline->vk_pipeline, NULL);
+    vkDestroyPipeline(device->vk_device, pipeline->vk_pipeline, host_allocator());
     pipeline->vk_pipeline = NULL;
 
-    vkDestroyPipelineLayout(device->vk_device, pipeline->layout, NULL);
+    vkDestroyPipelineLayout(device->vk_device, pipeline->layout, host_allocator());
     pipeline->layout = NULL;
 }
 
-void render_pass_begin(VulkanContext *context, u32 image_index) {
+void render_pass_begin(VulkanContext *context, VkExtent2D extent) {
     VkRenderPassBeginInfo begin_info = {VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
     begin_info.renderPass = context->graphics_pipeline.render_pass;
-    begin_info.framebuffer = context->framebuffers[image_index];
+    begin_info.framebuffer = context->framebuffer;
     begin_info.renderArea.offset.x = 0;
     begin_info.renderArea.offset.y = 0;
-    begin_info.renderArea.extent = context->swapchain.extent;
+    begin_info.renderArea.extent = extent;
 
-    VkClearValue clear_color = {.color = {0.0, 0.0, 0.0, 1.0}};
-    begin_info.clearValueCount = 1;
-    begin_info.pClearValues = &clear_color;
+    // The resolve attachment is not cleared, so it needs no clear value
+    VkClearValue clear_values[FRAMEBUFFER_ATTACHMENT_RESOLVE] = {0};
+    clear_values[FRAMEBUFFER_ATTACHMENT_COLOR].color = (VkClearColorValue) {{0.0f, 0.0f, 0.0f, 1.0f}};
+    clear_values[FRAMEBUFFER_ATTACHMENT_DEPTH].depthStencil = (VkClearDepthStencilValue) {1.0f, 0};
+    begin_info.clearValueCount = FRAMEBUFFER_ATTACHMENT_RESOLVE;
+    begin_info.pClearValues = clear_values;
 
     vkCmdBeginRenderPass(context->current_renderer->command_buffer, &begin_info, VK_SUBPASS_CONTENTS_INLINE);
 }
@@ -201,4 +295,11 @@ void render_pass_end(VulkanContext *context) {
 
 void bind_pipeline(VulkanContext *context) {
     vkCmdBindPipeline(context->current_renderer->command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, context->graphics_pipeline.vk_pipeline);
+    bindless_bind(&context->bindless, context->current_renderer->command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                  context->graphics_pipeline.layout);
+}
+
+void push_draw_constants(VulkanContext *context, BindlessDrawConstants *constants) {
+    vkCmdPushConstants(context->current_renderer->command_buffer, context->graphics_pipeline.layout,
+                       VK_SHADER_STAGE_ALL, 0, sizeof(BindlessDrawConstants), constants);
 }
\ No newline at end of file
@@ -5,21 +5,36 @@
 #include "device.h"
 #include "shader.h"
 #include "swapchain.h"
+#include "bindless.h"
+#include "physical_device.h"
 
 typedef struct VulkanContext VulkanContext;
 
 typedef struct GraphicsPipeline {
+    // Color and depth are rendered with this many samples, above one they are resolved into the scene color image
+    VkSampleCountFlagBits samples;
+    VkFormat depth_format;
     VkRenderPass render_pass;
     VkPipeline vk_pipeline;
     VkPipelineLayout layout;
 } GraphicsPipeline;
 
-bool graphics_pipeline_create(Device *device, Swapchain *swapchain, GraphicsPipeline *out);
+bool graphics_pipeline_create(PhysicalDevice *physical_device, Device *device, Swapchain *swapchain,
+                              BindlessTable *bindless, GraphicsPipeline *out);
+
+// Depth test and write on, shared by every pipeline drawing in the render pass
+VkPipelineDepthStencilStateCreateInfo graphics_pipeline_depth_state();
 
 void graphics_pipeline_destroy(Device *device, GraphicsPipeline *pipeline);
 
-void render_pass_begin(VulkanContext *context, u32 image_index);
+// Compute pipelines only need a layout and one shader, path is the SPIR-V file
+bool compute_pipeline_create(Device *device, VkPipelineLayout layout, const char *path, VkPipeline *out);
+
+// Renders into the top left extent of the framebuffer
+void render_pass_begin(VulkanContext *context, VkExtent2D extent);
 
 void render_pass_end(VulkanContext *context);
 
-void bind_pipeline(VulkanContext *context);
\ No newline at end of file
+void bind_pipeline(VulkanContext *context);
+
+void push_draw_constants(VulkanContext *context, BindlessDrawConstants *constants);
\ No newline at end of file
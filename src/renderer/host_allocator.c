@@ -0,0 +1,240 @@
+#include "host_allocator.h"
+#include "core/alloc_counter.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+
+// Alignment of the header in front of every allocation, also the smallest alignment handed out
+#define HOST_ALLOCATOR_MIN_ALIGNMENT 16
+
+typedef struct HostAllocationHeader {
+    // What malloc returned, NULL for arena allocations
+    void *base;
+    size_t size;
+    u32 scope;
+    u32 padding;
+} HostAllocationHeader;
+
+typedef struct HostArena {
+    u8 *memory;
+    size_t offset;
+    u64 live;
+} HostArena;
+
+typedef struct HostAllocator {
+    atomic_ullong live_bytes[HOST_ALLOCATOR_SCOPE_COUNT];
+    atomic_ullong live_count[HOST_ALLOCATOR_SCOPE_COUNT];
+    atomic_ullong peak_bytes[HOST_ALLOCATOR_SCOPE_COUNT];
+    atomic_ullong total_count[HOST_ALLOCATOR_SCOPE_COUNT];
+    atomic_ullong internal_bytes;
+    atomic_ullong heap_count;
+
+    HostArena arena;
+    u64 frame_start_heap_count;
+    u64 frame_heap_count;
+    u64 frame_arena_bytes;
+    u64 last_churn_report;
+} HostAllocator;
+
+static HostAllocator host = {0};
+// Set on the thread between host_allocator_frame_begin and host_allocator_frame_end
+static _Thread_local HostArena *host_frame_arena = NULL;
+
+static const char *host_scope_names[HOST_ALLOCATOR_SCOPE_COUNT] = {
+        "command", "object", "cache", "device", "instance"
+};
+
+void host_allocator_count(u32 scope, size_t size) {
+    u64 live = atomic_fetch_add(&host.live_bytes[scope], size) + size;
+    atomic_fetch_add(&host.live_count[scope], 1);
+    atomic_fetch_add(&host.total_count[scope], 1);
+
+    u64 peak = atomic_load(&host.peak_bytes[scope]);
+    while (live > peak && !atomic_compare_exchange_weak(&host.peak_bytes[scope], &peak, live)) {
+    }
+}
+
+void host_allocator_uncount(u32 scope, size_t size) {
+    atomic_fetch_sub(&host.live_bytes[scope], size);
+    atomic_fetch_sub(&host.live_count[scope], 1);
+}
+
+HostAllocationHeader *host_allocation_header(void *memory) {
+    return (HostAllocationHeader *) memory - 1;
+}
+
+void *host_arena_alloc(HostArena *arena, size_t size, size_t alignment) {
+    uintptr_t start = (uintptr_t) arena->memory + arena->offset + sizeof(HostAllocationHeader);
+    uintptr_t aligned = (start + alignment - 1) & ~(uintptr_t) (alignment - 1);
+    if (aligned + size > (uintptr_t) arena->memory + HOST_ALLOCATOR_FRAME_SIZE) {
+        return NULL;
+    }
+
+    arena->offset = aligned + size - (uintptr_t) arena->memory;
+    arena->live++;
+    return (void *) aligned;
+}
+
+void *VKAPI_PTR host_allocate(void *user_data, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    if (size == 0) {
+        return NULL;
+    }
+    if (alignment < HOST_ALLOCATOR_MIN_ALIGNMENT) {
+        alignment = HOST_ALLOCATOR_MIN_ALIGNMENT;
+    }
+
+    void *base = NULL;
+    void *memory = NULL;
+    if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND && host_frame_arena != NULL) {
+        memory = host_arena_alloc(host_frame_arena, size, alignment);
+    }
+
+    if (memory == NULL) {
+        // Counted in heap_count instead of the process wide counter, so driver churn is reported on its own
+        base = alloc_counter_untracked_malloc(size + alignment + sizeof(HostAllocationHeader));
+        if (base == NULL) {
+            return NULL;
+        }
+        uintptr_t start = (uintptr_t) base + sizeof(HostAllocationHeader);
+        memory = (void *) ((start + alignment - 1) & ~(uintptr_t) (alignment - 1));
+        atomic_fetch_add(&host.heap_count, 1);
+    }
+
+    HostAllocationHeader *header = host_allocation_header(memory);
+    header->base = base;
+    header->size = size;
+    header->scope = scope;
+    host_allocator_count(scope, size);
+    return memory;
+}
+
+void VKAPI_PTR host_free(void *user_data, void *memory) {
+    if (memory == NULL) {
+        return;
+    }
+
+    HostAllocationHeader *header = host_allocation_header(memory);
+    host_allocator_uncount(header->scope, header->size);
+    if (header->base != NULL) {
+        free(header->base);
+    } else {
+        // Arena memory is only given back when the frame ends
+        host.arena.live--;
+    }
+}
+
+void *VKAPI_PTR host_reallocate(void *user_data, void *original, size_t size, size_t alignment,
+                                VkSystemAllocationScope scope) {
+    if (original == NULL) {
+        return host_allocate(user_data, size, alignment, scope);
+    }
+    if (size == 0) {
+        host_free(user_data, original);
+        return NULL;
+    }
+
+    void *memory = host_allocate(user_data, size, alignment, scope);
+    if (memory == NULL) {
+        // The original stays valid when reallocation fails
+        return NULL;
+    }
+
+    size_t original_size = host_allocation_header(original)->size;
+    memcpy(memory, original, original_size < size ? original_size : size);
+    host_free(user_data, original);
+    return memory;
+}
+
+void VKAPI_PTR host_internal_allocation(void *user_data, size_t size, VkInternalAllocationType type,
+                                       VkSystemAllocationScope scope) {
+    atomic_fetch_add(&host.internal_bytes, size);
+}
+
+void VKAPI_PTR host_internal_free(void *user_data, size_t size, VkInternalAllocationType type,
+                                 VkSystemAllocationScope scope) {
+    atomic_fetch_sub(&host.internal_bytes, size);
+}
+
+static const VkAllocationCallbacks host_callbacks = {
+        .pUserData = NULL,
+        .pfnAllocation = host_allocate,
+        .pfnReallocation = host_reallocate,
+        .pfnFree = host_free,
+        .pfnInternalAllocation = host_internal_allocation,
+        .pfnInternalFree = host_internal_free
+};
+
+bool host_allocator_init() {
+    memset(&host, 0, sizeof(HostAllocator));
+    host.arena.memory = aligned_alloc(HOST_ALLOCATOR_MIN_ALIGNMENT, HOST_ALLOCATOR_FRAME_SIZE);
+    if (host.arena.memory == NULL) {
+        LOG_ERROR("Failed to allocate the host frame arena");
+        return false;
+    }
+    return true;
+}
+
+void host_allocator_shutdown() {
+    host_allocator_report();
+    free(host.arena.memory);
+    host.arena.memory = NULL;
+}
+
+const VkAllocationCallbacks *host_allocator() {
+    return &host_callbacks;
+}
+
+void host_allocator_frame_begin() {
+    host.frame_start_heap_count = atomic_load(&host.heap_count);
+    if (host.arena.memory != NULL) {
+        host_frame_arena = &host.arena;
+    }
+}
+
+void host_allocator_frame_end() {
+    host_frame_arena = NULL;
+    host.frame_heap_count = atomic_load(&host.heap_count) - host.frame_start_heap_count;
+    host.frame_arena_bytes = host.arena.offset;
+
+    // Command scoped memory may not outlive the call that allocated it, so this only trips on driver bugs
+    if (host.arena.live == 0) {
+        host.arena.offset = 0;
+    } else {
+        LOG_ERROR("%llu command scope allocations outlived the frame", (unsigned long long) host.arena.live);
+    }
+
+    u64 now = SDL_GetTicks64();
+    if (host.frame_heap_count > 0 && now - host.last_churn_report >= 1000) {
+        LOG_INFO("Driver host allocations this frame: %llu on the heap, %llu bytes in the frame arena",
+                 (unsigned long long) host.frame_heap_count, (unsigned long long) host.frame_arena_bytes);
+        host.last_churn_report = now;
+    }
+}
+
+void host_allocator_stats(HostAllocationStats *out) {
+    HostAllocationStats result = {0};
+    for (u32 scope = 0; scope < HOST_ALLOCATOR_SCOPE_COUNT; ++scope) {
+        result.live_bytes[scope] = atomic_load(&host.live_bytes[scope]);
+        result.live_count[scope] = atomic_load(&host.live_count[scope]);
+        result.peak_bytes[scope] = atomic_load(&host.peak_bytes[scope]);
+        result.total_count[scope] = atomic_load(&host.total_count[scope]);
+    }
+    result.internal_bytes = atomic_load(&host.internal_bytes);
+    result.frame_heap_count = host.frame_heap_count;
+    result.frame_arena_bytes = host.frame_arena_bytes;
+    *out = result;
+}
+
+void host_allocator_report() {
+    HostAllocationStats stats;
+    host_allocator_stats(&stats);
+    for (u32 scope = 0; scope < HOST_ALLOCATOR_SCOPE_COUNT; ++scope) {
+        LOG_INFO("Host allocations, %s scope: %llu live (%llu bytes), peak %llu bytes, %llu total",
+                 host_scope_names[scope], (unsigned long long) stats.live_count[scope],
+                 (unsigned long long) stats.live_bytes[scope], (unsigned long long) stats.peak_bytes[scope],
+                 (unsigned long long) stats.total_count[scope]);
+    }
+    LOG_INFO("Driver internal allocations: %llu bytes", (unsigned long long) stats.internal_bytes);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <std/defines.h>
+#include "vulkan_types.h"
+
+// Per-frame arena for command scoped driver allocations made on the render thread
+#define HOST_ALLOCATOR_FRAME_SIZE (1024 * 1024)
+// One counter set per VkSystemAllocationScope
+#define HOST_ALLOCATOR_SCOPE_COUNT (VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1)
+
+typedef struct HostAllocationStats {
+    u64 live_bytes[HOST_ALLOCATOR_SCOPE_COUNT];
+    u64 live_count[HOST_ALLOCATOR_SCOPE_COUNT];
+    u64 peak_bytes[HOST_ALLOCATOR_SCOPE_COUNT];
+    u64 total_count[HOST_ALLOCATOR_SCOPE_COUNT];
+    // Memory the driver allocated itself and reported through the internal allocation notifications
+    u64 internal_bytes;
+    // Heap allocations during the last frame, arena allocations don't count
+    u64 frame_heap_count;
+    u64 frame_arena_bytes;
+} HostAllocationStats;
+
+bool host_allocator_init();
+
+void host_allocator_shutdown();
+
+// Passed as pAllocator to every Vulkan object the renderer creates and destroys
+const VkAllocationCallbacks *host_allocator();
+
+// Command scoped allocations from the calling thread come out of the frame arena until host_allocator_frame_end,
+// which also counts the heap allocations made by any thread in between
+void host_allocator_frame_begin();
+
+void host_allocator_frame_end();
+
+void host_allocator_stats(HostAllocationStats *out);
+
+// Logs live, peak and total allocations per scope
+void host_allocator_report();
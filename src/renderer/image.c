@@ -0,0 +1,124 @@
+#include "image.h"
+#include "host_allocator.h"
+
+bool image_create(PhysicalDevice *physical_device, Device *device, ImageConfig *config, Image *out) {
+    Image result = {
+            .format = config->format,
+            .extent = config->extent,
+            .mip_levels = config->mip_levels > 0 ? config->mip_levels : 1
+    };
+
+    VkImageCreateInfo create_info = {VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+    create_info.imageType = VK_IMAGE_TYPE_2D;
+    create_info.format = config->format;
+    create_info.extent.width = config->extent.width;
+    create_info.extent.height = config->extent.height;
+    create_info.extent.depth = 1;
+    create_info.mipLevels = result.mip_levels;
+    create_info.arrayLayers = 1;
+    create_info.samples = config->samples != 0 ? config->samples : VK_SAMPLE_COUNT_1_BIT;
+    create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    create_info.usage = config->usage;
+    create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VK_CHECK(vkCreateImage(device->vk_device, &create_info, host_allocator(), &result.vk_image));
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(device->vk_device, result.vk_image, &requirements);
+
+    u32 memory_type;
+    bool found = config->preferred_memory_properties != 0 &&
+                 physical_device_find_memory_type(physical_device, requirements.memoryTypeBits,
+                                                  config->preferred_memory_properties, &memory_type);
+    if (!found && !physical_device_find_memory_type(physical_device, requirements.memoryTypeBits,
+                                                    config->memory_properties, &memory_type)) {
+        LOG_ERROR("No suitable memory type for %s image %ux%u", string_VkFormat(config->format),
+                  config->extent.width, config->extent.height);
+        vkDestroyImage(device->vk_device, result.vk_image, host_allocator());
+        return false;
+    }
+
+    VkMemoryAllocateInfo allocate_info = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+    allocate_info.allocationSize = requirements.size;
+    allocate_info.memoryTypeIndex = memory_type;
+    VK_CHECK(vkAllocateMemory(device->vk_device, &allocate_info, host_allocator(), &result.memory));
+    VK_CHECK(vkBindImageMemory(device->vk_device, result.vk_image, result.memory, 0));
+    result.size = requirements.size;
+    result.memory_properties = physical_device->memory_properties.memoryTypes[memory_type].propertyFlags;
+
+    VkImageViewCreateInfo view_create_info = {VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+    view_create_info.image = result.vk_image;
+    view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_create_info.format = config->format;
+    view_create_info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    view_create_info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    view_create_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    view_create_info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    view_create_info.subresourceRange.aspectMask = config->aspect;
+    view_create_info.subresourceRange.baseMipLevel = 0;
+    view_create_info.subresourceRange.levelCount = result.mip_levels;
+    view_create_info.subresourceRange.baseArrayLayer = 0;
+    view_create_info.subresourceRange.layerCount = 1;
+    VK_CHECK(vkCreateImageView(device->vk_device, &view_create_info, host_allocator(), &result.view));
+
+    *out = result;
+    return true;
+}
+
+void image_destroy(Device *device, Image *image) {
+    vkDestroyImageView(device->vk_device, image->view, host_allocator());
+    image->view = NULL;
+    vkDestroyImage(device->vk_device, image->vk_image, host_allocator());
+    image->vk_image = NULL;
+    vkFreeMemory(device->vk_device, image->memory, host_allocator());
+    image->memory = NULL;
+}
+
+void image_transition(VkCommandBuffer command_buffer, VkImage image, VkImageAspectFlags aspect, u32 base_mip,
+                      u32 mip_count, VkImageLayout old_layout, VkImageLayout new_layout,
+                      VkPipelineStageFlags src_stage, VkAccessFlags src_access,
+                      VkPipelineStageFlags dst_stage, VkAccessFlags dst_access) {
+    VkImageMemoryBarrier barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+    barrier.oldLayout = old_layout;
+    barrier.newLayout = new_layout;
+    barrier.srcAccessMask = src_access;
+    barrier.dstAccessMask = dst_access;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = aspect;
+    barrier.subresourceRange.baseMipLevel = base_mip;
+    barrier.subresourceRange.levelCount = mip_count;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    vkCmdPipelineBarrier(command_buffer, src_stage, dst_stage, 0, 0, NULL, 0, NULL, 1, &barrier);
+}
+
+bool sampler_create(PhysicalDevice *physical_device, Device *device, VkFilter filter,
+                    VkSamplerAddressMode address_mode, VkSampler *out) {
+    VkSamplerCreateInfo create_info = {VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+    create_info.magFilter = filter;
+    create_info.minFilter = filter;
+    create_info.mipmapMode = filter == VK_FILTER_LINEAR ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    create_info.addressModeU = address_mode;
+    create_info.addressModeV = address_mode;
+    create_info.addressModeW = address_mode;
+    create_info.mipLodBias = 0.0f;
+    create_info.minLod = 0.0f;
+    create_info.maxLod = VK_LOD_CLAMP_NONE;
+    create_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+
+    if (device->sampler_anisotropy) {
+        create_info.anisotropyEnable = VK_TRUE;
+        create_info.maxAnisotropy = physical_device->properties.limits.maxSamplerAnisotropy;
+    }
+
+    VK_CHECK(vkCreateSampler(device->vk_device, &create_info, host_allocator(), out));
+    return true;
+}
+
+void sampler_destroy(Device *device, VkSampler *sampler) {
+    vkDestroySampler(device->vk_device, *sampler, host_allocator());
+    *sampler = NULL;
+}
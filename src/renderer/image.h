@@ -0,0 +1,45 @@
+#pragma once
+
+#include <std/defines.h>
+#include "vulkan_types.h"
+#include "physical_device.h"
+#include "device.h"
+
+typedef struct ImageConfig {
+    VkFormat format;
+    VkExtent2D extent;
+    u32 mip_levels;
+    VkSampleCountFlagBits samples;
+    VkImageUsageFlags usage;
+    VkImageAspectFlags aspect;
+    VkMemoryPropertyFlags memory_properties;
+    // Tried before memory_properties when set, e.g. lazily allocated memory for transient attachments
+    VkMemoryPropertyFlags preferred_memory_properties;
+} ImageConfig;
+
+typedef struct Image {
+    VkImage vk_image;
+    VkDeviceMemory memory;
+    VkImageView view;
+
+    VkFormat format;
+    VkExtent2D extent;
+    u32 mip_levels;
+    VkDeviceSize size;
+    // Of the memory type the image ended up in
+    VkMemoryPropertyFlags memory_properties;
+} Image;
+
+bool image_create(PhysicalDevice *physical_device, Device *device, ImageConfig *config, Image *out);
+
+void image_destroy(Device *device, Image *image);
+
+void image_transition(VkCommandBuffer command_buffer, VkImage image, VkImageAspectFlags aspect, u32 base_mip,
+                      u32 mip_count, VkImageLayout old_layout, VkImageLayout new_layout,
+                      VkPipelineStageFlags src_stage, VkAccessFlags src_access,
+                      VkPipelineStageFlags dst_stage, VkAccessFlags dst_access);
+
+bool sampler_create(PhysicalDevice *physical_device, Device *device, VkFilter filter,
+                    VkSamplerAddressMode address_mode, VkSampler *out);
+
+void sampler_destroy(Device *device, VkSampler *sampler);
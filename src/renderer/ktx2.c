@@ -0,0 +1,164 @@
+#include "ktx2.h"
+#include <string.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+static const u8 ktx2_identifier[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+typedef struct Ktx2Header {
+    u8 identifier[12];
+    u32 vk_format;
+    u32 type_size;
+    u32 pixel_width;
+    u32 pixel_height;
+    u32 pixel_depth;
+    u32 layer_count;
+    u32 face_count;
+    u32 level_count;
+    u32 supercompression_scheme;
+
+    u32 dfd_offset;
+    u32 dfd_size;
+    u32 kvd_offset;
+    u32 kvd_size;
+    u64 sgd_offset;
+    u64 sgd_size;
+} Ktx2Header;
+
+bool ktx2_validate(const char *path, Ktx2Header *header) {
+    if (memcmp(header->identifier, ktx2_identifier, sizeof(ktx2_identifier)) != 0) {
+        LOG_ERROR("Not a KTX2 file: %s", path);
+        return false;
+    }
+
+    if (header->vk_format == VK_FORMAT_UNDEFINED) {
+        LOG_ERROR("Basis Universal KTX2 files need transcoding, which is not supported: %s", path);
+        return false;
+    }
+
+    if (header->pixel_depth > 1 || header->layer_count > 1 || header->face_count > 1) {
+        LOG_ERROR("Only plain 2D KTX2 textures are supported: %s", path);
+        return false;
+    }
+
+    switch (header->supercompression_scheme) {
+        case KTX2_SUPERCOMPRESSION_NONE:
+            break;
+        case KTX2_SUPERCOMPRESSION_ZSTD:
+#ifdef HAVE_ZSTD
+            break;
+#else
+            LOG_ERROR("KTX2 file is zstd supercompressed but zstd support is not compiled in: %s", path);
+            return false;
+#endif
+        default:
+            LOG_ERROR("Unsupported KTX2 supercompression scheme %u: %s", header->supercompression_scheme, path);
+            return false;
+    }
+
+    u32 level_count = header->level_count > 0 ? header->level_count : 1;
+    if (level_count > KTX2_MAX_LEVELS) {
+        LOG_ERROR("KTX2 file has too many mip levels (%u): %s", level_count, path);
+        return false;
+    }
+
+    return true;
+}
+
+bool ktx2_open(const char *path, Ktx2File *out) {
+    Ktx2File result = {0};
+    if (!mapped_file_open(path, &result.file)) {
+        LOG_ERROR("Failed to map KTX2 file: %s", path);
+        return false;
+    }
+
+    Ktx2Header header;
+    if (result.file.size < sizeof(Ktx2Header)) {
+        LOG_ERROR("KTX2 file is truncated: %s", path);
+        mapped_file_close(&result.file);
+        return false;
+    }
+    memcpy(&header, result.file.data, sizeof(Ktx2Header));
+
+    if (!ktx2_validate(path, &header)) {
+        mapped_file_close(&result.file);
+        return false;
+    }
+
+    result.format = (VkFormat) header.vk_format;
+    result.extent.width = header.pixel_width;
+    result.extent.height = header.pixel_height > 0 ? header.pixel_height : 1;
+    result.level_count = header.level_count > 0 ? header.level_count : 1;
+    result.supercompression = (Ktx2Supercompression) header.supercompression_scheme;
+
+    const u8 *data = result.file.data;
+    u64 index_size = sizeof(Ktx2Level) * result.level_count;
+    if (result.file.size < sizeof(Ktx2Header) + index_size) {
+        LOG_ERROR("KTX2 level index is truncated: %s", path);
+        mapped_file_close(&result.file);
+        return false;
+    }
+    memcpy(result.levels, data + sizeof(Ktx2Header), index_size);
+
+    for (u32 i = 0; i < result.level_count; ++i) {
+        Ktx2Level *level = &result.levels[i];
+        if (level->offset + level->size > result.file.size) {
+            LOG_ERROR("KTX2 level %u points outside of the file: %s", i, path);
+            mapped_file_close(&result.file);
+            return false;
+        }
+
+        if (result.supercompression == KTX2_SUPERCOMPRESSION_NONE) {
+            level->uncompressed_size = level->size;
+        }
+    }
+
+    *out = result;
+    return true;
+}
+
+void ktx2_close(Ktx2File *ktx) {
+    mapped_file_close(&ktx->file);
+}
+
+VkExtent2D ktx2_level_extent(Ktx2File *ktx, u32 level) {
+    VkExtent2D extent = {
+            .width = ktx->extent.width >> level,
+            .height = ktx->extent.height >> level
+    };
+
+    if (extent.width == 0) extent.width = 1;
+    if (extent.height == 0) extent.height = 1;
+    return extent;
+}
+
+bool ktx2_read_level(Ktx2File *ktx, u32 level, void *out, u64 out_size) {
+    Ktx2Level *info = &ktx->levels[level];
+    const u8 *source = (const u8 *) ktx->file.data + info->offset;
+
+    if (out_size < info->uncompressed_size) {
+        LOG_ERROR("KTX2 level %u doesn't fit the destination (%llu < %llu)", level,
+                  (unsigned long long) out_size, (unsigned long long) info->uncompressed_size);
+        return false;
+    }
+
+    switch (ktx->supercompression) {
+        case KTX2_SUPERCOMPRESSION_NONE:
+            memcpy(out, source, info->size);
+            return true;
+#ifdef HAVE_ZSTD
+        case KTX2_SUPERCOMPRESSION_ZSTD: {
+            size_t written = ZSTD_decompress(out, out_size, source, info->size);
+            if (ZSTD_isError(written) || written != info->uncompressed_size) {
+                LOG_ERROR("Failed to decompress KTX2 level %u: %s", level, ZSTD_getErrorName(written));
+                return false;
+            }
+            return true;
+        }
+#endif
+        default:
+            return false;
+    }
+}
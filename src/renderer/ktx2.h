@@ -0,0 +1,40 @@
+#pragma once
+
+#include <std/defines.h>
+#include "vulkan_types.h"
+#include "core/mapped_file.h"
+
+#define KTX2_MAX_LEVELS 16
+
+typedef enum Ktx2Supercompression {
+    KTX2_SUPERCOMPRESSION_NONE = 0,
+    KTX2_SUPERCOMPRESSION_BASIS_LZ = 1,
+    KTX2_SUPERCOMPRESSION_ZSTD = 2,
+    KTX2_SUPERCOMPRESSION_ZLIB = 3,
+} Ktx2Supercompression;
+
+typedef struct Ktx2Level {
+    u64 offset;
+    u64 size;
+    u64 uncompressed_size;
+} Ktx2Level;
+
+// A parsed view over a memory-mapped KTX2 file, level data is never copied out of the mapping
+typedef struct Ktx2File {
+    MappedFile file;
+
+    VkFormat format;
+    VkExtent2D extent;
+    u32 level_count;
+    Ktx2Supercompression supercompression;
+    Ktx2Level levels[KTX2_MAX_LEVELS];
+} Ktx2File;
+
+bool ktx2_open(const char *path, Ktx2File *out);
+
+void ktx2_close(Ktx2File *ktx);
+
+VkExtent2D ktx2_level_extent(Ktx2File *ktx, u32 level);
+
+// Writes the level's texel data to `out`, decompressing it if the file is supercompressed
+bool ktx2_read_level(Ktx2File *ktx, u32 level, void *out, u64 out_size);
@@ -0,0 +1,204 @@
+#include "light_clusters.h"
+#include "host_allocator.h"
+#include "vulkan.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <std/containers/darray.h>
+
+// Index count padded to 16 bytes ahead of the per cluster ranges and the index list
+#define LIGHT_CLUSTERS_HEADER 16
+
+VkDeviceSize light_clusters_size() {
+    return LIGHT_CLUSTERS_HEADER + sizeof(u32) * 2 * LIGHT_CLUSTER_COUNT + sizeof(u32) * LIGHT_MAX_INDICES;
+}
+
+bool light_frame_create(VulkanContext *context, LightFrame *out) {
+    LightFrame result = {0};
+    VkDeviceSize lights_size = sizeof(LightHeader) + sizeof(LightData) * LIGHT_MAX_LIGHTS;
+    if (!buffer_create(&context->physical_device, &context->device, lights_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &result.lights)) {
+        return false;
+    }
+
+    if (!buffer_create(&context->physical_device, &context->device, light_clusters_size(),
+                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &result.clusters)) {
+        buffer_destroy(&context->device, &result.lights);
+        return false;
+    }
+
+    // Nothing is shaded with lights until the first update
+    memset(result.lights.mapped, 0, sizeof(LightHeader));
+    result.lights_handle = bindless_register_storage_buffer(&context->device, &context->bindless,
+                                                            result.lights.vk_buffer, 0, lights_size);
+    result.clusters_handle = bindless_register_storage_buffer(&context->device, &context->bindless,
+                                                              result.clusters.vk_buffer, 0, light_clusters_size());
+    *out = result;
+    return result.lights_handle != BINDLESS_INVALID_HANDLE && result.clusters_handle != BINDLESS_INVALID_HANDLE;
+}
+
+bool light_clusters_create(VulkanContext *context, LightClusters *out) {
+    LightClusters result = {0};
+
+    VkPushConstantRange push_constant_range = {0};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_ALL;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(LightClusterConstants);
+
+    VkPipelineLayoutCreateInfo layout_create_info = {VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    layout_create_info.setLayoutCount = 1;
+    layout_create_info.pSetLayouts = &context->bindless.layout;
+    layout_create_info.pushConstantRangeCount = 1;
+    layout_create_info.pPushConstantRanges = &push_constant_range;
+    VK_CHECK(vkCreatePipelineLayout(context->device.vk_device, &layout_create_info, host_allocator(), &result.layout));
+
+    if (!compute_pipeline_create(&context->device, result.layout, "light_assign.comp.spv",
+                                 &result.assign_pipeline)) {
+        LOG_ERROR("Couldn't create the light assignment pipeline!");
+        light_clusters_destroy(context, &result);
+        return false;
+    }
+
+    result.frames = darray_create(LightFrame);
+    for (u32 i = 0; i < darray_length(context->renderer_instances); ++i) {
+        LightFrame frame = {0};
+        bool created = light_frame_create(context, &frame);
+        darray_push(result.frames, frame);
+        if (!created) {
+            LOG_ERROR("Couldn't create the light buffers!");
+            light_clusters_destroy(context, &result);
+            return false;
+        }
+    }
+
+    LOG_INFO("Lights are clustered into %ux%ux%u cells, up to %u lights per frame", LIGHT_CLUSTER_X, LIGHT_CLUSTER_Y,
+             LIGHT_CLUSTER_Z, LIGHT_MAX_LIGHTS);
+    *out = result;
+    return true;
+}
+
+void light_clusters_destroy(VulkanContext *context, LightClusters *clusters) {
+    if (clusters->frames != NULL) {
+        for (u32 i = 0; i < darray_length(clusters->frames); ++i) {
+            buffer_destroy(&context->device, &clusters->frames[i].lights);
+            buffer_destroy(&context->device, &clusters->frames[i].clusters);
+        }
+        darray_destroy(clusters->frames);
+        clusters->frames = NULL;
+    }
+
+    vkDestroyPipeline(context->device.vk_device, clusters->assign_pipeline, host_allocator());
+    clusters->assign_pipeline = NULL;
+    vkDestroyPipelineLayout(context->device.vk_device, clusters->layout, host_allocator());
+    clusters->layout = NULL;
+
+    light_list_destroy(&clusters->lights);
+}
+
+Light *light_list_reserve(LightList *list, u32 count) {
+    if (list->count + count > list->capacity) {
+        u32 capacity = list->capacity == 0 ? 256 : list->capacity * 2;
+        while (capacity < list->count + count) {
+            capacity *= 2;
+        }
+        list->lights = realloc(list->lights, sizeof(Light) * capacity);
+        list->capacity = capacity;
+    }
+
+    Light *lights = &list->lights[list->count];
+    list->count += count;
+    return lights;
+}
+
+void light_list_destroy(LightList *list) {
+    free(list->lights);
+    memset(list, 0, sizeof(LightList));
+}
+
+void light_data_fill(const Light *light, LightData *out) {
+    memcpy(out->position_range, light->position, sizeof(float) * 3);
+    out->position_range[3] = light->range;
+    for (u32 i = 0; i < 3; ++i) {
+        out->color[i] = light->color[i] * light->intensity;
+    }
+
+    if (light->type != LIGHT_TYPE_SPOT) {
+        memset(out->direction, 0, sizeof(out->direction));
+        out->direction[3] = -2.0f;
+        out->color[3] = -2.0f;
+        return;
+    }
+
+    const float *d = light->direction;
+    float length = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    float scale = length > 0.0f ? 1.0f / length : 0.0f;
+    for (u32 i = 0; i < 3; ++i) {
+        out->direction[i] = d[i] * scale;
+    }
+
+    // The shader blends between the cone edges with smoothstep, which needs the inner edge strictly inside
+    float cos_outer = cosf(light->outer_angle);
+    float cos_inner = cosf(light->inner_angle);
+    out->direction[3] = cos_outer;
+    out->color[3] = cos_inner > cos_outer ? cos_inner : cos_outer + 1e-4f;
+}
+
+void light_clusters_update(VulkanContext *context, LightClusters *clusters, const float *view_projection) {
+    LightList *list = &clusters->lights;
+    u32 count = list->count < LIGHT_MAX_LIGHTS ? list->count : LIGHT_MAX_LIGHTS;
+
+    LightFrame *frame = &clusters->frames[context->current_renderer_index];
+    LightHeader *header = frame->lights.mapped;
+    memcpy(header->view_projection, view_projection, sizeof(header->view_projection));
+
+    // Tiles cover the rendered extent, slices split the depth range evenly in log space
+    VkExtent2D extent = context->resolution.extent;
+    float log_range = logf(LIGHT_CLUSTER_FAR / LIGHT_CLUSTER_NEAR);
+    header->cluster[0] = (float) LIGHT_CLUSTER_X / (float) extent.width;
+    header->cluster[1] = (float) LIGHT_CLUSTER_Y / (float) extent.height;
+    header->cluster[2] = (float) LIGHT_CLUSTER_Z / log_range;
+    header->cluster[3] = -(float) LIGHT_CLUSTER_Z * logf(LIGHT_CLUSTER_NEAR) / log_range;
+    header->light_count = count;
+
+    LightData *data = (LightData *) (header + 1);
+    for (u32 i = 0; i < count; ++i) {
+        light_data_fill(&list->lights[i], &data[i]);
+    }
+
+    clusters->light_count = count;
+    list->count = 0;
+}
+
+void light_clusters_clear_pass(VulkanContext *context, VkCommandBuffer command_buffer, void *data) {
+    LightClusters *clusters = data;
+    if (clusters->light_count == 0) {
+        return;
+    }
+
+    LightFrame *frame = &clusters->frames[context->current_renderer_index];
+    vkCmdFillBuffer(command_buffer, frame->clusters.vk_buffer, 0, LIGHT_CLUSTERS_HEADER, 0);
+}
+
+void light_clusters_assign_pass(VulkanContext *context, VkCommandBuffer command_buffer, void *data) {
+    LightClusters *clusters = data;
+    if (clusters->light_count == 0) {
+        return;
+    }
+
+    LightFrame *frame = &clusters->frames[context->current_renderer_index];
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, clusters->assign_pipeline);
+    bindless_bind(&context->bindless, command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, clusters->layout);
+
+    LightClusterConstants constants = {
+            .material_buffer = context->materials.buffer_handle,
+            .material_index = context->default_material,
+            .texture_table = context->textures.handle_table_handle,
+            .lights = frame->lights_handle,
+            .clusters = frame->clusters_handle
+    };
+    vkCmdPushConstants(command_buffer, clusters->layout, VK_SHADER_STAGE_ALL, 0, sizeof(LightClusterConstants),
+                       &constants);
+    vkCmdDispatch(command_buffer, LIGHT_CLUSTER_COUNT, 1, 1);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <std/defines.h>
+#include "vulkan_types.h"
+#include "buffer.h"
+
+// Screen tiles across, down and exponential depth slices of the cluster grid, shaders/lights.glsl has the same values
+#define LIGHT_CLUSTER_X 16
+#define LIGHT_CLUSTER_Y 9
+#define LIGHT_CLUSTER_Z 24
+#define LIGHT_CLUSTER_COUNT (LIGHT_CLUSTER_X * LIGHT_CLUSTER_Y * LIGHT_CLUSTER_Z)
+// View depth the slices span, closer and further fragments use the first and last slice
+#define LIGHT_CLUSTER_NEAR 0.1f
+#define LIGHT_CLUSTER_FAR 1000.0f
+// Lights per frame, further ones are dropped
+#define LIGHT_MAX_LIGHTS (16 * 1024)
+// Light indices of all clusters together, clusters past it get no lights
+#define LIGHT_MAX_INDICES (LIGHT_CLUSTER_COUNT * 64)
+
+typedef struct VulkanContext VulkanContext;
+
+typedef enum LightType {
+    LIGHT_TYPE_POINT,
+    LIGHT_TYPE_SPOT
+} LightType;
+
+typedef struct Light {
+    LightType type;
+    float position[3];
+    // Spot lights only, where the cone points
+    float direction[3];
+    float color[3];
+    float intensity;
+    // Nothing is lit further away than this
+    float range;
+    // Spot lights only, half angles in radians: full intensity inside inner, none outside outer
+    float inner_angle;
+    float outer_angle;
+} Light;
+
+// Mirrors LightData in shaders/lights.glsl
+typedef struct LightData {
+    // xyz: world position, w: range
+    float position_range[4];
+    // rgb: color times intensity, w: cosine of the inner cone angle
+    float color[4];
+    // xyz: spot direction, w: cosine of the outer cone angle, below -1 for point lights
+    float direction[4];
+} LightData;
+
+// Mirrors the header of LightBuffer in shaders/lights.glsl, the lights follow it
+typedef struct LightHeader {
+    float view_projection[16];
+    // x, y: clusters per pixel across and down, z, w: scale and bias from log view depth to the slice
+    float cluster[4];
+    u32 light_count;
+    u32 padding[3];
+} LightHeader;
+
+// Starts with the BindlessDrawConstants fields so the bindless helpers work unchanged
+typedef struct LightClusterConstants {
+    u32 material_buffer;
+    u32 material_index;
+    u32 texture_table;
+    u32 lights;
+    u32 clusters;
+} LightClusterConstants;
+
+// Lights queued for one frame, handed between render packets and the renderer like MeshletDrawList
+typedef struct LightList {
+    Light *lights;
+    u32 count;
+    u32 capacity;
+} LightList;
+
+// Buffers of one renderer instance: the lights written by the CPU, and per cluster index ranges into one compact index
+// list written by the assignment pass of the frame using it
+typedef struct LightFrame {
+    Buffer lights;
+    u32 lights_handle;
+    Buffer clusters;
+    u32 clusters_handle;
+} LightFrame;
+
+// Clustered forward lighting: the view frustum is split into a grid of clusters, a compute pass lists the lights
+// touching each one, and the meshlet fragment shader only shades with the lights of its own cluster
+typedef struct LightClusters {
+    VkPipelineLayout layout;
+    VkPipeline assign_pipeline;
+    LightFrame *frames;
+    LightList lights;
+
+    // Recorded by light_clusters_update for the passes in the same frame
+    u32 light_count;
+} LightClusters;
+
+bool light_clusters_create(VulkanContext *context, LightClusters *out);
+
+void light_clusters_destroy(VulkanContext *context, LightClusters *clusters);
+
+// Appends count lights for the caller to fill in, valid until the next reserve
+Light *light_list_reserve(LightList *list, u32 count);
+
+void light_list_destroy(LightList *list);
+
+// Uploads this frame's lights and cluster grid for the view and the render extent, then clears the light list
+void light_clusters_update(VulkanContext *context, LightClusters *clusters, const float *view_projection);
+
+// Render graph passes: resetting this frame's index list with a transfer, then assigning lights to clusters with
+// compute. data is the light clusters.
+void light_clusters_clear_pass(VulkanContext *context, VkCommandBuffer command_buffer, void *data);
+
+void light_clusters_assign_pass(VulkanContext *context, VkCommandBuffer command_buffer, void *data);
@@ -0,0 +1,50 @@
+#include "material.h"
+#include <std/core/memory.h>
+
+bool material_table_create(PhysicalDevice *physical_device, Device *device, BindlessTable *bindless,
+                           MaterialTable *out) {
+    MaterialTable result = {0};
+
+    VkDeviceSize size = sizeof(Material) * MATERIAL_MAX_COUNT;
+    if (!buffer_create(physical_device, device, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &result.buffer)) {
+        LOG_ERROR("Couldn't create material buffer!");
+        return false;
+    }
+    result.materials = result.buffer.mapped;
+
+    result.buffer_handle = bindless_register_storage_buffer(device, bindless, result.buffer.vk_buffer, 0, size);
+    if (result.buffer_handle == BINDLESS_INVALID_HANDLE) {
+        buffer_destroy(device, &result.buffer);
+        return false;
+    }
+
+    *out = result;
+    return true;
+}
+
+void material_table_destroy(Device *device, BindlessTable *bindless, MaterialTable *table, u64 frame) {
+    // Tables are only written out once the handle is registered
+    if (table->materials != NULL) {
+        bindless_release(bindless, BINDLESS_BINDING_STORAGE_BUFFERS, table->buffer_handle, frame);
+    }
+    table->buffer_handle = BINDLESS_INVALID_HANDLE;
+    buffer_destroy(device, &table->buffer);
+    table->materials = NULL;
+    table->count = 0;
+}
+
+u32 material_create(MaterialTable *table, Material *material) {
+    if (table->count >= MATERIAL_MAX_COUNT) {
+        LOG_ERROR("Material table is full!");
+        return MATERIAL_INVALID;
+    }
+
+    u32 index = table->count++;
+    material_update(table, index, material);
+    return index;
+}
+
+void material_update(MaterialTable *table, u32 index, Material *material) {
+    memory_copy(&table->materials[index], material, sizeof(Material));
+}
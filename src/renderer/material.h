@@ -0,0 +1,38 @@
+#pragma once
+
+#include <std/defines.h>
+#include "vulkan_types.h"
+#include "buffer.h"
+#include "bindless.h"
+
+#define MATERIAL_MAX_COUNT 4096
+#define MATERIAL_INVALID UINT32_MAX
+
+// Mirrors the Material struct in shaders/bindless.glsl (std430)
+typedef struct Material {
+    float base_color[4];
+    // Texture id, resolved to the currently streamed image through the texture handle table
+    u32 albedo_texture;
+    u32 albedo_sampler;
+    u32 padding[2];
+} Material;
+
+typedef struct MaterialTable {
+    Buffer buffer;
+    Material *materials;
+    u32 count;
+
+    // Bindless storage buffer handle the shaders read materials through
+    u32 buffer_handle;
+} MaterialTable;
+
+bool material_table_create(PhysicalDevice *physical_device, Device *device, BindlessTable *bindless,
+                           MaterialTable *out);
+
+// Releases the buffer's bindless handle as of frame, the device has to be done with the table
+void material_table_destroy(Device *device, BindlessTable *bindless, MaterialTable *table, u64 frame);
+
+// Returns MATERIAL_INVALID when the table is full
+u32 material_create(MaterialTable *table, Material *material);
+
+void material_update(MaterialTable *table, u32 index, Material *material);
@@ -0,0 +1,154 @@
+#include "memory_budget.h"
+
+#include <string.h>
+
+void memory_budget_query_heaps(PhysicalDevice *physical_device, bool supported, MemoryBudgetStats *out) {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget = {
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT};
+    VkPhysicalDeviceMemoryProperties2 properties = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2};
+    if (supported) {
+        properties.pNext = &budget;
+        vkGetPhysicalDeviceMemoryProperties2(physical_device->device, &properties);
+    } else {
+        properties.memoryProperties = physical_device->memory_properties;
+    }
+
+    VkPhysicalDeviceMemoryProperties *memory = &properties.memoryProperties;
+    out->heap_count = memory->memoryHeapCount;
+    out->device_budget = 0;
+    out->device_usage = 0;
+    out->supported = supported;
+    for (u32 i = 0; i < memory->memoryHeapCount; ++i) {
+        MemoryHeapStats *heap = &out->heaps[i];
+        heap->size = memory->memoryHeaps[i].size;
+        heap->budget = supported ? budget.heapBudget[i] : heap->size;
+        heap->usage = supported ? budget.heapUsage[i] : 0;
+        heap->device_local = (memory->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+
+        if (heap->device_local) {
+            out->device_budget += heap->budget;
+            out->device_usage += heap->usage;
+        }
+    }
+}
+
+// Levels go up as soon as a threshold is crossed but only come down with some margin, so a subsystem releasing
+// memory doesn't immediately grow back into the same pressure
+MemoryPressure memory_budget_pressure(double ratio, MemoryPressure previous) {
+    if (ratio >= MEMORY_PRESSURE_SEVERE_THRESHOLD) {
+        return MEMORY_PRESSURE_SEVERE;
+    }
+    if (previous == MEMORY_PRESSURE_SEVERE && ratio >= MEMORY_PRESSURE_SEVERE_THRESHOLD - MEMORY_PRESSURE_HYSTERESIS) {
+        return MEMORY_PRESSURE_SEVERE;
+    }
+    if (ratio >= MEMORY_PRESSURE_HIGH_THRESHOLD) {
+        return MEMORY_PRESSURE_HIGH;
+    }
+    if (previous != MEMORY_PRESSURE_NONE && ratio >= MEMORY_PRESSURE_HIGH_THRESHOLD - MEMORY_PRESSURE_HYSTERESIS) {
+        return MEMORY_PRESSURE_HIGH;
+    }
+    return MEMORY_PRESSURE_NONE;
+}
+
+bool memory_budget_create(PhysicalDevice *physical_device, Device *device, MemoryBudget *out) {
+    MemoryBudget result = {0};
+    memory_budget_query_heaps(physical_device, device->memory_budget, &result.stats);
+    result.published = result.stats;
+
+    for (u32 i = 0; i < result.stats.heap_count; ++i) {
+        MemoryHeapStats *heap = &result.stats.heaps[i];
+        LOG_INFO("Memory heap %u%s: %llu MiB, budget %llu MiB", i, heap->device_local ? " (device local)" : "",
+                 (unsigned long long) (heap->size >> 20), (unsigned long long) (heap->budget >> 20));
+    }
+    if (!device->memory_budget) {
+        LOG_INFO("VK_EXT_memory_budget is not available, memory pressure won't be reported");
+    }
+
+    *out = result;
+    return true;
+}
+
+bool memory_budget_add_callback(MemoryBudget *budget, MemoryPressureCallback callback, void *data) {
+    if (budget->callback_count >= MEMORY_BUDGET_MAX_CALLBACKS) {
+        LOG_ERROR("Memory pressure callback limit reached");
+        return false;
+    }
+
+    budget->callbacks[budget->callback_count] = callback;
+    budget->callback_data[budget->callback_count] = data;
+    budget->callback_count++;
+    return true;
+}
+
+void memory_budget_update(PhysicalDevice *physical_device, MemoryBudget *budget) {
+    if (!budget->stats.supported) {
+        return;
+    }
+
+    MemoryBudgetStats *stats = &budget->stats;
+    MemoryPressure previous = stats->pressure;
+    memory_budget_query_heaps(physical_device, true, stats);
+
+    // The fullest device local heap decides the level
+    MemoryPressureEvent event = {.headroom = UINT64_MAX, .stats = stats};
+    double ratio = 0.0;
+    for (u32 i = 0; i < stats->heap_count; ++i) {
+        MemoryHeapStats *heap = &stats->heaps[i];
+        if (!heap->device_local || heap->budget == 0) {
+            continue;
+        }
+
+        double heap_ratio = (double) heap->usage / (double) heap->budget;
+        ratio = heap_ratio > ratio ? heap_ratio : ratio;
+
+        VkDeviceSize threshold = (VkDeviceSize) ((double) heap->budget * MEMORY_PRESSURE_HIGH_THRESHOLD);
+        if (heap->usage > threshold) {
+            event.overshoot += heap->usage - threshold;
+            event.headroom = 0;
+        } else if (threshold - heap->usage < event.headroom) {
+            event.headroom = threshold - heap->usage;
+        }
+    }
+    if (event.headroom == UINT64_MAX) {
+        event.headroom = 0;
+    }
+
+    stats->pressure = memory_budget_pressure(ratio, previous);
+    event.pressure = stats->pressure;
+    budget->updates++;
+
+    SDL_AtomicLock(&budget->lock);
+    budget->published = *stats;
+    SDL_AtomicUnlock(&budget->lock);
+
+    if (stats->pressure != previous) {
+        LOG_INFO("Memory pressure %s: %llu of %llu MiB device local memory in use",
+                 memory_pressure_name(stats->pressure), (unsigned long long) (stats->device_usage >> 20),
+                 (unsigned long long) (stats->device_budget >> 20));
+    } else if (budget->updates % MEMORY_BUDGET_CALLBACK_INTERVAL != 0) {
+        return;
+    }
+
+    for (u32 i = 0; i < budget->callback_count; ++i) {
+        budget->callbacks[i](budget->callback_data[i], &event);
+    }
+}
+
+void memory_budget_stats(MemoryBudget *budget, MemoryBudgetStats *out) {
+    SDL_AtomicLock(&budget->lock);
+    memcpy(out, &budget->published, sizeof(MemoryBudgetStats));
+    SDL_AtomicUnlock(&budget->lock);
+}
+
+const char *memory_pressure_name(MemoryPressure pressure) {
+    switch (pressure) {
+        case MEMORY_PRESSURE_NONE:
+            return "none";
+        case MEMORY_PRESSURE_HIGH:
+            return "high";
+        case MEMORY_PRESSURE_SEVERE:
+            return "severe";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <SDL.h>
+#include <std/defines.h>
+#include "vulkan_types.h"
+#include "physical_device.h"
+#include "device.h"
+
+#define MEMORY_BUDGET_MAX_CALLBACKS 8
+
+// Fractions of a heap's budget where subsystems are asked to give memory back
+#define MEMORY_PRESSURE_HIGH_THRESHOLD 0.85
+#define MEMORY_PRESSURE_SEVERE_THRESHOLD 0.95
+// A pressure level is only left once usage drops this far below its threshold
+#define MEMORY_PRESSURE_HYSTERESIS 0.05
+
+// Callbacks run on level changes and every this many frames in between, so responses can converge over time
+#define MEMORY_BUDGET_CALLBACK_INTERVAL 30
+
+typedef enum MemoryPressure {
+    MEMORY_PRESSURE_NONE,
+    MEMORY_PRESSURE_HIGH,
+    MEMORY_PRESSURE_SEVERE,
+} MemoryPressure;
+
+typedef struct MemoryHeapStats {
+    VkDeviceSize size;
+    // What this process can use before the driver starts paging, shrinks when other processes grab the heap
+    VkDeviceSize budget;
+    VkDeviceSize usage;
+    bool device_local;
+} MemoryHeapStats;
+
+typedef struct MemoryBudgetStats {
+    MemoryHeapStats heaps[VK_MAX_MEMORY_HEAPS];
+    u32 heap_count;
+    // Sums over the device local heaps
+    VkDeviceSize device_budget;
+    VkDeviceSize device_usage;
+    MemoryPressure pressure;
+    // False without VK_EXT_memory_budget, budgets are then the heap sizes and usage stays 0
+    bool supported;
+} MemoryBudgetStats;
+
+typedef struct MemoryPressureEvent {
+    MemoryPressure pressure;
+    // Bytes to release to get every device local heap under the high threshold
+    VkDeviceSize overshoot;
+    // Bytes that can still be allocated before the first device local heap reaches the high threshold
+    VkDeviceSize headroom;
+    const MemoryBudgetStats *stats;
+} MemoryPressureEvent;
+
+typedef void (*MemoryPressureCallback)(void *data, const MemoryPressureEvent *event);
+
+typedef struct MemoryBudget {
+    // Written by memory_budget_update on the render thread
+    MemoryBudgetStats stats;
+    u64 updates;
+
+    // Copy of stats for other threads
+    MemoryBudgetStats published;
+    SDL_SpinLock lock;
+
+    MemoryPressureCallback callbacks[MEMORY_BUDGET_MAX_CALLBACKS];
+    void *callback_data[MEMORY_BUDGET_MAX_CALLBACKS];
+    u32 callback_count;
+} MemoryBudget;
+
+bool memory_budget_create(PhysicalDevice *physical_device, Device *device, MemoryBudget *out);
+
+// Callbacks run on the thread calling memory_budget_update
+bool memory_budget_add_callback(MemoryBudget *budget, MemoryPressureCallback callback, void *data);
+
+// Polls the heap budgets and usage, then notifies the callbacks. Call once per frame.
+void memory_budget_update(PhysicalDevice *physical_device, MemoryBudget *budget);
+
+// Safe from any thread, the stats are as of the last update
+void memory_budget_stats(MemoryBudget *budget, MemoryBudgetStats *out);
+
+const char *memory_pressure_name(MemoryPressure pressure);
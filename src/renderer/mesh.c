@@ -0,0 +1,193 @@
+#include "mesh.h"
+#include "vulkan.h"
+#include "asset/mesh_file.h"
+#include <string.h>
+#include <std/containers/darray.h>
+
+void mesh_pool_release(VulkanContext *context, MeshPool *pool) {
+    buffer_destroy(&context->device, &pool->vertices);
+    buffer_destroy(&context->device, &pool->indices);
+    buffer_destroy(&context->device, &pool->meshlets);
+    buffer_destroy(&context->device, &pool->meshlet_vertices);
+    buffer_destroy(&context->device, &pool->meshlet_triangles);
+    buffer_destroy(&context->device, &pool->lods);
+}
+
+bool mesh_pool_storage_create(VulkanContext *context, VkDeviceSize size, VkBufferUsageFlags usage, Buffer *out,
+                              u32 *handle) {
+    if (!buffer_create(&context->physical_device, &context->device, size,
+                       usage | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, out)) {
+        return false;
+    }
+
+    if (handle != NULL) {
+        *handle = bindless_register_storage_buffer(&context->device, &context->bindless, out->vk_buffer, 0, size);
+    }
+    return true;
+}
+
+bool mesh_pool_create(VulkanContext *context, MeshPool *out) {
+    MeshPool result = {0};
+
+    if (!mesh_pool_storage_create(context, MESH_POOL_VERTEX_SIZE, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                  &result.vertices, &result.vertices_handle) ||
+        !mesh_pool_storage_create(context, MESH_POOL_INDEX_SIZE, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                  &result.indices, NULL) ||
+        !mesh_pool_storage_create(context, MESH_POOL_MESHLET_SIZE, 0, &result.meshlets,
+                                  &result.meshlets_handle) ||
+        !mesh_pool_storage_create(context, MESH_POOL_MESHLET_VERTEX_SIZE, 0, &result.meshlet_vertices,
+                                  &result.meshlet_vertices_handle) ||
+        !mesh_pool_storage_create(context, MESH_POOL_MESHLET_TRIANGLE_SIZE, 0, &result.meshlet_triangles,
+                                  &result.meshlet_triangles_handle) ||
+        !mesh_pool_storage_create(context, sizeof(GpuMeshLods) * MESH_POOL_MAX_MESHES, 0, &result.lods,
+                                  &result.lods_handle)) {
+        LOG_ERROR("Couldn't create mesh pool buffers!");
+        mesh_pool_release(context, &result);
+        return false;
+    }
+
+    result.meshes = darray_create(Mesh);
+
+    *out = result;
+    return true;
+}
+
+void mesh_pool_destroy(VulkanContext *context, MeshPool *pool) {
+    for (u32 i = 0; i < darray_length(pool->meshes); ++i) {
+        free(pool->meshes[i].submeshes);
+        free(pool->meshes[i].lods);
+    }
+    darray_destroy(pool->meshes);
+    pool->meshes = NULL;
+
+    mesh_pool_release(context, pool);
+}
+
+VkDeviceSize mesh_pool_align(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+u32 mesh_load(VulkanContext *context, MeshPool *pool, Uploader *uploader, const char *path) {
+    MeshFile file;
+    if (!mesh_file_open(path, &file)) {
+        return MESH_INVALID;
+    }
+
+    const MeshFileHeader *header = file.header;
+    u64 vertex_size = mesh_file_section_size(&file, MESH_SECTION_VERTICES);
+    u64 index_size = mesh_file_section_size(&file, MESH_SECTION_INDICES);
+    u64 meshlet_size = sizeof(GpuMeshlet) * header->meshlet_count;
+    u64 meshlet_vertex_size = mesh_file_section_size(&file, MESH_SECTION_MESHLET_VERTICES);
+    u64 meshlet_triangle_size = mesh_file_section_size(&file, MESH_SECTION_MESHLET_TRIANGLES);
+
+    // Vertex offsets must be a multiple of the stride so vertexOffset in draws is a whole vertex index
+    VkDeviceSize vertex_offset = mesh_pool_align(pool->vertices_used, header->vertex_stride);
+    VkDeviceSize index_offset = mesh_pool_align(pool->indices_used, sizeof(u32));
+    VkDeviceSize meshlet_offset = pool->meshlets_used;
+    VkDeviceSize meshlet_vertex_offset = pool->meshlet_vertices_used;
+    VkDeviceSize meshlet_triangle_offset = mesh_pool_align(pool->meshlet_triangles_used, sizeof(u32));
+    if (vertex_offset + vertex_size > pool->vertices.size || index_offset + index_size > pool->indices.size ||
+        meshlet_offset + meshlet_size > pool->meshlets.size ||
+        meshlet_vertex_offset + meshlet_vertex_size > pool->meshlet_vertices.size ||
+        meshlet_triangle_offset + meshlet_triangle_size > pool->meshlet_triangles.size) {
+        LOG_ERROR("Mesh pool is full, can't load %s", path);
+        mesh_file_close(&file);
+        return MESH_INVALID;
+    }
+
+    u32 id = darray_length(pool->meshes);
+    if (id >= MESH_POOL_MAX_MESHES) {
+        LOG_ERROR("Mesh pool has no room for another mesh, can't load %s", path);
+        mesh_file_close(&file);
+        return MESH_INVALID;
+    }
+
+    // The mapped sections go straight into staging memory, nothing is parsed or copied on the way
+    uploader_copy_to_buffer(context, uploader, &pool->vertices, vertex_offset, file.vertices, vertex_size);
+    uploader_copy_to_buffer(context, uploader, &pool->indices, index_offset, file.indices, index_size);
+    uploader_copy_to_buffer(context, uploader, &pool->meshlet_vertices, meshlet_vertex_offset,
+                            file.meshlet_vertices, meshlet_vertex_size);
+    uploader_copy_to_buffer(context, uploader, &pool->meshlet_triangles, meshlet_triangle_offset,
+                            file.meshlet_triangles, meshlet_triangle_size);
+
+    // Meshlets are the one section that is rewritten, their offsets become absolute within the pool
+    u32 index_size_bytes = header->index_type == MESH_INDEX_TYPE_U16 ? sizeof(u16) : sizeof(u32);
+    GpuMeshlet *meshlets = malloc(meshlet_size);
+    for (u32 i = 0; i < header->submesh_count * header->lod_count; ++i) {
+        const MeshLod *lod = &file.lods[i];
+        u32 first_index = (u32) (index_offset / index_size_bytes) + lod->first_index;
+
+        for (u32 j = lod->first_meshlet; j < lod->first_meshlet + lod->meshlet_count; ++j) {
+            const MeshMeshlet *source = &file.meshlets[j];
+            GpuMeshlet *meshlet = &meshlets[j];
+            memcpy(meshlet->center, source->center, sizeof(meshlet->center));
+            meshlet->radius = source->radius;
+            memcpy(meshlet->cone_axis, source->cone_axis, sizeof(meshlet->cone_axis));
+            meshlet->cone_cutoff = source->cone_cutoff;
+            meshlet->vertex_offset = (u32) (meshlet_vertex_offset / sizeof(u32)) + source->vertex_offset;
+            meshlet->triangle_offset = (u32) meshlet_triangle_offset + source->triangle_offset;
+            meshlet->counts = source->vertex_count | source->triangle_count << 8;
+
+            // Meshlets are cut from the level's triangles in order, so each one is a contiguous index range
+            meshlet->first_index = first_index;
+            first_index += source->triangle_count * 3;
+        }
+    }
+    uploader_copy_to_buffer(context, uploader, &pool->meshlets, meshlet_offset, meshlets, meshlet_size);
+    free(meshlets);
+
+    Mesh mesh = {
+            .vertex_format = (MeshVertexFormat) header->vertex_format,
+            .vertex_stride = header->vertex_stride,
+            .vertex_count = header->vertex_count,
+            .vertex_offset = vertex_offset,
+            .index_type = header->index_type == MESH_INDEX_TYPE_U16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32,
+            .index_count = header->index_count,
+            .index_offset = index_offset,
+            .meshlet_offset = (u32) (meshlet_offset / sizeof(GpuMeshlet)),
+            .meshlet_count = header->meshlet_count,
+            .bounds = header->bounds,
+            .submesh_count = header->submesh_count,
+            .lod_count = header->lod_count,
+    };
+    mesh.submeshes = malloc(sizeof(MeshSubmesh) * mesh.submesh_count);
+    memcpy(mesh.submeshes, file.submeshes, sizeof(MeshSubmesh) * mesh.submesh_count);
+    mesh.lods = malloc(sizeof(MeshLod) * mesh.submesh_count * mesh.lod_count);
+    memcpy(mesh.lods, file.lods, sizeof(MeshLod) * mesh.submesh_count * mesh.lod_count);
+    memcpy(mesh.lod_errors, header->lod_errors, sizeof(mesh.lod_errors));
+    for (u32 level = 0; level < mesh.lod_count; ++level) {
+        mesh.level_first_meshlet[level] = mesh.submesh_count > 0 ? mesh.lods[level].first_meshlet : 0;
+        for (u32 i = 0; i < mesh.submesh_count; ++i) {
+            const MeshLod *lod = &mesh.lods[i * mesh.lod_count + level];
+            mesh.level_meshlet_count[level] += lod->meshlet_count;
+            mesh.level_triangles[level] += lod->index_count / 3;
+        }
+    }
+
+    GpuMeshLods lods = {
+            .sphere = {0.0f, 0.0f, 0.0f, mesh.bounds.radius},
+            .level_count = mesh.lod_count > MESH_MAX_LODS ? MESH_MAX_LODS : mesh.lod_count
+    };
+    for (u32 axis = 0; axis < 3; ++axis) {
+        lods.sphere[axis] = (mesh.bounds.min[axis] + mesh.bounds.max[axis]) * 0.5f;
+    }
+    for (u32 level = 0; level < lods.level_count; ++level) {
+        lods.errors[level] = mesh.lod_errors[level];
+        lods.first_meshlet[level] = mesh.meshlet_offset + mesh.level_first_meshlet[level];
+        lods.meshlet_count[level] = mesh.level_meshlet_count[level];
+    }
+    uploader_copy_to_buffer(context, uploader, &pool->lods, sizeof(GpuMeshLods) * id, &lods, sizeof(lods));
+
+    pool->vertices_used = vertex_offset + vertex_size;
+    pool->indices_used = index_offset + index_size;
+    pool->meshlets_used = meshlet_offset + meshlet_size;
+    pool->meshlet_vertices_used = meshlet_vertex_offset + meshlet_vertex_size;
+    pool->meshlet_triangles_used = meshlet_triangle_offset + meshlet_triangle_size;
+
+    uploader_flush(context, uploader);
+    mesh_file_close(&file);
+
+    darray_push(pool->meshes, mesh);
+    return id;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <std/defines.h>
+#include "vulkan_types.h"
+#include "buffer.h"
+#include "upload.h"
+#include "asset/mesh_format.h"
+
+#define MESH_POOL_VERTEX_SIZE (256 * 1024 * 1024)
+#define MESH_POOL_INDEX_SIZE (128 * 1024 * 1024)
+#define MESH_POOL_MESHLET_SIZE (16 * 1024 * 1024)
+#define MESH_POOL_MESHLET_VERTEX_SIZE (64 * 1024 * 1024)
+#define MESH_POOL_MESHLET_TRIANGLE_SIZE (32 * 1024 * 1024)
+// Entries in the pool's level of detail table, one per loaded mesh
+#define MESH_POOL_MAX_MESHES 4096
+#define MESH_INVALID UINT32_MAX
+
+typedef struct VulkanContext VulkanContext;
+
+// MeshMeshlet rebased onto the pool buffers, so shaders only need the owning mesh's vertex offset
+typedef struct GpuMeshlet {
+    float center[3];
+    float radius;
+    float cone_axis[3];
+    float cone_cutoff;
+    // Into the pool's meshlet vertex buffer, in u32s
+    u32 vertex_offset;
+    // Into the pool's meshlet triangle buffer, in bytes
+    u32 triangle_offset;
+    // vertex_count | triangle_count << 8
+    u32 counts;
+    // The meshlet's triangles as a range of the pool's index buffer, in indices of the mesh's index type
+    u32 first_index;
+} GpuMeshlet;
+
+// Mirrors MeshLods in shaders/meshlet.glsl, what the culling pass needs to pick a mesh's level itself
+typedef struct GpuMeshLods {
+    float errors[MESH_MAX_LODS];
+    // Each level of all submeshes as one absolute range of the pool's meshlet buffer
+    u32 first_meshlet[MESH_MAX_LODS];
+    u32 meshlet_count[MESH_MAX_LODS];
+    // Object space center of the bounds and their radius
+    float sphere[4];
+    u32 level_count;
+    u32 padding[3];
+} GpuMeshLods;
+
+typedef struct Mesh {
+    MeshVertexFormat vertex_format;
+    u32 vertex_stride;
+    u32 vertex_count;
+    VkDeviceSize vertex_offset;
+
+    VkIndexType index_type;
+    u32 index_count;
+    VkDeviceSize index_offset;
+
+    u32 meshlet_offset;
+    u32 meshlet_count;
+
+    MeshBounds bounds;
+    MeshSubmesh *submeshes;
+    u32 submesh_count;
+
+    // lods[submesh * lod_count + level], ranges are relative to index_offset like the submesh ranges
+    MeshLod *lods;
+    u32 lod_count;
+    float lod_errors[MESH_MAX_LODS];
+    // Each level of all submeshes as one range, relative to meshlet_offset
+    u32 level_first_meshlet[MESH_MAX_LODS];
+    u32 level_meshlet_count[MESH_MAX_LODS];
+    u32 level_triangles[MESH_MAX_LODS];
+} Mesh;
+
+// Every mesh lives in one shared vertex and index buffer, bound once per frame
+typedef struct MeshPool {
+    Buffer vertices;
+    Buffer indices;
+    Buffer meshlets;
+    Buffer meshlet_vertices;
+    Buffer meshlet_triangles;
+    Buffer lods;
+    VkDeviceSize vertices_used;
+    VkDeviceSize indices_used;
+    VkDeviceSize meshlets_used;
+    VkDeviceSize meshlet_vertices_used;
+    VkDeviceSize meshlet_triangles_used;
+
+    // Bindless storage buffer handles for vertex pulling and meshlet culling
+    u32 vertices_handle;
+    u32 meshlets_handle;
+    u32 meshlet_vertices_handle;
+    u32 meshlet_triangles_handle;
+    u32 lods_handle;
+
+    Mesh *meshes;
+} MeshPool;
+
+bool mesh_pool_create(VulkanContext *context, MeshPool *out);
+
+void mesh_pool_destroy(VulkanContext *context, MeshPool *pool);
+
+u32 mesh_load(VulkanContext *context, MeshPool *pool, Uploader *uploader, const char *path);
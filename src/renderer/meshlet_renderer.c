@@ -0,0 +1,680 @@
+#include "meshlet_renderer.h"
+#include "host_allocator.h"
+#include "vulkan.h"
+#include "shader.h"
+#include <math.h>
+#include <string.h>
+#include <std/containers/darray.h>
+
+// Two u32 counters, one per index type, padded to 16 bytes ahead of the command lists
+#define MESHLET_COMMANDS_HEADER 16
+
+typedef struct MeshletCommand {
+    u32 index_count;
+    u32 instance_count;
+    u32 first_index;
+    i32 vertex_offset;
+    u32 first_instance;
+} MeshletCommand;
+
+MeshletPath meshlet_select_path(Device *device) {
+    if (device->mesh_shader) {
+        return MESHLET_PATH_MESH_SHADER;
+    }
+
+    if (device->multi_draw_indirect) {
+        return MESHLET_PATH_INDIRECT;
+    }
+
+    return MESHLET_PATH_NONE;
+}
+
+VkDeviceSize meshlet_commands_size(u32 capacity) {
+    return MESHLET_COMMANDS_HEADER + sizeof(MeshletCommand) * capacity * 2;
+}
+
+bool meshlet_graphics_pipeline_create(VulkanContext *context, VkPipelineLayout layout, const char **paths,
+                                      const VkShaderStageFlagBits *stages, u32 stage_count, VkPipeline *out) {
+    Device *device = &context->device;
+    VkShaderModule modules[3] = {0};
+    VkPipelineShaderStageCreateInfo stage_create_infos[3] = {0};
+    bool mesh_shader = false;
+
+    bool loaded = true;
+    for (u32 i = 0; i < stage_count && loaded; ++i) {
+        loaded = shader_module_load(device, paths[i], &modules[i]);
+        stage_create_infos[i].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stage_create_infos[i].stage = stages[i];
+        stage_create_infos[i].module = modules[i];
+        stage_create_infos[i].pName = "main";
+        mesh_shader |= stages[i] == VK_SHADER_STAGE_MESH_BIT_EXT;
+    }
+
+    if (!loaded) {
+        for (u32 i = 0; i < stage_count; ++i) {
+            vkDestroyShaderModule(device->vk_device, modules[i], host_allocator());
+        }
+        return false;
+    }
+
+    // Vertices are pulled from the mesh pool in the shaders, there is no fixed function vertex input
+    VkPipelineVertexInputStateCreateInfo vertex_input_create_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+
+    VkPipelineInputAssemblyStateCreateInfo input_assembly_create_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
+    input_assembly_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkDynamicState dynamic_states[] = {
+            VK_DYNAMIC_STATE_VIEWPORT,
+            VK_DYNAMIC_STATE_SCISSOR
+    };
+    VkPipelineDynamicStateCreateInfo dynamic_state_create_info = {VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
+    dynamic_state_create_info.dynamicStateCount = sizeof(dynamic_states) / sizeof(VkDynamicState);
+    dynamic_state_create_info.pDynamicStates = dynamic_states;
+
+    VkPipelineViewportStateCreateInfo viewport_state_create_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO};
+    viewport_state_create_info.viewportCount = 1;
+    viewport_state_create_info.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterization_create_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO};
+    rasterization_create_info.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterization_create_info.lineWidth = 1.0f;
+    rasterization_create_info.cullMode = VK_CULL_MODE_BACK_BIT;
+    rasterization_create_info.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisample_create_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO};
+    multisample_create_info.rasterizationSamples = context->graphics_pipeline.samples;
+    multisample_create_info.minSampleShading = 1.0f;
+
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_create_info = graphics_pipeline_depth_state();
+
+    VkPipelineColorBlendAttachmentState color_blend_attachment_state = {0};
+    color_blend_attachment_state.colorWriteMask =
+            VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    VkPipelineColorBlendStateCreateInfo color_blend_create_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO};
+    color_blend_create_info.attachmentCount = 1;
+    color_blend_create_info.pAttachments = &color_blend_attachment_state;
+
+    VkGraphicsPipelineCreateInfo pipeline_create_info = {VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
+    pipeline_create_info.stageCount = stage_count;
+    pipeline_create_info.pStages = stage_create_infos;
+    pipeline_create_info.pVertexInputState = mesh_shader ? NULL : &vertex_input_create_info;
+    pipeline_create_info.pInputAssemblyState = mesh_shader ? NULL : &input_assembly_create_info;
+    pipeline_create_info.pViewportState = &viewport_state_create_info;
+    pipeline_create_info.pRasterizationState = &rasterization_create_info;
+    pipeline_create_info.pMultisampleState = &multisample_create_info;
+    pipeline_create_info.pDepthStencilState = &depth_stencil_create_info;
+    pipeline_create_info.pColorBlendState = &color_blend_create_info;
+    pipeline_create_info.pDynamicState = &dynamic_state_create_info;
+    pipeline_create_info.layout = layout;
+    pipeline_create_info.renderPass = context->graphics_pipeline.render_pass;
+    pipeline_create_info.subpass = 0;
+    pipeline_create_info.basePipelineIndex = -1;
+    VK_CHECK(vkCreateGraphicsPipelines(device->vk_device, device->pipeline_cache, 1, &pipeline_create_info, host_allocator(),
+                                       out));
+
+    for (u32 i = 0; i < stage_count; ++i) {
+        vkDestroyShaderModule(device->vk_device, modules[i], host_allocator());
+    }
+    return true;
+}
+
+bool meshlet_pipelines_create(VulkanContext *context, MeshletRenderer *renderer) {
+    if (renderer->path == MESHLET_PATH_MESH_SHADER) {
+        const char *paths[] = {"meshlet.task.spv", "meshlet.mesh.spv", "meshlet.frag.spv"};
+        VkShaderStageFlagBits stages[] = {
+                VK_SHADER_STAGE_TASK_BIT_EXT, VK_SHADER_STAGE_MESH_BIT_EXT, VK_SHADER_STAGE_FRAGMENT_BIT
+        };
+        return meshlet_graphics_pipeline_create(context, renderer->layout, paths, stages, 3,
+                                                &renderer->draw_pipeline);
+    }
+
+    const char *paths[] = {"meshlet.vert.spv", "meshlet.frag.spv"};
+    VkShaderStageFlagBits stages[] = {VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT};
+    return compute_pipeline_create(&context->device, renderer->layout, "meshlet_cull.comp.spv",
+                                   &renderer->cull_pipeline) &&
+           meshlet_graphics_pipeline_create(context, renderer->layout, paths, stages, 2, &renderer->draw_pipeline);
+}
+
+bool meshlet_renderer_create(VulkanContext *context, MeshletRenderer *out) {
+    MeshletRenderer result = {0};
+    result.path = meshlet_select_path(&context->device);
+
+    if (result.path == MESHLET_PATH_NONE) {
+        LOG_ERROR("Neither mesh shaders nor multi draw indirect are supported, meshes will not be drawn");
+        *out = result;
+        return true;
+    }
+
+    VkDescriptorSetLayout set_layouts[] = {context->bindless.layout, context->frame_allocator_layout};
+
+    VkPushConstantRange push_constant_range = {0};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_ALL;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(MeshletConstants);
+
+    VkPipelineLayoutCreateInfo layout_create_info = {VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    layout_create_info.setLayoutCount = sizeof(set_layouts) / sizeof(VkDescriptorSetLayout);
+    layout_create_info.pSetLayouts = set_layouts;
+    layout_create_info.pushConstantRangeCount = 1;
+    layout_create_info.pPushConstantRanges = &push_constant_range;
+    VK_CHECK(vkCreatePipelineLayout(context->device.vk_device, &layout_create_info, host_allocator(), &result.layout));
+
+    if (!meshlet_pipelines_create(context, &result)) {
+        LOG_ERROR("Couldn't create the meshlet pipelines!");
+        meshlet_renderer_destroy(context, &result);
+        return false;
+    }
+
+    result.frames = darray_create(MeshletFrame);
+    if (result.path == MESHLET_PATH_MESH_SHADER) {
+        result.draw_mesh_tasks = (PFN_vkCmdDrawMeshTasksEXT) vkGetDeviceProcAddr(context->device.vk_device,
+                                                                                  "vkCmdDrawMeshTasksEXT");
+        for (u32 i = 0; i < darray_length(context->renderer_instances); ++i) {
+            MeshletFrame frame = {0};
+            darray_push(result.frames, frame);
+        }
+        LOG_INFO("Meshlets are culled in task shaders");
+    } else {
+        // One command list per index type, each must fit the device's indirect draw count
+        result.command_capacity = MESHLET_MAX_COMMANDS;
+        u32 max_draw_count = context->physical_device.properties.limits.maxDrawIndirectCount;
+        if (max_draw_count < result.command_capacity) {
+            result.command_capacity = max_draw_count;
+        }
+
+        for (u32 i = 0; i < darray_length(context->renderer_instances); ++i) {
+            MeshletFrame frame = {0};
+            VkDeviceSize size = meshlet_commands_size(result.command_capacity);
+            if (!buffer_create(&context->physical_device, &context->device, size,
+                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                               VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &frame.commands)) {
+                LOG_ERROR("Couldn't create the meshlet command buffer!");
+                meshlet_renderer_destroy(context, &result);
+                return false;
+            }
+
+            frame.commands_handle = bindless_register_storage_buffer(&context->device, &context->bindless,
+                                                                     frame.commands.vk_buffer, 0, size);
+            darray_push(result.frames, frame);
+        }
+
+        LOG_INFO("Meshlets are culled in compute, %s", context->device.draw_indirect_count
+                                                        ? "compacted with an indirect count"
+                                                        : "without an indirect count");
+    }
+
+    *out = result;
+    if (!culler_create(&out->culler)) {
+        LOG_ERROR("Couldn't create the meshlet culler!");
+        meshlet_renderer_destroy(context, out);
+        return false;
+    }
+    return true;
+}
+
+void meshlet_renderer_destroy(VulkanContext *context, MeshletRenderer *renderer) {
+    if (renderer->frames != NULL) {
+        for (u32 i = 0; i < darray_length(renderer->frames); ++i) {
+            buffer_destroy(&context->device, &renderer->frames[i].commands);
+            buffer_destroy(&context->device, &renderer->frames[i].instances);
+        }
+        darray_destroy(renderer->frames);
+        renderer->frames = NULL;
+    }
+
+    vkDestroyPipeline(context->device.vk_device, renderer->cull_pipeline, host_allocator());
+    renderer->cull_pipeline = NULL;
+    vkDestroyPipeline(context->device.vk_device, renderer->draw_pipeline, host_allocator());
+    renderer->draw_pipeline = NULL;
+    vkDestroyPipelineLayout(context->device.vk_device, renderer->layout, host_allocator());
+    renderer->layout = NULL;
+
+    meshlet_draw_list_destroy(&renderer->draws);
+
+    culler_destroy(&renderer->culler);
+    for (u32 axis = 0; axis < 3; ++axis) {
+        free(renderer->bounds.center[axis]);
+        free(renderer->bounds.extent[axis]);
+        free(renderer->lod_center[axis]);
+        renderer->lod_center[axis] = NULL;
+    }
+    free(renderer->bounds.radius);
+    free(renderer->visible);
+    free(renderer->lod_radius);
+    free(renderer->lod_scale);
+    free(renderer->levels);
+    renderer->lod_radius = NULL;
+    renderer->lod_scale = NULL;
+    renderer->levels = NULL;
+    memset(&renderer->bounds, 0, sizeof(CullBounds));
+    renderer->visible = NULL;
+    renderer->bounds_capacity = 0;
+}
+
+void meshlet_renderer_set_view(MeshletRenderer *renderer, const float *view_projection, const float *camera) {
+    MeshletView *view = &renderer->view;
+    memcpy(view->view_projection, view_projection, sizeof(view->view_projection));
+    memcpy(view->camera, camera, sizeof(float) * 3);
+    view->camera[3] = 1.0f;
+
+    cull_frustum_extract(view_projection, &renderer->frustum);
+    memcpy(view->frustum, renderer->frustum.planes, sizeof(view->frustum));
+
+    // The second row of view_projection is the unit view space up axis times the vertical focal length
+    float focal = sqrtf(view_projection[1] * view_projection[1] + view_projection[5] * view_projection[5] +
+                        view_projection[9] * view_projection[9]);
+    memcpy(renderer->lod_view.camera, camera, sizeof(renderer->lod_view.camera));
+    renderer->lod_view.projection_scale = focal * 0.5f;
+    renderer->lod_view.threshold = MESHLET_LOD_THRESHOLD;
+}
+
+MeshletDraw *meshlet_draw_list_reserve(MeshletDrawList *list, u32 count) {
+    if (list->count + count > list->capacity) {
+        u32 capacity = list->capacity == 0 ? 256 : list->capacity * 2;
+        while (capacity < list->count + count) {
+            capacity *= 2;
+        }
+        list->draws = realloc(list->draws, sizeof(MeshletDraw) * capacity);
+        list->capacity = capacity;
+    }
+
+    MeshletDraw *draws = &list->draws[list->count];
+    list->count += count;
+    return draws;
+}
+
+void meshlet_draw_list_destroy(MeshletDrawList *list) {
+    free(list->draws);
+    memset(list, 0, sizeof(MeshletDrawList));
+}
+
+float meshlet_transform_scale(const float *transform) {
+    float scale = 0.0f;
+    for (u32 column = 0; column < 3; ++column) {
+        const float *axis = &transform[column * 4];
+        float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+        scale = length > scale ? length : scale;
+    }
+    return scale;
+}
+
+void meshlet_instance_fill(MeshPool *pool, MeshletDraw *draw, u32 level, u32 first_group, MeshletInstance *out) {
+    Mesh *mesh = &pool->meshes[draw->mesh];
+    MeshletInstance instance = {
+            .position_scale = {1.0f, 1.0f, 1.0f, meshlet_transform_scale(draw->transform)},
+            .first_meshlet = mesh->meshlet_offset + mesh->level_first_meshlet[level],
+            .meshlet_count = mesh->level_meshlet_count[level],
+            .first_group = first_group,
+            .material = draw->material,
+            .vertex_offset = (u32) (mesh->vertex_offset / mesh->vertex_stride),
+            .index_type = mesh->index_type == VK_INDEX_TYPE_UINT16 ? 0 : 1,
+            .vertex_format = mesh->vertex_format,
+            .mesh = draw->mesh
+    };
+    memcpy(instance.transform, draw->transform, sizeof(instance.transform));
+
+    // Quantized positions are unorm16 over the mesh bounds
+    if (mesh->vertex_format == MESH_VERTEX_FORMAT_QUANTIZED) {
+        for (u32 axis = 0; axis < 3; ++axis) {
+            instance.position_scale[axis] = (mesh->bounds.max[axis] - mesh->bounds.min[axis]) / 65535.0f;
+            instance.position_offset[axis] = mesh->bounds.min[axis];
+        }
+    }
+
+    *out = instance;
+}
+
+// World space box around each draw's mesh bounds
+void meshlet_bounds_fill(MeshPool *pool, MeshletRenderer *renderer, u32 draw_count) {
+    if (draw_count > renderer->bounds_capacity) {
+        for (u32 axis = 0; axis < 3; ++axis) {
+            renderer->bounds.center[axis] = realloc(renderer->bounds.center[axis], sizeof(float) * draw_count);
+            renderer->bounds.extent[axis] = realloc(renderer->bounds.extent[axis], sizeof(float) * draw_count);
+            renderer->lod_center[axis] = realloc(renderer->lod_center[axis], sizeof(float) * draw_count);
+        }
+        renderer->visible = realloc(renderer->visible, sizeof(u32) * draw_count);
+        renderer->lod_radius = realloc(renderer->lod_radius, sizeof(float) * draw_count);
+        renderer->lod_scale = realloc(renderer->lod_scale, sizeof(float) * draw_count);
+        renderer->levels = realloc(renderer->levels, draw_count);
+        renderer->bounds_capacity = draw_count;
+    }
+
+    CullBounds *bounds = &renderer->bounds;
+    bounds->count = draw_count;
+    for (u32 i = 0; i < draw_count; ++i) {
+        const float *m = renderer->draws.draws[i].transform;
+        const MeshBounds *mesh_bounds = &pool->meshes[renderer->draws.draws[i].mesh].bounds;
+
+        float center[3];
+        float extent[3];
+        for (u32 axis = 0; axis < 3; ++axis) {
+            center[axis] = (mesh_bounds->min[axis] + mesh_bounds->max[axis]) * 0.5f;
+            extent[axis] = (mesh_bounds->max[axis] - mesh_bounds->min[axis]) * 0.5f;
+        }
+
+        for (u32 row = 0; row < 3; ++row) {
+            bounds->center[row][i] = m[12 + row] + m[row] * center[0] + m[4 + row] * center[1] +
+                                     m[8 + row] * center[2];
+            bounds->extent[row][i] = fabsf(m[row]) * extent[0] + fabsf(m[4 + row]) * extent[1] +
+                                     fabsf(m[8 + row]) * extent[2];
+        }
+    }
+}
+
+// Picks the levels of the visible draws, one lod_select call per run of draws using the same mesh. With gpu_lod the
+// culling pass picks them and the run only gets its widest level.
+void meshlet_lods_select(MeshPool *pool, MeshletRenderer *renderer, const LodView *view, u32 visible_count) {
+    for (u32 i = 0; i < visible_count; ++i) {
+        u32 draw_index = renderer->visible[i];
+        MeshletDraw *draw = &renderer->draws.draws[draw_index];
+        float scale = meshlet_transform_scale(draw->transform);
+        for (u32 axis = 0; axis < 3; ++axis) {
+            renderer->lod_center[axis][i] = renderer->bounds.center[axis][draw_index];
+        }
+        renderer->lod_radius[i] = pool->meshes[draw->mesh].bounds.radius * scale;
+        renderer->lod_scale[i] = scale;
+    }
+
+    u32 start = 0;
+    while (start < visible_count) {
+        u32 mesh_id = renderer->draws.draws[renderer->visible[start]].mesh;
+        u32 end = start + 1;
+        while (end < visible_count && renderer->draws.draws[renderer->visible[end]].mesh == mesh_id) {
+            end++;
+        }
+
+        Mesh *mesh = &pool->meshes[mesh_id];
+        if (renderer->gpu_lod) {
+            // Enough groups for whichever level the culling pass picks
+            u32 widest = 0;
+            for (u32 level = 1; level < mesh->lod_count; ++level) {
+                widest = mesh->level_meshlet_count[level] > mesh->level_meshlet_count[widest] ? level : widest;
+            }
+            memset(&renderer->levels[start], (int) widest, end - start);
+            start = end;
+            continue;
+        }
+
+        LodObjects objects = {
+                .x = &renderer->lod_center[0][start],
+                .y = &renderer->lod_center[1][start],
+                .z = &renderer->lod_center[2][start],
+                .radius = &renderer->lod_radius[start],
+                .scale = &renderer->lod_scale[start],
+                .count = end - start
+        };
+        lod_select(view, mesh->lod_errors, mesh->level_triangles, mesh->lod_count, &objects,
+                   &renderer->levels[start], &renderer->lod_stats);
+        start = end;
+    }
+}
+
+// Streams the albedo of each visible draw towards the pixels its bounding sphere covers, from the centers and radii
+// meshlet_lods_select filled in
+void meshlet_textures_request(VulkanContext *context, MeshletRenderer *renderer, const LodView *view,
+                              u32 visible_count) {
+    MaterialTable *materials = &context->materials;
+    for (u32 i = 0; i < visible_count; ++i) {
+        MeshletDraw *draw = &renderer->draws.draws[renderer->visible[i]];
+        if (draw->material >= materials->count) {
+            continue;
+        }
+        u32 texture = materials->materials[draw->material].albedo_texture;
+        if (texture == TEXTURE_INVALID) {
+            continue;
+        }
+
+        float dx = renderer->lod_center[0][i] - view->camera[0];
+        float dy = renderer->lod_center[1][i] - view->camera[1];
+        float dz = renderer->lod_center[2][i] - view->camera[2];
+        float radius = renderer->lod_radius[i];
+        // Cameras inside the sphere count as the sphere filling the view
+        float distance = fmaxf(sqrtf(dx * dx + dy * dy + dz * dz), radius);
+        float pixels = distance > 0.0f ? 2.0f * radius * view->projection_scale / distance : 0.0f;
+        texture_request(&context->textures, texture, pixels, context->frame_number);
+    }
+}
+
+void meshlet_bind(VulkanContext *context, MeshletRenderer *renderer, VkPipelineBindPoint bind_point,
+                  VkPipeline pipeline) {
+    VkCommandBuffer command_buffer = context->current_renderer->command_buffer;
+    vkCmdBindPipeline(command_buffer, bind_point, pipeline);
+    bindless_bind(&context->bindless, command_buffer, bind_point, renderer->layout);
+
+    u32 dynamic_offsets[FRAME_ALLOCATOR_BINDING_MAX] = {renderer->view_offset, renderer->instance_offset};
+    vkCmdBindDescriptorSets(command_buffer, bind_point, renderer->layout, 1, 1, &renderer->instance_set,
+                            FRAME_ALLOCATOR_BINDING_MAX, dynamic_offsets);
+}
+
+MeshletConstants meshlet_constants(VulkanContext *context, MeshletRenderer *renderer) {
+    MeshletConstants constants = {
+            .material_buffer = context->materials.buffer_handle,
+            .material_index = context->default_material,
+            .texture_table = context->textures.handle_table_handle,
+            .vertices = context->meshes.vertices_handle,
+            .meshlets = context->meshes.meshlets_handle,
+            .meshlet_vertices = context->meshes.meshlet_vertices_handle,
+            .meshlet_triangles = context->meshes.meshlet_triangles_handle,
+            .commands = BINDLESS_INVALID_HANDLE,
+            .instance_count = renderer->instance_count,
+            .command_capacity = renderer->command_capacity,
+            .compact = context->device.draw_indirect_count,
+            .lights = BINDLESS_INVALID_HANDLE,
+            .clusters = BINDLESS_INVALID_HANDLE,
+            .lods = renderer->gpu_lod ? context->meshes.lods_handle : BINDLESS_INVALID_HANDLE
+    };
+
+    if (context->lights.frames != NULL) {
+        LightFrame *lights = &context->lights.frames[context->current_renderer_index];
+        constants.lights = lights->lights_handle;
+        constants.clusters = lights->clusters_handle;
+    }
+
+    if (renderer->frames != NULL) {
+        constants.commands = renderer->frames[context->current_renderer_index].commands_handle;
+    }
+    return constants;
+}
+
+// Instances come from the frame allocator while they fit one dynamic storage range. Larger lists go to the frame's
+// own buffer, bound through a set from the frame's descriptor pool with the instances at offset 0.
+bool meshlet_instances_alloc(VulkanContext *context, MeshletRenderer *renderer, u32 count, MeshletInstance **out) {
+    FrameAllocator *allocator = &context->current_renderer->frame_allocator;
+    VkDeviceSize size = sizeof(MeshletInstance) * count;
+    FrameAllocation allocation;
+    if (size <= allocator->storage_range && frame_allocator_alloc(allocator, size, &allocation)) {
+        renderer->instance_set = allocator->dynamic_set;
+        renderer->instance_offset = allocation.dynamic_offset;
+        *out = allocation.data;
+        return true;
+    }
+
+    if (size > context->physical_device.properties.limits.maxStorageBufferRange) {
+        LOG_ERROR("%u visible meshlet instances exceed the device's storage buffer range, skipping them", count);
+        return false;
+    }
+
+    // The frame's fence has signaled, so the buffer it drew from last time is free to replace
+    MeshletFrame *frame = &renderer->frames[context->current_renderer_index];
+    if (frame->instances.size < size) {
+        VkDeviceSize capacity = frame->instances.size > 0 ? frame->instances.size : size;
+        while (capacity < size) {
+            capacity *= 2;
+        }
+        LOG_WARN("%u visible meshlet instances overflow the frame allocator, using a %llu KiB instance buffer", count,
+                 (unsigned long long) (capacity >> 10));
+
+        buffer_destroy(&context->device, &frame->instances);
+        if (!buffer_create(&context->physical_device, &context->device, capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                           &frame->instances)) {
+            LOG_ERROR("Couldn't create the meshlet instance buffer!");
+            frame->instances = (Buffer) {0};
+            return false;
+        }
+    }
+
+    VkDescriptorSet set = frame_allocator_storage_set(context, allocator, frame->instances.vk_buffer,
+                                                      frame->instances.size);
+    if (set == VK_NULL_HANDLE) {
+        return false;
+    }
+
+    renderer->instance_set = set;
+    renderer->instance_offset = 0;
+    *out = frame->instances.mapped;
+    return true;
+}
+
+void meshlet_renderer_cull(VulkanContext *context, MeshletRenderer *renderer) {
+    u32 draw_count = renderer->draws.count;
+    renderer->draws.count = 0;
+    renderer->draw_count = draw_count;
+    renderer->group_count = 0;
+    renderer->instance_count = 0;
+    renderer->index_types[0] = renderer->index_types[1] = false;
+    lod_stats_reset(&renderer->lod_stats);
+    if (renderer->path == MESHLET_PATH_NONE || draw_count == 0) {
+        return;
+    }
+
+    FrameAllocation view;
+    if (!frame_allocator_alloc(&context->current_renderer->frame_allocator, sizeof(MeshletView), &view)) {
+        return;
+    }
+
+    MeshletView *view_data = view.data;
+    memcpy(view_data, &renderer->view, sizeof(MeshletView));
+    renderer->view_offset = view.dynamic_offset;
+
+    DepthPyramid *pyramid = &context->depth_pyramid;
+    memcpy(view_data->occlusion_view_projection, pyramid->view_projection, sizeof(pyramid->view_projection));
+    view_data->pyramid[0] = pyramid->valid ? pyramid->image_handle : BINDLESS_INVALID_HANDLE;
+    view_data->pyramid[1] = pyramid->sampler_handle;
+    view_data->pyramid[2] = pyramid->image.extent.width;
+    view_data->pyramid[3] = pyramid->image.extent.height;
+
+    meshlet_bounds_fill(&context->meshes, renderer, draw_count);
+    u32 visible_count = culler_run(&renderer->culler, &renderer->frustum, &renderer->bounds, CULL_SHAPE_BOX,
+                                   renderer->visible);
+
+    // Levels are picked against the rendered height, which is what a pixel of error is measured in
+    LodView lod_view = renderer->lod_view;
+    lod_view.projection_scale *= (float) context->resolution.extent.height;
+    view_data->lod[0] = lod_view.projection_scale / lod_view.threshold;
+    meshlet_lods_select(&context->meshes, renderer, &lod_view, visible_count);
+    meshlet_textures_request(context, renderer, &lod_view, visible_count);
+
+    // Only visible draws get instances
+    MeshletInstance *instance_data = NULL;
+    if (visible_count == 0 || !meshlet_instances_alloc(context, renderer, visible_count, &instance_data)) {
+        return;
+    }
+
+    for (u32 i = 0; i < visible_count; ++i) {
+        MeshletInstance *instance = &instance_data[renderer->instance_count];
+        meshlet_instance_fill(&context->meshes, &renderer->draws.draws[renderer->visible[i]], renderer->levels[i],
+                              renderer->group_count, instance);
+        if (instance->meshlet_count == 0) {
+            continue;
+        }
+
+        renderer->index_types[instance->index_type] = true;
+        renderer->group_count += (instance->meshlet_count + MESHLET_GROUP_SIZE - 1) / MESHLET_GROUP_SIZE;
+        renderer->instance_count++;
+    }
+}
+
+void meshlet_renderer_clear_pass(VulkanContext *context, VkCommandBuffer command_buffer, void *data) {
+    MeshletRenderer *renderer = data;
+    if (renderer->path != MESHLET_PATH_INDIRECT || renderer->group_count == 0) {
+        return;
+    }
+
+    Buffer *commands = &renderer->frames[context->current_renderer_index].commands;
+
+    // Compacted lists only need their counters reset, sparse lists need every slot that is drawn zeroed
+    VkDeviceSize clear_size = MESHLET_COMMANDS_HEADER;
+    if (!context->device.draw_indirect_count) {
+        clear_size = VK_WHOLE_SIZE;
+    }
+    vkCmdFillBuffer(command_buffer, commands->vk_buffer, 0, clear_size, 0);
+}
+
+void meshlet_renderer_cull_pass(VulkanContext *context, VkCommandBuffer command_buffer, void *data) {
+    MeshletRenderer *renderer = data;
+    if (renderer->path != MESHLET_PATH_INDIRECT || renderer->group_count == 0) {
+        return;
+    }
+
+    meshlet_bind(context, renderer, VK_PIPELINE_BIND_POINT_COMPUTE, renderer->cull_pipeline);
+    MeshletConstants constants = meshlet_constants(context, renderer);
+    for (u32 first = 0; first < renderer->group_count; first += MESHLET_MAX_GROUPS_PER_DISPATCH) {
+        u32 count = renderer->group_count - first;
+        count = count < MESHLET_MAX_GROUPS_PER_DISPATCH ? count : MESHLET_MAX_GROUPS_PER_DISPATCH;
+
+        constants.first_group = first;
+        vkCmdPushConstants(command_buffer, renderer->layout, VK_SHADER_STAGE_ALL, 0, sizeof(MeshletConstants),
+                           &constants);
+        vkCmdDispatch(command_buffer, count, 1, 1);
+    }
+}
+
+void meshlet_draw_indirect(VulkanContext *context, MeshletRenderer *renderer) {
+    VkCommandBuffer command_buffer = context->current_renderer->command_buffer;
+    Buffer *commands = &renderer->frames[context->current_renderer_index].commands;
+    u32 sparse_count = renderer->group_count * MESHLET_GROUP_SIZE;
+    sparse_count = sparse_count < renderer->command_capacity ? sparse_count : renderer->command_capacity;
+
+    VkIndexType index_types[] = {VK_INDEX_TYPE_UINT16, VK_INDEX_TYPE_UINT32};
+    for (u32 list = 0; list < 2; ++list) {
+        if (!renderer->index_types[list]) {
+            continue;
+        }
+
+        VkDeviceSize offset = MESHLET_COMMANDS_HEADER + sizeof(MeshletCommand) * renderer->command_capacity * list;
+        vkCmdBindIndexBuffer(command_buffer, context->meshes.indices.vk_buffer, 0, index_types[list]);
+        if (context->device.draw_indirect_count) {
+            vkCmdDrawIndexedIndirectCount(command_buffer, commands->vk_buffer, offset, commands->vk_buffer,
+                                          sizeof(u32) * list, renderer->command_capacity, sizeof(MeshletCommand));
+        } else {
+            vkCmdDrawIndexedIndirect(command_buffer, commands->vk_buffer, offset, sparse_count,
+                                     sizeof(MeshletCommand));
+        }
+    }
+}
+
+void meshlet_renderer_draw(VulkanContext *context, MeshletRenderer *renderer) {
+    if (renderer->group_count == 0) {
+        return;
+    }
+
+    VkCommandBuffer command_buffer = context->current_renderer->command_buffer;
+    meshlet_bind(context, renderer, VK_PIPELINE_BIND_POINT_GRAPHICS, renderer->draw_pipeline);
+    MeshletConstants constants = meshlet_constants(context, renderer);
+
+    if (renderer->path == MESHLET_PATH_INDIRECT) {
+        vkCmdPushConstants(command_buffer, renderer->layout, VK_SHADER_STAGE_ALL, 0, sizeof(MeshletConstants),
+                           &constants);
+        meshlet_draw_indirect(context, renderer);
+        return;
+    }
+
+    for (u32 first = 0; first < renderer->group_count; first += MESHLET_MAX_GROUPS_PER_DISPATCH) {
+        u32 count = renderer->group_count - first;
+        count = count < MESHLET_MAX_GROUPS_PER_DISPATCH ? count : MESHLET_MAX_GROUPS_PER_DISPATCH;
+
+        constants.first_group = first;
+        vkCmdPushConstants(command_buffer, renderer->layout, VK_SHADER_STAGE_ALL, 0, sizeof(MeshletConstants),
+                           &constants);
+        renderer->draw_mesh_tasks(command_buffer, count, 1, 1);
+    }
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <std/defines.h>
+#include "vulkan_types.h"
+#include "buffer.h"
+#include "core/cull.h"
+#include "core/lod.h"
+
+// Meshlets culled per invocation group, one task shader or compute workgroup each
+#define MESHLET_GROUP_SIZE 32
+// Indirect commands per index type and frame, further visible meshlets are dropped
+#define MESHLET_MAX_COMMANDS (128 * 1024)
+// Guaranteed minimum of maxComputeWorkGroupCount[0] and maxTaskWorkGroupCount[0]
+#define MESHLET_MAX_GROUPS_PER_DISPATCH 65535
+// Screen space error in pixels a coarser level of detail may add
+#define MESHLET_LOD_THRESHOLD 1.0f
+
+typedef struct VulkanContext VulkanContext;
+
+typedef enum MeshletPath {
+    // No way to draw meshlets on this device, draws are dropped
+    MESHLET_PATH_NONE,
+    // Compute culling writes one indexed indirect command per visible meshlet
+    MESHLET_PATH_INDIRECT,
+    // Task shaders cull and launch one mesh shader workgroup per visible meshlet
+    MESHLET_PATH_MESH_SHADER,
+} MeshletPath;
+
+// Mirrors MeshInstance in shaders/meshlet.glsl
+typedef struct MeshletInstance {
+    float transform[16];
+    // xyz: quantized position to object space, w: largest axis scale of the transform for bounding spheres
+    float position_scale[4];
+    float position_offset[4];
+    u32 first_meshlet;
+    u32 meshlet_count;
+    u32 first_group;
+    u32 material;
+    u32 vertex_offset;
+    u32 index_type;
+    u32 vertex_format;
+    // Pool mesh id, for picking the level in the culling pass
+    u32 mesh;
+} MeshletInstance;
+
+// Mirrors MeshletView in shaders/meshlet.glsl
+typedef struct MeshletView {
+    float view_projection[16];
+    float frustum[6][4];
+    float camera[4];
+    // Filled in per frame from the depth pyramid: the view it was rendered with, then the pyramid image and sampler
+    // handles and its size. The image is BINDLESS_INVALID_HANDLE while there's no pyramid to test against.
+    float occlusion_view_projection[16];
+    u32 pyramid[4];
+    // x: distance factor of a unit of level error, LodView's projection_scale over its threshold
+    float lod[4];
+} MeshletView;
+
+// Starts with the BindlessDrawConstants fields so the bindless helpers work unchanged
+typedef struct MeshletConstants {
+    u32 material_buffer;
+    u32 material_index;
+    u32 texture_table;
+    u32 vertices;
+    u32 meshlets;
+    u32 meshlet_vertices;
+    u32 meshlet_triangles;
+    u32 commands;
+    u32 instance_count;
+    u32 first_group;
+    u32 command_capacity;
+    u32 compact;
+    // This frame's LightFrame buffers for shading
+    u32 lights;
+    u32 clusters;
+    // The pool's GpuMeshLods table when the culling pass picks levels, BINDLESS_INVALID_HANDLE when instances
+    // already hold theirs
+    u32 lods;
+} MeshletConstants;
+
+typedef struct MeshletDraw {
+    u32 mesh;
+    u32 material;
+    float transform[16];
+} MeshletDraw;
+
+// Draws queued for one frame, handed between render packets and the renderer by swapping the whole list
+typedef struct MeshletDrawList {
+    MeshletDraw *draws;
+    u32 count;
+    u32 capacity;
+} MeshletDrawList;
+
+// Indirect commands of one renderer instance, written by the culling pass of the frame using it. instances only
+// exists once a frame's visible instances didn't fit one frame allocator storage range, and grows on demand.
+typedef struct MeshletFrame {
+    Buffer commands;
+    u32 commands_handle;
+    Buffer instances;
+} MeshletFrame;
+
+typedef struct MeshletRenderer {
+    MeshletPath path;
+
+    VkPipelineLayout layout;
+    VkPipeline cull_pipeline;
+    VkPipeline draw_pipeline;
+    PFN_vkCmdDrawMeshTasksEXT draw_mesh_tasks;
+
+    MeshletFrame *frames;
+
+    u32 command_capacity;
+
+    MeshletView view;
+    MeshletDrawList draws;
+
+    // Whole draws are frustum culled on the CPU before their meshlets reach the GPU
+    Culler culler;
+    CullFrustum frustum;
+    CullBounds bounds;
+    u32 *visible;
+    u32 bounds_capacity;
+
+    // Visible draws as LodObjects, levels are picked for runs of draws sharing a mesh. projection_scale is per pixel
+    // of rendered height.
+    LodView lod_view;
+    float *lod_center[3];
+    float *lod_radius;
+    float *lod_scale;
+    u8 *levels;
+    // Triangles of the levels drawn this frame against full detail, only counted while levels are picked on the CPU
+    LodStats lod_stats;
+    // Levels are picked per instance in the culling pass instead, instances cover the level with the most meshlets
+    bool gpu_lod;
+
+    // Recorded by meshlet_renderer_cull for the draw in the same frame. draw_count is before culling.
+    u32 draw_count;
+    u32 instance_count;
+    u32 group_count;
+    u32 view_offset;
+    u32 instance_offset;
+    // Bound with view_offset and instance_offset, the frame allocator's dynamic set unless the instances overflowed
+    VkDescriptorSet instance_set;
+    bool index_types[2];
+} MeshletRenderer;
+
+bool meshlet_renderer_create(VulkanContext *context, MeshletRenderer *out);
+
+void meshlet_renderer_destroy(VulkanContext *context, MeshletRenderer *renderer);
+
+// view_projection is column major, camera is the world space eye position
+void meshlet_renderer_set_view(MeshletRenderer *renderer, const float *view_projection, const float *camera);
+
+// Appends count draws for the caller to fill in, valid until the next reserve
+MeshletDraw *meshlet_draw_list_reserve(MeshletDrawList *list, u32 count);
+
+void meshlet_draw_list_destroy(MeshletDrawList *list);
+
+// Culls whole draws against the view, picks each visible draw's level of detail, uploads the visible instances and
+// clears the draw list
+void meshlet_renderer_cull(VulkanContext *context, MeshletRenderer *renderer);
+
+// Render graph passes of the indirect path: clearing this frame's command buffer with a transfer, then culling
+// meshlets into it with compute. data is the renderer.
+void meshlet_renderer_clear_pass(VulkanContext *context, VkCommandBuffer command_buffer, void *data);
+
+void meshlet_renderer_cull_pass(VulkanContext *context, VkCommandBuffer command_buffer, void *data);
+
+// Draws what meshlet_renderer_cull kept, inside the render pass
+void meshlet_renderer_draw(VulkanContext *context, MeshletRenderer *renderer);
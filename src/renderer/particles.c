@@ -0,0 +1,399 @@
+#include "particles.h"
+#include "host_allocator.h"
+#include "vulkan.h"
+#include "shader.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PARTICLE_GRAVITY 9.81f
+#define PARTICLE_DRAG 0.2f
+
+bool particle_draw_pipeline_create(VulkanContext *context, ParticleSystem *system) {
+    Device *device = &context->device;
+    Shader shader = {0};
+    if (!shader_load(device, "particle.vert.spv", "particle.frag.spv", &shader)) {
+        return false;
+    }
+
+    VkPipelineShaderStageCreateInfo stage_create_infos[2] = {
+            {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO},
+            {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO}
+    };
+    stage_create_infos[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stage_create_infos[0].module = shader.vertex;
+    stage_create_infos[0].pName = "main";
+    stage_create_infos[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stage_create_infos[1].module = shader.fragment;
+    stage_create_infos[1].pName = "main";
+
+    // Corners come from gl_VertexIndex and particles from the alive list, nothing is fetched as vertex input
+    VkPipelineVertexInputStateCreateInfo vertex_input_create_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+
+    VkPipelineInputAssemblyStateCreateInfo input_assembly_create_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
+    input_assembly_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkDynamicState dynamic_states[] = {
+            VK_DYNAMIC_STATE_VIEWPORT,
+            VK_DYNAMIC_STATE_SCISSOR
+    };
+    VkPipelineDynamicStateCreateInfo dynamic_state_create_info = {VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
+    dynamic_state_create_info.dynamicStateCount = sizeof(dynamic_states) / sizeof(VkDynamicState);
+    dynamic_state_create_info.pDynamicStates = dynamic_states;
+
+    VkPipelineViewportStateCreateInfo viewport_state_create_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO};
+    viewport_state_create_info.viewportCount = 1;
+    viewport_state_create_info.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterization_create_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO};
+    rasterization_create_info.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterization_create_info.lineWidth = 1.0f;
+    rasterization_create_info.cullMode = VK_CULL_MODE_NONE;
+
+    VkPipelineMultisampleStateCreateInfo multisample_create_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO};
+    multisample_create_info.rasterizationSamples = context->graphics_pipeline.samples;
+    multisample_create_info.minSampleShading = 1.0f;
+
+    // Tested against the scene but unsorted, so they must not hide each other
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_create_info = graphics_pipeline_depth_state();
+    depth_stencil_create_info.depthWriteEnable = VK_FALSE;
+
+    VkPipelineColorBlendAttachmentState color_blend_attachment_state = {0};
+    color_blend_attachment_state.colorWriteMask =
+            VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    color_blend_attachment_state.blendEnable = VK_TRUE;
+    color_blend_attachment_state.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    color_blend_attachment_state.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    color_blend_attachment_state.colorBlendOp = VK_BLEND_OP_ADD;
+    color_blend_attachment_state.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    color_blend_attachment_state.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    color_blend_attachment_state.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    VkPipelineColorBlendStateCreateInfo color_blend_create_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO};
+    color_blend_create_info.attachmentCount = 1;
+    color_blend_create_info.pAttachments = &color_blend_attachment_state;
+
+    VkGraphicsPipelineCreateInfo pipeline_create_info = {VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
+    pipeline_create_info.stageCount = 2;
+    pipeline_create_info.pStages = stage_create_infos;
+    pipeline_create_info.pVertexInputState = &vertex_input_create_info;
+    pipeline_create_info.pInputAssemblyState = &input_assembly_create_info;
+    pipeline_create_info.pViewportState = &viewport_state_create_info;
+    pipeline_create_info.pRasterizationState = &rasterization_create_info;
+    pipeline_create_info.pMultisampleState = &multisample_create_info;
+    pipeline_create_info.pDepthStencilState = &depth_stencil_create_info;
+    pipeline_create_info.pColorBlendState = &color_blend_create_info;
+    pipeline_create_info.pDynamicState = &dynamic_state_create_info;
+    pipeline_create_info.layout = system->layout;
+    pipeline_create_info.renderPass = context->graphics_pipeline.render_pass;
+    pipeline_create_info.subpass = 0;
+    pipeline_create_info.basePipelineIndex = -1;
+    VK_CHECK(vkCreateGraphicsPipelines(device->vk_device, device->pipeline_cache, 1, &pipeline_create_info, host_allocator(),
+                                       &system->draw_pipeline));
+
+    shader_destroy(device, &shader);
+    return true;
+}
+
+bool particle_system_create(VulkanContext *context, ParticleSystem *out) {
+    ParticleSystem result = {0};
+    result.counters_handle = BINDLESS_INVALID_HANDLE;
+    result.dispatch_handle = BINDLESS_INVALID_HANDLE;
+    for (u32 i = 0; i < PARTICLE_ARRAY_MAX; ++i) {
+        result.arrays[i] = BINDLESS_INVALID_HANDLE;
+    }
+
+    VkDescriptorSetLayout set_layouts[] = {context->bindless.layout, context->frame_allocator_layout};
+
+    VkPushConstantRange push_constant_range = {0};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_ALL;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(ParticleConstants);
+
+    VkPipelineLayoutCreateInfo layout_create_info = {VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    layout_create_info.setLayoutCount = sizeof(set_layouts) / sizeof(VkDescriptorSetLayout);
+    layout_create_info.pSetLayouts = set_layouts;
+    layout_create_info.pushConstantRangeCount = 1;
+    layout_create_info.pPushConstantRanges = &push_constant_range;
+    VK_CHECK(vkCreatePipelineLayout(context->device.vk_device, &layout_create_info, host_allocator(), &result.layout));
+
+    Device *device = &context->device;
+    if (!compute_pipeline_create(device, result.layout, "particle_begin.comp.spv", &result.begin_pipeline) ||
+        !compute_pipeline_create(device, result.layout, "particle_emit.comp.spv", &result.emit_pipeline) ||
+        !compute_pipeline_create(device, result.layout, "particle_update.comp.spv", &result.update_pipeline) ||
+        !particle_draw_pipeline_create(context, &result)) {
+        LOG_ERROR("Couldn't create the particle pipelines!");
+        particle_system_destroy(context, &result);
+        return false;
+    }
+
+    *out = result;
+    return true;
+}
+
+// Frees the buffers of the current capacity, their handles go back to the table once the frames using them are done
+void particle_buffers_destroy(VulkanContext *context, ParticleSystem *system) {
+    for (u32 i = 0; i < PARTICLE_ARRAY_MAX; ++i) {
+        if (system->arrays[i] != BINDLESS_INVALID_HANDLE) {
+            bindless_release(&context->bindless, BINDLESS_BINDING_STORAGE_BUFFERS, system->arrays[i],
+                             context->frame_number);
+            system->arrays[i] = BINDLESS_INVALID_HANDLE;
+        }
+    }
+    if (system->counters_handle != BINDLESS_INVALID_HANDLE) {
+        bindless_release(&context->bindless, BINDLESS_BINDING_STORAGE_BUFFERS, system->counters_handle,
+                         context->frame_number);
+        system->counters_handle = BINDLESS_INVALID_HANDLE;
+    }
+    if (system->dispatch_handle != BINDLESS_INVALID_HANDLE) {
+        bindless_release(&context->bindless, BINDLESS_BINDING_STORAGE_BUFFERS, system->dispatch_handle,
+                         context->frame_number);
+        system->dispatch_handle = BINDLESS_INVALID_HANDLE;
+    }
+
+    buffer_destroy(&context->device, &system->state);
+    buffer_destroy(&context->device, &system->counters);
+    buffer_destroy(&context->device, &system->dispatch);
+}
+
+void particle_system_destroy(VulkanContext *context, ParticleSystem *system) {
+    particle_buffers_destroy(context, system);
+
+    Device *device = &context->device;
+    vkDestroyPipeline(device->vk_device, system->begin_pipeline, host_allocator());
+    system->begin_pipeline = NULL;
+    vkDestroyPipeline(device->vk_device, system->emit_pipeline, host_allocator());
+    system->emit_pipeline = NULL;
+    vkDestroyPipeline(device->vk_device, system->update_pipeline, host_allocator());
+    system->update_pipeline = NULL;
+    vkDestroyPipeline(device->vk_device, system->draw_pipeline, host_allocator());
+    system->draw_pipeline = NULL;
+    vkDestroyPipelineLayout(device->vk_device, system->layout, host_allocator());
+    system->layout = NULL;
+}
+
+// Largest capacity one dispatch over every particle and one bindless range per array can cover
+u32 particle_max_capacity(VulkanContext *context) {
+    VkPhysicalDeviceLimits *limits = &context->physical_device.properties.limits;
+    u64 capacity = (u64) limits->maxComputeWorkGroupCount[0] * PARTICLE_GROUP_SIZE;
+    u64 range_capacity = limits->maxStorageBufferRange / (sizeof(float) * 4);
+    return (u32) (capacity < range_capacity ? capacity : range_capacity);
+}
+
+bool particle_system_configure(VulkanContext *context, ParticleSystem *system, const ParticleSettings *settings) {
+    particle_buffers_destroy(context, system);
+    system->settings = *settings;
+    system->active = false;
+    system->frame = 0;
+    system->emit_request = 0;
+    system->emit_carry = 0.0f;
+    system->last_update = 0;
+
+    u32 max_capacity = particle_max_capacity(context);
+    if (system->settings.capacity > max_capacity) {
+        LOG_WARN("Particle capacity %u is above the device limit, clamped to %u", system->settings.capacity,
+                 max_capacity);
+        system->settings.capacity = max_capacity;
+    }
+
+    u32 capacity = system->settings.capacity;
+    if (capacity == 0) {
+        return true;
+    }
+
+    // Vectors are 16 bytes per particle, colors and the index lists 4
+    VkDeviceSize alignment = context->physical_device.properties.limits.minStorageBufferOffsetAlignment;
+    VkDeviceSize offsets[PARTICLE_ARRAY_MAX];
+    VkDeviceSize ranges[PARTICLE_ARRAY_MAX];
+    VkDeviceSize size = 0;
+    for (u32 i = 0; i < PARTICLE_ARRAY_MAX; ++i) {
+        bool vector = i == PARTICLE_ARRAY_POSITIONS || i == PARTICLE_ARRAY_VELOCITIES;
+        ranges[i] = (VkDeviceSize) capacity * (vector ? sizeof(float) * 4 : sizeof(u32));
+        offsets[i] = (size + alignment - 1) / alignment * alignment;
+        size = offsets[i] + ranges[i];
+    }
+
+    Device *device = &context->device;
+    PhysicalDevice *physical_device = &context->physical_device;
+    if (!buffer_create(physical_device, device, size,
+                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &system->state) ||
+        !buffer_create(physical_device, device, sizeof(ParticleCounters),
+                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                       VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &system->counters) ||
+        !buffer_create(physical_device, device, sizeof(u32) * 3,
+                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &system->dispatch)) {
+        LOG_ERROR("Couldn't create the particle buffers!");
+        particle_buffers_destroy(context, system);
+        system->settings.capacity = 0;
+        return false;
+    }
+
+    bool registered = true;
+    for (u32 i = 0; i < PARTICLE_ARRAY_MAX; ++i) {
+        system->arrays[i] = bindless_register_storage_buffer(device, &context->bindless, system->state.vk_buffer,
+                                                             offsets[i], ranges[i]);
+        registered = registered && system->arrays[i] != BINDLESS_INVALID_HANDLE;
+    }
+    system->counters_handle = bindless_register_storage_buffer(device, &context->bindless,
+                                                               system->counters.vk_buffer, 0,
+                                                               sizeof(ParticleCounters));
+    system->dispatch_handle = bindless_register_storage_buffer(device, &context->bindless,
+                                                               system->dispatch.vk_buffer, 0, sizeof(u32) * 3);
+    if (!registered || system->counters_handle == BINDLESS_INVALID_HANDLE ||
+        system->dispatch_handle == BINDLESS_INVALID_HANDLE) {
+        LOG_ERROR("Out of bindless storage buffer handles for the particles!");
+        particle_buffers_destroy(context, system);
+        system->settings.capacity = 0;
+        return false;
+    }
+
+    // Every slot starts out dead, the last frame's survivor count in the draw arguments is zero
+    u32 *dead = malloc(sizeof(u32) * capacity);
+    for (u32 i = 0; i < capacity; ++i) {
+        dead[i] = i;
+    }
+    ParticleCounters counters = {.dead_count = capacity, .draw = {6, 0, 0, 0}};
+    uploader_copy_to_buffer(context, &context->uploader, &system->state, offsets[PARTICLE_ARRAY_DEAD], dead,
+                            ranges[PARTICLE_ARRAY_DEAD]);
+    uploader_copy_to_buffer(context, &context->uploader, &system->counters, 0, &counters, sizeof(counters));
+    uploader_flush(context, &context->uploader);
+    free(dead);
+
+    LOG_INFO("Particle system configured for %u particles, %llu KiB of state", capacity,
+             (unsigned long long) (size >> 10));
+    return true;
+}
+
+void particle_system_update(VulkanContext *context, ParticleSystem *system, const float *view_projection) {
+    ParticleSettings *settings = &system->settings;
+    system->active = false;
+    system->emit_request = 0;
+    if (settings->capacity == 0) {
+        return;
+    }
+
+    u64 now = SDL_GetPerformanceCounter();
+    float step = 0.0f;
+    if (system->last_update != 0) {
+        step = (float) (latency_ticks_to_ms(now - system->last_update) / 1000.0);
+        step = step < PARTICLE_MAX_STEP ? step : PARTICLE_MAX_STEP;
+    }
+    system->last_update = now;
+
+    // Fractions carry over, so low rates at high frame rates still emit
+    system->emit_carry += settings->emit_rate * step;
+    u32 request = (u32) system->emit_carry;
+    system->emit_carry -= (float) request;
+    system->emit_request = request < settings->capacity ? request : settings->capacity;
+
+    FrameAllocation allocation;
+    if (!frame_allocator_alloc(&context->current_renderer->frame_allocator, sizeof(ParticleFrame), &allocation)) {
+        system->emit_request = 0;
+        return;
+    }
+    system->active = true;
+    system->frame_offset = allocation.dynamic_offset;
+    system->frame++;
+
+    ParticleFrame *frame = allocation.data;
+    memcpy(frame->view_projection, view_projection, sizeof(frame->view_projection));
+    memcpy(frame->origin, settings->origin, sizeof(float) * 3);
+    frame->origin[3] = settings->speed;
+    // Clip space offsets along the view axes, scaled by w like the center so the quad shrinks with distance
+    const float *m = view_projection;
+    frame->billboard[0] = sqrtf(m[0] * m[0] + m[4] * m[4] + m[8] * m[8]);
+    frame->billboard[1] = sqrtf(m[1] * m[1] + m[5] * m[5] + m[9] * m[9]);
+    frame->billboard[2] = settings->size;
+    frame->billboard[3] = step;
+    frame->motion[0] = settings->lifetime;
+    frame->motion[1] = PARTICLE_GRAVITY;
+    frame->motion[2] = PARTICLE_DRAG;
+    frame->motion[3] = 0.0f;
+    frame->emit[0] = system->emit_request;
+    frame->emit[1] = system->frame * 0x9e3779b9u;
+    frame->emit[2] = 0;
+    frame->emit[3] = 0;
+}
+
+void particle_bind(VulkanContext *context, ParticleSystem *system, VkPipelineBindPoint bind_point,
+                   VkPipeline pipeline) {
+    VkCommandBuffer command_buffer = context->current_renderer->command_buffer;
+    vkCmdBindPipeline(command_buffer, bind_point, pipeline);
+    bindless_bind(&context->bindless, command_buffer, bind_point, system->layout);
+
+    u32 dynamic_offsets[FRAME_ALLOCATOR_BINDING_MAX] = {system->frame_offset, 0};
+    vkCmdBindDescriptorSets(command_buffer, bind_point, system->layout, 1, 1,
+                            &context->current_renderer->frame_allocator.dynamic_set, FRAME_ALLOCATOR_BINDING_MAX,
+                            dynamic_offsets);
+
+    // Update reads this frame's alive list and fills the other one, which is what the draw and the next frame see
+    u32 current = system->frame & 1;
+    ParticleConstants constants = {
+            .material_buffer = context->materials.buffer_handle,
+            .material_index = context->default_material,
+            .texture_table = context->textures.handle_table_handle,
+            .positions = system->arrays[PARTICLE_ARRAY_POSITIONS],
+            .velocities = system->arrays[PARTICLE_ARRAY_VELOCITIES],
+            .colors = system->arrays[PARTICLE_ARRAY_COLORS],
+            .alive = system->arrays[PARTICLE_ARRAY_ALIVE_0 + current],
+            .next_alive = system->arrays[PARTICLE_ARRAY_ALIVE_0 + (current ^ 1)],
+            .dead = system->arrays[PARTICLE_ARRAY_DEAD],
+            .counters = system->counters_handle,
+            .dispatch = system->dispatch_handle,
+            .capacity = system->settings.capacity
+    };
+    vkCmdPushConstants(command_buffer, system->layout, VK_SHADER_STAGE_ALL, 0, sizeof(ParticleConstants),
+                       &constants);
+}
+
+void particle_system_begin_pass(VulkanContext *context, VkCommandBuffer command_buffer, void *data) {
+    ParticleSystem *system = data;
+    if (!system->active) {
+        return;
+    }
+
+    particle_bind(context, system, VK_PIPELINE_BIND_POINT_COMPUTE, system->begin_pipeline);
+    vkCmdDispatch(command_buffer, 1, 1, 1);
+}
+
+void particle_system_emit_pass(VulkanContext *context, VkCommandBuffer command_buffer, void *data) {
+    ParticleSystem *system = data;
+    if (!system->active || system->emit_request == 0) {
+        return;
+    }
+
+    // Sized for the request, threads past what begin found free slots for return right away
+    particle_bind(context, system, VK_PIPELINE_BIND_POINT_COMPUTE, system->emit_pipeline);
+    vkCmdDispatch(command_buffer, (system->emit_request + PARTICLE_GROUP_SIZE - 1) / PARTICLE_GROUP_SIZE, 1, 1);
+}
+
+void particle_system_update_pass(VulkanContext *context, VkCommandBuffer command_buffer, void *data) {
+    ParticleSystem *system = data;
+    if (!system->active) {
+        return;
+    }
+
+    particle_bind(context, system, VK_PIPELINE_BIND_POINT_COMPUTE, system->update_pipeline);
+    vkCmdDispatchIndirect(command_buffer, system->dispatch.vk_buffer, 0);
+}
+
+void particle_system_draw(VulkanContext *context, ParticleSystem *system) {
+    if (!system->active) {
+        return;
+    }
+
+    particle_bind(context, system, VK_PIPELINE_BIND_POINT_GRAPHICS, system->draw_pipeline);
+    vkCmdDrawIndirect(context->current_renderer->command_buffer, system->counters.vk_buffer,
+                      offsetof(ParticleCounters, draw), 1, sizeof(VkDrawIndirectCommand));
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <std/defines.h>
+#include "vulkan_types.h"
+#include "buffer.h"
+
+// Invocations per workgroup of every particle compute shader
+#define PARTICLE_GROUP_SIZE 64
+// Longest simulation step, a stalled frame doesn't launch everything at once
+#define PARTICLE_MAX_STEP 0.1f
+
+typedef struct VulkanContext VulkanContext;
+
+typedef struct ParticleSettings {
+    // Particles alive at once at most, 0 turns the system off
+    u32 capacity;
+    // Particles per second, emission pauses while every slot is alive
+    float emit_rate;
+    // Seconds
+    float lifetime;
+    float origin[3];
+    // Launch speed, directions are spread over the upper hemisphere
+    float speed;
+    // World space edge length of the billboards
+    float size;
+} ParticleSettings;
+
+// Mirrors ParticleFrame in shaders/particles.glsl
+typedef struct ParticleFrame {
+    float view_projection[16];
+    // xyz: emitter origin, w: launch speed
+    float origin[4];
+    // xy: clip space size of one world unit at unit depth, z: billboard size, w: time step
+    float billboard[4];
+    // x: lifetime, y: gravity, z: drag
+    float motion[4];
+    // x: requested emissions, y: random seed
+    u32 emit[4];
+} ParticleFrame;
+
+// Starts with the BindlessDrawConstants fields so the bindless helpers work unchanged
+typedef struct ParticleConstants {
+    u32 material_buffer;
+    u32 material_index;
+    u32 texture_table;
+    u32 positions;
+    u32 velocities;
+    u32 colors;
+    u32 alive;
+    u32 next_alive;
+    u32 dead;
+    u32 counters;
+    u32 dispatch;
+    u32 capacity;
+} ParticleConstants;
+
+// Where the arrays of one system live in its state buffer, each one a bindless storage buffer
+typedef enum ParticleArray {
+    // xyz: position, w: age
+    PARTICLE_ARRAY_POSITIONS,
+    // xyz: velocity, w: lifetime
+    PARTICLE_ARRAY_VELOCITIES,
+    PARTICLE_ARRAY_COLORS,
+    // Alive lists swap every frame, update compacts the survivors of one into the other
+    PARTICLE_ARRAY_ALIVE_0,
+    PARTICLE_ARRAY_ALIVE_1,
+    PARTICLE_ARRAY_DEAD,
+    PARTICLE_ARRAY_MAX
+} ParticleArray;
+
+// Mirrors ParticleCounters in shaders/particles.glsl, draw is a VkDrawIndirectCommand
+typedef struct ParticleCounters {
+    u32 alive_count;
+    u32 dead_count;
+    u32 emit_count;
+    // First alive list entry of this frame's emissions
+    u32 emit_base;
+    u32 draw[4];
+} ParticleCounters;
+
+// Simulated entirely on the GPU: begin turns last frame's counts into this frame's emission and indirect arguments,
+// emit takes slots off the dead list and update integrates the alive list, compacting survivors into the next one.
+// The draw reads the survivor count straight from the counters buffer, nothing is read back.
+typedef struct ParticleSystem {
+    ParticleSettings settings;
+
+    VkPipelineLayout layout;
+    VkPipeline begin_pipeline;
+    VkPipeline emit_pipeline;
+    VkPipeline update_pipeline;
+    VkPipeline draw_pipeline;
+
+    // Structure of arrays, see ParticleArray
+    Buffer state;
+    u32 arrays[PARTICLE_ARRAY_MAX];
+    // ParticleCounters, read back by nothing but the indirect draw
+    Buffer counters;
+    u32 counters_handle;
+    // VkDispatchIndirectCommand of the update pass
+    Buffer dispatch;
+    u32 dispatch_handle;
+
+    // Render thread only, set per frame by particle_system_update. Without its frame constants nothing runs.
+    bool active;
+    u32 frame;
+    u32 emit_request;
+    float emit_carry;
+    u64 last_update;
+    u32 frame_offset;
+} ParticleSystem;
+
+bool particle_system_create(VulkanContext *context, ParticleSystem *out);
+
+void particle_system_destroy(VulkanContext *context, ParticleSystem *system);
+
+// Reallocates the state for the new capacity and starts over with every particle dead. The device has to be idle.
+bool particle_system_configure(VulkanContext *context, ParticleSystem *system, const ParticleSettings *settings);
+
+// Once per frame before the graph runs: steps time, decides the emissions and uploads the frame constants
+void particle_system_update(VulkanContext *context, ParticleSystem *system, const float *view_projection);
+
+// Render graph passes, one compute dispatch each so the graph places the barriers between them. data is the system.
+void particle_system_begin_pass(VulkanContext *context, VkCommandBuffer command_buffer, void *data);
+
+void particle_system_emit_pass(VulkanContext *context, VkCommandBuffer command_buffer, void *data);
+
+void particle_system_update_pass(VulkanContext *context, VkCommandBuffer command_buffer, void *data);
+
+// Camera facing quads for the survivors, inside the render pass
+void particle_system_draw(VulkanContext *context, ParticleSystem *system);
@@ -1,9 +1,10 @@
 #include <string.h>
 #include <std/containers/darray.h>
-#include <std/core/logger.h>
+#include "core/log.h"
 #include <std/core/memory.h>
 #include "vulkan_types.h"
 #include "physical_device.h"
+#include "core/arena.h"
 
 u16 priority(PhysicalDevice *device) {
     switch (device->properties.deviceType) {
@@ -22,13 +23,21 @@ u16 priority(PhysicalDevice *device) {
     }
 }
 
-PhysicalDevice *query_physical_devices(VkInstance instance) {
+u16 device_priority(PhysicalDevice *device, bool prefer_software) {
+    if (prefer_software && device->properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU) {
+        return UINT16_MAX;
+    }
+    return priority(device);
+}
+
+PhysicalDevice *query_physical_devices(VkInstance instance, Arena *scratch, u32 *out_count) {
     u32 deviceCount = 0;
     VK_CHECK(vkEnumeratePhysicalDevices(instance, &deviceCount, 0))
-    VkPhysicalDevice *devices = darray_reserve(VkPhysicalDevice, deviceCount);
+    VkPhysicalDevice *devices = arena_alloc_array(scratch, VkPhysicalDevice, deviceCount);
     VK_CHECK(vkEnumeratePhysicalDevices(instance, &deviceCount, devices))
 
-    PhysicalDevice *all = darray_reserve(PhysicalDevice, deviceCount);
+    PhysicalDevice *all = arena_alloc_array(scratch, PhysicalDevice, deviceCount);
+    memset(all, 0, sizeof(PhysicalDevice) * deviceCount);
     for (u32 i = 0; i < deviceCount; ++i) {
         VkPhysicalDeviceProperties properties;
         vkGetPhysicalDeviceProperties(devices[i], &properties);
@@ -40,61 +49,132 @@ PhysicalDevice *query_physical_devices(VkInstance instance) {
                  properties.vendorID, properties.deviceName);
     }
 
-    darray_destroy(devices)
+    *out_count = deviceCount;
     return all;
 }
 
-const char **query_available_device_extensions(PhysicalDevice *physical_device) {
+VkExtensionProperties *query_available_device_extensions(PhysicalDevice *physical_device) {
     u32 count = 0;
     VK_CHECK(vkEnumerateDeviceExtensionProperties(physical_device->device, NULL, &count, NULL));
     VkExtensionProperties *properties = darray_reserve(VkExtensionProperties, count);
     VK_CHECK(vkEnumerateDeviceExtensionProperties(physical_device->device, NULL, &count, properties));
 
-    const char **names = darray_reserve(const char *, count);
     for (int i = 0; i < count; ++i) {
         LOG_INFO("Found supported device extension: %s", properties[i].extensionName);
-        names[i] = properties[i].extensionName;
     }
 
-    darray_destroy(properties);
-    return names;
+    return properties;
 }
 
-bool physical_device_select_best(VkInstance instance, PhysicalDevice *out) {
+void query_device_features(PhysicalDevice *physical_device) {
+    VkPhysicalDeviceVulkan12Properties properties_12 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES};
+    VkPhysicalDeviceProperties2 properties = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
+    properties.pNext = &properties_12;
+    vkGetPhysicalDeviceProperties2(physical_device->device, &properties);
+
+    VkPhysicalDeviceVulkan12Features features_12 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+    VkPhysicalDeviceFeatures2 features = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+    features.pNext = &features_12;
+
+    void **next = &features_12.pNext;
+    VkPhysicalDeviceVulkan13Features features_13 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES};
+    if (physical_device->properties.apiVersion >= VK_API_VERSION_1_3) {
+        *next = &features_13;
+        next = &features_13.pNext;
+    }
+
+    VkPhysicalDeviceMeshShaderFeaturesEXT mesh_shader_features = {
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT};
+    if (physical_device_is_extension_available(physical_device, VK_EXT_MESH_SHADER_EXTENSION_NAME)) {
+        *next = &mesh_shader_features;
+        next = &mesh_shader_features.pNext;
+    }
+
+    VkPhysicalDevicePresentIdFeaturesKHR present_id_features = {
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR};
+    VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features = {
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR};
+    if (physical_device_is_extension_available(physical_device, VK_KHR_PRESENT_ID_EXTENSION_NAME)) {
+        *next = &present_id_features;
+        next = &present_id_features.pNext;
+    }
+    if (physical_device_is_extension_available(physical_device, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+        *next = &present_wait_features;
+        next = &present_wait_features.pNext;
+    }
+    vkGetPhysicalDeviceFeatures2(physical_device->device, &features);
+
+    // The chains point at stack memory, don't keep them around
+    properties_12.pNext = NULL;
+    features_12.pNext = NULL;
+    features_13.pNext = NULL;
+    mesh_shader_features.pNext = NULL;
+    present_id_features.pNext = NULL;
+    present_wait_features.pNext = NULL;
+
+    physical_device->properties_12 = properties_12;
+    physical_device->features = features.features;
+    physical_device->features_12 = features_12;
+    physical_device->features_13 = features_13;
+    physical_device->mesh_shader_features = mesh_shader_features;
+    physical_device->present_id_features = present_id_features;
+    physical_device->present_wait_features = present_wait_features;
+    vkGetPhysicalDeviceMemoryProperties(physical_device->device, &physical_device->memory_properties);
+}
+
+bool physical_device_select_best(VkInstance instance, bool prefer_software, PhysicalDevice *out) {
     LOG_INFO("Querying physical devices...");
-    PhysicalDevice *all = query_physical_devices(instance);
+    ArenaScope scratch = scratch_begin();
+    u32 count = 0;
+    PhysicalDevice *all = query_physical_devices(instance, scratch.arena, &count);
     PhysicalDevice *selected_device = NULL;
-    for (int i = 0; i < darray_length(all); ++i) {
-        if (selected_device == NULL || priority(&all[i]) > priority(selected_device)) {
+    for (u32 i = 0; i < count; ++i) {
+        if (selected_device == NULL ||
+            device_priority(&all[i], prefer_software) > device_priority(selected_device, prefer_software)) {
             selected_device = &all[i];
         }
     }
 
     if (selected_device == NULL) {
         LOG_ERROR("Couldn't find a suitable physical device.");
+        scratch_end(scratch);
         return false;
     }
 
     memory_copy(out, selected_device, sizeof(PhysicalDevice));
     out->available_extensions = query_available_device_extensions(out);
+    query_device_features(out);
 
     LOG_INFO("Selected physical device %s:  %d - %s",
              string_VkPhysicalDeviceType(selected_device->properties.deviceType),
              selected_device->properties.vendorID, selected_device->properties.deviceName);
 
-    darray_destroy(all)
+    scratch_end(scratch);
     return true;
 }
 
 bool physical_device_is_extension_available(PhysicalDevice *physical_device, const char *name) {
     for (int i = 0; i < darray_length(physical_device->available_extensions); ++i) {
-        if (strcmp(name, physical_device->available_extensions[i]) == 0) {
+        if (strcmp(name, physical_device->available_extensions[i].extensionName) == 0) {
             return true;
         }
     }
     return false;
 }
 
+bool physical_device_find_memory_type(PhysicalDevice *physical_device, u32 type_bits, VkMemoryPropertyFlags properties,
+                                      u32 *out) {
+    VkPhysicalDeviceMemoryProperties *memory = &physical_device->memory_properties;
+    for (u32 i = 0; i < memory->memoryTypeCount; ++i) {
+        if ((type_bits & (1 << i)) && (memory->memoryTypes[i].propertyFlags & properties) == properties) {
+            *out = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void physical_device_destroy(PhysicalDevice *physical_device) {
     if (physical_device->available_extensions) {
         darray_destroy(physical_device->available_extensions);
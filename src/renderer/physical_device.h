@@ -6,13 +6,28 @@
 typedef struct PhysicalDevice {
     VkPhysicalDevice device;
     VkPhysicalDeviceProperties properties;
+    VkPhysicalDeviceVulkan12Properties properties_12;
+    VkPhysicalDeviceFeatures features;
+    VkPhysicalDeviceVulkan12Features features_12;
+    // Only queried on Vulkan 1.3 devices
+    VkPhysicalDeviceVulkan13Features features_13;
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    // Only queried when VK_EXT_mesh_shader is available
+    VkPhysicalDeviceMeshShaderFeaturesEXT mesh_shader_features;
+    // Only queried when VK_KHR_present_id and VK_KHR_present_wait are available
+    VkPhysicalDevicePresentIdFeaturesKHR present_id_features;
+    VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features;
 
-    const char **available_extensions;
+    VkExtensionProperties *available_extensions;
 } PhysicalDevice;
 
-bool physical_device_select_best(VkInstance instance, PhysicalDevice *out);
+// prefer_software picks a CPU implementation such as lavapipe over any GPU when one is installed
+bool physical_device_select_best(VkInstance instance, bool prefer_software, PhysicalDevice *out);
 
 bool physical_device_is_extension_available(PhysicalDevice *physical_device, const char *name);
 
+bool physical_device_find_memory_type(PhysicalDevice *physical_device, u32 type_bits, VkMemoryPropertyFlags properties,
+                                      u32 *out);
+
 void physical_device_destroy(PhysicalDevice *physical_device);
 
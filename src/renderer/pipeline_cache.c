@@ -0,0 +1,78 @@
+#include "pipeline_cache.h"
+#include "host_allocator.h"
+#include "core/log.h"
+#include "core/mapped_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Drivers reject foreign data themselves, but not all of them gracefully, so the header is checked first
+bool pipeline_cache_compatible(PhysicalDevice *physical_device, const MappedFile *file) {
+    VkPipelineCacheHeaderVersionOne header;
+    if (file->size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, file->data, sizeof(header));
+
+    VkPhysicalDeviceProperties *properties = &physical_device->properties;
+    return header.headerSize >= sizeof(header) && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header.vendorID == properties->vendorID && header.deviceID == properties->deviceID &&
+           memcmp(header.pipelineCacheUUID, properties->pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+bool pipeline_cache_create(PhysicalDevice *physical_device, Device *device, const char *path, VkPipelineCache *out) {
+    VkPipelineCacheCreateInfo create_info = {VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+    MappedFile file = {0};
+    bool loaded = mapped_file_open(path, &file);
+    if (loaded && pipeline_cache_compatible(physical_device, &file)) {
+        create_info.initialDataSize = file.size;
+        create_info.pInitialData = file.data;
+    } else if (loaded) {
+        LOG_INFO("Pipeline cache %s is from another driver or device, starting empty", path);
+    }
+
+    VkResult result = vkCreatePipelineCache(device->vk_device, &create_info, host_allocator(), out);
+    if (result != VK_SUCCESS && create_info.initialDataSize > 0) {
+        LOG_WARN("Driver rejected the pipeline cache %s, starting empty", path);
+        create_info.initialDataSize = 0;
+        create_info.pInitialData = NULL;
+        result = vkCreatePipelineCache(device->vk_device, &create_info, host_allocator(), out);
+    }
+
+    if (loaded) {
+        mapped_file_close(&file);
+    }
+    if (result != VK_SUCCESS) {
+        LOG_ERROR("Couldn't create the pipeline cache!");
+        *out = VK_NULL_HANDLE;
+        return false;
+    }
+    return true;
+}
+
+bool pipeline_cache_save(Device *device, VkPipelineCache cache, const char *path) {
+    size_t size = 0;
+    if (cache == VK_NULL_HANDLE || vkGetPipelineCacheData(device->vk_device, cache, &size, NULL) != VK_SUCCESS ||
+        size == 0) {
+        return false;
+    }
+
+    void *data = malloc(size);
+    bool saved = vkGetPipelineCacheData(device->vk_device, cache, &size, data) == VK_SUCCESS;
+    FILE *file = saved ? fopen(path, "wb") : NULL;
+    saved = file != NULL && fwrite(data, 1, size, file) == size;
+    if (file != NULL) {
+        saved = fclose(file) == 0 && saved;
+    }
+    free(data);
+
+    if (!saved) {
+        LOG_WARN("Couldn't save the pipeline cache to %s", path);
+    }
+    return saved;
+}
+
+void pipeline_cache_destroy(Device *device, VkPipelineCache cache) {
+    vkDestroyPipelineCache(device->vk_device, cache, host_allocator());
+}
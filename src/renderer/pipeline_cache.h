@@ -0,0 +1,17 @@
+#pragma once
+
+#include <std/defines.h>
+#include "vulkan_types.h"
+#include "device.h"
+#include "physical_device.h"
+
+// Next to the executable's working directory like the compiled shaders
+#define PIPELINE_CACHE_PATH "pipeline_cache.bin"
+
+// Starts from the cache saved at path when it was written by the same driver and device, empty otherwise
+bool pipeline_cache_create(PhysicalDevice *physical_device, Device *device, const char *path, VkPipelineCache *out);
+
+// Writes what the driver has cached so far, the next run creates its pipelines from it
+bool pipeline_cache_save(Device *device, VkPipelineCache cache, const char *path);
+
+void pipeline_cache_destroy(Device *device, VkPipelineCache cache);
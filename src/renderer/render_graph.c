@@ -0,0 +1,693 @@
+#include "render_graph.h"
+#include "host_allocator.h"
+
+#include <string.h>
+
+typedef struct RenderGraphAccessInfo {
+    // 0 takes the shader stages of the pass
+    VkPipelineStageFlags2 stages;
+    VkAccessFlags2 access;
+    VkImageLayout layout;
+    bool write;
+} RenderGraphAccessInfo;
+
+static const RenderGraphAccessInfo render_graph_access_info[RENDER_GRAPH_ACCESS_MAX] = {
+        [RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT] = {
+                VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true},
+        [RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT] = {
+                VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true},
+        [RENDER_GRAPH_ACCESS_SAMPLED] = {
+                0, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false},
+        [RENDER_GRAPH_ACCESS_STORAGE_READ] = {
+                0, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false},
+        [RENDER_GRAPH_ACCESS_STORAGE_WRITE] = {
+                0, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true},
+        [RENDER_GRAPH_ACCESS_INDIRECT] = {
+                VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT,
+                VK_IMAGE_LAYOUT_UNDEFINED, false},
+        [RENDER_GRAPH_ACCESS_TRANSFER_READ] = {
+                VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false},
+        [RENDER_GRAPH_ACCESS_TRANSFER_WRITE] = {
+                VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true},
+};
+
+// What the barriers planned so far leave a resource in
+typedef struct RenderGraphState {
+    // Last write or layout transition
+    VkPipelineStageFlags2 stages;
+    VkAccessFlags2 access;
+    // Reads already made visible since then
+    VkPipelineStageFlags2 read_stages;
+    VkAccessFlags2 read_access;
+    VkImageLayout layout;
+    bool used;
+} RenderGraphState;
+
+void render_graph_reset(Device *device, RenderGraph *graph) {
+    for (u32 i = 0; i < graph->resource_count; ++i) {
+        RenderGraphResource *resource = &graph->resources[i];
+        if (resource->imported) {
+            continue;
+        }
+
+        if (resource->view != NULL) {
+            vkDestroyImageView(device->vk_device, resource->view, host_allocator());
+        }
+        if (resource->vk_image != NULL) {
+            vkDestroyImage(device->vk_device, resource->vk_image, host_allocator());
+        }
+        if (resource->vk_buffer != NULL) {
+            vkDestroyBuffer(device->vk_device, resource->vk_buffer, host_allocator());
+        }
+    }
+
+    for (u32 i = 0; i < graph->memory_count; ++i) {
+        vkFreeMemory(device->vk_device, graph->memory[i], host_allocator());
+    }
+
+    memset(graph, 0, sizeof(RenderGraph));
+}
+
+void render_graph_destroy(Device *device, RenderGraph *graph) {
+    render_graph_reset(device, graph);
+}
+
+RenderGraphResource *render_graph_add_resource(RenderGraph *graph, const char *name, RenderGraphResourceType type,
+                                               u32 *out_index) {
+    if (graph->compiled) {
+        LOG_ERROR("Render graph is already compiled, can't add %s", name);
+        return NULL;
+    }
+    if (graph->resource_count >= RENDER_GRAPH_MAX_RESOURCES) {
+        LOG_ERROR("Render graph resource limit reached, can't add %s", name);
+        return NULL;
+    }
+
+    *out_index = graph->resource_count++;
+    RenderGraphResource *resource = &graph->resources[*out_index];
+    resource->name = name;
+    resource->type = type;
+    resource->first_pass = RENDER_GRAPH_INVALID;
+    resource->last_pass = RENDER_GRAPH_INVALID;
+    return resource;
+}
+
+u32 render_graph_import_image(RenderGraph *graph, const char *name, VkImageAspectFlags aspect,
+                              VkImageLayout initial_layout, VkPipelineStageFlags2 initial_stages,
+                              VkImageLayout final_layout) {
+    u32 index;
+    RenderGraphResource *resource = render_graph_add_resource(graph, name, RENDER_GRAPH_RESOURCE_IMAGE, &index);
+    if (resource == NULL) {
+        return RENDER_GRAPH_INVALID;
+    }
+
+    resource->imported = true;
+    resource->image.aspect = aspect;
+    resource->initial_layout = initial_layout;
+    resource->initial_stages = initial_stages;
+    resource->final_layout = final_layout;
+    return index;
+}
+
+u32 render_graph_import_buffer(RenderGraph *graph, const char *name, VkPipelineStageFlags2 initial_stages) {
+    u32 index;
+    RenderGraphResource *resource = render_graph_add_resource(graph, name, RENDER_GRAPH_RESOURCE_BUFFER, &index);
+    if (resource == NULL) {
+        return RENDER_GRAPH_INVALID;
+    }
+
+    resource->imported = true;
+    resource->initial_stages = initial_stages;
+    return index;
+}
+
+u32 render_graph_create_image(RenderGraph *graph, const char *name, const RenderGraphImageDesc *desc) {
+    u32 index;
+    RenderGraphResource *resource = render_graph_add_resource(graph, name, RENDER_GRAPH_RESOURCE_IMAGE, &index);
+    if (resource == NULL) {
+        return RENDER_GRAPH_INVALID;
+    }
+
+    resource->image = *desc;
+    return index;
+}
+
+u32 render_graph_create_buffer(RenderGraph *graph, const char *name, const RenderGraphBufferDesc *desc) {
+    u32 index;
+    RenderGraphResource *resource = render_graph_add_resource(graph, name, RENDER_GRAPH_RESOURCE_BUFFER, &index);
+    if (resource == NULL) {
+        return RENDER_GRAPH_INVALID;
+    }
+
+    resource->buffer = *desc;
+    return index;
+}
+
+void render_graph_mark_output(RenderGraph *graph, u32 resource) {
+    if (resource < graph->resource_count) {
+        graph->resources[resource].output = true;
+    }
+}
+
+void render_graph_set_image(RenderGraph *graph, u32 resource, VkImage image, VkImageView view) {
+    graph->resources[resource].vk_image = image;
+    graph->resources[resource].view = view;
+}
+
+void render_graph_set_buffer(RenderGraph *graph, u32 resource, VkBuffer buffer) {
+    graph->resources[resource].vk_buffer = buffer;
+}
+
+u32 render_graph_add_pass(RenderGraph *graph, const char *name, VkPipelineStageFlags2 shader_stages,
+                          RenderGraphPassFunction function, void *data) {
+    if (graph->compiled) {
+        LOG_ERROR("Render graph is already compiled, can't add pass %s", name);
+        return RENDER_GRAPH_INVALID;
+    }
+    if (graph->pass_count >= RENDER_GRAPH_MAX_PASSES) {
+        LOG_ERROR("Render graph pass limit reached, can't add %s", name);
+        return RENDER_GRAPH_INVALID;
+    }
+
+    RenderGraphPass *pass = &graph->passes[graph->pass_count];
+    pass->name = name;
+    pass->function = function;
+    pass->data = data;
+    pass->shader_stages = shader_stages;
+    return graph->pass_count++;
+}
+
+bool render_graph_use(RenderGraph *graph, u32 pass_index, u32 resource, RenderGraphAccess access) {
+    if (pass_index >= graph->pass_count || resource >= graph->resource_count) {
+        LOG_ERROR("Invalid render graph pass %u or resource %u", pass_index, resource);
+        return false;
+    }
+
+    RenderGraphPass *pass = &graph->passes[pass_index];
+    bool image = graph->resources[resource].type == RENDER_GRAPH_RESOURCE_IMAGE;
+    bool image_only = access == RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT ||
+                      access == RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT || access == RENDER_GRAPH_ACCESS_SAMPLED;
+    if ((image_only && !image) || (access == RENDER_GRAPH_ACCESS_INDIRECT && image)) {
+        LOG_ERROR("Pass %s can't use %s that way", pass->name, graph->resources[resource].name);
+        return false;
+    }
+
+    for (u32 i = 0; i < pass->use_count; ++i) {
+        if (pass->uses[i].resource == resource) {
+            LOG_ERROR("Pass %s uses %s twice", pass->name, graph->resources[resource].name);
+            return false;
+        }
+    }
+    if (pass->use_count >= RENDER_GRAPH_MAX_USES) {
+        LOG_ERROR("Pass %s uses too many resources", pass->name);
+        return false;
+    }
+
+    pass->uses[pass->use_count].resource = resource;
+    pass->uses[pass->use_count].access = access;
+    pass->use_count++;
+    return true;
+}
+
+void render_graph_side_effects(RenderGraph *graph, u32 pass) {
+    if (pass < graph->pass_count) {
+        graph->passes[pass].side_effects = true;
+    }
+}
+
+// Walks backwards from the outputs, a pass survives when something later reads what it writes. Writers stay needed
+// after a later write, attachments may be loaded rather than cleared.
+void render_graph_cull(RenderGraph *graph) {
+    u64 needed = 0;
+    for (u32 i = 0; i < graph->resource_count; ++i) {
+        if (graph->resources[i].output) {
+            needed |= 1ull << i;
+        }
+    }
+
+    for (u32 p = graph->pass_count; p-- > 0;) {
+        RenderGraphPass *pass = &graph->passes[p];
+        u64 reads = 0;
+        u64 writes = 0;
+        for (u32 i = 0; i < pass->use_count; ++i) {
+            u64 bit = 1ull << pass->uses[i].resource;
+            if (render_graph_access_info[pass->uses[i].access].write) {
+                writes |= bit;
+            } else {
+                reads |= bit;
+            }
+        }
+
+        pass->culled = !pass->side_effects && (writes & needed) == 0;
+        if (pass->culled) {
+            LOG_INFO("Render graph culled pass %s", pass->name);
+            continue;
+        }
+        needed |= reads;
+    }
+}
+
+bool render_graph_create_transient(PhysicalDevice *physical_device, Device *device, RenderGraphResource *resource) {
+    VkMemoryRequirements requirements;
+    if (resource->type == RENDER_GRAPH_RESOURCE_IMAGE) {
+        VkImageCreateInfo create_info = {VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+        create_info.imageType = VK_IMAGE_TYPE_2D;
+        create_info.format = resource->image.format;
+        create_info.extent.width = resource->image.extent.width;
+        create_info.extent.height = resource->image.extent.height;
+        create_info.extent.depth = 1;
+        create_info.mipLevels = 1;
+        create_info.arrayLayers = 1;
+        create_info.samples = resource->image.samples != 0 ? resource->image.samples : VK_SAMPLE_COUNT_1_BIT;
+        create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        create_info.usage = resource->image.usage;
+        create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VK_CHECK(vkCreateImage(device->vk_device, &create_info, host_allocator(), &resource->vk_image));
+        vkGetImageMemoryRequirements(device->vk_device, resource->vk_image, &requirements);
+    } else {
+        VkBufferCreateInfo create_info = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+        create_info.size = resource->buffer.size;
+        create_info.usage = resource->buffer.usage;
+        create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        VK_CHECK(vkCreateBuffer(device->vk_device, &create_info, host_allocator(), &resource->vk_buffer));
+        vkGetBufferMemoryRequirements(device->vk_device, resource->vk_buffer, &requirements);
+    }
+
+    if (!physical_device_find_memory_type(physical_device, requirements.memoryTypeBits,
+                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &resource->memory_type)) {
+        LOG_ERROR("No device local memory for render graph resource %s", resource->name);
+        return false;
+    }
+
+    // Buffers and optimal images sharing memory must sit on separate granularity pages
+    VkDeviceSize granularity = physical_device->properties.limits.bufferImageGranularity;
+    resource->size = requirements.size;
+    resource->alignment = requirements.alignment > granularity ? requirements.alignment : granularity;
+    return true;
+}
+
+bool render_graph_lifetimes_overlap(const RenderGraphResource *a, const RenderGraphResource *b) {
+    return a->first_pass <= b->last_pass && b->first_pass <= a->last_pass;
+}
+
+bool render_graph_memory_overlaps(const RenderGraphResource *a, const RenderGraphResource *b) {
+    return a->memory_type == b->memory_type && a->offset < b->offset + b->size && b->offset < a->offset + a->size;
+}
+
+// First fit below everything placed that is alive at the same time, larger resources are placed first
+void render_graph_place(RenderGraph *graph, const u32 *placed, u32 placed_count, RenderGraphResource *resource) {
+    resource->offset = 0;
+    bool moved = true;
+    while (moved) {
+        moved = false;
+        for (u32 i = 0; i < placed_count; ++i) {
+            RenderGraphResource *other = &graph->resources[placed[i]];
+            if (!render_graph_lifetimes_overlap(resource, other) || !render_graph_memory_overlaps(resource, other)) {
+                continue;
+            }
+
+            VkDeviceSize end = other->offset + other->size;
+            resource->offset = (end + resource->alignment - 1) / resource->alignment * resource->alignment;
+            moved = true;
+        }
+    }
+}
+
+bool render_graph_allocate_transients(PhysicalDevice *physical_device, Device *device, RenderGraph *graph) {
+    u32 order[RENDER_GRAPH_MAX_RESOURCES];
+    u32 count = 0;
+    for (u32 i = 0; i < graph->resource_count; ++i) {
+        RenderGraphResource *resource = &graph->resources[i];
+        if (resource->imported || resource->first_pass == RENDER_GRAPH_INVALID) {
+            continue;
+        }
+        if (!render_graph_create_transient(physical_device, device, resource)) {
+            return false;
+        }
+
+        // Insertion sort by size, largest first
+        u32 j = count++;
+        while (j > 0 && graph->resources[order[j - 1]].size < resource->size) {
+            order[j] = order[j - 1];
+            --j;
+        }
+        order[j] = i;
+        graph->transient_bytes += resource->size;
+    }
+
+    for (u32 i = 0; i < count; ++i) {
+        render_graph_place(graph, order, i, &graph->resources[order[i]]);
+    }
+
+    // One allocation per memory type, sized to the highest placed end
+    for (u32 i = 0; i < count; ++i) {
+        RenderGraphResource *resource = &graph->resources[order[i]];
+        u32 memory = RENDER_GRAPH_INVALID;
+        VkDeviceSize size = 0;
+        for (u32 j = 0; j < count; ++j) {
+            RenderGraphResource *other = &graph->resources[order[j]];
+            if (other->memory_type != resource->memory_type) {
+                continue;
+            }
+            if (j < i) {
+                memory = other->memory;
+                break;
+            }
+            VkDeviceSize end = other->offset + other->size;
+            size = end > size ? end : size;
+        }
+
+        if (memory == RENDER_GRAPH_INVALID) {
+            VkMemoryAllocateInfo allocate_info = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+            allocate_info.allocationSize = size;
+            allocate_info.memoryTypeIndex = resource->memory_type;
+            memory = graph->memory_count++;
+            VK_CHECK(vkAllocateMemory(device->vk_device, &allocate_info, host_allocator(), &graph->memory[memory]));
+            graph->allocated_bytes += size;
+        }
+        resource->memory = memory;
+
+        if (resource->type == RENDER_GRAPH_RESOURCE_IMAGE) {
+            VK_CHECK(vkBindImageMemory(device->vk_device, resource->vk_image, graph->memory[memory],
+                                       resource->offset));
+
+            VkImageViewCreateInfo view_create_info = {VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+            view_create_info.image = resource->vk_image;
+            view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            view_create_info.format = resource->image.format;
+            view_create_info.subresourceRange.aspectMask = resource->image.aspect;
+            view_create_info.subresourceRange.levelCount = 1;
+            view_create_info.subresourceRange.layerCount = 1;
+            VK_CHECK(vkCreateImageView(device->vk_device, &view_create_info, host_allocator(), &resource->view));
+        } else {
+            VK_CHECK(vkBindBufferMemory(device->vk_device, resource->vk_buffer, graph->memory[memory],
+                                        resource->offset));
+        }
+    }
+
+    for (u32 i = 0; i < count; ++i) {
+        RenderGraphResource *resource = &graph->resources[order[i]];
+        for (u32 j = 0; j < count; ++j) {
+            RenderGraphResource *other = &graph->resources[order[j]];
+            if (other->last_pass < resource->first_pass && render_graph_memory_overlaps(resource, other)) {
+                resource->aliases |= 1ull << order[j];
+            }
+        }
+    }
+
+    return true;
+}
+
+bool render_graph_add_barrier(RenderGraph *graph, const RenderGraphBarrier *barrier) {
+    if (graph->barrier_count >= RENDER_GRAPH_MAX_BARRIERS) {
+        LOG_ERROR("Render graph barrier limit reached");
+        return false;
+    }
+    graph->barriers[graph->barrier_count++] = *barrier;
+    return true;
+}
+
+// Plans the barrier in front of one use: reads of data that is already visible in their stage need none, writes and
+// layout changes wait for the last write and every read since
+bool render_graph_plan_use(RenderGraph *graph, RenderGraphState *states, const RenderGraphPass *pass,
+                           const RenderGraphUse *use) {
+    RenderGraphResource *resource = &graph->resources[use->resource];
+    RenderGraphState *state = &states[use->resource];
+    const RenderGraphAccessInfo *info = &render_graph_access_info[use->access];
+    bool image = resource->type == RENDER_GRAPH_RESOURCE_IMAGE;
+
+    RenderGraphBarrier barrier = {
+            .resource = use->resource,
+            .dst_stages = info->stages != 0 ? info->stages : pass->shader_stages,
+            .dst_access = info->access,
+            .old_layout = state->layout,
+            .new_layout = image ? info->layout : VK_IMAGE_LAYOUT_UNDEFINED
+    };
+
+    bool needed;
+    if (!resource->imported && !state->used) {
+        // Whatever lived in this memory before is discarded, but its last accesses have to finish first
+        for (u32 i = 0; i < graph->resource_count; ++i) {
+            if (resource->aliases & (1ull << i)) {
+                barrier.src_stages |= states[i].stages | states[i].read_stages;
+                barrier.src_access |= states[i].access;
+            }
+        }
+        barrier.old_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        needed = image || barrier.src_stages != 0;
+    } else if (!info->write && barrier.new_layout == state->layout) {
+        bool visible = (state->read_stages & barrier.dst_stages) == barrier.dst_stages &&
+                       (state->read_access & barrier.dst_access) == barrier.dst_access;
+        barrier.src_stages = state->stages;
+        barrier.src_access = state->access;
+        needed = !visible && (state->stages != 0 || state->access != 0);
+    } else {
+        barrier.src_stages = state->stages | state->read_stages;
+        barrier.src_access = state->access;
+        needed = barrier.old_layout != barrier.new_layout || barrier.src_stages != 0;
+    }
+
+    if (needed && !render_graph_add_barrier(graph, &barrier)) {
+        return false;
+    }
+
+    if (info->write || barrier.new_layout != state->layout || !state->used) {
+        // Writes and transitions start a new state, a transition for reading already made them visible
+        state->stages = barrier.dst_stages;
+        state->access = info->write ? info->access : 0;
+        state->read_stages = info->write ? 0 : barrier.dst_stages;
+        state->read_access = info->write ? 0 : barrier.dst_access;
+        state->layout = barrier.new_layout;
+    } else {
+        state->read_stages |= barrier.dst_stages;
+        state->read_access |= barrier.dst_access;
+    }
+    state->used = true;
+    return true;
+}
+
+bool render_graph_plan_barriers(RenderGraph *graph) {
+    RenderGraphState states[RENDER_GRAPH_MAX_RESOURCES] = {0};
+    for (u32 i = 0; i < graph->resource_count; ++i) {
+        RenderGraphResource *resource = &graph->resources[i];
+        if (resource->imported) {
+            states[i].layout = resource->initial_layout;
+            states[i].stages = resource->initial_stages;
+            states[i].used = true;
+        }
+    }
+
+    for (u32 p = 0; p < graph->pass_count; ++p) {
+        RenderGraphPass *pass = &graph->passes[p];
+        pass->first_barrier = graph->barrier_count;
+        if (pass->culled) {
+            continue;
+        }
+
+        for (u32 i = 0; i < pass->use_count; ++i) {
+            if (!render_graph_plan_use(graph, states, pass, &pass->uses[i])) {
+                return false;
+            }
+        }
+        pass->barrier_count = graph->barrier_count - pass->first_barrier;
+    }
+
+    graph->final_barrier = graph->barrier_count;
+    for (u32 i = 0; i < graph->resource_count; ++i) {
+        RenderGraphResource *resource = &graph->resources[i];
+        RenderGraphState *state = &states[i];
+        if (!resource->imported || resource->final_layout == VK_IMAGE_LAYOUT_UNDEFINED ||
+            resource->final_layout == state->layout) {
+            continue;
+        }
+
+        RenderGraphBarrier barrier = {
+                .resource = i,
+                .src_stages = state->stages | state->read_stages,
+                .src_access = state->access,
+                .dst_stages = VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT,
+                .old_layout = state->layout,
+                .new_layout = resource->final_layout
+        };
+        if (!render_graph_add_barrier(graph, &barrier)) {
+            return false;
+        }
+    }
+    graph->final_barrier_count = graph->barrier_count - graph->final_barrier;
+    return true;
+}
+
+bool render_graph_compile(PhysicalDevice *physical_device, Device *device, RenderGraph *graph) {
+    if (graph->compiled) {
+        return true;
+    }
+    graph->synchronization2 = device->synchronization2;
+
+    render_graph_cull(graph);
+    for (u32 p = 0; p < graph->pass_count; ++p) {
+        RenderGraphPass *pass = &graph->passes[p];
+        if (pass->culled) {
+            continue;
+        }
+
+        for (u32 i = 0; i < pass->use_count; ++i) {
+            RenderGraphResource *resource = &graph->resources[pass->uses[i].resource];
+            if (resource->first_pass == RENDER_GRAPH_INVALID) {
+                resource->first_pass = p;
+            }
+            resource->last_pass = p;
+        }
+    }
+
+    if (!render_graph_allocate_transients(physical_device, device, graph) || !render_graph_plan_barriers(graph)) {
+        LOG_ERROR("Couldn't compile the render graph!");
+        return false;
+    }
+
+    u32 culled = 0;
+    for (u32 p = 0; p < graph->pass_count; ++p) {
+        culled += graph->passes[p].culled;
+    }
+    LOG_INFO("Render graph compiled: %u passes, %u culled, %u barriers, %llu KiB transient memory in %llu KiB",
+             graph->pass_count, culled, graph->barrier_count, (unsigned long long) (graph->transient_bytes >> 10),
+             (unsigned long long) (graph->allocated_bytes >> 10));
+    graph->compiled = true;
+    return true;
+}
+
+VkImageSubresourceRange render_graph_subresources(const RenderGraphResource *resource) {
+    VkImageSubresourceRange range = {0};
+    range.aspectMask = resource->image.aspect;
+    range.levelCount = VK_REMAINING_MIP_LEVELS;
+    range.layerCount = VK_REMAINING_ARRAY_LAYERS;
+    return range;
+}
+
+// Without synchronization2 the barriers share one pair of stage masks, the planned stage and access bits all have
+// the same values in both APIs
+void render_graph_barriers_legacy(RenderGraph *graph, VkCommandBuffer command_buffer, u32 first, u32 count) {
+    VkImageMemoryBarrier images[RENDER_GRAPH_MAX_RESOURCES];
+    VkBufferMemoryBarrier buffers[RENDER_GRAPH_MAX_RESOURCES];
+    u32 image_count = 0;
+    u32 buffer_count = 0;
+    VkPipelineStageFlags src_stages = 0;
+    VkPipelineStageFlags dst_stages = 0;
+
+    for (u32 i = first; i < first + count; ++i) {
+        const RenderGraphBarrier *barrier = &graph->barriers[i];
+        const RenderGraphResource *resource = &graph->resources[barrier->resource];
+        src_stages |= (VkPipelineStageFlags) barrier->src_stages;
+        dst_stages |= (VkPipelineStageFlags) barrier->dst_stages;
+
+        if (resource->type == RENDER_GRAPH_RESOURCE_IMAGE) {
+            VkImageMemoryBarrier *image = &images[image_count++];
+            *image = (VkImageMemoryBarrier) {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+            image->srcAccessMask = (VkAccessFlags) barrier->src_access;
+            image->dstAccessMask = (VkAccessFlags) barrier->dst_access;
+            image->oldLayout = barrier->old_layout;
+            image->newLayout = barrier->new_layout;
+            image->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            image->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            image->image = resource->vk_image;
+            image->subresourceRange = render_graph_subresources(resource);
+        } else {
+            VkBufferMemoryBarrier *buffer = &buffers[buffer_count++];
+            *buffer = (VkBufferMemoryBarrier) {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+            buffer->srcAccessMask = (VkAccessFlags) barrier->src_access;
+            buffer->dstAccessMask = (VkAccessFlags) barrier->dst_access;
+            buffer->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            buffer->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            buffer->buffer = resource->vk_buffer;
+            buffer->size = VK_WHOLE_SIZE;
+        }
+    }
+
+    src_stages = src_stages != 0 ? src_stages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    vkCmdPipelineBarrier(command_buffer, src_stages, dst_stages, 0, 0, NULL, buffer_count, buffers, image_count,
+                         images);
+}
+
+void render_graph_barriers(RenderGraph *graph, VkCommandBuffer command_buffer, u32 first, u32 count) {
+    if (count == 0) {
+        return;
+    }
+    if (!graph->synchronization2) {
+        render_graph_barriers_legacy(graph, command_buffer, first, count);
+        return;
+    }
+
+    VkImageMemoryBarrier2 images[RENDER_GRAPH_MAX_RESOURCES];
+    VkBufferMemoryBarrier2 buffers[RENDER_GRAPH_MAX_RESOURCES];
+    u32 image_count = 0;
+    u32 buffer_count = 0;
+
+    for (u32 i = first; i < first + count; ++i) {
+        const RenderGraphBarrier *barrier = &graph->barriers[i];
+        const RenderGraphResource *resource = &graph->resources[barrier->resource];
+        if (resource->type == RENDER_GRAPH_RESOURCE_IMAGE) {
+            VkImageMemoryBarrier2 *image = &images[image_count++];
+            *image = (VkImageMemoryBarrier2) {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+            image->srcStageMask = barrier->src_stages;
+            image->srcAccessMask = barrier->src_access;
+            image->dstStageMask = barrier->dst_stages;
+            image->dstAccessMask = barrier->dst_access;
+            image->oldLayout = barrier->old_layout;
+            image->newLayout = barrier->new_layout;
+            image->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            image->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            image->image = resource->vk_image;
+            image->subresourceRange = render_graph_subresources(resource);
+        } else {
+            VkBufferMemoryBarrier2 *buffer = &buffers[buffer_count++];
+            *buffer = (VkBufferMemoryBarrier2) {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2};
+            buffer->srcStageMask = barrier->src_stages;
+            buffer->srcAccessMask = barrier->src_access;
+            buffer->dstStageMask = barrier->dst_stages;
+            buffer->dstAccessMask = barrier->dst_access;
+            buffer->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            buffer->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            buffer->buffer = resource->vk_buffer;
+            buffer->size = VK_WHOLE_SIZE;
+        }
+    }
+
+    VkDependencyInfo dependency = {VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dependency.imageMemoryBarrierCount = image_count;
+    dependency.pImageMemoryBarriers = images;
+    dependency.bufferMemoryBarrierCount = buffer_count;
+    dependency.pBufferMemoryBarriers = buffers;
+    vkCmdPipelineBarrier2(command_buffer, &dependency);
+}
+
+void render_graph_set_timestamps(RenderGraph *graph, VkQueryPool pool, u32 first_timestamp) {
+    graph->timestamp_pool = pool;
+    graph->first_timestamp = first_timestamp;
+}
+
+void render_graph_execute(VulkanContext *context, RenderGraph *graph, VkCommandBuffer command_buffer) {
+    if (!graph->compiled) {
+        LOG_ERROR("Render graph executed before it was compiled");
+        return;
+    }
+
+    for (u32 p = 0; p < graph->pass_count; ++p) {
+        RenderGraphPass *pass = &graph->passes[p];
+        if (!pass->culled) {
+            render_graph_barriers(graph, command_buffer, pass->first_barrier, pass->barrier_count);
+            pass->function(context, command_buffer, pass->data);
+        }
+
+        if (graph->timestamp_pool != VK_NULL_HANDLE) {
+            vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, graph->timestamp_pool,
+                                graph->first_timestamp + p);
+        }
+    }
+    render_graph_barriers(graph, command_buffer, graph->final_barrier, graph->final_barrier_count);
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <std/defines.h>
+#include "vulkan_types.h"
+#include "physical_device.h"
+#include "device.h"
+
+// Limits of one graph, resources are tracked in 64 bit masks
+#define RENDER_GRAPH_MAX_PASSES 32
+#define RENDER_GRAPH_MAX_RESOURCES 64
+#define RENDER_GRAPH_MAX_USES 8
+#define RENDER_GRAPH_MAX_BARRIERS 256
+#define RENDER_GRAPH_INVALID UINT32_MAX
+
+typedef struct VulkanContext VulkanContext;
+
+typedef enum RenderGraphAccess {
+    RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT,
+    RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT,
+    // Shader accesses happen in the shader stages of the pass
+    RENDER_GRAPH_ACCESS_SAMPLED,
+    RENDER_GRAPH_ACCESS_STORAGE_READ,
+    // Read and write
+    RENDER_GRAPH_ACCESS_STORAGE_WRITE,
+    RENDER_GRAPH_ACCESS_INDIRECT,
+    RENDER_GRAPH_ACCESS_TRANSFER_READ,
+    RENDER_GRAPH_ACCESS_TRANSFER_WRITE,
+    RENDER_GRAPH_ACCESS_MAX
+} RenderGraphAccess;
+
+typedef enum RenderGraphResourceType {
+    RENDER_GRAPH_RESOURCE_IMAGE,
+    RENDER_GRAPH_RESOURCE_BUFFER,
+} RenderGraphResourceType;
+
+typedef struct RenderGraphImageDesc {
+    VkFormat format;
+    VkExtent2D extent;
+    VkSampleCountFlagBits samples;
+    VkImageUsageFlags usage;
+    VkImageAspectFlags aspect;
+} RenderGraphImageDesc;
+
+typedef struct RenderGraphBufferDesc {
+    VkDeviceSize size;
+    VkBufferUsageFlags usage;
+} RenderGraphBufferDesc;
+
+typedef struct RenderGraphResource {
+    const char *name;
+    RenderGraphResourceType type;
+    // Imported resources are owned elsewhere and set every frame, the others are transient and owned by the graph
+    bool imported;
+    // Keeps the passes writing it from being culled
+    bool output;
+    RenderGraphImageDesc image;
+    RenderGraphBufferDesc buffer;
+
+    VkImage vk_image;
+    VkImageView view;
+    VkBuffer vk_buffer;
+
+    // State of imported resources before the graph runs, and the layout images are left in
+    VkImageLayout initial_layout;
+    VkPipelineStageFlags2 initial_stages;
+    VkImageLayout final_layout;
+
+    // Transient placement, lifetimes are in pass indices
+    u32 memory;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    VkDeviceSize alignment;
+    u32 memory_type;
+    u32 first_pass;
+    u32 last_pass;
+    // Transient resources that used the same memory earlier in the frame
+    u64 aliases;
+} RenderGraphResource;
+
+typedef struct RenderGraphUse {
+    u32 resource;
+    RenderGraphAccess access;
+} RenderGraphUse;
+
+typedef struct RenderGraphBarrier {
+    u32 resource;
+    VkPipelineStageFlags2 src_stages;
+    VkAccessFlags2 src_access;
+    VkPipelineStageFlags2 dst_stages;
+    VkAccessFlags2 dst_access;
+    VkImageLayout old_layout;
+    VkImageLayout new_layout;
+} RenderGraphBarrier;
+
+// Records the pass into the frame's command buffer, barriers for its uses are already in place
+typedef void (*RenderGraphPassFunction)(VulkanContext *context, VkCommandBuffer command_buffer, void *data);
+
+typedef struct RenderGraphPass {
+    const char *name;
+    RenderGraphPassFunction function;
+    void *data;
+    // Stages shader accesses of this pass happen in
+    VkPipelineStageFlags2 shader_stages;
+    RenderGraphUse uses[RENDER_GRAPH_MAX_USES];
+    u32 use_count;
+    // Runs even when nothing reads what it writes
+    bool side_effects;
+    bool culled;
+
+    u32 first_barrier;
+    u32 barrier_count;
+} RenderGraphPass;
+
+// Passes run in the order they were added, compiling culls them and plans barriers and transient memory once so
+// executing a frame only records
+typedef struct RenderGraph {
+    RenderGraphPass passes[RENDER_GRAPH_MAX_PASSES];
+    u32 pass_count;
+    RenderGraphResource resources[RENDER_GRAPH_MAX_RESOURCES];
+    u32 resource_count;
+
+    RenderGraphBarrier barriers[RENDER_GRAPH_MAX_BARRIERS];
+    u32 barrier_count;
+    // Transitions of imported images into their final layout after the last pass
+    u32 final_barrier;
+    u32 final_barrier_count;
+
+    VkDeviceMemory memory[RENDER_GRAPH_MAX_RESOURCES];
+    u32 memory_count;
+    // Sum of the transient resources' sizes, and what was allocated for them after aliasing
+    VkDeviceSize transient_bytes;
+    VkDeviceSize allocated_bytes;
+
+    // Queries written after each pass, culled ones included, starting at first_timestamp. Off while the pool is
+    // VK_NULL_HANDLE.
+    VkQueryPool timestamp_pool;
+    u32 first_timestamp;
+
+    bool synchronization2;
+    bool compiled;
+} RenderGraph;
+
+// Clears all passes and resources, destroying the transient ones, so the graph can be built again
+void render_graph_reset(Device *device, RenderGraph *graph);
+
+void render_graph_destroy(Device *device, RenderGraph *graph);
+
+// initial_stages are the stages the image was last used in or, for swapchain images, the acquire semaphore waits in.
+// A final_layout of VK_IMAGE_LAYOUT_UNDEFINED leaves the image in the layout of its last use.
+u32 render_graph_import_image(RenderGraph *graph, const char *name, VkImageAspectFlags aspect,
+                              VkImageLayout initial_layout, VkPipelineStageFlags2 initial_stages,
+                              VkImageLayout final_layout);
+
+// Buffers that persist across frames pass the stages the previous frame last used them in, so the first use waits for
+// them. Buffers each frame has its own copy of pass 0.
+u32 render_graph_import_buffer(RenderGraph *graph, const char *name, VkPipelineStageFlags2 initial_stages);
+
+u32 render_graph_create_image(RenderGraph *graph, const char *name, const RenderGraphImageDesc *desc);
+
+u32 render_graph_create_buffer(RenderGraph *graph, const char *name, const RenderGraphBufferDesc *desc);
+
+void render_graph_mark_output(RenderGraph *graph, u32 resource);
+
+// Sets the handles of an imported resource for the frame about to be executed
+void render_graph_set_image(RenderGraph *graph, u32 resource, VkImage image, VkImageView view);
+
+void render_graph_set_buffer(RenderGraph *graph, u32 resource, VkBuffer buffer);
+
+u32 render_graph_add_pass(RenderGraph *graph, const char *name, VkPipelineStageFlags2 shader_stages,
+                          RenderGraphPassFunction function, void *data);
+
+// Declares that the pass accesses the resource, each resource at most once per pass
+bool render_graph_use(RenderGraph *graph, u32 pass, u32 resource, RenderGraphAccess access);
+
+void render_graph_side_effects(RenderGraph *graph, u32 pass);
+
+// Culls passes nothing depends on, places transient resources in shared memory where their lifetimes don't overlap
+// and plans the barriers between passes
+bool render_graph_compile(PhysicalDevice *physical_device, Device *device, RenderGraph *graph);
+
+// Set per frame, pass_count queries from first_timestamp on have to be reset
+void render_graph_set_timestamps(RenderGraph *graph, VkQueryPool pool, u32 first_timestamp);
+
+void render_graph_execute(VulkanContext *context, RenderGraph *graph, VkCommandBuffer command_buffer);
@@ -0,0 +1,136 @@
+#include "render_thread.h"
+#include "core/job.h"
+#include "core/arena.h"
+#include "core/log.h"
+
+#include <string.h>
+
+void render_packet_reset(RenderPacket *packet) {
+    packet->has_view = false;
+    packet->resized = false;
+    packet->present_changed = false;
+    memset(&packet->input, 0, sizeof(FrameInput));
+    packet->draws.count = 0;
+    packet->lights.count = 0;
+}
+
+int render_thread_main(void *data) {
+    RenderThread *thread = data;
+    // Culling and other parallel work recorded from here goes through the job system too
+    if (!job_system_register_thread()) {
+        LOG_WARN("Render thread has no job system slot, its parallel work runs on the render thread alone");
+    }
+
+    while (true) {
+        SDL_SemWait(thread->ready_count);
+
+        RenderPacket *packet = NULL;
+        if (!spsc_queue_pop(&thread->ready, (void **) &packet)) {
+            // Woken without a packet only to stop
+            break;
+        }
+
+        thread->render(packet);
+        render_packet_reset(packet);
+        spsc_queue_push(&thread->free, packet);
+        SDL_SemPost(thread->free_count);
+    }
+
+    job_system_unregister_thread();
+    scratch_release();
+    log_thread_release();
+    return 0;
+}
+
+bool render_thread_create(RenderPacketFunction render, RenderThread *out) {
+    RenderThread result = {0};
+    result.render = render;
+    *out = result;
+
+    if (!spsc_queue_create(RENDER_PACKET_COUNT, &out->ready) || !spsc_queue_create(RENDER_PACKET_COUNT, &out->free)) {
+        render_thread_destroy(out);
+        return false;
+    }
+
+    out->ready_count = SDL_CreateSemaphore(0);
+    out->free_count = SDL_CreateSemaphore(RENDER_PACKET_COUNT);
+    if (out->ready_count == NULL || out->free_count == NULL) {
+        LOG_ERROR("Failed to create render thread semaphores: %s", SDL_GetError());
+        render_thread_destroy(out);
+        return false;
+    }
+
+    for (u32 i = 0; i < RENDER_PACKET_COUNT; ++i) {
+        spsc_queue_push(&out->free, &out->packets[i]);
+    }
+    return true;
+}
+
+void render_thread_destroy(RenderThread *thread) {
+    if (thread->thread != NULL) {
+        render_thread_flush(thread);
+        atomic_store(&thread->running, false);
+        SDL_SemPost(thread->ready_count);
+        SDL_WaitThread(thread->thread, NULL);
+    }
+
+    if (thread->ready_count != NULL) {
+        SDL_DestroySemaphore(thread->ready_count);
+    }
+    if (thread->free_count != NULL) {
+        SDL_DestroySemaphore(thread->free_count);
+    }
+    spsc_queue_destroy(&thread->ready);
+    spsc_queue_destroy(&thread->free);
+    for (u32 i = 0; i < RENDER_PACKET_COUNT; ++i) {
+        meshlet_draw_list_destroy(&thread->packets[i].draws);
+        light_list_destroy(&thread->packets[i].lights);
+    }
+    memset(thread, 0, sizeof(RenderThread));
+}
+
+bool render_thread_start(RenderThread *thread) {
+    atomic_store(&thread->running, true);
+    thread->thread = SDL_CreateThread(render_thread_main, "render", thread);
+    if (thread->thread == NULL) {
+        LOG_ERROR("Failed to create the render thread, rendering on the main thread: %s", SDL_GetError());
+        atomic_store(&thread->running, false);
+        return false;
+    }
+    return true;
+}
+
+RenderPacket *render_thread_packet(RenderThread *thread) {
+    if (thread->building == NULL) {
+        SDL_SemWait(thread->free_count);
+        spsc_queue_pop(&thread->free, (void **) &thread->building);
+    }
+    return thread->building;
+}
+
+void render_thread_submit(RenderThread *thread) {
+    RenderPacket *packet = render_thread_packet(thread);
+    thread->building = NULL;
+
+    if (!atomic_load(&thread->running)) {
+        thread->render(packet);
+        render_packet_reset(packet);
+        spsc_queue_push(&thread->free, packet);
+        SDL_SemPost(thread->free_count);
+        return;
+    }
+
+    spsc_queue_push(&thread->ready, packet);
+    SDL_SemPost(thread->ready_count);
+}
+
+void render_thread_flush(RenderThread *thread) {
+    // Holding every free packet means the render thread has none left to work on
+    u32 held = thread->building != NULL ? 1 : 0;
+    for (u32 i = held; i < RENDER_PACKET_COUNT; ++i) {
+        SDL_SemWait(thread->free_count);
+    }
+    for (u32 i = held; i < RENDER_PACKET_COUNT; ++i) {
+        SDL_SemPost(thread->free_count);
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <SDL.h>
+#include <std/defines.h>
+#include "core/spsc_queue.h"
+#include "meshlet_renderer.h"
+#include "light_clusters.h"
+#include "frame_timing.h"
+#include "swapchain.h"
+
+// One packet being built by the main thread while the other one is rendered
+#define RENDER_PACKET_COUNT 2
+
+// Everything the main thread hands over for one frame
+typedef struct RenderPacket {
+    bool has_view;
+    float view_projection[16];
+    float camera[3];
+
+    bool resized;
+    // Recreates the swapchain with new present settings
+    bool present_changed;
+    PresentSettings present;
+
+    FrameInput input;
+    MeshletDrawList draws;
+    LightList lights;
+} RenderPacket;
+
+typedef void (*RenderPacketFunction)(RenderPacket *packet);
+
+typedef struct RenderThread {
+    SDL_Thread *thread;
+    RenderPacketFunction render;
+    atomic_bool running;
+
+    RenderPacket packets[RENDER_PACKET_COUNT];
+    // Main thread to render thread, and back once a packet is consumed. The semaphores count queued packets so either
+    // side can sleep on an empty queue.
+    SpscQueue ready;
+    SpscQueue free;
+    SDL_sem *ready_count;
+    SDL_sem *free_count;
+
+    // Packet the main thread is filling, NULL until the first access of a frame
+    RenderPacket *building;
+} RenderThread;
+
+bool render_thread_create(RenderPacketFunction render, RenderThread *out);
+
+// Renders the packets still queued, then stops the thread
+void render_thread_destroy(RenderThread *thread);
+
+// Starts rendering submitted packets on their own thread. Until this is called, or if it fails, render_thread_submit
+// renders on the calling thread.
+bool render_thread_start(RenderThread *thread);
+
+// Main thread: the packet for the frame being built, waits while the render thread still holds every packet
+RenderPacket *render_thread_packet(RenderThread *thread);
+
+// Main thread: hands the current packet to the render thread
+void render_thread_submit(RenderThread *thread);
+
+// Main thread: waits until the render thread has consumed every submitted packet and is idle
+void render_thread_flush(RenderThread *thread);
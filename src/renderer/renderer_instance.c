@@ -1,4 +1,5 @@
 #include "renderer_instance.h"
+#include "host_allocator.h"
 #include "vulkan.h"
 #include "std/containers/darray.h"
 #include "command_buffer.h"
@@ -8,21 +9,27 @@ void create_sync_objects(VulkanContext *context, RendererInstance *instance) {
     VkFenceCreateInfo fence_create_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
     fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    VK_CHECK(vkCreateSemaphore(context->device.vk_device, &semaphore_create_info, NULL,
+    VK_CHECK(vkCreateSemaphore(context->device.vk_device, &semaphore_create_info, host_allocator(),
                                &instance->image_available_semaphore));
-    VK_CHECK(vkCreateSemaphore(context->device.vk_device, &semaphore_create_info, NULL,
+    VK_CHECK(vkCreateSemaphore(context->device.vk_device, &semaphore_create_info, host_allocator(),
                                &instance->render_finished_semaphore));
-    VK_CHECK(vkCreateFence(context->device.vk_device, &fence_create_info, NULL, &instance->in_flight_fence));
+    VK_CHECK(vkCreateFence(context->device.vk_device, &fence_create_info, host_allocator(),
+                           &instance->in_flight_fence));
 }
 
 void renderer_instance_create(VulkanContext *context, u32 count) {
     context->renderer_instances = darray_create(RendererInstance);
+    frame_allocator_layout_create(context);
 
     for (int i = 0; i < count; ++i) {
         RendererInstance instance = {0};
 
         create_sync_objects(context, &instance);
         command_buffer_create(context, &instance);
+        if (!frame_allocator_create(context, &instance.frame_allocator)) {
+            LOG_ERROR("Couldn't create frame allocator for renderer instance %d", i);
+            exit(-1);
+        }
 
         darray_push(context->renderer_instances, instance);
     }
@@ -33,11 +40,18 @@ void renderer_instance_destroy(VulkanContext *context) {
         RendererInstance *instance = &context->renderer_instances[i];
         VK_CHECK(vkWaitForFences(context->device.vk_device, 1, &instance->in_flight_fence, VK_TRUE, UINT64_MAX));
 
-        vkDestroySemaphore(context->device.vk_device, instance->render_finished_semaphore, NULL);
-        vkDestroySemaphore(context->device.vk_device, instance->image_available_semaphore, NULL);
-        vkDestroyFence(context->device.vk_device, instance->in_flight_fence, NULL);
+        vkDestroySemaphore(context->device.vk_device, instance->render_finished_semaphore, host_allocator());
+        vkDestroySemaphore(context->device.vk_device, instance->image_available_semaphore, host_allocator());
+        vkDestroyFence(context->device.vk_device, instance->in_flight_fence, host_allocator());
+        frame_allocator_destroy(context, &instance->frame_allocator);
     }
 
     darray_destroy(context->renderer_instances);
     context->renderer_instances = NULL;
+    frame_allocator_layout_destroy(context);
+}
+
+void renderer_instance_begin_frame(VulkanContext *context, RendererInstance *instance) {
+    // Only valid once the instance's fence has signaled: everything it handed out is no longer in use by the GPU
+    frame_allocator_reset(context, &instance->frame_allocator);
 }
\ No newline at end of file
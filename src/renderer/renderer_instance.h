@@ -2,6 +2,7 @@
 
 #include <std/defines.h>
 #include "vulkan_types.h"
+#include "frame_allocator.h"
 
 typedef struct VulkanContext VulkanContext;
 
@@ -10,8 +11,12 @@ typedef struct RendererInstance {
     VkSemaphore image_available_semaphore;
     VkSemaphore render_finished_semaphore;
     VkFence in_flight_fence;
+
+    FrameAllocator frame_allocator;
 } RendererInstance;
 
 void renderer_instance_create(VulkanContext *context, u32 count);
 
 void renderer_instance_destroy(VulkanContext *context);
+
+void renderer_instance_begin_frame(VulkanContext *context, RendererInstance *instance);
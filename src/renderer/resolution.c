@@ -0,0 +1,74 @@
+#include "resolution.h"
+
+#include <math.h>
+
+void resolution_scaler_init(ResolutionScaler *out) {
+    atomic_init(&out->budget, 0);
+    out->scale = RESOLUTION_SCALE_MAX;
+    out->frames = 0;
+    out->full = (VkExtent2D) {0, 0};
+    out->extent = (VkExtent2D) {0, 0};
+}
+
+void resolution_scaler_set_budget(ResolutionScaler *scaler, u64 ticks) {
+    atomic_store(&scaler->budget, ticks);
+}
+
+u32 resolution_scaler_axis(u32 full, float scale) {
+    // Even sizes keep the upscale from shifting by half a pixel between steps
+    u32 size = (u32) ((float) full * scale) & ~1u;
+    if (size == 0) {
+        return full > 0 ? 1 : 0;
+    }
+    return size < full ? size : full;
+}
+
+void resolution_scaler_apply(ResolutionScaler *scaler) {
+    scaler->extent.width = resolution_scaler_axis(scaler->full.width, scaler->scale);
+    scaler->extent.height = resolution_scaler_axis(scaler->full.height, scaler->scale);
+}
+
+void resolution_scaler_resize(ResolutionScaler *scaler, VkExtent2D full) {
+    scaler->full = full;
+    resolution_scaler_apply(scaler);
+}
+
+void resolution_scaler_update(ResolutionScaler *scaler, u64 gpu_time, u64 cpu_time) {
+    u64 budget = atomic_load(&scaler->budget);
+    if (budget == 0 || gpu_time == 0) {
+        if (scaler->scale != RESOLUTION_SCALE_MAX) {
+            scaler->scale = RESOLUTION_SCALE_MAX;
+            resolution_scaler_apply(scaler);
+        }
+        return;
+    }
+
+    if (++scaler->frames < RESOLUTION_UPDATE_INTERVAL) {
+        return;
+    }
+    scaler->frames = 0;
+
+    double target = (double) (cpu_time > budget ? cpu_time : budget) * RESOLUTION_BUDGET_HEADROOM;
+    // Pixels scale with the square of the axis scale. Moving halfway to the estimate damps the measurement noise, but
+    // by at least the deadband so the scale doesn't stall just outside of it.
+    float estimate = scaler->scale * (float) sqrt(target / (double) gpu_time);
+    float step = (estimate - scaler->scale) * 0.5f;
+    if (fabsf(estimate - scaler->scale) < RESOLUTION_SCALE_DEADBAND) {
+        return;
+    }
+    if (fabsf(step) < RESOLUTION_SCALE_DEADBAND) {
+        step = step < 0.0f ? -RESOLUTION_SCALE_DEADBAND : RESOLUTION_SCALE_DEADBAND;
+    }
+
+    float scale = scaler->scale + step;
+    if (scale < RESOLUTION_SCALE_MIN) {
+        scale = RESOLUTION_SCALE_MIN;
+    } else if (scale > RESOLUTION_SCALE_MAX) {
+        scale = RESOLUTION_SCALE_MAX;
+    }
+    if (scale == scaler->scale) {
+        return;
+    }
+    scaler->scale = scale;
+    resolution_scaler_apply(scaler);
+}
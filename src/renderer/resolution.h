@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <std/defines.h>
+#include "vulkan_types.h"
+
+// Range of the render resolution as a fraction of the swapchain extent on each axis
+#define RESOLUTION_SCALE_MIN 0.5f
+#define RESOLUTION_SCALE_MAX 1.0f
+// Frames between two adjustments, so the smoothed GPU time catches up with the last change
+#define RESOLUTION_UPDATE_INTERVAL 8
+// Fraction of the frame budget the GPU is steered towards, leaves room for spikes
+#define RESOLUTION_BUDGET_HEADROOM 0.9
+// Changes smaller than this are skipped, keeps the image from shimmering around the target
+#define RESOLUTION_SCALE_DEADBAND 0.02f
+
+// Picks the render resolution from measured frame times. The scene renders into the top left of a target with the
+// swapchain's size and is scaled up into the swapchain image, so changing the scale never reallocates anything.
+typedef struct ResolutionScaler {
+    // Ticks per frame to hold, 0 keeps the scale at RESOLUTION_SCALE_MAX. Set from any thread.
+    atomic_ullong budget;
+
+    // Render thread only
+    float scale;
+    u32 frames;
+    VkExtent2D full;
+    VkExtent2D extent;
+} ResolutionScaler;
+
+void resolution_scaler_init(ResolutionScaler *out);
+
+void resolution_scaler_set_budget(ResolutionScaler *scaler, u64 ticks);
+
+// With the swapchain, keeps the current scale
+void resolution_scaler_resize(ResolutionScaler *scaler, VkExtent2D full);
+
+// Once per frame with the smoothed GPU and render thread times. GPU time is assumed to grow with the pixel count and
+// is steered into the budget, or up to the CPU time when the frame is CPU bound since resolution can't help there.
+void resolution_scaler_update(ResolutionScaler *scaler, u64 gpu_time, u64 cpu_time);
@@ -1,6 +1,7 @@
 #include "shader.h"
+#include "host_allocator.h"
 #include <std/core/file.h>
-#include <std/core/logger.h>
+#include "core/log.h"
 #include <std/core/memory.h>
 
 void shader_create_module(Device *device, BinaryContents *code, VkShaderModule *out) {
@@ -8,7 +9,7 @@ void shader_create_module(Device *device, BinaryContents *code, VkShaderModule *
     create_info.codeSize = code->size;
     create_info.pCode = code->data;
 
-    VK_CHECK(vkCreateShaderModule(device->vk_device, &create_info, NULL, out));
+    VK_CHECK(vkCreateShaderModule(device->vk_device, &create_info, host_allocator(), out));
 }
 
 bool shader_load(Device *device, const char *vertex, const char *fragment, Shader *out) {
@@ -30,9 +31,20 @@ bool shader_load(Device *device, const char *vertex, const char *fragment, Shade
     return true;
 }
 
+bool shader_module_load(Device *device, const char *path, VkShaderModule *out) {
+    BinaryContents binary = {0};
+    if (!file_read_binary(path, &binary)) {
+        LOG_ERROR("Failed to load shader: %s", path);
+        return false;
+    }
+
+    shader_create_module(device, &binary, out);
+    return true;
+}
+
 void shader_destroy(Device *device, Shader *shader) {
-    vkDestroyShaderModule(device->vk_device, shader->vertex, NULL);
+    vkDestroyShaderModule(device->vk_device, shader->vertex, host_allocator());
     shader->vertex = NULL;
-    vkDestroyShaderModule(device->vk_device, shader->fragment, NULL);
+    vkDestroyShaderModule(device->vk_device, shader->fragment, host_allocator());
     shader->fragment = NULL;
 }
\ No newline at end of file
@@ -11,4 +11,7 @@ typedef struct Shader {
 
 bool shader_load(Device *device, const char *vertex, const char *fragment, Shader *out);
 
+// Single stage loader for pipelines that are not a plain vertex + fragment pair
+bool shader_module_load(Device *device, const char *path, VkShaderModule *out);
+
 void shader_destroy(Device *device, Shader *shader);
\ No newline at end of file
@@ -1,30 +1,31 @@
 #include "swapchain.h"
+#include "host_allocator.h"
+#include "core/arena.h"
 
 #include <SDL_vulkan.h>
-#include <std/containers/darray.h>
 
-bool query_swapchain_details(PhysicalDevice *physical_device, VkSurfaceKHR *surface, Swapchain *out) {
+// Formats and present modes land in the scratch arena, they are only needed to pick one of each
+bool query_swapchain_details(PhysicalDevice *physical_device, VkSurfaceKHR *surface, Arena *scratch,
+                             VkSurfaceFormatKHR **formats, u32 *format_count, VkPresentModeKHR **present_modes,
+                             u32 *mode_count, Swapchain *out) {
     VK_CHECK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physical_device->device, *surface,
                                                        &out->surface_capabilities));
 
-    u32 format_count;
-    VK_CHECK(vkGetPhysicalDeviceSurfaceFormatsKHR(physical_device->device, *surface, &format_count, NULL));
-    out->formats = darray_reserve(VkSurfaceFormatKHR, format_count);
-    VK_CHECK(vkGetPhysicalDeviceSurfaceFormatsKHR(physical_device->device, *surface, &format_count,
-                                                  out->formats));
+    VK_CHECK(vkGetPhysicalDeviceSurfaceFormatsKHR(physical_device->device, *surface, format_count, NULL));
+    *formats = arena_alloc_array(scratch, VkSurfaceFormatKHR, *format_count);
+    VK_CHECK(vkGetPhysicalDeviceSurfaceFormatsKHR(physical_device->device, *surface, format_count, *formats));
 
-    u32 mode_count;
-    VK_CHECK(vkGetPhysicalDeviceSurfacePresentModesKHR(physical_device->device, *surface, &mode_count, NULL));
-    out->present_modes = darray_reserve(VkPresentModeKHR, mode_count);
-    VK_CHECK(vkGetPhysicalDeviceSurfacePresentModesKHR(physical_device->device, *surface, &mode_count,
-                                                       out->present_modes));
+    VK_CHECK(vkGetPhysicalDeviceSurfacePresentModesKHR(physical_device->device, *surface, mode_count, NULL));
+    *present_modes = arena_alloc_array(scratch, VkPresentModeKHR, *mode_count);
+    VK_CHECK(vkGetPhysicalDeviceSurfacePresentModesKHR(physical_device->device, *surface, mode_count,
+                                                       *present_modes));
 
-    if (darray_length(out->formats) == 0) {
+    if (*format_count == 0) {
         LOG_ERROR("No present formats available for swapchain!");
         return false;
     }
 
-    if (darray_length(out->present_modes) == 0) {
+    if (*mode_count == 0) {
         LOG_ERROR("No present modes available for swapchain!");
         return false;
     }
@@ -44,13 +45,11 @@ VkExtent2D swapchain_choose_swap_extent(SDL_Window *window) {
 }
 
 void swapchain_create_image_views(Device *device, Swapchain *swapchain) {
-    VkImageView *image_views = darray_reserve(VkImageView, darray_length(swapchain->images));
-
-    for (int i = 0; i < darray_length(swapchain->images); ++i) {
+    for (u32 i = 0; i < swapchain->image_count; ++i) {
         VkImageViewCreateInfo create_info = {VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
         create_info.image = swapchain->images[i];
         create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        create_info.format = swapchain->formats[swapchain->selected_format].format;
+        create_info.format = swapchain->surface_format.format;
         create_info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
         create_info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
         create_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
@@ -61,57 +60,121 @@ void swapchain_create_image_views(Device *device, Swapchain *swapchain) {
         create_info.subresourceRange.baseArrayLayer = 0;
         create_info.subresourceRange.layerCount = 1;
 
-        VK_CHECK(vkCreateImageView(device->vk_device, &create_info, NULL, &image_views[i]));
+        VK_CHECK(vkCreateImageView(device->vk_device, &create_info, host_allocator(), &swapchain->image_views[i]));
     }
-
-    swapchain->image_views = image_views;
 }
 
-bool swapchain_select_format(Swapchain *out) {
-    // Select format
-    out->selected_format = UINT32_MAX;
-    for (int i = 0; i < darray_length(out->formats); ++i) {
-        VkSurfaceFormatKHR format = out->formats[i];
+bool swapchain_select_format(const VkSurfaceFormatKHR *formats, u32 format_count, Swapchain *out) {
+    for (u32 i = 0; i < format_count; ++i) {
+        VkSurfaceFormatKHR format = formats[i];
 
         if (format.format == VK_FORMAT_B8G8R8A8_SRGB && format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
-            out->selected_format = i;
+            out->surface_format = format;
             LOG_INFO("Selecting swapchain surface format: %s - %s", string_VkFormat(format.format),
                      string_VkColorSpaceKHR(format.colorSpace));
-            break;
+            return true;
         }
     }
 
-    return out->selected_format != UINT32_MAX;
+    return false;
+}
+
+typedef struct PresentModePreference {
+    VkPresentModeKHR modes[4];
+    u32 count;
+} PresentModePreference;
+
+// Present modes in order of preference for each policy, FIFO is always supported and ends every list
+static const PresentModePreference swapchain_present_preferences[PRESENT_POLICY_MAX] = {
+        [PRESENT_POLICY_LOW_LATENCY] = {{VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR,
+                                         VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR}, 4},
+        [PRESENT_POLICY_POWER_SAVING] = {{VK_PRESENT_MODE_FIFO_KHR}, 1},
+        [PRESENT_POLICY_TEAR_FREE] = {{VK_PRESENT_MODE_FIFO_KHR}, 1},
+        [PRESENT_POLICY_BENCHMARK] = {{VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+                                       VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR}, 4},
+};
+
+// Low latency with variable refresh: the display waits for the frame instead of the frame for the display
+static const PresentModePreference swapchain_vrr_preference = {
+        {VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR}, 2};
+
+const char *swapchain_present_policy_name(PresentPolicy policy) {
+    switch (policy) {
+        case PRESENT_POLICY_LOW_LATENCY:
+            return "low latency";
+        case PRESENT_POLICY_POWER_SAVING:
+            return "power saving";
+        case PRESENT_POLICY_TEAR_FREE:
+            return "tear free";
+        case PRESENT_POLICY_BENCHMARK:
+            return "benchmark";
+        default:
+            return "unknown";
+    }
 }
 
-bool swapchain_select_present_mode(Swapchain *out) {
-    out->selected_mode = UINT32_MAX;
-    for (int i = 0; i < darray_length(out->present_modes); ++i) {
-        VkPresentModeKHR mode = out->present_modes[i];
+u32 swapchain_frame_rate_cap(const PresentSettings *present, u32 refresh_rate) {
+    switch (present->policy) {
+        case PRESENT_POLICY_LOW_LATENCY:
+            if (present->variable_refresh && refresh_rate > SWAPCHAIN_VRR_HEADROOM_FPS) {
+                return refresh_rate - SWAPCHAIN_VRR_HEADROOM_FPS;
+            }
+            return present->target_fps;
+        case PRESENT_POLICY_POWER_SAVING:
+            return present->target_fps != 0 ? present->target_fps : SWAPCHAIN_POWER_SAVING_FPS;
+        case PRESENT_POLICY_TEAR_FREE:
+            return present->target_fps;
+        default:
+            return 0;
+    }
+}
+
+bool swapchain_select_present_mode(const VkPresentModeKHR *present_modes, u32 mode_count,
+                                   const PresentSettings *present, Swapchain *out) {
+    const PresentModePreference *preference = &swapchain_present_preferences[present->policy];
+    if (present->policy == PRESENT_POLICY_LOW_LATENCY && present->variable_refresh) {
+        preference = &swapchain_vrr_preference;
+    }
 
-        if (mode == VK_PRESENT_MODE_MAILBOX_KHR || mode == VK_PRESENT_MODE_FIFO_KHR) {
-            out->selected_mode = i;
-            LOG_INFO("Selecting swapchain presentation format: %s", string_VkPresentModeKHR(mode));
-            break;
+    for (u32 p = 0; p < preference->count; ++p) {
+        for (u32 i = 0; i < mode_count; ++i) {
+            if (present_modes[i] == preference->modes[p]) {
+                out->present_mode = present_modes[i];
+                LOG_INFO("Selecting swapchain presentation mode for %s: %s",
+                         swapchain_present_policy_name(present->policy), string_VkPresentModeKHR(out->present_mode));
+                return true;
+            }
         }
     }
-    return out->selected_mode != UINT32_MAX;
+    return false;
 }
 
 bool swapchain_init(SDL_Window *window, PhysicalDevice *physicalDevice, Device *device, VkSurfaceKHR *surface,
-                    Swapchain *out) {
-    if (!query_swapchain_details(physicalDevice, surface, out)) {
+                    const PresentSettings *present, Swapchain *out) {
+    ArenaScope scratch = scratch_begin();
+    VkSurfaceFormatKHR *formats;
+    VkPresentModeKHR *present_modes;
+    u32 format_count, mode_count;
+    bool selected = false;
+    if (!query_swapchain_details(physicalDevice, surface, scratch.arena, &formats, &format_count, &present_modes,
+                                 &mode_count, out)) {
         LOG_ERROR("Couldn't query swapchain details!");
-        return false;
+    } else if (!swapchain_select_format(formats, format_count, out)) {
+        LOG_ERROR("Couldn't find a suitable swapchain format!");
+    } else if (!swapchain_select_present_mode(present_modes, mode_count, present, out)) {
+        LOG_ERROR("Couldn't find a suitable swapchain presentation mode!");
+    } else {
+        selected = true;
     }
+    scratch_end(scratch);
 
-    if (!swapchain_select_format(out)) {
-        LOG_ERROR("Couldn't find a suitable swapchain format!");
+    if (!selected) {
         return false;
     }
 
-    if (!swapchain_select_present_mode(out)) {
-        LOG_ERROR("Couldn't find a suitable swapchain presentation mode!");
+    // The scene is rendered offscreen and blitted into the swapchain image
+    if (!(out->surface_capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT)) {
+        LOG_ERROR("Swapchain images can't be blit destinations!");
         return false;
     }
 
@@ -125,11 +188,13 @@ bool swapchain_init(SDL_Window *window, PhysicalDevice *physicalDevice, Device *
     if (max_image_count > 0 && create_info.minImageCount > max_image_count) {
         create_info.minImageCount = max_image_count;
     }
-    create_info.imageFormat = out->formats[out->selected_format].format;
-    create_info.imageColorSpace = out->formats[out->selected_format].colorSpace;
+    create_info.imageFormat = out->surface_format.format;
+    create_info.imageColorSpace = out->surface_format.colorSpace;
     create_info.imageExtent = extent;
     create_info.imageArrayLayers = 1;
-    create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                             (out->surface_capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+    out->usage = create_info.imageUsage;
 
     u32 graphics_index = device->queues[QUEUE_FEATURE_GRAPHICS].queue_family->index;
     u32 present_index = device->queues[QUEUE_FEATURE_PRESENT].queue_family->index;
@@ -147,17 +212,20 @@ bool swapchain_init(SDL_Window *window, PhysicalDevice *physicalDevice, Device *
 
     create_info.preTransform = out->surface_capabilities.currentTransform;
     create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-    create_info.presentMode = out->present_modes[out->selected_mode];
+    create_info.presentMode = out->present_mode;
     create_info.clipped = VK_TRUE;
     create_info.oldSwapchain = VK_NULL_HANDLE;
 
-    VK_CHECK(vkCreateSwapchainKHR(device->vk_device, &create_info, NULL, &out->vk_swapchain));
+    VK_CHECK(vkCreateSwapchainKHR(device->vk_device, &create_info, host_allocator(), &out->vk_swapchain));
 
-    u32 image_count = 0;
-    VK_CHECK(vkGetSwapchainImagesKHR(device->vk_device, out->vk_swapchain, &image_count, NULL));
-    VkImage *images = darray_reserve(VkImage, image_count);
-    VK_CHECK(vkGetSwapchainImagesKHR(device->vk_device, out->vk_swapchain, &image_count, images));
-    out->images = images;
+    VK_CHECK(vkGetSwapchainImagesKHR(device->vk_device, out->vk_swapchain, &out->image_count, NULL));
+    if (out->image_count > SWAPCHAIN_MAX_IMAGES) {
+        LOG_ERROR("Swapchain has %u images, at most %u are supported", out->image_count, SWAPCHAIN_MAX_IMAGES);
+        vkDestroySwapchainKHR(device->vk_device, out->vk_swapchain, host_allocator());
+        out->vk_swapchain = NULL;
+        return false;
+    }
+    VK_CHECK(vkGetSwapchainImagesKHR(device->vk_device, out->vk_swapchain, &out->image_count, out->images));
     out->extent = extent;
 
     swapchain_create_image_views(device, out);
@@ -166,15 +234,11 @@ bool swapchain_init(SDL_Window *window, PhysicalDevice *physicalDevice, Device *
 }
 
 void swapchain_destroy(Device *device, Swapchain *swapchain) {
-    for (int i = 0; i < darray_length(swapchain->image_views); ++i) {
-        vkDestroyImageView(device->vk_device, swapchain->image_views[i], NULL);
+    for (u32 i = 0; i < swapchain->image_count; ++i) {
+        vkDestroyImageView(device->vk_device, swapchain->image_views[i], host_allocator());
     }
+    swapchain->image_count = 0;
 
-    darray_destroy(swapchain->image_views);
-    swapchain->image_views = NULL;
-    darray_destroy(swapchain->images);
-    swapchain->images = NULL;
-
-    vkDestroySwapchainKHR(device->vk_device, swapchain->vk_swapchain, NULL);
+    vkDestroySwapchainKHR(device->vk_device, swapchain->vk_swapchain, host_allocator());
     swapchain->vk_swapchain = NULL;
 }
\ No newline at end of file
@@ -6,21 +6,55 @@
 #include "device.h"
 #include <SDL.h>
 
+typedef enum PresentPolicy {
+    // Newest frame at the next refresh: mailbox, then immediate. With variable refresh, FIFO capped just below the
+    // refresh rate so frames never wait in the queue and never tear.
+    PRESENT_POLICY_LOW_LATENCY,
+    // FIFO with the frame rate capped at target_fps
+    PRESENT_POLICY_POWER_SAVING,
+    // FIFO, optionally capped at target_fps
+    PRESENT_POLICY_TEAR_FREE,
+    // Immediate and uncapped, for measuring throughput
+    PRESENT_POLICY_BENCHMARK,
+    PRESENT_POLICY_MAX
+} PresentPolicy;
+
+typedef struct PresentSettings {
+    PresentPolicy policy;
+    // 0 leaves the frame rate to the present mode, power saving falls back to SWAPCHAIN_POWER_SAVING_FPS
+    u32 target_fps;
+    // The display adapts its refresh to the frame rate (G-Sync, FreeSync), Vulkan has no portable way to query this
+    bool variable_refresh;
+} PresentSettings;
+
+#define SWAPCHAIN_POWER_SAVING_FPS 30
+// Frames per second kept below the refresh rate with variable refresh, so presents never queue up behind vsync
+#define SWAPCHAIN_VRR_HEADROOM_FPS 3
+
+// Images a swapchain may have, drivers hand out minImageCount + 1 in practice
+#define SWAPCHAIN_MAX_IMAGES 8
+
 typedef struct Swapchain {
     VkSwapchainKHR vk_swapchain;
-    VkImage *images;
-    VkImageView *image_views;
+    VkImage images[SWAPCHAIN_MAX_IMAGES];
+    VkImageView image_views[SWAPCHAIN_MAX_IMAGES];
+    u32 image_count;
 
     VkSurfaceCapabilitiesKHR surface_capabilities;
-    VkSurfaceFormatKHR *formats;
-    VkPresentModeKHR *present_modes;
+    VkSurfaceFormatKHR surface_format;
+    VkPresentModeKHR present_mode;
+    // Transfer source is added where supported so frames can be read back
+    VkImageUsageFlags usage;
 
     VkExtent2D extent;
-
-    u32 selected_format;
-    u32 selected_mode;
 } Swapchain;
 
-bool swapchain_init(SDL_Window *window, PhysicalDevice *physicalDevice, Device *device, VkSurfaceKHR *surface, Swapchain *out);
+bool swapchain_init(SDL_Window *window, PhysicalDevice *physicalDevice, Device *device, VkSurfaceKHR *surface,
+                    const PresentSettings *present, Swapchain *out);
+
+// Frames per second the CPU should be limited to for the settings, 0 for uncapped. refresh_rate is 0 when unknown.
+u32 swapchain_frame_rate_cap(const PresentSettings *present, u32 refresh_rate);
+
+const char *swapchain_present_policy_name(PresentPolicy policy);
 
 void swapchain_destroy(Device *device, Swapchain *swapchain);
\ No newline at end of file
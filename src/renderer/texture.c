@@ -0,0 +1,582 @@
+#include "texture.h"
+#include "host_allocator.h"
+#include "vulkan.h"
+#include <math.h>
+#include <string.h>
+
+#define TEXTURE_RETIRED_CAPACITY (TEXTURE_UPLOAD_BATCH * (BINDLESS_RELEASE_DELAY + 2))
+#define TEXTURE_STAGING_ALIGNMENT 16
+
+VkDeviceSize texture_align(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+VkDeviceSize texture_staging_size(Texture *texture, u32 target_mip) {
+    VkDeviceSize size = 0;
+    for (u32 level = target_mip; level < texture->ktx.level_count; ++level) {
+        size = texture_align(size, TEXTURE_STAGING_ALIGNMENT) + texture->ktx.levels[level].uncompressed_size;
+    }
+    return size;
+}
+
+void texture_submit_and_wait(VulkanContext *context, TextureStreamer *streamer) {
+    VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &streamer->command_buffer;
+
+    VK_CHECK(vkResetFences(context->device.vk_device, 1, &streamer->fence));
+    VK_CHECK(vkQueueSubmit(context->device.queues[QUEUE_FEATURE_GRAPHICS].vk_queue, 1, &submit_info,
+                           streamer->fence));
+    VK_CHECK(vkWaitForFences(context->device.vk_device, 1, &streamer->fence, VK_TRUE, UINT64_MAX));
+}
+
+bool texture_create_fallback(VulkanContext *context, TextureStreamer *streamer) {
+    ImageConfig config = {
+            .format = VK_FORMAT_R8G8B8A8_UNORM,
+            .extent = {1, 1},
+            .mip_levels = 1,
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            .aspect = VK_IMAGE_ASPECT_COLOR_BIT,
+            .memory_properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    };
+    if (!image_create(&context->physical_device, &context->device, &config, &streamer->fallback)) {
+        return false;
+    }
+
+    u8 white[4] = {255, 255, 255, 255};
+    memcpy(streamer->staging.mapped, white, sizeof(white));
+
+    VkCommandBuffer command_buffer = streamer->command_buffer;
+    VkCommandBufferBeginInfo begin_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK(vkBeginCommandBuffer(command_buffer, &begin_info));
+
+    image_transition(command_buffer, streamer->fallback.vk_image, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1,
+                     VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                     VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    VkBufferImageCopy region = {0};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent.width = 1;
+    region.imageExtent.height = 1;
+    region.imageExtent.depth = 1;
+    vkCmdCopyBufferToImage(command_buffer, streamer->staging.vk_buffer, streamer->fallback.vk_image,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    image_transition(command_buffer, streamer->fallback.vk_image, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1,
+                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                     VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+    VK_CHECK(vkEndCommandBuffer(command_buffer));
+    texture_submit_and_wait(context, streamer);
+
+    streamer->fallback_handle = bindless_register_sampled_image(&context->device, &context->bindless,
+                                                                streamer->fallback.view,
+                                                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    return streamer->fallback_handle != BINDLESS_INVALID_HANDLE;
+}
+
+bool texture_streamer_create(VulkanContext *context, VkDeviceSize budget, TextureStreamer *out) {
+    TextureStreamer result = {.budget = budget, .requested_budget = budget};
+    Device *device = &context->device;
+
+    result.textures = calloc(TEXTURE_MAX_COUNT, sizeof(Texture));
+    result.retired = calloc(TEXTURE_RETIRED_CAPACITY, sizeof(TextureRetired));
+
+    VkDeviceSize table_size = sizeof(u32) * TEXTURE_MAX_COUNT;
+    if (!buffer_create(&context->physical_device, device, table_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                       &result.handle_table)) {
+        LOG_ERROR("Couldn't create texture handle table!");
+        return false;
+    }
+    result.handles = result.handle_table.mapped;
+    result.handle_table_handle = bindless_register_storage_buffer(device, &context->bindless,
+                                                                  result.handle_table.vk_buffer, 0, table_size);
+
+    if (!buffer_create(&context->physical_device, device, TEXTURE_STAGING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                       &result.staging)) {
+        LOG_ERROR("Couldn't create texture staging buffer!");
+        return false;
+    }
+
+    VkCommandBufferAllocateInfo allocate_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    allocate_info.commandPool = context->command_pool;
+    allocate_info.commandBufferCount = 1;
+    allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    VK_CHECK(vkAllocateCommandBuffers(device->vk_device, &allocate_info, &result.command_buffer));
+
+    VkFenceCreateInfo fence_create_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    VK_CHECK(vkCreateFence(device->vk_device, &fence_create_info, host_allocator(), &result.fence));
+
+    sampler_create(&context->physical_device, device, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT,
+                   &result.sampler);
+    result.sampler_handle = bindless_register_sampler(device, &context->bindless, result.sampler);
+
+    if (!texture_create_fallback(context, &result)) {
+        LOG_ERROR("Couldn't create fallback texture!");
+        return false;
+    }
+
+    for (u32 i = 0; i < TEXTURE_MAX_COUNT; ++i) {
+        result.handles[i] = result.fallback_handle;
+    }
+
+    *out = result;
+    LOG_INFO("Texture streamer created with a budget of %llu MiB", (unsigned long long) (budget >> 20));
+    return true;
+}
+
+void texture_streamer_destroy(VulkanContext *context, TextureStreamer *streamer) {
+    Device *device = &context->device;
+    job_wait(&streamer->decode_jobs);
+    VK_CHECK(vkWaitForFences(device->vk_device, 1, &streamer->fence, VK_TRUE, UINT64_MAX));
+
+    for (u32 i = 0; i < streamer->upload_count; ++i) {
+        image_destroy(device, &streamer->uploads[i].image);
+    }
+    streamer->upload_count = 0;
+
+    for (u32 i = 0; i < streamer->retired_count; ++i) {
+        image_destroy(device, &streamer->retired[i].image);
+    }
+    streamer->retired_count = 0;
+
+    for (u32 i = 0; i < streamer->texture_count; ++i) {
+        Texture *texture = &streamer->textures[i];
+        if (texture->image.vk_image) {
+            image_destroy(device, &texture->image);
+        }
+        ktx2_close(&texture->ktx);
+    }
+    streamer->texture_count = 0;
+
+    image_destroy(device, &streamer->fallback);
+    sampler_destroy(device, &streamer->sampler);
+    vkDestroyFence(device->vk_device, streamer->fence, host_allocator());
+    streamer->fence = NULL;
+    vkFreeCommandBuffers(device->vk_device, context->command_pool, 1, &streamer->command_buffer);
+    streamer->command_buffer = NULL;
+
+    buffer_destroy(device, &streamer->staging);
+    buffer_destroy(device, &streamer->handle_table);
+    streamer->handles = NULL;
+
+    free(streamer->textures);
+    streamer->textures = NULL;
+    free(streamer->retired);
+    streamer->retired = NULL;
+}
+
+void texture_streamer_set_budget(TextureStreamer *streamer, VkDeviceSize budget) {
+    streamer->budget = budget;
+    streamer->requested_budget = budget;
+}
+
+void texture_streamer_memory_pressure(void *data, const MemoryPressureEvent *event) {
+    TextureStreamer *streamer = data;
+    VkDeviceSize budget = streamer->budget;
+    if (event->pressure == MEMORY_PRESSURE_NONE) {
+        // Grow back slowly, half the headroom per callback leaves room for everyone else
+        VkDeviceSize grown = streamer->resident_bytes + event->headroom / 2;
+        budget = grown > budget ? grown : budget;
+        budget = budget < streamer->requested_budget ? budget : streamer->requested_budget;
+    } else {
+        // Give back the whole overshoot, and a quarter of what is resident on top when it is severe
+        VkDeviceSize release = event->overshoot;
+        if (event->pressure == MEMORY_PRESSURE_SEVERE) {
+            release += streamer->resident_bytes / 4;
+        }
+        VkDeviceSize shrunk = streamer->resident_bytes > release ? streamer->resident_bytes - release : 0;
+        budget = shrunk < budget ? shrunk : budget;
+    }
+
+    if (budget != streamer->budget) {
+        LOG_INFO("Texture budget %llu MiB under %s memory pressure", (unsigned long long) (budget >> 20),
+                 memory_pressure_name(event->pressure));
+        streamer->budget = budget;
+    }
+}
+
+u32 texture_load(TextureStreamer *streamer, const char *path) {
+    if (streamer->texture_count >= TEXTURE_MAX_COUNT) {
+        LOG_ERROR("Texture limit reached, can't load %s", path);
+        return TEXTURE_INVALID;
+    }
+
+    Texture texture = {0};
+    if (!ktx2_open(path, &texture.ktx)) {
+        return TEXTURE_INVALID;
+    }
+
+    u32 level_count = texture.ktx.level_count;
+    texture.tail_mip = level_count - 1;
+    for (u32 level = 0; level < level_count; ++level) {
+        VkExtent2D extent = ktx2_level_extent(&texture.ktx, level);
+        if (extent.width <= TEXTURE_MIP_TAIL_SIZE && extent.height <= TEXTURE_MIP_TAIL_SIZE) {
+            texture.tail_mip = level;
+            break;
+        }
+    }
+
+    texture.resident_mip = level_count;
+    texture.wanted_mip = texture.tail_mip;
+    texture.min_mip = 0;
+    texture.image_handle = BINDLESS_INVALID_HANDLE;
+
+    u32 id = streamer->texture_count++;
+    streamer->textures[id] = texture;
+    return id;
+}
+
+void texture_request(TextureStreamer *streamer, u32 texture_id, float screen_pixels, u64 frame) {
+    Texture *texture = &streamer->textures[texture_id];
+
+    u32 size = texture->ktx.extent.width > texture->ktx.extent.height ? texture->ktx.extent.width
+                                                                        : texture->ktx.extent.height;
+    u32 mip = 0;
+    if (screen_pixels < 1.0f) {
+        mip = texture->tail_mip;
+    } else if (screen_pixels < (float) size) {
+        mip = (u32) floorf(log2f((float) size / screen_pixels));
+    }
+
+    if (mip > texture->tail_mip) {
+        mip = texture->tail_mip;
+    }
+
+    if (texture->last_used_frame != frame || mip < texture->wanted_mip) {
+        texture->wanted_mip = mip;
+    }
+    texture->last_used_frame = frame;
+}
+
+void texture_retire(VulkanContext *context, TextureStreamer *streamer, Texture *texture) {
+    if (texture->image.vk_image == NULL) {
+        return;
+    }
+
+    bindless_release(&context->bindless, BINDLESS_BINDING_SAMPLED_IMAGES, texture->image_handle,
+                     context->frame_number);
+
+    TextureRetired retired = {.image = texture->image, .frame = context->frame_number + BINDLESS_RELEASE_DELAY};
+    streamer->retired[streamer->retired_count++] = retired;
+    streamer->retired_bytes += texture->image.size;
+
+    texture->image = (Image) {0};
+    texture->image_handle = BINDLESS_INVALID_HANDLE;
+}
+
+void texture_collect_retired(VulkanContext *context, TextureStreamer *streamer) {
+    u32 kept = 0;
+    for (u32 i = 0; i < streamer->retired_count; ++i) {
+        TextureRetired *retired = &streamer->retired[i];
+        if (retired->frame <= context->frame_number) {
+            streamer->resident_bytes -= retired->image.size;
+            streamer->retired_bytes -= retired->image.size;
+            image_destroy(&context->device, &retired->image);
+        } else {
+            streamer->retired[kept++] = *retired;
+        }
+    }
+    streamer->retired_count = kept;
+}
+
+void texture_finish_uploads(VulkanContext *context, TextureStreamer *streamer) {
+    for (u32 i = 0; i < streamer->upload_count; ++i) {
+        TextureUpload *upload = &streamer->uploads[i];
+        Texture *texture = &streamer->textures[upload->texture];
+
+        u32 handle = bindless_register_sampled_image(&context->device, &context->bindless, upload->image.view,
+                                                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        if (handle == BINDLESS_INVALID_HANDLE) {
+            streamer->resident_bytes -= upload->image.size;
+            image_destroy(&context->device, &upload->image);
+            texture->busy = false;
+            continue;
+        }
+
+        texture_retire(context, streamer, texture);
+        texture->image = upload->image;
+        texture->image_handle = handle;
+        texture->resident_mip = upload->target_mip;
+        texture->busy = false;
+        streamer->handles[upload->texture] = handle;
+    }
+
+    streamer->upload_count = 0;
+}
+
+u32 texture_effective_wanted_mip(TextureStreamer *streamer, Texture *texture, u64 frame) {
+    u32 wanted = texture->wanted_mip;
+    if (frame > texture->last_used_frame + TEXTURE_IDLE_FRAMES) {
+        wanted = texture->tail_mip;
+    }
+
+    return wanted < texture->min_mip ? texture->min_mip : wanted;
+}
+
+// Evicts from the texture that is the most over-resident, falling back to the least recently used one
+Texture *texture_select_eviction(TextureStreamer *streamer, u64 frame) {
+    Texture *best = NULL;
+    u32 best_excess = 0;
+
+    for (u32 i = 0; i < streamer->texture_count; ++i) {
+        Texture *texture = &streamer->textures[i];
+        if (texture->busy || texture->resident_mip >= texture->tail_mip) {
+            continue;
+        }
+
+        u32 wanted = texture_effective_wanted_mip(streamer, texture, frame);
+        u32 excess = wanted > texture->resident_mip ? wanted - texture->resident_mip : 0;
+        if (best == NULL || excess > best_excess ||
+            (excess == best_excess && texture->last_used_frame < best->last_used_frame)) {
+            best = texture;
+            best_excess = excess;
+        }
+    }
+
+    return best;
+}
+
+// Promotes the texture that is furthest from the detail it wants, preferring recently used ones
+Texture *texture_select_promotion(TextureStreamer *streamer, u64 frame) {
+    Texture *best = NULL;
+    u32 best_deficit = 0;
+
+    for (u32 i = 0; i < streamer->texture_count; ++i) {
+        Texture *texture = &streamer->textures[i];
+        if (texture->busy) {
+            continue;
+        }
+
+        u32 wanted = texture_effective_wanted_mip(streamer, texture, frame);
+        if (texture->resident_mip <= wanted) {
+            continue;
+        }
+
+        u32 deficit = texture->resident_mip - wanted;
+        if (best == NULL || deficit > best_deficit ||
+            (deficit == best_deficit && texture->last_used_frame > best->last_used_frame)) {
+            best = texture;
+            best_deficit = deficit;
+        }
+    }
+
+    return best;
+}
+
+void texture_decode(void *data) {
+    TextureUpload *upload = data;
+    Ktx2File *ktx = upload->ktx;
+    for (u32 level = upload->target_mip; level < ktx->level_count; ++level) {
+        u64 size = ktx->levels[level].uncompressed_size;
+        if (!ktx2_read_level(ktx, level, upload->staging + upload->offsets[level], size)) {
+            upload->failed_level = level;
+            return;
+        }
+    }
+    upload->failed_level = ktx->level_count;
+}
+
+// Creates the image and reserves its staging range, then queues a job to decode the levels into it. Nothing is
+// recorded until the job is done, so the resident image stays in use if a level fails to read.
+bool texture_queue_upload(VulkanContext *context, TextureStreamer *streamer, u32 texture_id, u32 target_mip,
+                          VkDeviceSize *staging_offset) {
+    Texture *texture = &streamer->textures[texture_id];
+    Ktx2File *ktx = &texture->ktx;
+
+    VkDeviceSize staging_size = texture_staging_size(texture, target_mip);
+    if (staging_size > TEXTURE_STAGING_SIZE) {
+        LOG_ERROR("Texture %u level %u doesn't fit the staging buffer, clamping its resolution", texture_id,
+                  target_mip);
+        texture->min_mip = target_mip + 1;
+        return false;
+    }
+
+    if (texture_align(*staging_offset, TEXTURE_STAGING_ALIGNMENT) + staging_size > TEXTURE_STAGING_SIZE) {
+        return false;
+    }
+
+    ImageConfig config = {
+            .format = ktx->format,
+            .extent = ktx2_level_extent(ktx, target_mip),
+            .mip_levels = ktx->level_count - target_mip,
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            .aspect = VK_IMAGE_ASPECT_COLOR_BIT,
+            .memory_properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    };
+
+    TextureUpload *upload = &streamer->uploads[streamer->upload_count];
+    *upload = (TextureUpload) {.texture = texture_id, .target_mip = target_mip, .ktx = ktx,
+                               .staging = streamer->staging.mapped};
+    if (!image_create(&context->physical_device, &context->device, &config, &upload->image)) {
+        return false;
+    }
+
+    VkDeviceSize offset = *staging_offset;
+    for (u32 level = target_mip; level < ktx->level_count; ++level) {
+        offset = texture_align(offset, TEXTURE_STAGING_ALIGNMENT);
+        upload->offsets[level] = offset;
+        offset += ktx->levels[level].uncompressed_size;
+    }
+    *staging_offset = offset;
+
+    streamer->resident_bytes += upload->image.size;
+    streamer->upload_count++;
+    texture->busy = true;
+    job_run(texture_decode, upload, &streamer->decode_jobs);
+    return true;
+}
+
+void texture_record_upload(VkCommandBuffer command_buffer, TextureStreamer *streamer, TextureUpload *upload) {
+    Ktx2File *ktx = upload->ktx;
+    image_transition(command_buffer, upload->image.vk_image, VK_IMAGE_ASPECT_COLOR_BIT, 0, upload->image.mip_levels,
+                     VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                     VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    for (u32 level = upload->target_mip; level < ktx->level_count; ++level) {
+        VkExtent2D extent = ktx2_level_extent(ktx, level);
+        VkBufferImageCopy region = {0};
+        region.bufferOffset = upload->offsets[level];
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = level - upload->target_mip;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent.width = extent.width;
+        region.imageExtent.height = extent.height;
+        region.imageExtent.depth = 1;
+        vkCmdCopyBufferToImage(command_buffer, streamer->staging.vk_buffer, upload->image.vk_image,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    }
+
+    image_transition(command_buffer, upload->image.vk_image, VK_IMAGE_ASPECT_COLOR_BIT, 0, upload->image.mip_levels,
+                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                     VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+}
+
+// Records and submits the copies of a decoded batch, uploads whose levels failed to read are dropped. Their images
+// were never recorded, so they are destroyed right away.
+void texture_submit_uploads(VulkanContext *context, TextureStreamer *streamer) {
+    VkCommandBuffer command_buffer = streamer->command_buffer;
+    VK_CHECK(vkResetCommandBuffer(command_buffer, 0));
+    VkCommandBufferBeginInfo begin_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK(vkBeginCommandBuffer(command_buffer, &begin_info));
+
+    u32 kept = 0;
+    for (u32 i = 0; i < streamer->upload_count; ++i) {
+        TextureUpload *upload = &streamer->uploads[i];
+        Texture *texture = &streamer->textures[upload->texture];
+        if (upload->failed_level < upload->ktx->level_count) {
+            LOG_ERROR("Failed to read level %u of texture %u, clamping its resolution", upload->failed_level,
+                      upload->texture);
+            texture->min_mip = upload->failed_level + 1;
+            texture->busy = false;
+            streamer->resident_bytes -= upload->image.size;
+            image_destroy(&context->device, &upload->image);
+            continue;
+        }
+
+        texture_record_upload(command_buffer, streamer, upload);
+        streamer->uploads[kept++] = *upload;
+    }
+    streamer->upload_count = kept;
+    streamer->decoding = false;
+
+    VK_CHECK(vkEndCommandBuffer(command_buffer));
+
+    if (streamer->upload_count == 0) {
+        return;
+    }
+
+    VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &command_buffer;
+    VK_CHECK(vkResetFences(context->device.vk_device, 1, &streamer->fence));
+    VK_CHECK(vkQueueSubmit(context->device.queues[QUEUE_FEATURE_GRAPHICS].vk_queue, 1, &submit_info,
+                           streamer->fence));
+}
+
+void texture_prefetch(Texture *texture, u32 target_mip) {
+    for (u32 level = target_mip; level < texture->ktx.level_count; ++level) {
+        Ktx2Level *info = &texture->ktx.levels[level];
+        mapped_file_prefetch(&texture->ktx.file, info->offset, info->size);
+    }
+}
+
+void texture_streamer_update(VulkanContext *context, TextureStreamer *streamer) {
+    Device *device = &context->device;
+    u64 frame = context->frame_number;
+
+    texture_collect_retired(context, streamer);
+
+    if (streamer->decoding) {
+        if (atomic_load_explicit(&streamer->decode_jobs.pending, memory_order_acquire) > 0) {
+            return;
+        }
+        texture_submit_uploads(context, streamer);
+        return;
+    }
+
+    if (streamer->upload_count > 0) {
+        if (vkGetFenceStatus(device->vk_device, streamer->fence) != VK_SUCCESS) {
+            return;
+        }
+        texture_finish_uploads(context, streamer);
+    }
+
+    if (streamer->retired_count + TEXTURE_UPLOAD_BATCH > TEXTURE_RETIRED_CAPACITY) {
+        return;
+    }
+
+    // Budget decisions look at what will be resident once retired and replaced images are gone
+    VkDeviceSize releasing = streamer->retired_bytes;
+    VkDeviceSize staging_offset = 0;
+    while (streamer->upload_count < TEXTURE_UPLOAD_BATCH) {
+        Texture *texture = NULL;
+        u32 target_mip = 0;
+        VkDeviceSize projected = streamer->resident_bytes - releasing;
+
+        if (projected > streamer->budget) {
+            // Over budget: drop the finest resident level of the best eviction candidate
+            texture = texture_select_eviction(streamer, frame);
+            if (texture == NULL) {
+                break;
+            }
+            target_mip = texture->resident_mip + 1;
+        } else {
+            texture = texture_select_promotion(streamer, frame);
+            if (texture == NULL) {
+                break;
+            }
+
+            // Unloaded textures jump straight to their mip tail, or the finest level that still reads, then gain one
+            // level per upload
+            u32 first_mip = texture->tail_mip > texture->min_mip ? texture->tail_mip : texture->min_mip;
+            target_mip = texture->resident_mip >= texture->ktx.level_count ? first_mip : texture->resident_mip - 1;
+
+            VkDeviceSize estimate = texture_staging_size(texture, target_mip);
+            if (projected + estimate > streamer->budget) {
+                break;
+            }
+        }
+
+        u32 texture_id = (u32) (texture - streamer->textures);
+        VkDeviceSize replaced = texture->image.size;
+        texture_prefetch(texture, target_mip);
+        if (!texture_queue_upload(context, streamer, texture_id, target_mip, &staging_offset)) {
+            break;
+        }
+        releasing += replaced;
+    }
+
+    streamer->decoding = streamer->upload_count > 0;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <std/defines.h>
+#include "vulkan_types.h"
+#include "buffer.h"
+#include "image.h"
+#include "ktx2.h"
+#include "memory_budget.h"
+#include "core/job.h"
+
+#define TEXTURE_MAX_COUNT 4096
+#define TEXTURE_INVALID UINT32_MAX
+#define TEXTURE_STAGING_SIZE (32 * 1024 * 1024)
+#define TEXTURE_UPLOAD_BATCH 32
+#define TEXTURE_DEFAULT_BUDGET (512ull * 1024 * 1024)
+
+// Levels no larger than this are uploaded together as soon as a texture is loaded
+#define TEXTURE_MIP_TAIL_SIZE 64
+
+// Textures not requested for this many frames only keep their mip tail wanted
+#define TEXTURE_IDLE_FRAMES 120
+
+typedef struct VulkanContext VulkanContext;
+
+typedef struct Texture {
+    Ktx2File ktx;
+
+    // Holds levels [resident_mip, level_count) of the file, resident_mip == level_count while nothing is loaded
+    Image image;
+    u32 image_handle;
+    u32 resident_mip;
+
+    u32 wanted_mip;
+    u32 tail_mip;
+    // Finest level whose upload fits the staging buffer and reads from the file
+    u32 min_mip;
+    u64 last_used_frame;
+    bool busy;
+} Texture;
+
+typedef struct TextureUpload {
+    u32 texture;
+    u32 target_mip;
+    Image image;
+
+    // Read by the decode job, which writes each level to staging at its offset
+    Ktx2File *ktx;
+    u8 *staging;
+    VkDeviceSize offsets[KTX2_MAX_LEVELS];
+    // Written by the decode job: the first level that failed to read, level_count when all of them did
+    u32 failed_level;
+} TextureUpload;
+
+typedef struct TextureRetired {
+    Image image;
+    u64 frame;
+} TextureRetired;
+
+typedef struct TextureStreamer {
+    Texture *textures;
+    u32 texture_count;
+
+    // Texture id -> bindless image handle, read by shaders so images can be swapped without touching materials
+    Buffer handle_table;
+    u32 *handles;
+    u32 handle_table_handle;
+
+    VkSampler sampler;
+    u32 sampler_handle;
+    Image fallback;
+    u32 fallback_handle;
+
+    Buffer staging;
+    VkCommandBuffer command_buffer;
+    VkFence fence;
+    TextureUpload uploads[TEXTURE_UPLOAD_BATCH];
+    u32 upload_count;
+    // Set while jobs decode the batch into staging, its copies are recorded once decode_jobs drains
+    bool decoding;
+    JobCounter decode_jobs;
+
+    TextureRetired *retired;
+    u32 retired_count;
+
+    // Lowered below requested_budget while the device is under memory pressure
+    VkDeviceSize budget;
+    VkDeviceSize requested_budget;
+    // Includes retired images that are still waiting for in-flight frames to finish
+    VkDeviceSize resident_bytes;
+    VkDeviceSize retired_bytes;
+} TextureStreamer;
+
+bool texture_streamer_create(VulkanContext *context, VkDeviceSize budget, TextureStreamer *out);
+
+void texture_streamer_destroy(VulkanContext *context, TextureStreamer *streamer);
+
+void texture_streamer_set_budget(TextureStreamer *streamer, VkDeviceSize budget);
+
+// MemoryPressureCallback that shrinks the budget under pressure, so the streamer evicts fine mips, and grows it back
+// towards the requested budget once the pressure is gone
+void texture_streamer_memory_pressure(void *data, const MemoryPressureEvent *event);
+
+// Retires finished uploads, then starts the next batch of promotions or evictions without blocking. Levels are decoded
+// by jobs, the render thread only records the copies on a later update.
+void texture_streamer_update(VulkanContext *context, TextureStreamer *streamer);
+
+u32 texture_load(TextureStreamer *streamer, const char *path);
+
+// Reports how many pixels the texture covers on screen this frame, which drives the mip it streams towards
+void texture_request(TextureStreamer *streamer, u32 texture, float screen_pixels, u64 frame);
@@ -0,0 +1,135 @@
+#include "upload.h"
+#include "host_allocator.h"
+#include "vulkan.h"
+#include <string.h>
+
+bool uploader_create(VulkanContext *context, Uploader *out) {
+    Uploader result = {0};
+    Device *device = &context->device;
+
+    for (u32 i = 0; i < UPLOAD_SLOT_COUNT; ++i) {
+        UploadSlot *slot = &result.slots[i];
+        if (!buffer_create(&context->physical_device, device, UPLOAD_STAGING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                           &slot->staging)) {
+            LOG_ERROR("Couldn't create upload staging buffer!");
+            return false;
+        }
+
+        VkCommandBufferAllocateInfo allocate_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocate_info.commandPool = context->command_pool;
+        allocate_info.commandBufferCount = 1;
+        allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        VK_CHECK(vkAllocateCommandBuffers(device->vk_device, &allocate_info, &slot->command_buffer));
+
+        VkFenceCreateInfo fence_create_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+        fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        VK_CHECK(vkCreateFence(device->vk_device, &fence_create_info, host_allocator(), &slot->fence));
+    }
+
+    *out = result;
+    return true;
+}
+
+void uploader_destroy(VulkanContext *context, Uploader *uploader) {
+    Device *device = &context->device;
+
+    for (u32 i = 0; i < UPLOAD_SLOT_COUNT; ++i) {
+        UploadSlot *slot = &uploader->slots[i];
+        VK_CHECK(vkWaitForFences(device->vk_device, 1, &slot->fence, VK_TRUE, UINT64_MAX));
+
+        vkDestroyFence(device->vk_device, slot->fence, host_allocator());
+        slot->fence = NULL;
+        vkFreeCommandBuffers(device->vk_device, context->command_pool, 1, &slot->command_buffer);
+        slot->command_buffer = NULL;
+        buffer_destroy(device, &slot->staging);
+    }
+}
+
+void uploader_begin_slot(VulkanContext *context, UploadSlot *slot) {
+    // The slot's previous copies must be done before its staging memory is overwritten
+    VK_CHECK(vkWaitForFences(context->device.vk_device, 1, &slot->fence, VK_TRUE, UINT64_MAX));
+    VK_CHECK(vkResetFences(context->device.vk_device, 1, &slot->fence));
+    VK_CHECK(vkResetCommandBuffer(slot->command_buffer, 0));
+
+    VkCommandBufferBeginInfo begin_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK(vkBeginCommandBuffer(slot->command_buffer, &begin_info));
+
+    slot->used = 0;
+    slot->recording = true;
+}
+
+void uploader_submit_slot(VulkanContext *context, UploadSlot *slot) {
+    VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    VkPipelineStageFlags stages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+    if (context->device.mesh_shader) {
+        stages |= VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_MESH_SHADER_BIT_EXT;
+    }
+    vkCmdPipelineBarrier(slot->command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, stages, 0, 1, &barrier, 0, NULL, 0,
+                         NULL);
+    VK_CHECK(vkEndCommandBuffer(slot->command_buffer));
+
+    VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &slot->command_buffer;
+    VK_CHECK(vkQueueSubmit(context->device.queues[QUEUE_FEATURE_GRAPHICS].vk_queue, 1, &submit_info, slot->fence));
+
+    slot->recording = false;
+}
+
+void uploader_copy_to_buffer(VulkanContext *context, Uploader *uploader, Buffer *destination, VkDeviceSize offset,
+                             const void *data, VkDeviceSize size) {
+    const u8 *source = data;
+
+    while (size > 0) {
+        UploadSlot *slot = &uploader->slots[uploader->current];
+        if (!slot->recording) {
+            uploader_begin_slot(context, slot);
+        }
+
+        VkDeviceSize available = slot->staging.size - slot->used;
+        if (available == 0) {
+            uploader_submit_slot(context, slot);
+            uploader->current = (uploader->current + 1) % UPLOAD_SLOT_COUNT;
+            continue;
+        }
+
+        VkDeviceSize chunk = size < available ? size : available;
+        memcpy((u8 *) slot->staging.mapped + slot->used, source, chunk);
+
+        VkBufferCopy region = {
+                .srcOffset = slot->used,
+                .dstOffset = offset,
+                .size = chunk
+        };
+        vkCmdCopyBuffer(slot->command_buffer, slot->staging.vk_buffer, destination->vk_buffer, 1, &region);
+
+        // Keep the next staging offset aligned for any copy granularity
+        slot->used += (chunk + 15) & ~(VkDeviceSize) 15;
+        if (slot->used > slot->staging.size) {
+            slot->used = slot->staging.size;
+        }
+
+        source += chunk;
+        offset += chunk;
+        size -= chunk;
+    }
+}
+
+void uploader_flush(VulkanContext *context, Uploader *uploader) {
+    for (u32 i = 0; i < UPLOAD_SLOT_COUNT; ++i) {
+        UploadSlot *slot = &uploader->slots[i];
+        if (slot->recording) {
+            uploader_submit_slot(context, slot);
+        }
+    }
+
+    for (u32 i = 0; i < UPLOAD_SLOT_COUNT; ++i) {
+        VK_CHECK(vkWaitForFences(context->device.vk_device, 1, &uploader->slots[i].fence, VK_TRUE, UINT64_MAX));
+    }
+}
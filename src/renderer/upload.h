@@ -0,0 +1,34 @@
+#pragma once
+
+#include <std/defines.h>
+#include "vulkan_types.h"
+#include "buffer.h"
+
+#define UPLOAD_STAGING_SIZE (16 * 1024 * 1024)
+#define UPLOAD_SLOT_COUNT 2
+
+typedef struct VulkanContext VulkanContext;
+
+typedef struct UploadSlot {
+    Buffer staging;
+    VkDeviceSize used;
+    VkCommandBuffer command_buffer;
+    VkFence fence;
+    bool recording;
+} UploadSlot;
+
+// Double buffered staging: one slot is filled from the CPU while the other is being copied by the GPU
+typedef struct Uploader {
+    UploadSlot slots[UPLOAD_SLOT_COUNT];
+    u32 current;
+} Uploader;
+
+bool uploader_create(VulkanContext *context, Uploader *out);
+
+void uploader_destroy(VulkanContext *context, Uploader *uploader);
+
+void uploader_copy_to_buffer(VulkanContext *context, Uploader *uploader, Buffer *destination, VkDeviceSize offset,
+                             const void *data, VkDeviceSize size);
+
+// Submits pending copies and waits for all of them, the destination buffers are ready for use afterwards
+void uploader_flush(VulkanContext *context, Uploader *uploader);
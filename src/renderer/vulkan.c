@@ -3,12 +3,24 @@
 #include "framebuffer.h"
 #include "command_pool.h"
 #include "command_buffer.h"
+#include "pipeline_cache.h"
+#include "core/alloc_counter.h"
+#include "core/arena.h"
 #include <std/containers/darray.h>
 #include <SDL_vulkan.h>
 #include <vulkan/vk_enum_string_helper.h>
+#include <string.h>
 
 static VulkanContext context = {0};
 
+void render_packet(RenderPacket *packet);
+
+u32 vulkan_frame_rate_cap(const PresentSettings *settings);
+
+void vulkan_update_frame_budget(u32 cap);
+
+bool build_render_graph(VulkanContext *context);
+
 bool create_device(VulkanContext *context) {
     device_create(&context->physical_device, &context->surface, &context->device);
 
@@ -22,25 +34,49 @@ bool create_device(VulkanContext *context) {
         return false;
     }
 
-    return true;
+    if (!bindless_create(&context->physical_device, &context->device, &context->bindless)) {
+        LOG_ERROR("Couldn't create the bindless resource table!");
+        return false;
+    }
+
+    if (!material_table_create(&context->physical_device, &context->device, &context->bindless,
+                               &context->materials)) {
+        LOG_ERROR("Couldn't create the material table!");
+        return false;
+    }
+
+    Material default_material = {
+            .base_color = {1.0f, 1.0f, 1.0f, 1.0f},
+            .albedo_texture = TEXTURE_INVALID,
+            .albedo_sampler = BINDLESS_INVALID_HANDLE
+    };
+    context->default_material = material_create(&context->materials, &default_material);
+
+    return context->default_material != MATERIAL_INVALID;
 }
 
 bool recreate_swap_chain(SDL_Window *window) {
+    u64 allocations = alloc_counter_read();
+    u64 recreate_start = SDL_GetPerformanceCounter();
     if (context.swapchain.vk_swapchain != NULL) {
         framebuffer_destroy(&context);
         swapchain_destroy(&context.device, &context.swapchain);
     }
 
-    if (!swapchain_init(window, &context.physical_device, &context.device, &context.surface, &context.swapchain)) {
+    if (!swapchain_init(window, &context.physical_device, &context.device, &context.surface, &context.present,
+                        &context.swapchain)) {
         LOG_ERROR("Couldn't create a swapchain!");
         return false;
     }
 
     if (context.graphics_pipeline.vk_pipeline == NULL) {
-        if (!graphics_pipeline_create(&context.device, &context.swapchain, &context.graphics_pipeline)) {
+        u64 start = SDL_GetPerformanceCounter();
+        if (!graphics_pipeline_create(&context.physical_device, &context.device, &context.swapchain,
+                                      &context.bindless, &context.graphics_pipeline)) {
             LOG_ERROR("Couldn't create graphics vk_pipeline!");
             return false;
         }
+        context.init_stats.pipeline_ms += latency_ticks_to_ms(SDL_GetPerformanceCounter() - start);
     }
 
     if (!framebuffer_create(&context)) {
@@ -48,10 +84,35 @@ bool recreate_swap_chain(SDL_Window *window) {
         return false;
     }
 
+    if (context.depth_pyramid.pipeline != NULL && !depth_pyramid_resize(&context, &context.depth_pyramid)) {
+        LOG_ERROR("Couldn't resize the depth pyramid!");
+        return false;
+    }
+
+    if (context.render_graph.compiled && !build_render_graph(&context)) {
+        LOG_ERROR("Couldn't rebuild the render graph!");
+        return false;
+    }
+
+    // Only the renderer's own allocations, the driver's go through the host allocator and are reported by it
+    alloc_counter_check("Swapchain recreation", allocations);
+    LOG_DEBUG("Swapchain recreated at %ux%u in %.3f ms", context.swapchain.extent.width,
+              context.swapchain.extent.height, latency_ticks_to_ms(SDL_GetPerformanceCounter() - recreate_start));
     return true;
 }
 
-bool vulkan_init(SDL_Window *window, const char *app_name) {
+bool vulkan_init(SDL_Window *window, const char *app_name, const PresentSettings *present) {
+    u64 init_start = SDL_GetPerformanceCounter();
+    context.window = window;
+    context.present = *present;
+    if (!host_allocator_init()) {
+        return false;
+    }
+    frame_pacer_init(FRAME_PACING_THROUGHPUT, &context.pacer);
+    frame_limiter_init(&context.limiter);
+    frame_limiter_set_fps(&context.limiter, vulkan_frame_rate_cap(present));
+    resolution_scaler_init(&context.resolution);
+    vulkan_update_frame_budget(vulkan_frame_rate_cap(present));
     if (!vulkan_instance_create(window, app_name, &context.instance)) {
         LOG_ERROR("Unable to create Vulkan instance!");
         return false;
@@ -62,7 +123,8 @@ bool vulkan_init(SDL_Window *window, const char *app_name) {
         return false;
     }
 
-    if (!physical_device_select_best(context.instance.vk_instance, &context.physical_device)) {
+    if (!physical_device_select_best(context.instance.vk_instance, context.prefer_software_device,
+                                     &context.physical_device)) {
         LOG_ERROR("Couldn't find a suitable GPU!");
         return false;
     }
@@ -72,59 +134,353 @@ bool vulkan_init(SDL_Window *window, const char *app_name) {
         return false;
     }
 
+    if (!pipeline_cache_create(&context.physical_device, &context.device, PIPELINE_CACHE_PATH,
+                               &context.device.pipeline_cache)) {
+        return false;
+    }
+
     if (!recreate_swap_chain(window)) {
         LOG_ERROR("Couldn't create a swapchain!");
         return false;
     }
 
+    if (!memory_budget_create(&context.physical_device, &context.device, &context.memory_budget)) {
+        LOG_ERROR("Couldn't create the memory budget tracker!");
+        return false;
+    }
+
     const int max_renderers = 3;
     command_pool_create(&context);
     renderer_instance_create(&context, max_renderers);
 
+    if (!texture_streamer_create(&context, TEXTURE_DEFAULT_BUDGET, &context.textures)) {
+        LOG_ERROR("Couldn't create the texture streamer!");
+        return false;
+    }
+    memory_budget_add_callback(&context.memory_budget, texture_streamer_memory_pressure, &context.textures);
+
+    if (!uploader_create(&context, &context.uploader)) {
+        LOG_ERROR("Couldn't create the uploader!");
+        return false;
+    }
+
+    if (!mesh_pool_create(&context, &context.meshes)) {
+        LOG_ERROR("Couldn't create the mesh pool!");
+        return false;
+    }
+
+    // Almost all of it is creating the meshlet pipelines
+    u64 meshlet_start = SDL_GetPerformanceCounter();
+    if (!meshlet_renderer_create(&context, &context.meshlet_renderer)) {
+        LOG_ERROR("Couldn't create the meshlet renderer!");
+        return false;
+    }
+    context.init_stats.pipeline_ms += latency_ticks_to_ms(SDL_GetPerformanceCounter() - meshlet_start);
+
+    if (!light_clusters_create(&context, &context.lights)) {
+        LOG_ERROR("Couldn't create the light clusters!");
+        return false;
+    }
+
+    if (!particle_system_create(&context, &context.particles)) {
+        LOG_ERROR("Couldn't create the particle system!");
+        return false;
+    }
+
+    if (!depth_pyramid_create(&context, &context.depth_pyramid)) {
+        LOG_ERROR("Couldn't create the depth pyramid!");
+        return false;
+    }
+
+    if (!debug_overlay_create(&context, &context.overlay)) {
+        LOG_ERROR("Couldn't create the debug overlay!");
+        return false;
+    }
+
+    if (!build_render_graph(&context)) {
+        LOG_ERROR("Couldn't build the render graph!");
+        return false;
+    }
+
+    if (!frame_timing_create(&context, &context.pacer, &context.timing)) {
+        LOG_ERROR("Couldn't create the frame timing queries!");
+        return false;
+    }
+
+    if (!render_thread_create(render_packet, &context.render_thread)) {
+        LOG_ERROR("Couldn't create the render thread!");
+        return false;
+    }
+    render_thread_start(&context.render_thread);
+
+    context.init_stats.init_ms = latency_ticks_to_ms(SDL_GetPerformanceCounter() - init_start);
     return true;
 }
 
 void vulkan_shutdown() {
+    command_stream_writer_close(&context.command_stream);
+    render_thread_destroy(&context.render_thread);
+    vkDeviceWaitIdle(context.device.vk_device);
+    frame_capture_stop(&context, &context.capture);
+    frame_timing_destroy(&context, &context.timing);
     renderer_instance_destroy(&context);
+    texture_streamer_destroy(&context, &context.textures);
+    meshlet_renderer_destroy(&context, &context.meshlet_renderer);
+    light_clusters_destroy(&context, &context.lights);
+    particle_system_destroy(&context, &context.particles);
+    depth_pyramid_destroy(&context, &context.depth_pyramid);
+    debug_overlay_destroy(&context, &context.overlay);
+    mesh_pool_destroy(&context, &context.meshes);
+    uploader_destroy(&context, &context.uploader);
     command_pool_destroy(&context);
+    render_graph_destroy(&context.device, &context.render_graph);
     framebuffer_destroy(&context);
     graphics_pipeline_destroy(&context.device, &context.graphics_pipeline);
+    pipeline_cache_save(&context.device, context.device.pipeline_cache, PIPELINE_CACHE_PATH);
+    pipeline_cache_destroy(&context.device, context.device.pipeline_cache);
     physical_device_destroy(&context.physical_device);
     swapchain_destroy(&context.device, &context.swapchain);
+    material_table_destroy(&context.device, &context.bindless, &context.materials, context.frame_number);
+    bindless_destroy(&context.device, &context.bindless);
     device_destroy(&context.device);
     vkDestroySurfaceKHR(context.instance.vk_instance, context.surface, NULL);
     vulkan_instance_destroy(&context.instance);
+    host_allocator_shutdown();
+    scratch_release();
+
+    bool prefer_software_device = context.prefer_software_device;
+    context = (VulkanContext) {0};
+    context.prefer_software_device = prefer_software_device;
 }
 
-void begin_frame(u32 image_index) {
-    command_buffer_begin(context.current_renderer);
-    render_pass_begin(&context, image_index);
-    bind_pipeline(&context);
+void vulkan_prefer_software_device(bool prefer) {
+    context.prefer_software_device = prefer;
+}
+
+void vulkan_init_stats(VulkanInitStats *out) {
+    *out = context.init_stats;
+}
+
+void main_pass(VulkanContext *context, VkCommandBuffer command_buffer, void *data) {
+    VkExtent2D extent = context->resolution.extent;
+    render_pass_begin(context, extent);
+    bind_pipeline(context);
 
     VkViewport viewport = {0};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
-    viewport.width = context.swapchain.extent.width;
-    viewport.height = context.swapchain.extent.height;
+    viewport.width = extent.width;
+    viewport.height = extent.height;
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(context.current_renderer->command_buffer, 0, 1, &viewport);
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
 
     VkRect2D scissor = {0};
     scissor.offset.x = 0;
     scissor.offset.y = 0;
-    scissor.extent = context.swapchain.extent;
-    vkCmdSetScissor(context.current_renderer->command_buffer, 0, 1, &scissor);
+    scissor.extent = extent;
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+
+    BindlessDrawConstants draw_constants = {
+            .material_buffer = context->materials.buffer_handle,
+            .material_index = context->default_material,
+            .texture_table = context->textures.handle_table_handle
+    };
+    push_draw_constants(context, &draw_constants);
+    vkCmdDraw(command_buffer, 3, 1, 0, 0);
+    meshlet_renderer_draw(context, &context->meshlet_renderer);
+    particle_system_draw(context, &context->particles);
+    debug_overlay_draw(context, &context->overlay);
+    render_pass_end(context);
+}
+
+// Scales the rendered part of the scene color image up to the whole swapchain image
+void upscale_pass(VulkanContext *context, VkCommandBuffer command_buffer, void *data) {
+    VkExtent2D source = context->resolution.extent;
+    VkExtent2D destination = context->swapchain.extent;
+
+    VkImageBlit region = {0};
+    region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.srcSubresource.layerCount = 1;
+    region.srcOffsets[1] = (VkOffset3D) {(i32) source.width, (i32) source.height, 1};
+    region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.dstSubresource.layerCount = 1;
+    region.dstOffsets[1] = (VkOffset3D) {(i32) destination.width, (i32) destination.height, 1};
+
+    VkFilter filter = source.width == destination.width && source.height == destination.height
+                              ? VK_FILTER_NEAREST : context->upscale_filter;
+    vkCmdBlitImage(command_buffer, context->scene_color.vk_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                   context->swapchain.images[context->image_index], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,
+                   &region, filter);
 }
 
-void end_frame(u32 image_index) {
-    render_pass_end(&context);
+bool build_render_graph(VulkanContext *context) {
+    RenderGraph *graph = &context->render_graph;
+    render_graph_reset(&context->device, graph);
+
+    // Acquire waits in the transfer stage, the graph moves the image out of whatever layout it had
+    context->graph_backbuffer = render_graph_import_image(graph, "backbuffer", VK_IMAGE_ASPECT_COLOR_BIT,
+                                                          VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                                                          VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    render_graph_mark_output(graph, context->graph_backbuffer);
+
+    // Shared by the frames in flight, the previous frame's blit may still be reading it
+    context->graph_scene_color = render_graph_import_image(graph, "scene_color", VK_IMAGE_ASPECT_COLOR_BIT,
+                                                           VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                                                           VK_IMAGE_LAYOUT_UNDEFINED);
+
+    // Meshlets are culled against the pyramid the frame before built from its depth, both are shared by the frames
+    // in flight. The pyramid stays in the general layout, its build makes the writes visible to compute itself.
+    MeshletRenderer *meshlets = &context->meshlet_renderer;
+    context->graph_depth = RENDER_GRAPH_INVALID;
+    context->graph_depth_pyramid = RENDER_GRAPH_INVALID;
+    if (meshlets->path != MESHLET_PATH_NONE) {
+        VkImageAspectFlags depth_aspect = framebuffer_depth_aspect(context->graphics_pipeline.depth_format);
+        context->graph_depth = render_graph_import_image(graph, "depth", depth_aspect, VK_IMAGE_LAYOUT_UNDEFINED,
+                                                         VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                                                         VK_IMAGE_LAYOUT_UNDEFINED);
+        context->graph_depth_pyramid = render_graph_import_image(graph, "depth_pyramid", VK_IMAGE_ASPECT_COLOR_BIT,
+                                                                 VK_IMAGE_LAYOUT_GENERAL,
+                                                                 VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                                                                 VK_IMAGE_LAYOUT_UNDEFINED);
+    }
+
+    context->graph_meshlet_commands = RENDER_GRAPH_INVALID;
+    if (meshlets->path == MESHLET_PATH_INDIRECT) {
+        context->graph_meshlet_commands = render_graph_import_buffer(graph, "meshlet_commands", 0);
+        u32 clear = render_graph_add_pass(graph, "meshlet_clear", 0, meshlet_renderer_clear_pass, meshlets);
+        render_graph_use(graph, clear, context->graph_meshlet_commands, RENDER_GRAPH_ACCESS_TRANSFER_WRITE);
+        u32 cull = render_graph_add_pass(graph, "meshlet_cull", VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                                         meshlet_renderer_cull_pass, meshlets);
+        render_graph_use(graph, cull, context->graph_meshlet_commands, RENDER_GRAPH_ACCESS_STORAGE_WRITE);
+        render_graph_use(graph, cull, context->graph_depth_pyramid, RENDER_GRAPH_ACCESS_STORAGE_READ);
+    }
+
+    // Each renderer instance has its own cluster lists, written before the main pass shades with them
+    LightClusters *lights = &context->lights;
+    context->graph_light_clusters = render_graph_import_buffer(graph, "light_clusters", 0);
+    u32 light_clear = render_graph_add_pass(graph, "light_clear", 0, light_clusters_clear_pass, lights);
+    render_graph_use(graph, light_clear, context->graph_light_clusters, RENDER_GRAPH_ACCESS_TRANSFER_WRITE);
+    u32 light_assign = render_graph_add_pass(graph, "light_assign", VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                                             light_clusters_assign_pass, lights);
+    render_graph_use(graph, light_assign, context->graph_light_clusters, RENDER_GRAPH_ACCESS_STORAGE_WRITE);
+
+    // Persistent across frames, so each one's first use waits for the draw of the frame before
+    ParticleSystem *particles = &context->particles;
+    context->graph_particle_state = RENDER_GRAPH_INVALID;
+    context->graph_particle_counters = RENDER_GRAPH_INVALID;
+    context->graph_particle_dispatch = RENDER_GRAPH_INVALID;
+    if (particles->settings.capacity > 0) {
+        context->graph_particle_state = render_graph_import_buffer(graph, "particle_state",
+                                                                   VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT);
+        context->graph_particle_counters = render_graph_import_buffer(graph, "particle_counters",
+                                                                      VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT);
+        context->graph_particle_dispatch = render_graph_import_buffer(graph, "particle_dispatch",
+                                                                      VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT);
+
+        u32 begin = render_graph_add_pass(graph, "particle_begin", VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                                          particle_system_begin_pass, particles);
+        render_graph_use(graph, begin, context->graph_particle_counters, RENDER_GRAPH_ACCESS_STORAGE_WRITE);
+        render_graph_use(graph, begin, context->graph_particle_dispatch, RENDER_GRAPH_ACCESS_STORAGE_WRITE);
+        u32 emit = render_graph_add_pass(graph, "particle_emit", VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                                         particle_system_emit_pass, particles);
+        render_graph_use(graph, emit, context->graph_particle_counters, RENDER_GRAPH_ACCESS_STORAGE_READ);
+        render_graph_use(graph, emit, context->graph_particle_state, RENDER_GRAPH_ACCESS_STORAGE_WRITE);
+        u32 update = render_graph_add_pass(graph, "particle_update", VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                                           particle_system_update_pass, particles);
+        render_graph_use(graph, update, context->graph_particle_dispatch, RENDER_GRAPH_ACCESS_INDIRECT);
+        render_graph_use(graph, update, context->graph_particle_state, RENDER_GRAPH_ACCESS_STORAGE_WRITE);
+        render_graph_use(graph, update, context->graph_particle_counters, RENDER_GRAPH_ACCESS_STORAGE_WRITE);
+    }
+
+    VkPipelineStageFlags2 draw_stages = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT |
+                                        VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+    if (meshlets->path == MESHLET_PATH_MESH_SHADER) {
+        draw_stages |= VK_PIPELINE_STAGE_2_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT;
+    }
+    u32 main = render_graph_add_pass(graph, "main", draw_stages, main_pass, NULL);
+    render_graph_use(graph, main, context->graph_scene_color, RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT);
+    if (context->graph_meshlet_commands != RENDER_GRAPH_INVALID) {
+        render_graph_use(graph, main, context->graph_meshlet_commands, RENDER_GRAPH_ACCESS_INDIRECT);
+    }
+    render_graph_use(graph, main, context->graph_light_clusters, RENDER_GRAPH_ACCESS_STORAGE_READ);
+    if (context->graph_particle_state != RENDER_GRAPH_INVALID) {
+        render_graph_use(graph, main, context->graph_particle_state, RENDER_GRAPH_ACCESS_STORAGE_READ);
+        render_graph_use(graph, main, context->graph_particle_counters, RENDER_GRAPH_ACCESS_INDIRECT);
+    }
+    if (context->graph_depth != RENDER_GRAPH_INVALID) {
+        render_graph_use(graph, main, context->graph_depth, RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT);
+        // Task shaders cull meshlets inside the main pass
+        if (meshlets->path == MESHLET_PATH_MESH_SHADER) {
+            render_graph_use(graph, main, context->graph_depth_pyramid, RENDER_GRAPH_ACCESS_STORAGE_READ);
+        }
+
+        // Nothing in this frame reads the pyramid, the next frame does
+        u32 pyramid = render_graph_add_pass(graph, "depth_pyramid", VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                                            depth_pyramid_build_pass, &context->depth_pyramid);
+        render_graph_use(graph, pyramid, context->graph_depth, RENDER_GRAPH_ACCESS_SAMPLED);
+        render_graph_use(graph, pyramid, context->graph_depth_pyramid, RENDER_GRAPH_ACCESS_STORAGE_WRITE);
+        render_graph_side_effects(graph, pyramid);
+    }
+
+    u32 upscale = render_graph_add_pass(graph, "upscale", 0, upscale_pass, NULL);
+    render_graph_use(graph, upscale, context->graph_scene_color, RENDER_GRAPH_ACCESS_TRANSFER_READ);
+    render_graph_use(graph, upscale, context->graph_backbuffer, RENDER_GRAPH_ACCESS_TRANSFER_WRITE);
+
+    if (context->capture.active) {
+        u32 capture = render_graph_add_pass(graph, "capture", 0, frame_capture_pass, &context->capture);
+        render_graph_use(graph, capture, context->graph_backbuffer, RENDER_GRAPH_ACCESS_TRANSFER_READ);
+        render_graph_side_effects(graph, capture);
+    }
+
+    return render_graph_compile(&context->physical_device, &context->device, graph);
+}
+
+void begin_frame(u32 image_index) {
+    context.image_index = image_index;
+    command_buffer_begin(context.current_renderer);
+    depth_pyramid_begin_frame(&context.depth_pyramid, context.current_renderer->command_buffer);
+    frame_timing_begin(&context, &context.timing, context.current_renderer_index,
+                       context.current_renderer->command_buffer);
+    meshlet_renderer_cull(&context, &context.meshlet_renderer);
+    light_clusters_update(&context, &context.lights, context.meshlet_renderer.view.view_projection);
+    particle_system_update(&context, &context.particles, context.meshlet_renderer.view.view_projection);
+
+    render_graph_set_image(&context.render_graph, context.graph_backbuffer, context.swapchain.images[image_index],
+                           context.swapchain.image_views[image_index]);
+    render_graph_set_image(&context.render_graph, context.graph_scene_color, context.scene_color.vk_image,
+                           context.scene_color.view);
+    if (context.graph_meshlet_commands != RENDER_GRAPH_INVALID) {
+        MeshletFrame *frame = &context.meshlet_renderer.frames[context.current_renderer_index];
+        render_graph_set_buffer(&context.render_graph, context.graph_meshlet_commands, frame->commands.vk_buffer);
+    }
+    if (context.graph_depth != RENDER_GRAPH_INVALID) {
+        DepthPyramid *pyramid = &context.depth_pyramid;
+        render_graph_set_image(&context.render_graph, context.graph_depth, context.depth_attachment.vk_image,
+                               pyramid->depth_view);
+        render_graph_set_image(&context.render_graph, context.graph_depth_pyramid, pyramid->image.vk_image,
+                               pyramid->image.view);
+    }
+    LightFrame *lights = &context.lights.frames[context.current_renderer_index];
+    render_graph_set_buffer(&context.render_graph, context.graph_light_clusters, lights->clusters.vk_buffer);
+    if (context.graph_particle_state != RENDER_GRAPH_INVALID) {
+        ParticleSystem *particles = &context.particles;
+        render_graph_set_buffer(&context.render_graph, context.graph_particle_state, particles->state.vk_buffer);
+        render_graph_set_buffer(&context.render_graph, context.graph_particle_counters, particles->counters.vk_buffer);
+        render_graph_set_buffer(&context.render_graph, context.graph_particle_dispatch, particles->dispatch.vk_buffer);
+    }
+    frame_timing_graph(&context.timing, context.current_renderer_index, &context.render_graph,
+                       context.current_renderer->command_buffer);
+}
+
+void end_frame(u32 image_index, const FrameInput *input) {
+    frame_timing_end(&context.timing, context.current_renderer_index, context.current_renderer->command_buffer);
     command_buffer_end(context.current_renderer);
 
     VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
 
     VkSemaphore semaphores[] = {context.current_renderer->image_available_semaphore};
-    VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+    VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_TRANSFER_BIT};
     submit_info.waitSemaphoreCount = sizeof(semaphores) / sizeof(VkSemaphore);
     submit_info.pWaitSemaphores = semaphores;
     submit_info.pWaitDstStageMask = wait_stages;
@@ -137,8 +493,11 @@ void end_frame(u32 image_index) {
 
     VkQueue graphics_queue = context.device.queues[QUEUE_FEATURE_GRAPHICS].vk_queue;
     VK_CHECK(vkQueueSubmit(graphics_queue, 1, &submit_info, context.current_renderer->in_flight_fence));
+    frame_timing_submitted(&context.timing);
 
+    VkPresentIdKHR present_id;
     VkPresentInfoKHR present_info = {VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
+    present_info.pNext = frame_timing_present(&context.timing, input, &present_id);
     present_info.waitSemaphoreCount = 1;
     present_info.pWaitSemaphores = signal_semaphores;
     present_info.swapchainCount = 1;
@@ -146,29 +505,347 @@ void end_frame(u32 image_index) {
     present_info.pImageIndices = &image_index;
     present_info.pResults = NULL;
     VK_CHECK(vkQueuePresentKHR(graphics_queue, &present_info));
+    frame_timing_presented(&context, &context.timing, context.swapchain.vk_swapchain);
 }
 
-void vulkan_render() {
+void render_frame(const FrameInput *input) {
+    u64 allocations = alloc_counter_read();
+    host_allocator_frame_begin();
     context.current_renderer = &context.renderer_instances[context.current_renderer_index];
 
     // Wait for the previous frame to finish
     VK_CHECK(vkWaitForFences(context.device.vk_device, 1, &context.current_renderer->in_flight_fence, VK_TRUE,
                              UINT64_MAX));
+    frame_capture_poll(&context, &context.capture);
     VK_CHECK(vkResetFences(context.device.vk_device, 1, &context.current_renderer->in_flight_fence));
+    renderer_instance_begin_frame(&context, context.current_renderer);
 
     u32 image_index = 0;
     VK_CHECK(vkAcquireNextImageKHR(context.device.vk_device, context.swapchain.vk_swapchain, UINT64_MAX,
                                    context.current_renderer->image_available_semaphore, VK_NULL_HANDLE, &image_index));
+    context.timing.record_start = SDL_GetPerformanceCounter();
     vkResetCommandBuffer(context.current_renderer->command_buffer, 0);
+    bindless_begin_frame(&context.bindless, context.frame_number);
+    memory_budget_update(&context.physical_device, &context.memory_budget);
+    texture_streamer_update(&context, &context.textures);
+    resolution_scaler_update(&context.resolution, atomic_load(&context.pacer.gpu_time),
+                             atomic_load(&context.pacer.render_time));
 
     begin_frame(image_index);
-    vkCmdDraw(context.current_renderer->command_buffer, 3, 1, 0, 0);
-    end_frame(image_index);
+    render_graph_execute(&context, &context.render_graph, context.current_renderer->command_buffer);
+    end_frame(image_index, input);
     context.current_renderer_index =
             (context.current_renderer_index + 1) % darray_length(context.renderer_instances);
+    ++context.frame_number;
+    host_allocator_frame_end();
+
+    // Only steady state frames are expected to stay off the heap, growing draw lists and uploads may not
+    u64 now = SDL_GetTicks64();
+    if (alloc_counter_read() != allocations && now - context.last_allocation_report >= 1000) {
+        alloc_counter_check("Frame", allocations);
+        context.last_allocation_report = now;
+    }
+}
+
+// Runs on the render thread, everything below owns the device and queues while it is running
+void render_packet(RenderPacket *packet) {
+    if (packet->present_changed) {
+        context.present = packet->present;
+    }
+
+    if (packet->resized || packet->present_changed) {
+        vkDeviceWaitIdle(context.device.vk_device);
+        frame_timing_reset(&context.timing);
+        recreate_swap_chain(context.window);
+    }
+
+    if (packet->has_view) {
+        meshlet_renderer_set_view(&context.meshlet_renderer, packet->view_projection, packet->camera);
+    }
+
+    // The packet takes the renderer's emptied list back for the main thread to fill again
+    MeshletDrawList draws = context.meshlet_renderer.draws;
+    context.meshlet_renderer.draws = packet->draws;
+    packet->draws = draws;
+    LightList lights = context.lights.lights;
+    context.lights.lights = packet->lights;
+    packet->lights = lights;
+
+    render_frame(&packet->input);
+}
+
+void vulkan_render() {
+    if (context.command_stream.file != NULL) {
+        RenderPacket *packet = render_thread_packet(&context.render_thread);
+        command_stream_write_frame(&context.command_stream, &packet->draws, &packet->lights);
+    }
+    frame_pacer_build_done(&context.pacer);
+    render_thread_submit(&context.render_thread);
 }
 
 void vulkan_window_resized(SDL_Window *window) {
+    if (context.command_stream.file != NULL) {
+        int width, height;
+        SDL_Vulkan_GetDrawableSize(window, &width, &height);
+        command_stream_write_resize(&context.command_stream, width, height);
+    }
+    render_thread_packet(&context.render_thread)->resized = true;
+}
+
+void vulkan_wait_frame_start() {
+    frame_limiter_wait(&context.limiter);
+    frame_pacer_wait(&context.pacer);
+}
+
+void vulkan_set_frame_pacing(FramePacing pacing) {
+    frame_pacer_set_mode(&context.pacer, pacing);
+}
+
+u32 vulkan_frame_rate_cap(const PresentSettings *settings) {
+    SDL_DisplayMode mode;
+    u32 refresh_rate = 0;
+    if (SDL_GetWindowDisplayMode(context.window, &mode) == 0 && mode.refresh_rate > 0) {
+        refresh_rate = mode.refresh_rate;
+    }
+    return swapchain_frame_rate_cap(settings, refresh_rate);
+}
+
+void vulkan_update_frame_budget(u32 cap) {
+    SDL_DisplayMode mode;
+    if (cap == 0 && SDL_GetWindowDisplayMode(context.window, &mode) == 0 && mode.refresh_rate > 0) {
+        cap = mode.refresh_rate;
+    }
+    resolution_scaler_set_budget(&context.resolution, cap != 0 ? SDL_GetPerformanceFrequency() / cap : 0);
+}
+
+void vulkan_set_frame_budget(double milliseconds) {
+    u64 ticks = (u64) (milliseconds * (double) SDL_GetPerformanceFrequency() / 1000.0);
+    resolution_scaler_set_budget(&context.resolution, ticks);
+    if (context.command_stream.file != NULL) {
+        command_stream_write_frame_budget(&context.command_stream, milliseconds);
+    }
+    LOG_INFO("Frame budget %.2f ms", milliseconds);
+}
+
+void vulkan_set_present_settings(const PresentSettings *settings) {
+    if (context.command_stream.file != NULL) {
+        command_stream_write_present(&context.command_stream, settings);
+    }
+    RenderPacket *packet = render_thread_packet(&context.render_thread);
+    packet->present = *settings;
+    packet->present_changed = true;
+
+    u32 cap = vulkan_frame_rate_cap(settings);
+    frame_limiter_set_fps(&context.limiter, cap);
+    vulkan_update_frame_budget(cap);
+    if (cap != 0) {
+        LOG_INFO("Present policy %s, capped at %u fps", swapchain_present_policy_name(settings->policy), cap);
+    } else {
+        LOG_INFO("Present policy %s, uncapped", swapchain_present_policy_name(settings->policy));
+    }
+}
+
+void vulkan_input_consumed(const InputEvent *event) {
+    FrameInput *input = &render_thread_packet(&context.render_thread)->input;
+    if (input->timestamp == 0) {
+        input->first_id = event->id;
+        input->timestamp = event->timestamp;
+    }
+    input->last_id = event->id;
+}
+
+void vulkan_memory_stats(MemoryBudgetStats *out) {
+    memory_budget_stats(&context.memory_budget, out);
+}
+
+bool vulkan_add_memory_pressure_callback(MemoryPressureCallback callback, void *data) {
+    render_thread_flush(&context.render_thread);
+    return memory_budget_add_callback(&context.memory_budget, callback, data);
+}
+
+bool vulkan_start_capture(const char *path, CaptureFormat format, u32 fps) {
+    // Rebuilding the graph frees its transient memory, which frames in flight may still use
+    render_thread_flush(&context.render_thread);
+    vkDeviceWaitIdle(context.device.vk_device);
+    if (!frame_capture_start(&context, &context.capture, path, format, fps)) {
+        return false;
+    }
+    if (!build_render_graph(&context)) {
+        LOG_ERROR("Couldn't rebuild the render graph for capturing!");
+        frame_capture_stop(&context, &context.capture);
+        return false;
+    }
+    return true;
+}
+
+void vulkan_stop_capture() {
+    render_thread_flush(&context.render_thread);
+    if (!context.capture.active) {
+        return;
+    }
+
+    vkDeviceWaitIdle(context.device.vk_device);
+    frame_capture_stop(&context, &context.capture);
+    if (!build_render_graph(&context)) {
+        LOG_ERROR("Couldn't rebuild the render graph after capturing!");
+    }
+}
+
+bool vulkan_start_command_stream(const char *path) {
+    if (context.command_stream.file != NULL) {
+        LOG_ERROR("A command stream is already being recorded");
+        return false;
+    }
+    if (darray_length(context.meshes.meshes) > 0) {
+        LOG_ERROR("Command streams have to start before the first mesh is loaded");
+        return false;
+    }
+    if (!command_stream_writer_open(path, &context.command_stream)) {
+        return false;
+    }
+
+    // The present settings belong to the render thread until it is idle
+    render_thread_flush(&context.render_thread);
+    int width, height;
+    SDL_Vulkan_GetDrawableSize(context.window, &width, &height);
+    command_stream_write_init(&context.command_stream, &context.present, width, height);
+    LOG_INFO("Recording a command stream to %s", path);
+    return true;
+}
+
+void vulkan_stop_command_stream() {
+    command_stream_writer_close(&context.command_stream);
+}
+
+void vulkan_set_debug_overlay(bool enabled) {
+    atomic_store(&context.overlay.enabled, enabled);
+}
+
+void vulkan_set_gpu_lod_selection(bool enabled) {
+    // The meshlet renderer is owned by the render thread
+    render_thread_flush(&context.render_thread);
+    context.meshlet_renderer.gpu_lod = enabled;
+}
+
+bool vulkan_set_particles(const ParticleSettings *settings) {
+    if (context.command_stream.file != NULL) {
+        command_stream_write_particles(&context.command_stream, settings);
+    }
+
+    // The old buffers may still be in use by frames in flight, and the graph gains or loses the particle passes
+    render_thread_flush(&context.render_thread);
     vkDeviceWaitIdle(context.device.vk_device);
-    recreate_swap_chain(window);
+    bool configured = particle_system_configure(&context, &context.particles, settings);
+    if (!build_render_graph(&context)) {
+        LOG_ERROR("Couldn't rebuild the render graph for the particles!");
+        return false;
+    }
+    return configured;
+}
+
+void vulkan_frame_times(double *render_ms, double *gpu_ms) {
+    *render_ms = latency_ticks_to_ms(atomic_load(&context.pacer.render_time));
+    *gpu_ms = latency_ticks_to_ms(atomic_load(&context.pacer.gpu_time));
+}
+
+u32 vulkan_load_mesh(const char *path) {
+    // Uploads share the graphics queue with frame submission
+    render_thread_flush(&context.render_thread);
+    u32 mesh = mesh_load(&context, &context.meshes, &context.uploader, path);
+    if (context.command_stream.file != NULL && mesh != MESH_INVALID) {
+        command_stream_write_load_mesh(&context.command_stream, mesh, path);
+    }
+    return mesh;
+}
+
+u32 vulkan_load_texture(const char *path) {
+    // The streamer is owned by the render thread
+    render_thread_flush(&context.render_thread);
+    u32 texture = texture_load(&context.textures, path);
+    if (context.command_stream.file != NULL && texture != TEXTURE_INVALID) {
+        command_stream_write_load_texture(&context.command_stream, texture, path);
+    }
+    return texture;
+}
+
+u32 vulkan_create_material(const float *base_color, u32 albedo_texture) {
+    if (albedo_texture != TEXTURE_INVALID && albedo_texture >= context.textures.texture_count) {
+        LOG_ERROR("Invalid texture id %u", albedo_texture);
+        return MATERIAL_INVALID;
+    }
+
+    // The render thread reads materials to decide which textures to stream
+    render_thread_flush(&context.render_thread);
+    Material material = {
+            .albedo_texture = albedo_texture,
+            .albedo_sampler = albedo_texture != TEXTURE_INVALID ? context.textures.sampler_handle
+                                                                : BINDLESS_INVALID_HANDLE
+    };
+    memcpy(material.base_color, base_color, sizeof(material.base_color));
+    u32 index = material_create(&context.materials, &material);
+    if (context.command_stream.file != NULL && index != MATERIAL_INVALID) {
+        command_stream_write_material(&context.command_stream, index, base_color, albedo_texture);
+    }
+    return index;
+}
+
+void vulkan_set_view(const float *view_projection, const float *camera) {
+    if (context.command_stream.file != NULL) {
+        command_stream_write_view(&context.command_stream, view_projection, camera);
+    }
+    RenderPacket *packet = render_thread_packet(&context.render_thread);
+    memcpy(packet->view_projection, view_projection, sizeof(packet->view_projection));
+    memcpy(packet->camera, camera, sizeof(packet->camera));
+    packet->has_view = true;
+}
+
+void vulkan_draw_mesh(u32 mesh, const float *transform) {
+    if (mesh >= darray_length(context.meshes.meshes)) {
+        LOG_ERROR("Invalid mesh id %u", mesh);
+        return;
+    }
+
+    MeshletDraw *draw = vulkan_reserve_draws(1);
+    draw->mesh = mesh;
+    memcpy(draw->transform, transform, sizeof(draw->transform));
+}
+
+MeshletDraw *vulkan_reserve_draws(u32 count) {
+    MeshletDraw *draws = meshlet_draw_list_reserve(&render_thread_packet(&context.render_thread)->draws, count);
+    for (u32 i = 0; i < count; ++i) {
+        draws[i].mesh = 0;
+        draws[i].material = context.default_material;
+    }
+    return draws;
+}
+
+void vulkan_add_light(const Light *light) {
+    *vulkan_reserve_lights(1) = *light;
+}
+
+Light *vulkan_reserve_lights(u32 count) {
+    Light *lights = light_list_reserve(&render_thread_packet(&context.render_thread)->lights, count);
+    memset(lights, 0, sizeof(Light) * count);
+    return lights;
+}
+
+void vulkan_draw_scene(Scene *scene, const u32 *meshes, u32 count) {
+    if (count == 0) {
+        scene_update(scene, NULL, 0);
+        return;
+    }
+
+    for (u32 i = 0; i < count; ++i) {
+        if (meshes[i] >= darray_length(context.meshes.meshes)) {
+            LOG_ERROR("Invalid mesh id %u", meshes[i]);
+            return;
+        }
+    }
+
+    // World matrices land directly in the draw list, which meshlet_renderer_cull copies once into the instance buffer
+    MeshletDraw *draws = vulkan_reserve_draws(count);
+    for (u32 i = 0; i < count; ++i) {
+        draws[i].mesh = meshes[i];
+    }
+    scene_update(scene, draws[0].transform, sizeof(MeshletDraw));
 }
\ No newline at end of file
@@ -2,7 +2,7 @@
 
 #include <SDL.h>
 #include <std/std.h>
-#include <std/core/logger.h>
+#include "core/log.h"
 
 #include <std/defines.h>
 #include "vulkan_types.h"
@@ -12,27 +12,191 @@
 #include "swapchain.h"
 #include "graphics_pipeline.h"
 #include "renderer_instance.h"
+#include "bindless.h"
+#include "material.h"
+#include "texture.h"
+#include "upload.h"
+#include "mesh.h"
+#include "meshlet_renderer.h"
+#include "render_thread.h"
+#include "frame_timing.h"
+#include "memory_budget.h"
+#include "render_graph.h"
+#include "resolution.h"
+#include "frame_capture.h"
+#include "command_stream.h"
+#include "debug_overlay.h"
+#include "particles.h"
+#include "light_clusters.h"
+#include "depth_pyramid.h"
+#include "host_allocator.h"
+#include "core/input.h"
+#include "core/latency.h"
+#include "core/scene.h"
+
+// Wall time of the last vulkan_init and the part of it spent creating pipelines
+typedef struct VulkanInitStats {
+    double init_ms;
+    double pipeline_ms;
+} VulkanInitStats;
 
 typedef struct VulkanContext {
+    SDL_Window *window;
+    // Survives shutdown, so it applies to every later init
+    bool prefer_software_device;
     VulkanInstance instance;
     VkSurfaceKHR surface;
     PhysicalDevice physical_device;
     Device device;
+    BindlessTable bindless;
+    MaterialTable materials;
+    u32 default_material;
     Swapchain swapchain;
+    // Owned by the render thread once it runs, changes arrive through the packet
+    PresentSettings present;
     GraphicsPipeline graphics_pipeline;
-    VkFramebuffer *framebuffers;
+    // The scene renders into scene_color at the scaler's extent, which is then scaled up into the swapchain image
+    VkFramebuffer framebuffer;
+    Image scene_color;
+    VkFilter upscale_filter;
+    // Color only exists with multisampling and is transient, depth is kept for the depth pyramid
+    Image depth_attachment;
+    Image color_attachment;
+    ResolutionScaler resolution;
 
     VkCommandPool command_pool;
+    VkDescriptorSetLayout frame_allocator_layout;
+    MemoryBudget memory_budget;
+    TextureStreamer textures;
+    Uploader uploader;
+    MeshPool meshes;
+    MeshletRenderer meshlet_renderer;
+    LightClusters lights;
+    ParticleSystem particles;
+    DepthPyramid depth_pyramid;
+    DebugOverlay overlay;
+    RenderThread render_thread;
+    FramePacer pacer;
+    FrameLimiter limiter;
+    FrameTiming timing;
+    FrameCapture capture;
+    // Main thread only, records the API calls below while open
+    CommandStreamWriter command_stream;
+
+    // Built once the renderers exist and again with the swapchain, resources are rebound every frame
+    RenderGraph render_graph;
+    u32 graph_backbuffer;
+    u32 graph_scene_color;
+    u32 graph_meshlet_commands;
+    u32 graph_particle_state;
+    u32 graph_particle_counters;
+    u32 graph_particle_dispatch;
+    u32 graph_light_clusters;
+    u32 graph_depth;
+    u32 graph_depth_pyramid;
+    // Swapchain image of the frame being recorded
+    u32 image_index;
 
     RendererInstance *renderer_instances;
     RendererInstance *current_renderer;
     u32 current_renderer_index;
+    u64 frame_number;
+    u64 last_allocation_report;
+    VulkanInitStats init_stats;
 } VulkanContext;
 
-bool vulkan_init(SDL_Window *window, const char *app_name);
+bool vulkan_init(SDL_Window *window, const char *app_name, const PresentSettings *present);
 
+// Leaves nothing behind, so vulkan_init can run again in the same process
 void vulkan_shutdown();
 
+// Selects a CPU implementation over the GPUs from the next init on, for running the same workload on any machine
+void vulkan_prefer_software_device(bool prefer);
+
+void vulkan_init_stats(VulkanInitStats *out);
+
+// Hands the frame built since the last call to the render thread, which records and submits it while the caller
+// goes on with the next one. Blocks only when the render thread is still busy with the frame before.
 void vulkan_render();
 
-void vulkan_window_resized(SDL_Window *window);
\ No newline at end of file
+void vulkan_window_resized(SDL_Window *window);
+
+// Call before pumping input for a frame. With FRAME_PACING_JUST_IN_TIME this sleeps until the latest start that still
+// makes the next present, so the frame samples input as late as possible.
+void vulkan_wait_frame_start();
+
+void vulkan_set_frame_pacing(FramePacing pacing);
+
+// Switches the present mode and frame rate cap, the swapchain is recreated on the render thread with the next frame
+void vulkan_set_present_settings(const PresentSettings *settings);
+
+// Marks an input event as consumed by the frame being built, its input to photon latency is reported once that frame
+// is visible
+void vulkan_input_consumed(const InputEvent *event);
+
+// Device memory budget and usage as of the last rendered frame, safe to call from any thread
+void vulkan_memory_stats(MemoryBudgetStats *out);
+
+// Waits for the render thread to go idle first. The callback runs on the render thread after the budget is polled at
+// the start of each frame.
+bool vulkan_add_memory_pressure_callback(MemoryPressureCallback callback, void *data);
+
+// Streams every presented frame to path, see frame_capture_start. fps only goes into the y4m header.
+bool vulkan_start_capture(const char *path, CaptureFormat format, u32 fps);
+
+void vulkan_stop_capture();
+
+// Records resource loads, materials, views, draw lists and present changes from here on for tools/replay. Has to start
+// before the first mesh or texture is loaded, since loads are what a replay rebuilds its resources from.
+bool vulkan_start_command_stream(const char *path);
+
+void vulkan_stop_command_stream();
+
+// Smoothed time the render thread spends recording a frame and the GPU spends executing it
+void vulkan_frame_times(double *render_ms, double *gpu_ms);
+
+// Shows frame times, GPU pass timings, memory usage and draw counts over the scene from the next frame on
+void vulkan_set_debug_overlay(bool enabled);
+
+// Picks meshlet levels of detail per instance in the culling pass instead of on the CPU. The overlay's triangle counts
+// are only kept for CPU selection. Waits for the render thread to go idle first.
+void vulkan_set_gpu_lod_selection(bool enabled);
+
+// Restarts the GPU particle system with these settings, a capacity of 0 turns it off. Waits for the device to go idle
+// first.
+bool vulkan_set_particles(const ParticleSettings *settings);
+
+// Frame time the render resolution is scaled to hold, 0 renders at full resolution. Present settings reset it to
+// their frame rate cap, or the refresh rate when uncapped.
+void vulkan_set_frame_budget(double milliseconds);
+
+// Waits for the render thread to go idle first
+u32 vulkan_load_mesh(const char *path);
+
+// Waits for the render thread to go idle first. Only the mip tail is loaded up front, finer levels stream in as draws
+// using the texture cover more of the screen.
+u32 vulkan_load_texture(const char *path);
+
+// Returns the index to put in MeshletDraw.material, or MATERIAL_INVALID when the table is full or the texture id is
+// unknown. albedo_texture comes from vulkan_load_texture, or is TEXTURE_INVALID for an untextured material. Waits for
+// the render thread to go idle first.
+u32 vulkan_create_material(const float *base_color, u32 albedo_texture);
+
+// view_projection is a column major matrix, camera the world space eye position used for cone culling
+void vulkan_set_view(const float *view_projection, const float *camera);
+
+// Queues a mesh for this frame's meshlet pass, transform is a column major object to world matrix
+void vulkan_draw_mesh(u32 mesh, const float *transform);
+
+// Appends count meshlet draws using the default material, the caller fills in mesh ids and transforms
+MeshletDraw *vulkan_reserve_draws(u32 count);
+
+// Lights this frame is shaded with, they have to be added again every frame
+void vulkan_add_light(const Light *light);
+
+// Appends count lights for the caller to fill in, valid until the next reserve or vulkan_render
+Light *vulkan_reserve_lights(u32 count);
+
+// Updates the scene straight into this frame's draw list: the node with instance slot i is drawn with meshes[i].
+// Every instance slot in the scene must be below count.
+void vulkan_draw_scene(Scene *scene, const u32 *meshes, u32 count);
\ No newline at end of file
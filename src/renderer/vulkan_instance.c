@@ -1,19 +1,21 @@
 #include "vulkan_instance.h"
+#include "host_allocator.h"
+#include "core/arena.h"
 
 #include <SDL_vulkan.h>
-#include <std/containers/darray.h>
 
-bool check_validation_layers(const char **requested) {
+bool check_validation_layers(const char **requested, u32 requested_count) {
+    ArenaScope scratch = scratch_begin();
     u32 layer_count;
     VK_CHECK(vkEnumerateInstanceLayerProperties(&layer_count, NULL));
-    VkLayerProperties *layer_props = darray_reserve(VkLayerProperties, layer_count);
+    VkLayerProperties *layer_props = arena_alloc_array(scratch.arena, VkLayerProperties, layer_count);
     VK_CHECK(vkEnumerateInstanceLayerProperties(&layer_count, layer_props));
 
     u32 not_found = 0;
 
-    for (u32 j = 0; j < darray_length(requested); ++j) {
+    for (u32 j = 0; j < requested_count; ++j) {
         bool found = false;
-        for (u32 i = 0; i < darray_length(layer_props); ++i) {
+        for (u32 i = 0; i < layer_count; ++i) {
             if (strcmp(requested[j], layer_props[i].layerName) == 0) {
                 LOG_INFO("Requested layer found: %s", requested[j]);
                 found = true;
@@ -27,7 +29,7 @@ bool check_validation_layers(const char **requested) {
         }
     }
 
-    darray_destroy(layer_props);
+    scratch_end(scratch);
     return not_found == 0;
 }
 
@@ -43,34 +45,34 @@ bool vulkan_instance_create(SDL_Window *window, const char *app_name, VulkanInst
     appInfo.pEngineName = "VulkanDemoEngine";
     appInfo.apiVersion = VK_API_VERSION_1_3;
 
+    ArenaScope scratch = scratch_begin();
     u32 sdl_extension_count = 0;
     SDL_Vulkan_GetInstanceExtensions(window, &sdl_extension_count, NULL);
-    const char **extensions = darray_reserve(const char *, sdl_extension_count);
+    const char **extensions = arena_alloc_array(scratch.arena, const char *, sdl_extension_count + 1);
     SDL_Vulkan_GetInstanceExtensions(window, &sdl_extension_count, extensions);
-    darray_push(extensions, &VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
+    extensions[sdl_extension_count] = VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME;
 
-    const char **layers = darray_create(const char *);
-    darray_push(layers, &"VK_LAYER_KHRONOS_validation");
-    check_validation_layers(layers);
+    const char *layers[] = {"VK_LAYER_KHRONOS_validation"};
+    u32 layer_count = sizeof(layers) / sizeof(const char *);
+    check_validation_layers(layers, layer_count);
 
     VkInstanceCreateInfo instanceCreateInfo = {VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
     instanceCreateInfo.pApplicationInfo = &appInfo;
-    instanceCreateInfo.enabledExtensionCount = darray_length(extensions);
+    instanceCreateInfo.enabledExtensionCount = sdl_extension_count + 1;
     instanceCreateInfo.ppEnabledExtensionNames = extensions;
-    instanceCreateInfo.enabledLayerCount = darray_length(layers);
+    instanceCreateInfo.enabledLayerCount = layer_count;
     instanceCreateInfo.ppEnabledLayerNames = layers;
     instanceCreateInfo.flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR;
 
     VulkanInstance instance = {0};
-    VK_CHECK(vkCreateInstance(&instanceCreateInfo, 0, &instance.vk_instance));
+    VK_CHECK(vkCreateInstance(&instanceCreateInfo, host_allocator(), &instance.vk_instance));
     *out = instance;
 
-    darray_destroy(extensions);
-    darray_destroy(layers);
+    scratch_end(scratch);
     return true;
 }
 
 void vulkan_instance_destroy(VulkanInstance *instance) {
-    vkDestroyInstance(instance->vk_instance, NULL);
+    vkDestroyInstance(instance->vk_instance, host_allocator());
     instance->vk_instance = NULL;
 }
\ No newline at end of file
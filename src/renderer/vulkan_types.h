@@ -1,7 +1,7 @@
 #pragma once
 
 #include <stdlib.h>
-#include <std/core/logger.h>
+#include "core/log.h"
 #include <vulkan/vulkan.h>
 #include <vulkan/vk_enum_string_helper.h>
 
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <SDL.h>
+#include "core/cull.h"
+#include "core/job.h"
+
+#define BENCH_DEFAULT_OBJECTS (1024 * 1024)
+#define BENCH_DEFAULT_ITERATIONS 50
+
+typedef u32 (*BenchCullFunction)(Culler *culler, const CullFrustum *frustum, const CullBounds *bounds,
+                                 CullShape shape, u32 *out_visible);
+
+void print_usage() {
+    printf("Usage:\n");
+    printf("  cull_bench [objects] [iterations] [threads]\n");
+}
+
+double now_seconds() {
+    struct timespec time;
+    timespec_get(&time, TIME_UTC);
+    return (double) time.tv_sec + (double) time.tv_nsec * 1e-9;
+}
+
+float random_range(float min, float max) {
+    return min + (max - min) * ((float) rand() / (float) RAND_MAX);
+}
+
+// Camera at the origin looking down -z with a 60 degree field of view, about a tenth of the objects survive
+void bench_frustum(CullFrustum *out) {
+    float near = 0.1f;
+    float far = 500.0f;
+    float focal = 1.0f / tanf(30.0f * 3.14159265f / 180.0f);
+    float aspect = 16.0f / 9.0f;
+
+    float projection[16] = {0};
+    projection[0] = focal / aspect;
+    projection[5] = -focal;
+    projection[10] = far / (near - far);
+    projection[11] = -1.0f;
+    projection[14] = near * far / (near - far);
+    cull_frustum_extract(projection, out);
+}
+
+void bench_bounds_create(u32 count, CullBounds *out) {
+    CullBounds result = {0};
+    for (u32 axis = 0; axis < 3; ++axis) {
+        result.center[axis] = malloc(sizeof(float) * count);
+        result.extent[axis] = malloc(sizeof(float) * count);
+    }
+    result.radius = malloc(sizeof(float) * count);
+    result.count = count;
+
+    srand(1);
+    for (u32 i = 0; i < count; ++i) {
+        float radius = 0.0f;
+        for (u32 axis = 0; axis < 3; ++axis) {
+            result.center[axis][i] = random_range(-500.0f, 500.0f);
+            result.extent[axis][i] = random_range(0.5f, 4.0f);
+            radius += result.extent[axis][i] * result.extent[axis][i];
+        }
+        result.radius[i] = sqrtf(radius);
+    }
+    *out = result;
+}
+
+void bench_bounds_destroy(CullBounds *bounds) {
+    for (u32 axis = 0; axis < 3; ++axis) {
+        free(bounds->center[axis]);
+        free(bounds->extent[axis]);
+    }
+    free(bounds->radius);
+}
+
+u32 bench_scalar(Culler *culler, const CullFrustum *frustum, const CullBounds *bounds, CullShape shape,
+                 u32 *out_visible) {
+    return cull_range_scalar(frustum, bounds, shape, 0, bounds->count, out_visible);
+}
+
+u32 bench_simd(Culler *culler, const CullFrustum *frustum, const CullBounds *bounds, CullShape shape,
+               u32 *out_visible) {
+    return cull_range(frustum, bounds, shape, 0, bounds->count, out_visible);
+}
+
+u32 bench_threaded(Culler *culler, const CullFrustum *frustum, const CullBounds *bounds, CullShape shape,
+                   u32 *out_visible) {
+    return culler_run(culler, frustum, bounds, shape, out_visible);
+}
+
+void bench_run(const char *name, BenchCullFunction function, Culler *culler, const CullFrustum *frustum,
+               const CullBounds *bounds, CullShape shape, u32 iterations, u32 *out_visible) {
+    u32 visible = 0;
+    double best = 0.0;
+    double total = 0.0;
+    for (u32 i = 0; i < iterations; ++i) {
+        double start = now_seconds();
+        visible = function(culler, frustum, bounds, shape, out_visible);
+        double elapsed = now_seconds() - start;
+
+        total += elapsed;
+        if (i == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    double nanoseconds = best * 1e9;
+    printf("  %-8s %-6s visible %8u  best %8.3f ms  mean %8.3f ms  %6.3f objects/ns\n", name,
+           shape == CULL_SHAPE_SPHERE ? "sphere" : "box", visible, best * 1000.0, total / iterations * 1000.0,
+           (double) bounds->count / nanoseconds);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        print_usage();
+        return 0;
+    }
+
+    u32 count = argc > 1 ? (u32) strtoul(argv[1], NULL, 10) : BENCH_DEFAULT_OBJECTS;
+    u32 iterations = argc > 2 ? (u32) strtoul(argv[2], NULL, 10) : BENCH_DEFAULT_ITERATIONS;
+    u32 threads = argc > 3 ? (u32) strtoul(argv[3], NULL, 10) : (u32) SDL_GetCPUCount() - 1;
+    if (count == 0 || iterations == 0) {
+        print_usage();
+        return -1;
+    }
+
+    CullFrustum frustum;
+    bench_frustum(&frustum);
+    CullBounds bounds;
+    bench_bounds_create(count, &bounds);
+    u32 *visible = malloc(sizeof(u32) * count);
+
+    Culler culler;
+    if (!job_system_init(threads) || !culler_create(&culler)) {
+        return -1;
+    }
+
+    printf("%u objects, %u iterations, %u worker threads\n", count, iterations, job_system_worker_count());
+    CullShape shapes[] = {CULL_SHAPE_SPHERE, CULL_SHAPE_BOX};
+    for (u32 i = 0; i < 2; ++i) {
+        bench_run("scalar", bench_scalar, &culler, &frustum, &bounds, shapes[i], iterations, visible);
+        bench_run("simd", bench_simd, &culler, &frustum, &bounds, shapes[i], iterations, visible);
+        bench_run("threaded", bench_threaded, &culler, &frustum, &bounds, shapes[i], iterations, visible);
+    }
+
+    culler_destroy(&culler);
+    job_system_shutdown();
+    free(visible);
+    bench_bounds_destroy(&bounds);
+    return 0;
+}
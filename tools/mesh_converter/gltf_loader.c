@@ -0,0 +1,170 @@
+#include "mesh_builder.h"
+#include "core/log.h"
+
+#include <math.h>
+#include <string.h>
+#include <std/containers/darray.h>
+
+#define CGLTF_IMPLEMENTATION
+#include <cgltf.h>
+
+void gltf_transform_point(const float *matrix, const float *point, float *out) {
+    for (u32 row = 0; row < 3; ++row) {
+        out[row] = matrix[row] * point[0] + matrix[4 + row] * point[1] + matrix[8 + row] * point[2] + matrix[12 + row];
+    }
+}
+
+// Normals go through the inverse transpose of the upper 3x3, which is its cofactor matrix scaled by 1/det.
+// Stored column-major, returns the determinant so mirroring transforms can be detected.
+float gltf_normal_matrix(const float *matrix, float *out) {
+    const float a = matrix[0], b = matrix[4], c = matrix[8];
+    const float d = matrix[1], e = matrix[5], f = matrix[9];
+    const float g = matrix[2], h = matrix[6], i = matrix[10];
+
+    out[0] = e * i - f * h;
+    out[1] = c * h - b * i;
+    out[2] = b * f - c * e;
+    out[3] = f * g - d * i;
+    out[4] = a * i - c * g;
+    out[5] = c * d - a * f;
+    out[6] = d * h - e * g;
+    out[7] = b * g - a * h;
+    out[8] = a * e - b * d;
+
+    float determinant = a * out[0] + b * out[3] + c * out[6];
+    if (determinant < 0.0f) {
+        for (u32 k = 0; k < 9; ++k) {
+            out[k] = -out[k];
+        }
+    }
+    return determinant;
+}
+
+void gltf_transform_normal(const float *normal_matrix, const float *normal, float *out) {
+    for (u32 row = 0; row < 3; ++row) {
+        out[row] = normal_matrix[row] * normal[0] + normal_matrix[3 + row] * normal[1] +
+                   normal_matrix[6 + row] * normal[2];
+    }
+
+    float length = sqrtf(out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+    if (length > 0.0f) {
+        out[0] /= length;
+        out[1] /= length;
+        out[2] /= length;
+    }
+}
+
+bool gltf_load_primitive(cgltf_data *data, cgltf_primitive *primitive, const float *world, MeshBuilder *builder) {
+    if (primitive->type != cgltf_primitive_type_triangles) {
+        LOG_INFO("Skipping non-triangle glTF primitive");
+        return true;
+    }
+
+    cgltf_accessor *positions = NULL;
+    cgltf_accessor *normals = NULL;
+    cgltf_accessor *uvs = NULL;
+    for (cgltf_size i = 0; i < primitive->attributes_count; ++i) {
+        cgltf_attribute *attribute = &primitive->attributes[i];
+        if (attribute->type == cgltf_attribute_type_position) {
+            positions = attribute->data;
+        } else if (attribute->type == cgltf_attribute_type_normal) {
+            normals = attribute->data;
+        } else if (attribute->type == cgltf_attribute_type_texcoord && attribute->index == 0) {
+            uvs = attribute->data;
+        }
+    }
+
+    if (positions == NULL) {
+        LOG_ERROR("glTF primitive has no positions");
+        return false;
+    }
+
+    float normal_matrix[9];
+    bool mirrored = gltf_normal_matrix(world, normal_matrix) < 0.0f;
+
+    u32 material = primitive->material ? (u32) (primitive->material - data->materials) : 0;
+    u32 first_vertex = darray_length(builder->vertices);
+    mesh_builder_begin_submesh(builder, material);
+
+    for (cgltf_size i = 0; i < positions->count; ++i) {
+        MeshVertex vertex = {0};
+        float value[3] = {0};
+
+        cgltf_accessor_read_float(positions, i, value, 3);
+        gltf_transform_point(world, value, vertex.position);
+
+        if (normals) {
+            cgltf_accessor_read_float(normals, i, value, 3);
+            gltf_transform_normal(normal_matrix, value, vertex.normal);
+        }
+
+        if (uvs) {
+            cgltf_accessor_read_float(uvs, i, vertex.uv, 2);
+        }
+
+        darray_push(builder->vertices, vertex);
+    }
+
+    cgltf_size index_count = primitive->indices ? primitive->indices->count : positions->count;
+    for (cgltf_size i = 0; i + 2 < index_count; i += 3) {
+        u32 triangle[3];
+        for (u32 corner = 0; corner < 3; ++corner) {
+            cgltf_size source = i + corner;
+            triangle[corner] = first_vertex + (u32) (primitive->indices
+                                                     ? cgltf_accessor_read_index(primitive->indices, source)
+                                                     : source);
+        }
+
+        // A mirroring transform flips the winding, swap two corners to keep front faces front facing
+        if (mirrored) {
+            u32 swap = triangle[1];
+            triangle[1] = triangle[2];
+            triangle[2] = swap;
+        }
+
+        darray_push(builder->indices, triangle[0]);
+        darray_push(builder->indices, triangle[1]);
+        darray_push(builder->indices, triangle[2]);
+    }
+
+    mesh_builder_end_submesh(builder);
+
+    if (normals == NULL) {
+        mesh_builder_generate_normals(builder, first_vertex);
+    }
+    return true;
+}
+
+bool gltf_load(const char *path, MeshBuilder *builder) {
+    cgltf_options options = {0};
+    cgltf_data *data = NULL;
+
+    if (cgltf_parse_file(&options, path, &data) != cgltf_result_success) {
+        LOG_ERROR("Failed to parse glTF file: %s", path);
+        return false;
+    }
+
+    if (cgltf_load_buffers(&options, data, path) != cgltf_result_success) {
+        LOG_ERROR("Failed to load glTF buffers: %s", path);
+        cgltf_free(data);
+        return false;
+    }
+
+    // Every mesh instance in the node hierarchy is baked into the output with its world transform
+    bool success = true;
+    for (cgltf_size i = 0; success && i < data->nodes_count; ++i) {
+        cgltf_node *node = &data->nodes[i];
+        if (node->mesh == NULL) {
+            continue;
+        }
+
+        float world[16];
+        cgltf_node_transform_world(node, world);
+        for (cgltf_size j = 0; success && j < node->mesh->primitives_count; ++j) {
+            success = gltf_load_primitive(data, &node->mesh->primitives[j], world, builder);
+        }
+    }
+
+    cgltf_free(data);
+    return success;
+}
@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "core/log.h"
+#include "mesh_builder.h"
+#include "asset/mesh_file.h"
+
+#define BENCH_STAGING_SIZE (16 * 1024 * 1024)
+
+void print_usage() {
+    printf("Usage:\n");
+    printf("  mesh_converter [--quantize] [--lods <count>] <input.obj|input.gltf|input.glb> <output.mesh>\n");
+    printf("  mesh_converter --bench <input.mesh> [iterations]\n");
+}
+
+bool has_extension(const char *path, const char *extension) {
+    size_t path_length = strlen(path);
+    size_t extension_length = strlen(extension);
+    return path_length >= extension_length &&
+           strcmp(path + path_length - extension_length, extension) == 0;
+}
+
+double now_seconds() {
+    struct timespec time;
+    timespec_get(&time, TIME_UTC);
+    return (double) time.tv_sec + (double) time.tv_nsec * 1e-9;
+}
+
+// Mirrors the runtime load path: map, validate, then stream each section through a staging sized buffer
+int bench(const char *path, u32 iterations) {
+    u8 *staging = malloc(BENCH_STAGING_SIZE);
+    double first = 0.0;
+    double best = 0.0;
+    double total = 0.0;
+    u64 bytes = 0;
+
+    for (u32 i = 0; i < iterations; ++i) {
+        double start = now_seconds();
+
+        MeshFile mesh;
+        if (!mesh_file_open(path, &mesh)) {
+            free(staging);
+            return -1;
+        }
+
+        bytes = 0;
+        for (u32 section = 0; section < MESH_SECTION_MAX; ++section) {
+            const u8 *data = mesh_file_section(&mesh, section);
+            u64 size = mesh_file_section_size(&mesh, section);
+            for (u64 offset = 0; offset < size; offset += BENCH_STAGING_SIZE) {
+                u64 chunk = size - offset < BENCH_STAGING_SIZE ? size - offset : BENCH_STAGING_SIZE;
+                memcpy(staging, data + offset, chunk);
+            }
+            bytes += size;
+        }
+        mesh_file_close(&mesh);
+
+        double elapsed = now_seconds() - start;
+        total += elapsed;
+        if (i == 0) {
+            first = elapsed;
+        }
+        if (i == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    double megabytes = (double) bytes / (1024.0 * 1024.0);
+    printf("%s: %.2f MiB, %u iterations\n", path, megabytes, iterations);
+    printf("  first: %.3f ms, %.1f MiB/s\n", first * 1000.0, megabytes / first);
+    printf("  best:  %.3f ms, %.1f MiB/s\n", best * 1000.0, megabytes / best);
+    printf("  mean:  %.3f ms, %.1f MiB/s\n", total / iterations * 1000.0, megabytes / (total / iterations));
+
+    free(staging);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 3 && strcmp(argv[1], "--bench") == 0) {
+        u32 iterations = argc >= 4 ? (u32) atoi(argv[3]) : 10;
+        return bench(argv[2], iterations > 0 ? iterations : 1);
+    }
+
+    MeshBuilderOptions options = {.lod_count = MESH_MAX_LODS};
+    int argument = 1;
+    while (argc > argument && strncmp(argv[argument], "--", 2) == 0) {
+        if (strcmp(argv[argument], "--quantize") == 0) {
+            options.quantize = true;
+            ++argument;
+        } else if (strcmp(argv[argument], "--lods") == 0 && argc > argument + 1) {
+            options.lod_count = (u32) atoi(argv[argument + 1]);
+            argument += 2;
+        } else {
+            print_usage();
+            return -1;
+        }
+    }
+
+    if (argc - argument != 2) {
+        print_usage();
+        return -1;
+    }
+
+    const char *input = argv[argument];
+    const char *output = argv[argument + 1];
+
+    MeshBuilder builder;
+    mesh_builder_init(&builder);
+
+    bool loaded = false;
+    if (has_extension(input, ".obj")) {
+        loaded = obj_load(input, &builder);
+    } else if (has_extension(input, ".gltf") || has_extension(input, ".glb")) {
+        loaded = gltf_load(input, &builder);
+    } else {
+        LOG_ERROR("Unsupported input format: %s", input);
+    }
+
+    bool written = loaded && mesh_builder_write(&builder, &options, output);
+    mesh_builder_destroy(&builder);
+    return written ? 0 : -1;
+}
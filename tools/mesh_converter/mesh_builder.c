@@ -0,0 +1,536 @@
+#include "mesh_builder.h"
+#include "core/log.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <std/containers/darray.h>
+
+typedef struct MeshletBuild {
+    MeshMeshlet *meshlets;
+    u32 *vertices;
+    u8 *triangles;
+} MeshletBuild;
+
+void mesh_builder_init(MeshBuilder *builder) {
+    builder->vertices = darray_create(MeshVertex);
+    builder->indices = darray_create(u32);
+    builder->submeshes = darray_create(MeshBuilderSubmesh);
+}
+
+void mesh_builder_destroy(MeshBuilder *builder) {
+    darray_destroy(builder->vertices);
+    builder->vertices = NULL;
+    darray_destroy(builder->indices);
+    builder->indices = NULL;
+    darray_destroy(builder->submeshes);
+    builder->submeshes = NULL;
+}
+
+void mesh_builder_begin_submesh(MeshBuilder *builder, u32 material) {
+    MeshBuilderSubmesh submesh = {
+            .first_index = darray_length(builder->indices),
+            .index_count = 0,
+            .material = material
+    };
+    darray_push(builder->submeshes, submesh);
+}
+
+void mesh_builder_end_submesh(MeshBuilder *builder) {
+    MeshBuilderSubmesh *submesh = &builder->submeshes[darray_length(builder->submeshes) - 1];
+    submesh->index_count = darray_length(builder->indices) - submesh->first_index;
+}
+
+void vec3_sub(const float *a, const float *b, float *out) {
+    out[0] = a[0] - b[0];
+    out[1] = a[1] - b[1];
+    out[2] = a[2] - b[2];
+}
+
+void vec3_cross(const float *a, const float *b, float *out) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+float vec3_dot(const float *a, const float *b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+float vec3_normalize(float *v) {
+    float length = sqrtf(vec3_dot(v, v));
+    if (length > 0.0f) {
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+    }
+    return length;
+}
+
+void triangle_normal(const MeshVertex *vertices, const u32 *triangle, float *out) {
+    float e0[3], e1[3];
+    vec3_sub(vertices[triangle[1]].position, vertices[triangle[0]].position, e0);
+    vec3_sub(vertices[triangle[2]].position, vertices[triangle[0]].position, e1);
+    vec3_cross(e0, e1, out);
+}
+
+void mesh_builder_generate_normals(MeshBuilder *builder, u32 first_vertex) {
+    u32 vertex_count = darray_length(builder->vertices);
+    bool *missing = calloc(vertex_count, sizeof(bool));
+    for (u32 i = first_vertex; i < vertex_count; ++i) {
+        float *normal = builder->vertices[i].normal;
+        missing[i] = normal[0] == 0.0f && normal[1] == 0.0f && normal[2] == 0.0f;
+    }
+
+    u32 index_count = darray_length(builder->indices);
+    for (u32 i = 0; i + 2 < index_count; i += 3) {
+        float normal[3];
+        triangle_normal(builder->vertices, &builder->indices[i], normal);
+
+        // Unnormalized face normals weight the sum by triangle area
+        for (u32 corner = 0; corner < 3; ++corner) {
+            u32 index = builder->indices[i + corner];
+            if (missing[index]) {
+                float *target = builder->vertices[index].normal;
+                target[0] += normal[0];
+                target[1] += normal[1];
+                target[2] += normal[2];
+            }
+        }
+    }
+
+    for (u32 i = first_vertex; i < vertex_count; ++i) {
+        if (missing[i]) {
+            vec3_normalize(builder->vertices[i].normal);
+        }
+    }
+
+    free(missing);
+}
+
+MeshBounds bounds_compute(const MeshVertex *vertices, const u32 *indices, u32 count) {
+    MeshBounds bounds = {
+            .min = {INFINITY, INFINITY, INFINITY},
+            .max = {-INFINITY, -INFINITY, -INFINITY}
+    };
+
+    for (u32 i = 0; i < count; ++i) {
+        const float *position = vertices[indices ? indices[i] : i].position;
+        for (u32 axis = 0; axis < 3; ++axis) {
+            bounds.min[axis] = fminf(bounds.min[axis], position[axis]);
+            bounds.max[axis] = fmaxf(bounds.max[axis], position[axis]);
+        }
+    }
+
+    if (count == 0) {
+        memset(&bounds, 0, sizeof(bounds));
+        return bounds;
+    }
+
+    for (u32 axis = 0; axis < 3; ++axis) {
+        bounds.center[axis] = (bounds.min[axis] + bounds.max[axis]) * 0.5f;
+    }
+
+    float radius_squared = 0.0f;
+    for (u32 i = 0; i < count; ++i) {
+        float offset[3];
+        vec3_sub(vertices[indices ? indices[i] : i].position, bounds.center, offset);
+        radius_squared = fmaxf(radius_squared, vec3_dot(offset, offset));
+    }
+    bounds.radius = sqrtf(radius_squared);
+
+    return bounds;
+}
+
+void meshlet_finish(MeshletBuild *build, MeshMeshlet *meshlet, const MeshVertex *vertices) {
+    const u32 *meshlet_vertices = &build->vertices[meshlet->vertex_offset];
+    const u8 *meshlet_triangles = &build->triangles[meshlet->triangle_offset];
+
+    MeshBounds bounds = bounds_compute(vertices, meshlet_vertices, meshlet->vertex_count);
+    memcpy(meshlet->center, bounds.center, sizeof(meshlet->center));
+    meshlet->radius = bounds.radius;
+
+    float axis[3] = {0};
+    float normals[MESHLET_MAX_TRIANGLES][3];
+    for (u32 i = 0; i < meshlet->triangle_count; ++i) {
+        u32 triangle[3] = {
+                meshlet_vertices[meshlet_triangles[i * 3 + 0]],
+                meshlet_vertices[meshlet_triangles[i * 3 + 1]],
+                meshlet_vertices[meshlet_triangles[i * 3 + 2]],
+        };
+        triangle_normal(vertices, triangle, normals[i]);
+        vec3_normalize(normals[i]);
+        axis[0] += normals[i][0];
+        axis[1] += normals[i][1];
+        axis[2] += normals[i][2];
+    }
+
+    float min_dot = 1.0f;
+    if (vec3_normalize(axis) > 0.0f) {
+        for (u32 i = 0; i < meshlet->triangle_count; ++i) {
+            min_dot = fminf(min_dot, vec3_dot(axis, normals[i]));
+        }
+    } else {
+        min_dot = -1.0f;
+    }
+
+    memcpy(meshlet->cone_axis, axis, sizeof(meshlet->cone_axis));
+    // A cone wider than a hemisphere can never be backfacing as a whole
+    meshlet->cone_cutoff = min_dot <= 0.0f ? 1.0f : sqrtf(1.0f - min_dot * min_dot);
+}
+
+// Cuts one level of a submesh into meshlets, indices is its triangle list in the full index stream
+void meshlets_build_submesh(MeshletBuild *build, MeshBuilder *builder, const u32 *indices, u32 index_count,
+                            u32 *local_index, u32 *local_stamp) {
+    MeshMeshlet meshlet = {
+            .vertex_offset = darray_length(build->vertices),
+            .triangle_offset = darray_length(build->triangles)
+    };
+
+    for (u32 i = 0; i + 2 < index_count; i += 3) {
+        u32 stamp = darray_length(build->meshlets) + 1;
+        u32 new_vertices = 0;
+        for (u32 corner = 0; corner < 3; ++corner) {
+            new_vertices += local_stamp[indices[i + corner]] != stamp;
+        }
+
+        if (meshlet.vertex_count + new_vertices > MESHLET_MAX_VERTICES ||
+            meshlet.triangle_count + 1 > MESHLET_MAX_TRIANGLES) {
+            meshlet_finish(build, &meshlet, builder->vertices);
+            darray_push(build->meshlets, meshlet);
+
+            // Keep every meshlet's triangle block 4 byte aligned for shaders reading it as u32
+            u8 padding = 0;
+            while (darray_length(build->triangles) % 4 != 0) {
+                darray_push(build->triangles, padding);
+            }
+
+            meshlet = (MeshMeshlet) {
+                    .vertex_offset = darray_length(build->vertices),
+                    .triangle_offset = darray_length(build->triangles)
+            };
+            stamp = darray_length(build->meshlets) + 1;
+        }
+
+        for (u32 corner = 0; corner < 3; ++corner) {
+            u32 index = indices[i + corner];
+            if (local_stamp[index] != stamp) {
+                local_stamp[index] = stamp;
+                local_index[index] = meshlet.vertex_count++;
+                darray_push(build->vertices, index);
+            }
+
+            u8 local = (u8) local_index[index];
+            darray_push(build->triangles, local);
+        }
+        meshlet.triangle_count++;
+    }
+
+    if (meshlet.triangle_count > 0) {
+        meshlet_finish(build, &meshlet, builder->vertices);
+        darray_push(build->meshlets, meshlet);
+
+        u8 padding = 0;
+        while (darray_length(build->triangles) % 4 != 0) {
+            darray_push(build->triangles, padding);
+        }
+    }
+}
+
+u16 float_to_half(float value) {
+    u32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    u32 sign = (bits >> 16) & 0x8000;
+    i32 exponent = (i32) ((bits >> 23) & 0xFF) - 127 + 15;
+    u32 mantissa = bits & 0x7FFFFF;
+
+    if (exponent <= 0) {
+        return (u16) sign;
+    }
+
+    if (exponent >= 31) {
+        return (u16) (sign | 0x7C00);
+    }
+
+    // Round to nearest
+    u32 half = sign | ((u32) exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000) {
+        half++;
+    }
+    return (u16) half;
+}
+
+i8 float_to_snorm8(float value) {
+    value = fmaxf(-1.0f, fminf(1.0f, value));
+    return (i8) lroundf(value * 127.0f);
+}
+
+void octahedral_encode(const float *normal, i8 *out) {
+    float sum = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+    float x = sum > 0.0f ? normal[0] / sum : 0.0f;
+    float y = sum > 0.0f ? normal[1] / sum : 0.0f;
+
+    if (normal[2] < 0.0f) {
+        float folded_x = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float folded_y = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = folded_x;
+        y = folded_y;
+    }
+
+    out[0] = float_to_snorm8(x);
+    out[1] = float_to_snorm8(y);
+}
+
+MeshVertexQuantized vertex_quantize(const MeshVertex *vertex, const MeshBounds *bounds) {
+    MeshVertexQuantized result = {0};
+
+    for (u32 axis = 0; axis < 3; ++axis) {
+        float extent = bounds->max[axis] - bounds->min[axis];
+        float normalized = extent > 0.0f ? (vertex->position[axis] - bounds->min[axis]) / extent : 0.0f;
+        result.position[axis] = (u16) lroundf(fmaxf(0.0f, fminf(1.0f, normalized)) * 65535.0f);
+    }
+
+    octahedral_encode(vertex->normal, result.normal);
+    result.uv[0] = float_to_half(vertex->uv[0]);
+    result.uv[1] = float_to_half(vertex->uv[1]);
+    return result;
+}
+
+u64 mesh_align(u64 value) {
+    return (value + MESH_FILE_ALIGNMENT - 1) & ~((u64) MESH_FILE_ALIGNMENT - 1);
+}
+
+bool mesh_write_section(FILE *file, MeshRange *range, const void *data) {
+    static const u8 zeros[MESH_FILE_ALIGNMENT] = {0};
+
+    long position = ftell(file);
+    if (position < 0 || (u64) position > range->offset) {
+        return false;
+    }
+
+    if (fwrite(zeros, 1, range->offset - (u64) position, file) != range->offset - (u64) position) {
+        return false;
+    }
+
+    return range->size == 0 || fwrite(data, 1, range->size, file) == range->size;
+}
+
+// Builds a chain of levels for one submesh, each simplified from full detail to half the triangles of the previous
+// one. Returns the number of levels, level 0 being the submesh itself.
+u32 lods_build_submesh(MeshBuilder *builder, MeshBuilderSubmesh *source, u32 max_lods, u32 **lod_indices,
+                       MeshLod *lods, float *errors) {
+    lods[0] = (MeshLod) {source->first_index, source->index_count};
+    errors[0] = 0.0f;
+
+    const u32 *indices = &builder->indices[source->first_index];
+    u32 *simplified = malloc(sizeof(u32) * source->index_count);
+    u32 level_count = 1;
+    while (level_count < max_lods) {
+        u32 previous = lods[level_count - 1].index_count;
+        u32 target = (source->index_count >> level_count) / 3 * 3;
+        if (target < 3) {
+            break;
+        }
+
+        float error = 0.0f;
+        u32 count = simplify(builder->vertices, darray_length(builder->vertices), indices, source->index_count,
+                             target, &error, simplified);
+
+        // Locked borders and seams can stall the reduction, a level that barely shrinks is not worth keeping
+        if (count == 0 || count > previous - previous / 10) {
+            break;
+        }
+
+        lods[level_count] = (MeshLod) {darray_length(*lod_indices), count};
+        errors[level_count] = error;
+        for (u32 i = 0; i < count; ++i) {
+            darray_push(*lod_indices, simplified[i]);
+        }
+        ++level_count;
+    }
+
+    free(simplified);
+    return level_count;
+}
+
+bool mesh_builder_write(MeshBuilder *builder, MeshBuilderOptions *options, const char *path) {
+    u32 vertex_count = darray_length(builder->vertices);
+    u32 index_count = darray_length(builder->indices);
+    u32 submesh_count = darray_length(builder->submeshes);
+
+    if (vertex_count == 0 || index_count == 0) {
+        LOG_ERROR("Nothing to write, mesh is empty");
+        return false;
+    }
+
+    // Levels of detail, their indices are appended after the full detail ones
+    u32 max_lods = options->lod_count == 0 ? 1 : options->lod_count;
+    max_lods = max_lods > MESH_MAX_LODS ? MESH_MAX_LODS : max_lods;
+
+    u32 *all_indices = darray_create(u32);
+    for (u32 i = 0; i < index_count; ++i) {
+        darray_push(all_indices, builder->indices[i]);
+    }
+
+    MeshLod *submesh_lods = calloc((u64) submesh_count * MESH_MAX_LODS, sizeof(MeshLod));
+    u32 *submesh_lod_counts = calloc(submesh_count, sizeof(u32));
+    float lod_errors[MESH_MAX_LODS] = {0};
+    u32 lod_count = 1;
+    for (u32 i = 0; i < submesh_count; ++i) {
+        MeshBuilderSubmesh *source = &builder->submeshes[i];
+        if (source->index_count == 0) {
+            continue;
+        }
+
+        float errors[MESH_MAX_LODS];
+        MeshLod *lods = &submesh_lods[i * MESH_MAX_LODS];
+        submesh_lod_counts[i] = lods_build_submesh(builder, source, max_lods, &all_indices, lods, errors);
+        for (u32 level = 0; level < submesh_lod_counts[i]; ++level) {
+            lod_errors[level] = fmaxf(lod_errors[level], errors[level]);
+        }
+        lod_count = submesh_lod_counts[i] > lod_count ? submesh_lod_counts[i] : lod_count;
+    }
+    index_count = darray_length(all_indices);
+
+    MeshFileHeader header = {
+            .magic = MESH_FILE_MAGIC,
+            .version = MESH_FILE_VERSION,
+            .vertex_format = options->quantize ? MESH_VERTEX_FORMAT_QUANTIZED : MESH_VERTEX_FORMAT_FLOAT,
+            .index_type = vertex_count <= UINT16_MAX ? MESH_INDEX_TYPE_U16 : MESH_INDEX_TYPE_U32,
+            .vertex_stride = options->quantize ? sizeof(MeshVertexQuantized) : sizeof(MeshVertex),
+            .vertex_count = vertex_count,
+            .index_count = index_count,
+            .submesh_count = submesh_count,
+            .lod_count = lod_count,
+    };
+    memcpy(header.lod_errors, lod_errors, sizeof(header.lod_errors));
+    header.bounds = bounds_compute(builder->vertices, NULL, vertex_count);
+
+    // Vertex stream
+    void *vertices = builder->vertices;
+    MeshVertexQuantized *quantized = NULL;
+    if (options->quantize) {
+        quantized = malloc(sizeof(MeshVertexQuantized) * vertex_count);
+        for (u32 i = 0; i < vertex_count; ++i) {
+            quantized[i] = vertex_quantize(&builder->vertices[i], &header.bounds);
+        }
+        vertices = quantized;
+    }
+
+    // Index stream
+    void *indices = all_indices;
+    u16 *indices_16 = NULL;
+    if (header.index_type == MESH_INDEX_TYPE_U16) {
+        indices_16 = malloc(sizeof(u16) * index_count);
+        for (u32 i = 0; i < index_count; ++i) {
+            indices_16[i] = (u16) all_indices[i];
+        }
+        indices = indices_16;
+    }
+
+    // Meshlets and submeshes
+    MeshletBuild build = {
+            .meshlets = darray_create(MeshMeshlet),
+            .vertices = darray_create(u32),
+            .triangles = darray_create(u8)
+    };
+    u32 *local_index = calloc(vertex_count, sizeof(u32));
+    u32 *local_stamp = calloc(vertex_count, sizeof(u32));
+
+    MeshSubmesh *submeshes = calloc(submesh_count, sizeof(MeshSubmesh));
+    MeshLod *lods = calloc((u64) submesh_count * lod_count, sizeof(MeshLod));
+    u32 written_submeshes = 0;
+    for (u32 i = 0; i < submesh_count; ++i) {
+        MeshBuilderSubmesh *source = &builder->submeshes[i];
+        if (source->index_count == 0) {
+            continue;
+        }
+
+        MeshSubmesh *submesh = &submeshes[written_submeshes++];
+        submesh->first_index = source->first_index;
+        submesh->index_count = source->index_count;
+        submesh->material = source->material;
+        submesh->bounds = bounds_compute(builder->vertices, &builder->indices[source->first_index],
+                                         source->index_count);
+
+        // Submeshes with a shorter chain repeat their coarsest level
+        for (u32 level = 0; level < lod_count; ++level) {
+            u32 available = level < submesh_lod_counts[i] ? level : submesh_lod_counts[i] - 1;
+            lods[(written_submeshes - 1) * lod_count + level] = submesh_lods[i * MESH_MAX_LODS + available];
+        }
+    }
+    submesh_count = written_submeshes;
+
+    // Level by level, so the renderer can draw one level of the whole mesh as a single meshlet range. Repeated levels
+    // get their own copy of the meshlets to keep that true.
+    for (u32 level = 0; level < lod_count; ++level) {
+        for (u32 i = 0; i < submesh_count; ++i) {
+            MeshLod *lod = &lods[i * lod_count + level];
+            lod->first_meshlet = darray_length(build.meshlets);
+            meshlets_build_submesh(&build, builder, &all_indices[lod->first_index], lod->index_count, local_index,
+                                   local_stamp);
+            lod->meshlet_count = darray_length(build.meshlets) - lod->first_meshlet;
+        }
+    }
+    for (u32 i = 0; i < submesh_count; ++i) {
+        submeshes[i].first_meshlet = lods[i * lod_count].first_meshlet;
+        submeshes[i].meshlet_count = lods[i * lod_count].meshlet_count;
+    }
+    header.submesh_count = submesh_count;
+    header.meshlet_count = darray_length(build.meshlets);
+
+    const void *section_data[MESH_SECTION_MAX] = {
+            vertices, indices, submeshes, build.meshlets, build.vertices, build.triangles, lods
+    };
+    u64 section_sizes[MESH_SECTION_MAX] = {
+            (u64) header.vertex_stride * vertex_count,
+            (u64) (header.index_type == MESH_INDEX_TYPE_U16 ? sizeof(u16) : sizeof(u32)) * index_count,
+            sizeof(MeshSubmesh) * submesh_count,
+            sizeof(MeshMeshlet) * header.meshlet_count,
+            sizeof(u32) * darray_length(build.vertices),
+            darray_length(build.triangles),
+            sizeof(MeshLod) * submesh_count * lod_count,
+    };
+
+    u64 offset = mesh_align(sizeof(MeshFileHeader));
+    for (u32 i = 0; i < MESH_SECTION_MAX; ++i) {
+        header.sections[i].offset = offset;
+        header.sections[i].size = section_sizes[i];
+        offset = mesh_align(offset + section_sizes[i]);
+    }
+
+    bool success = false;
+    FILE *file = fopen(path, "wb");
+    if (file != NULL) {
+        success = fwrite(&header, sizeof(header), 1, file) == 1;
+        for (u32 i = 0; success && i < MESH_SECTION_MAX; ++i) {
+            success = mesh_write_section(file, &header.sections[i], section_data[i]);
+        }
+        success = fclose(file) == 0 && success;
+    }
+
+    if (success) {
+        LOG_INFO("Wrote %s: %u vertices, %u indices, %u submeshes, %u meshlets, %u lods", path, vertex_count,
+                 index_count, submesh_count, header.meshlet_count, lod_count);
+        for (u32 i = 1; i < lod_count; ++i) {
+            LOG_INFO("  lod %u: error %f", i, header.lod_errors[i]);
+        }
+    } else {
+        LOG_ERROR("Failed to write mesh file: %s", path);
+    }
+
+    free(quantized);
+    free(indices_16);
+    free(submeshes);
+    free(lods);
+    free(submesh_lods);
+    free(submesh_lod_counts);
+    darray_destroy(all_indices);
+    free(local_index);
+    free(local_stamp);
+    darray_destroy(build.meshlets);
+    darray_destroy(build.vertices);
+    darray_destroy(build.triangles);
+    return success;
+}
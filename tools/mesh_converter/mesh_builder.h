@@ -0,0 +1,44 @@
+#pragma once
+
+#include <std/defines.h>
+#include "asset/mesh_format.h"
+
+typedef struct MeshBuilderSubmesh {
+    u32 first_index;
+    u32 index_count;
+    u32 material;
+} MeshBuilderSubmesh;
+
+typedef struct MeshBuilder {
+    MeshVertex *vertices;
+    u32 *indices;
+    MeshBuilderSubmesh *submeshes;
+} MeshBuilder;
+
+typedef struct MeshBuilderOptions {
+    bool quantize;
+    // Maximum number of levels of detail including full detail, 1 disables simplification
+    u32 lod_count;
+} MeshBuilderOptions;
+
+void mesh_builder_init(MeshBuilder *builder);
+
+void mesh_builder_destroy(MeshBuilder *builder);
+
+void mesh_builder_begin_submesh(MeshBuilder *builder, u32 material);
+
+void mesh_builder_end_submesh(MeshBuilder *builder);
+
+// Fills in normals for vertices that were loaded without one, from the faces they belong to
+void mesh_builder_generate_normals(MeshBuilder *builder, u32 first_vertex);
+
+// Quadric error edge collapse down to roughly target_index_count, writing the reduced triangle list into
+// out_indices (at least index_count large). Returns the new index count and the object space error.
+u32 simplify(const MeshVertex *vertices, u32 vertex_count, const u32 *indices, u32 index_count,
+             u32 target_index_count, float *out_error, u32 *out_indices);
+
+bool mesh_builder_write(MeshBuilder *builder, MeshBuilderOptions *options, const char *path);
+
+bool obj_load(const char *path, MeshBuilder *builder);
+
+bool gltf_load(const char *path, MeshBuilder *builder);
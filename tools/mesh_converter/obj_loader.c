@@ -0,0 +1,331 @@
+#include "mesh_builder.h"
+#include "core/log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <std/containers/darray.h>
+#include "core/mapped_file.h"
+
+#define OBJ_MAX_POLYGON 64
+
+typedef struct ObjCorner {
+    i32 position;
+    i32 uv;
+    i32 normal;
+} ObjCorner;
+
+typedef struct ObjVertexMap {
+    ObjCorner *keys;
+    u32 *values;
+    u32 capacity;
+    u32 count;
+} ObjVertexMap;
+
+typedef struct ObjMaterial {
+    char name[128];
+} ObjMaterial;
+
+typedef struct ObjParser {
+    const char *cursor;
+    const char *end;
+
+    float *positions;
+    float *uvs;
+    float *normals;
+
+    ObjVertexMap vertex_map;
+    ObjMaterial *materials;
+} ObjParser;
+
+u32 obj_corner_hash(ObjCorner *corner) {
+    u32 hash = (u32) corner->position * 73856093u;
+    hash ^= (u32) corner->uv * 19349663u;
+    hash ^= (u32) corner->normal * 83492791u;
+    return hash;
+}
+
+void obj_vertex_map_init(ObjVertexMap *map, u32 capacity) {
+    map->capacity = capacity;
+    map->count = 0;
+    map->keys = malloc(sizeof(ObjCorner) * capacity);
+    map->values = malloc(sizeof(u32) * capacity);
+    for (u32 i = 0; i < capacity; ++i) {
+        map->values[i] = UINT32_MAX;
+    }
+}
+
+void obj_vertex_map_destroy(ObjVertexMap *map) {
+    free(map->keys);
+    free(map->values);
+    map->keys = NULL;
+    map->values = NULL;
+}
+
+void obj_vertex_map_grow(ObjVertexMap *map) {
+    ObjVertexMap grown;
+    obj_vertex_map_init(&grown, map->capacity * 2);
+
+    for (u32 i = 0; i < map->capacity; ++i) {
+        if (map->values[i] == UINT32_MAX) {
+            continue;
+        }
+
+        u32 slot = obj_corner_hash(&map->keys[i]) & (grown.capacity - 1);
+        while (grown.values[slot] != UINT32_MAX) {
+            slot = (slot + 1) & (grown.capacity - 1);
+        }
+        grown.keys[slot] = map->keys[i];
+        grown.values[slot] = map->values[i];
+    }
+
+    grown.count = map->count;
+    obj_vertex_map_destroy(map);
+    *map = grown;
+}
+
+// Returns the slot holding the corner, or the empty slot it should go into
+u32 obj_vertex_map_find(ObjVertexMap *map, ObjCorner *corner) {
+    u32 slot = obj_corner_hash(corner) & (map->capacity - 1);
+    while (map->values[slot] != UINT32_MAX) {
+        ObjCorner *key = &map->keys[slot];
+        if (key->position == corner->position && key->uv == corner->uv && key->normal == corner->normal) {
+            break;
+        }
+        slot = (slot + 1) & (map->capacity - 1);
+    }
+    return slot;
+}
+
+void obj_skip_whitespace(ObjParser *parser) {
+    while (parser->cursor < parser->end && (*parser->cursor == ' ' || *parser->cursor == '\t')) {
+        parser->cursor++;
+    }
+}
+
+void obj_skip_line(ObjParser *parser) {
+    while (parser->cursor < parser->end && *parser->cursor != '\n') {
+        parser->cursor++;
+    }
+    if (parser->cursor < parser->end) {
+        parser->cursor++;
+    }
+}
+
+bool obj_at_line_end(ObjParser *parser) {
+    return parser->cursor >= parser->end || *parser->cursor == '\n' || *parser->cursor == '\r' ||
+           *parser->cursor == '#';
+}
+
+float obj_parse_float(ObjParser *parser) {
+    obj_skip_whitespace(parser);
+    char *end;
+    float value = strtof(parser->cursor, &end);
+    parser->cursor = end;
+    return value;
+}
+
+i32 obj_parse_int(ObjParser *parser) {
+    char *end;
+    long value = strtol(parser->cursor, &end, 10);
+    parser->cursor = end;
+    return (i32) value;
+}
+
+// Resolves 1-based and negative (relative) OBJ indices to 0-based ones, -1 when absent
+i32 obj_resolve_index(i32 index, u32 count) {
+    if (index > 0) {
+        return index - 1;
+    }
+    if (index < 0) {
+        return (i32) count + index;
+    }
+    return -1;
+}
+
+bool obj_parse_corner(ObjParser *parser, ObjCorner *out) {
+    obj_skip_whitespace(parser);
+    ObjCorner corner = {0};
+
+    corner.position = obj_resolve_index(obj_parse_int(parser), darray_length(parser->positions) / 3);
+    if (parser->cursor < parser->end && *parser->cursor == '/') {
+        parser->cursor++;
+        if (*parser->cursor != '/') {
+            corner.uv = obj_resolve_index(obj_parse_int(parser), darray_length(parser->uvs) / 2);
+        } else {
+            corner.uv = -1;
+        }
+
+        if (parser->cursor < parser->end && *parser->cursor == '/') {
+            parser->cursor++;
+            corner.normal = obj_resolve_index(obj_parse_int(parser), darray_length(parser->normals) / 3);
+        } else {
+            corner.normal = -1;
+        }
+    } else {
+        corner.uv = -1;
+        corner.normal = -1;
+    }
+
+    if (corner.position < 0 || corner.position >= (i32) (darray_length(parser->positions) / 3)) {
+        return false;
+    }
+
+    *out = corner;
+    return true;
+}
+
+u32 obj_emit_vertex(ObjParser *parser, MeshBuilder *builder, ObjCorner *corner) {
+    if (parser->vertex_map.count * 2 >= parser->vertex_map.capacity) {
+        obj_vertex_map_grow(&parser->vertex_map);
+    }
+
+    u32 slot = obj_vertex_map_find(&parser->vertex_map, corner);
+    if (parser->vertex_map.values[slot] != UINT32_MAX) {
+        return parser->vertex_map.values[slot];
+    }
+
+    MeshVertex vertex = {0};
+    memcpy(vertex.position, &parser->positions[corner->position * 3], sizeof(vertex.position));
+    if (corner->normal >= 0 && corner->normal < (i32) (darray_length(parser->normals) / 3)) {
+        memcpy(vertex.normal, &parser->normals[corner->normal * 3], sizeof(vertex.normal));
+    }
+    if (corner->uv >= 0 && corner->uv < (i32) (darray_length(parser->uvs) / 2)) {
+        vertex.uv[0] = parser->uvs[corner->uv * 2];
+        // OBJ uses a bottom-left uv origin, Vulkan samples from the top-left
+        vertex.uv[1] = 1.0f - parser->uvs[corner->uv * 2 + 1];
+    }
+
+    u32 index = darray_length(builder->vertices);
+    darray_push(builder->vertices, vertex);
+
+    parser->vertex_map.keys[slot] = *corner;
+    parser->vertex_map.values[slot] = index;
+    parser->vertex_map.count++;
+    return index;
+}
+
+bool obj_parse_face(ObjParser *parser, MeshBuilder *builder) {
+    u32 polygon[OBJ_MAX_POLYGON];
+    u32 count = 0;
+
+    while (!obj_at_line_end(parser)) {
+        ObjCorner corner;
+        if (!obj_parse_corner(parser, &corner)) {
+            return false;
+        }
+
+        if (count < OBJ_MAX_POLYGON) {
+            polygon[count++] = obj_emit_vertex(parser, builder, &corner);
+        }
+        obj_skip_whitespace(parser);
+    }
+
+    // Fan triangulation, fine for the convex polygons exporters produce
+    for (u32 i = 1; i + 1 < count; ++i) {
+        darray_push(builder->indices, polygon[0]);
+        darray_push(builder->indices, polygon[i]);
+        darray_push(builder->indices, polygon[i + 1]);
+    }
+    return true;
+}
+
+u32 obj_material_index(ObjParser *parser) {
+    obj_skip_whitespace(parser);
+    ObjMaterial material = {0};
+
+    u32 length = 0;
+    while (!obj_at_line_end(parser) && length + 1 < sizeof(material.name)) {
+        material.name[length++] = *parser->cursor++;
+    }
+    while (length > 0 && (material.name[length - 1] == ' ' || material.name[length - 1] == '\t')) {
+        material.name[--length] = '\0';
+    }
+
+    for (u32 i = 0; i < darray_length(parser->materials); ++i) {
+        if (strcmp(parser->materials[i].name, material.name) == 0) {
+            return i;
+        }
+    }
+
+    darray_push(parser->materials, material);
+    return darray_length(parser->materials) - 1;
+}
+
+bool obj_load(const char *path, MeshBuilder *builder) {
+    MappedFile file;
+    if (!mapped_file_open(path, &file)) {
+        LOG_ERROR("Failed to open OBJ file: %s", path);
+        return false;
+    }
+
+    // strtof/strtol need a terminator the mapping doesn't have
+    u64 size = file.size;
+    char *text = malloc(size + 1);
+    memcpy(text, file.data, size);
+    text[size] = '\0';
+    mapped_file_close(&file);
+
+    ObjParser parser = {
+            .cursor = text,
+            .end = text + size,
+            .positions = darray_create(float),
+            .uvs = darray_create(float),
+            .normals = darray_create(float),
+            .materials = darray_create(ObjMaterial),
+    };
+    obj_vertex_map_init(&parser.vertex_map, 1024);
+
+    u32 first_vertex = darray_length(builder->vertices);
+    mesh_builder_begin_submesh(builder, 0);
+
+    bool success = true;
+    while (success && parser.cursor < parser.end) {
+        obj_skip_whitespace(&parser);
+        const char *line = parser.cursor;
+        u64 remaining = parser.end - line;
+
+        if (remaining > 2 && line[0] == 'v' && line[1] == ' ') {
+            parser.cursor += 2;
+            for (u32 i = 0; i < 3; ++i) {
+                float value = obj_parse_float(&parser);
+                darray_push(parser.positions, value);
+            }
+        } else if (remaining > 3 && line[0] == 'v' && line[1] == 't' && line[2] == ' ') {
+            parser.cursor += 3;
+            for (u32 i = 0; i < 2; ++i) {
+                float value = obj_parse_float(&parser);
+                darray_push(parser.uvs, value);
+            }
+        } else if (remaining > 3 && line[0] == 'v' && line[1] == 'n' && line[2] == ' ') {
+            parser.cursor += 3;
+            for (u32 i = 0; i < 3; ++i) {
+                float value = obj_parse_float(&parser);
+                darray_push(parser.normals, value);
+            }
+        } else if (remaining > 2 && line[0] == 'f' && line[1] == ' ') {
+            parser.cursor += 2;
+            success = obj_parse_face(&parser, builder);
+        } else if (remaining > 7 && strncmp(line, "usemtl ", 7) == 0) {
+            parser.cursor += 7;
+            mesh_builder_end_submesh(builder);
+            mesh_builder_begin_submesh(builder, obj_material_index(&parser));
+        }
+
+        obj_skip_line(&parser);
+    }
+    mesh_builder_end_submesh(builder);
+
+    if (success) {
+        mesh_builder_generate_normals(builder, first_vertex);
+    } else {
+        LOG_ERROR("Malformed face in OBJ file: %s", path);
+    }
+
+    obj_vertex_map_destroy(&parser.vertex_map);
+    darray_destroy(parser.positions);
+    darray_destroy(parser.uvs);
+    darray_destroy(parser.normals);
+    darray_destroy(parser.materials);
+    free(text);
+    return success;
+}
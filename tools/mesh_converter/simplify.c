@@ -0,0 +1,338 @@
+#include "mesh_builder.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Edge collapse simplification driven by quadric error metrics (Garland & Heckbert). Vertices only ever collapse
+// onto existing vertices so every level can share the full detail vertex stream. Border and attribute seam
+// vertices are locked to keep the silhouette and uv layout intact.
+
+typedef struct Quadric {
+    double a00, a01, a02, a03;
+    double a11, a12, a13;
+    double a22, a23;
+    double a33;
+    double weight;
+} Quadric;
+
+typedef struct Collapse {
+    u32 from;
+    u32 to;
+    double cost;
+} Collapse;
+
+typedef struct PositionKey {
+    float position[3];
+    u32 vertex;
+} PositionKey;
+
+void quadric_add(Quadric *target, const Quadric *source) {
+    target->a00 += source->a00;
+    target->a01 += source->a01;
+    target->a02 += source->a02;
+    target->a03 += source->a03;
+    target->a11 += source->a11;
+    target->a12 += source->a12;
+    target->a13 += source->a13;
+    target->a22 += source->a22;
+    target->a23 += source->a23;
+    target->a33 += source->a33;
+    target->weight += source->weight;
+}
+
+Quadric quadric_from_plane(double a, double b, double c, double d, double weight) {
+    Quadric q = {
+            a * a * weight, a * b * weight, a * c * weight, a * d * weight,
+            b * b * weight, b * c * weight, b * d * weight,
+            c * c * weight, c * d * weight,
+            d * d * weight,
+            weight
+    };
+    return q;
+}
+
+double quadric_error(const Quadric *q, const float *p) {
+    double x = p[0], y = p[1], z = p[2];
+    double error = q->a00 * x * x + 2.0 * q->a01 * x * y + 2.0 * q->a02 * x * z + 2.0 * q->a03 * x +
+                   q->a11 * y * y + 2.0 * q->a12 * y * z + 2.0 * q->a13 * y +
+                   q->a22 * z * z + 2.0 * q->a23 * z +
+                   q->a33;
+    return error > 0.0 ? error : 0.0;
+}
+
+int position_key_compare(const void *a, const void *b) {
+    const PositionKey *ka = a, *kb = b;
+    int result = memcmp(ka->position, kb->position, sizeof(ka->position));
+    if (result != 0) {
+        return result;
+    }
+    return ka->vertex < kb->vertex ? -1 : ka->vertex > kb->vertex;
+}
+
+int collapse_compare(const void *a, const void *b) {
+    const Collapse *ca = a, *cb = b;
+    return ca->cost < cb->cost ? -1 : ca->cost > cb->cost;
+}
+
+int edge_compare(const void *a, const void *b) {
+    const u64 ea = *(const u64 *) a, eb = *(const u64 *) b;
+    return ea < eb ? -1 : ea > eb;
+}
+
+u64 edge_key(u32 a, u32 b) {
+    return a < b ? ((u64) a << 32) | b : ((u64) b << 32) | a;
+}
+
+void face_normal(const MeshVertex *vertices, u32 a, u32 b, u32 c, const float *override_position, u32 override,
+                 float *out) {
+    const float *pa = a == override ? override_position : vertices[a].position;
+    const float *pb = b == override ? override_position : vertices[b].position;
+    const float *pc = c == override ? override_position : vertices[c].position;
+
+    float e0[3] = {pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2]};
+    float e1[3] = {pc[0] - pa[0], pc[1] - pa[1], pc[2] - pa[2]};
+    out[0] = e0[1] * e1[2] - e0[2] * e1[1];
+    out[1] = e0[2] * e1[0] - e0[0] * e1[2];
+    out[2] = e0[0] * e1[1] - e0[1] * e1[0];
+}
+
+// Maps every vertex to the first vertex sharing its exact position, marking positions shared by several
+// vertices (uv or normal seams) as locked
+void build_position_remap(const MeshVertex *vertices, u32 vertex_count, u32 *remap, bool *locked) {
+    PositionKey *keys = malloc(sizeof(PositionKey) * vertex_count);
+    for (u32 i = 0; i < vertex_count; ++i) {
+        memcpy(keys[i].position, vertices[i].position, sizeof(keys[i].position));
+        keys[i].vertex = i;
+    }
+    qsort(keys, vertex_count, sizeof(PositionKey), position_key_compare);
+
+    for (u32 i = 0; i < vertex_count;) {
+        u32 end = i + 1;
+        while (end < vertex_count && memcmp(keys[end].position, keys[i].position, sizeof(keys[i].position)) == 0) {
+            ++end;
+        }
+
+        for (u32 j = i; j < end; ++j) {
+            remap[keys[j].vertex] = keys[i].vertex;
+        }
+        if (end - i > 1) {
+            locked[keys[i].vertex] = true;
+        }
+        i = end;
+    }
+
+    free(keys);
+}
+
+void lock_borders(const u32 *triangles, u32 index_count, bool *locked) {
+    u32 edge_count = index_count;
+    u64 *edges = malloc(sizeof(u64) * edge_count);
+    for (u32 i = 0; i < index_count; i += 3) {
+        for (u32 corner = 0; corner < 3; ++corner) {
+            edges[i + corner] = edge_key(triangles[i + corner], triangles[i + (corner + 1) % 3]);
+        }
+    }
+    qsort(edges, edge_count, sizeof(u64), edge_compare);
+
+    for (u32 i = 0; i < edge_count;) {
+        u32 end = i + 1;
+        while (end < edge_count && edges[end] == edges[i]) {
+            ++end;
+        }
+
+        if (end - i == 1) {
+            locked[edges[i] >> 32] = true;
+            locked[edges[i] & 0xFFFFFFFF] = true;
+        }
+        i = end;
+    }
+
+    free(edges);
+}
+
+// Triangles around each vertex in compressed rows: triangles adjacent to v are adjacency[offsets[v]..offsets[v+1])
+void build_adjacency(const u32 *triangles, u32 index_count, u32 vertex_count, u32 *offsets, u32 *adjacency) {
+    memset(offsets, 0, sizeof(u32) * (vertex_count + 1));
+    for (u32 i = 0; i < index_count; ++i) {
+        offsets[triangles[i] + 1]++;
+    }
+    for (u32 i = 0; i < vertex_count; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    u32 *fill = malloc(sizeof(u32) * vertex_count);
+    memcpy(fill, offsets, sizeof(u32) * vertex_count);
+    for (u32 i = 0; i < index_count; ++i) {
+        adjacency[fill[triangles[i]]++] = i / 3;
+    }
+    free(fill);
+}
+
+bool collapse_flips(const MeshVertex *vertices, const u32 *triangles, const u32 *offsets, const u32 *adjacency,
+                    u32 from, u32 to) {
+    for (u32 i = offsets[from]; i < offsets[from + 1]; ++i) {
+        const u32 *triangle = &triangles[adjacency[i] * 3];
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+            // Becomes degenerate and is removed
+            continue;
+        }
+
+        float before[3], after[3];
+        face_normal(vertices, triangle[0], triangle[1], triangle[2], NULL, UINT32_MAX, before);
+        face_normal(vertices, triangle[0], triangle[1], triangle[2], vertices[to].position, from, after);
+        if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0f) {
+            return true;
+        }
+    }
+    return false;
+}
+
+u32 simplify(const MeshVertex *vertices, u32 vertex_count, const u32 *indices, u32 index_count,
+             u32 target_index_count, float *out_error, u32 *out_indices) {
+    u32 *remap = malloc(sizeof(u32) * vertex_count);
+    bool *locked = calloc(vertex_count, sizeof(bool));
+    build_position_remap(vertices, vertex_count, remap, locked);
+
+    // Work on position-welded triangles, seams were locked above so welded vertices never move
+    u32 *triangles = malloc(sizeof(u32) * index_count);
+    u32 *corners = malloc(sizeof(u32) * index_count);
+    for (u32 i = 0; i < index_count; ++i) {
+        triangles[i] = remap[indices[i]];
+        corners[i] = indices[i];
+    }
+    lock_borders(triangles, index_count, locked);
+
+    Quadric *quadrics = calloc(vertex_count, sizeof(Quadric));
+    for (u32 i = 0; i < index_count; i += 3) {
+        float normal[3];
+        face_normal(vertices, triangles[i], triangles[i + 1], triangles[i + 2], NULL, UINT32_MAX, normal);
+        double length = sqrt((double) normal[0] * normal[0] + (double) normal[1] * normal[1] +
+                             (double) normal[2] * normal[2]);
+        if (length == 0.0) {
+            continue;
+        }
+
+        double a = normal[0] / length, b = normal[1] / length, c = normal[2] / length;
+        const float *p = vertices[triangles[i]].position;
+        double d = -(a * p[0] + b * p[1] + c * p[2]);
+
+        // Area weighted so large faces dominate the placement
+        Quadric q = quadric_from_plane(a, b, c, d, length * 0.5);
+        for (u32 corner = 0; corner < 3; ++corner) {
+            quadric_add(&quadrics[triangles[i + corner]], &q);
+        }
+    }
+
+    u32 *collapsed = malloc(sizeof(u32) * vertex_count);
+    for (u32 i = 0; i < vertex_count; ++i) {
+        collapsed[i] = i;
+    }
+
+    u32 *offsets = malloc(sizeof(u32) * (vertex_count + 1));
+    u32 *adjacency = malloc(sizeof(u32) * index_count);
+    Collapse *collapses = malloc(sizeof(Collapse) * index_count * 2);
+    bool *touched = malloc(sizeof(bool) * vertex_count);
+    double max_error = 0.0;
+
+    while (index_count > target_index_count) {
+        build_adjacency(triangles, index_count, vertex_count, offsets, adjacency);
+
+        u32 collapse_count = 0;
+        for (u32 i = 0; i < index_count; ++i) {
+            u32 a = triangles[i];
+            u32 b = triangles[i - i % 3 + (i + 1) % 3];
+            u32 ends[2][2] = {{a, b}, {b, a}};
+            for (u32 direction = 0; direction < 2; ++direction) {
+                u32 from = ends[direction][0], to = ends[direction][1];
+                if (locked[from]) {
+                    continue;
+                }
+
+                Quadric q = quadrics[from];
+                quadric_add(&q, &quadrics[to]);
+                Collapse collapse = {from, to, quadric_error(&q, vertices[to].position) / q.weight};
+                collapses[collapse_count++] = collapse;
+            }
+        }
+
+        if (collapse_count == 0) {
+            break;
+        }
+        qsort(collapses, collapse_count, sizeof(Collapse), collapse_compare);
+
+        // Each pass removes at most the triangles it needs to reach the target
+        memset(touched, 0, sizeof(bool) * vertex_count);
+        u32 triangles_to_remove = (index_count - target_index_count) / 3;
+        u32 removed = 0;
+        u32 applied = 0;
+        for (u32 i = 0; i < collapse_count && removed < triangles_to_remove; ++i) {
+            Collapse *collapse = &collapses[i];
+            if (touched[collapse->from] || touched[collapse->to]) {
+                continue;
+            }
+
+            if (collapse_flips(vertices, triangles, offsets, adjacency, collapse->from, collapse->to)) {
+                continue;
+            }
+
+            collapsed[collapse->from] = collapse->to;
+            quadric_add(&quadrics[collapse->to], &quadrics[collapse->from]);
+            if (collapse->cost > max_error) {
+                max_error = collapse->cost;
+            }
+
+            // Neighbours are frozen for the rest of the pass so flip checks stay valid
+            for (u32 j = offsets[collapse->from]; j < offsets[collapse->from + 1]; ++j) {
+                const u32 *triangle = &triangles[adjacency[j] * 3];
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+                if (triangle[0] == collapse->to || triangle[1] == collapse->to || triangle[2] == collapse->to) {
+                    ++removed;
+                }
+            }
+            ++applied;
+        }
+
+        if (applied == 0) {
+            break;
+        }
+
+        u32 written = 0;
+        for (u32 i = 0; i < index_count; i += 3) {
+            u32 a = collapsed[triangles[i]], b = collapsed[triangles[i + 1]], c = collapsed[triangles[i + 2]];
+            if (a == b || b == c || a == c) {
+                continue;
+            }
+            for (u32 corner = 0; corner < 3; ++corner) {
+                u32 vertex = triangles[i + corner];
+                corners[written + corner] = collapsed[vertex] == vertex ? corners[i + corner] : collapsed[vertex];
+            }
+            triangles[written++] = a;
+            triangles[written++] = b;
+            triangles[written++] = c;
+        }
+        index_count = written;
+
+        // Collapses within a pass never chain, but the next pass must see final targets
+        for (u32 i = 0; i < vertex_count; ++i) {
+            collapsed[i] = i;
+        }
+    }
+
+    // Corners that never moved keep their original vertex so seams keep their attributes
+    memcpy(out_indices, corners, sizeof(u32) * index_count);
+
+    *out_error = (float) sqrt(max_error);
+
+    free(remap);
+    free(locked);
+    free(triangles);
+    free(corners);
+    free(quadrics);
+    free(collapsed);
+    free(offsets);
+    free(adjacency);
+    free(collapses);
+    free(touched);
+    return index_count;
+}
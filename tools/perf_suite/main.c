@@ -0,0 +1,668 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <SDL.h>
+#include <SDL_vulkan.h>
+#include <std/containers/darray.h>
+#include "core/arena.h"
+#include "core/cull.h"
+#include "core/job.h"
+#include "core/log.h"
+#include "renderer/pipeline_cache.h"
+#include "renderer/vulkan.h"
+#include "mesh_builder.h"
+
+#define PERF_MAX_METRICS 32
+#define PERF_MAX_NAME 64
+#define PERF_MESH_PATH "perf_suite_sphere.mesh"
+#define PERF_WIDTH 640
+#define PERF_HEIGHT 360
+
+// Relative slowdown a metric may show against its baseline before it counts as a regression. Init and pipeline
+// creation go through the driver and the file system, so they are noisier than the rest.
+#define PERF_TOLERANCE 0.15
+#define PERF_INIT_TOLERANCE 0.30
+
+#define PERF_DEFAULT_FRAMES 200
+#define PERF_WARMUP_FRAMES 20
+#define PERF_CULL_OBJECTS (256 * 1024)
+#define PERF_CULL_ITERATIONS 20
+#define PERF_ALLOC_COUNT 4096
+#define PERF_ALLOC_ITERATIONS 200
+// Particles live about a second, so the warmup runs long enough for emission and expiry to balance out
+#define PERF_PARTICLE_LIFETIME 1.0f
+#define PERF_PARTICLE_WARMUP_SECONDS 1.5
+// Spheres the light benchmark shades, every one of them in view
+#define PERF_LIGHT_DRAWS 1024
+// Exit code for machines that can't run the suite, registered with CTest as SKIP_RETURN_CODE
+#define PERF_EXIT_SKIPPED 77
+
+typedef struct PerfOptions {
+    const char *baseline_path;
+    const char *write_path;
+    // Runs on the best GPU instead of a CPU implementation
+    bool hardware;
+    u32 frames;
+} PerfOptions;
+
+// Lower is better for every metric
+typedef struct PerfMetric {
+    char name[PERF_MAX_NAME];
+    double value;
+    double tolerance;
+} PerfMetric;
+
+typedef struct PerfSuite {
+    PerfMetric metrics[PERF_MAX_METRICS];
+    u32 metric_count;
+    SDL_Window *window;
+} PerfSuite;
+
+void print_usage() {
+    printf("Usage:\n");
+    printf("  perf_suite [--baseline=path] [--write-baseline=path] [--hardware] [--frames=N]\n");
+    printf("Runs on a CPU Vulkan implementation unless --hardware is given and exits with 1 when a metric is slower\n");
+    printf("than its baseline by more than the baseline's tolerance, or with %d when there is no display, no device or\n",
+           PERF_EXIT_SKIPPED);
+    printf("a baseline without metrics.\n");
+}
+
+double now_seconds() {
+    struct timespec time;
+    timespec_get(&time, TIME_UTC);
+    return (double) time.tv_sec + (double) time.tv_nsec * 1e-9;
+}
+
+float random_range(float min, float max) {
+    return min + (max - min) * ((float) rand() / (float) RAND_MAX);
+}
+
+bool perf_parse_options(int argc, char **argv, PerfOptions *out) {
+    PerfOptions result = {.frames = PERF_DEFAULT_FRAMES};
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--baseline=", 11) == 0) {
+            result.baseline_path = argv[i] + 11;
+        } else if (strncmp(argv[i], "--write-baseline=", 17) == 0) {
+            result.write_path = argv[i] + 17;
+        } else if (strcmp(argv[i], "--hardware") == 0) {
+            result.hardware = true;
+        } else if (strncmp(argv[i], "--frames=", 9) == 0) {
+            result.frames = (u32) strtoul(argv[i] + 9, NULL, 10);
+        } else {
+            return false;
+        }
+    }
+
+    *out = result;
+    return result.frames > 0;
+}
+
+void perf_add(PerfSuite *suite, const char *name, double value, double tolerance) {
+    if (suite->metric_count == PERF_MAX_METRICS) {
+        printf("ERROR: too many metrics, %s is dropped\n", name);
+        return;
+    }
+
+    PerfMetric *metric = &suite->metrics[suite->metric_count++];
+    snprintf(metric->name, PERF_MAX_NAME, "%s", name);
+    metric->value = value;
+    metric->tolerance = tolerance;
+    printf("  %-28s %12.4f\n", name, value);
+}
+
+// UV sphere of radius 1, small enough that large scenes stay reasonable on a CPU implementation
+bool perf_sphere_write(const char *path) {
+    const u32 rings = 12;
+    const u32 sectors = 24;
+    const float pi = 3.14159265f;
+
+    MeshBuilder builder;
+    mesh_builder_init(&builder);
+    mesh_builder_begin_submesh(&builder, 0);
+    for (u32 ring = 0; ring <= rings; ++ring) {
+        float theta = pi * (float) ring / (float) rings;
+        for (u32 sector = 0; sector <= sectors; ++sector) {
+            float phi = 2.0f * pi * (float) sector / (float) sectors;
+            MeshVertex vertex = {0};
+            vertex.normal[0] = sinf(theta) * cosf(phi);
+            vertex.normal[1] = cosf(theta);
+            vertex.normal[2] = sinf(theta) * sinf(phi);
+            memcpy(vertex.position, vertex.normal, sizeof(vertex.position));
+            vertex.uv[0] = (float) sector / (float) sectors;
+            vertex.uv[1] = (float) ring / (float) rings;
+            darray_push(builder.vertices, vertex);
+        }
+    }
+
+    for (u32 ring = 0; ring < rings; ++ring) {
+        for (u32 sector = 0; sector < sectors; ++sector) {
+            u32 a = ring * (sectors + 1) + sector;
+            u32 b = a + sectors + 1;
+            u32 quad[6] = {a, a + 1, b, a + 1, b + 1, b};
+            for (u32 i = 0; i < 6; ++i) {
+                darray_push(builder.indices, quad[i]);
+            }
+        }
+    }
+    mesh_builder_end_submesh(&builder);
+
+    MeshBuilderOptions options = {.quantize = false, .lod_count = 1};
+    bool written = mesh_builder_write(&builder, &options, path);
+    mesh_builder_destroy(&builder);
+    return written;
+}
+
+// Camera at the origin looking down -z with a 60 degree field of view
+void perf_projection(float aspect, float *out) {
+    float near = 0.1f;
+    float far = 1000.0f;
+    float focal = 1.0f / tanf(30.0f * 3.14159265f / 180.0f);
+
+    memset(out, 0, sizeof(float) * 16);
+    out[0] = focal / aspect;
+    out[5] = -focal;
+    out[10] = far / (near - far);
+    out[11] = -1.0f;
+    out[14] = near * far / (near - far);
+}
+
+bool perf_init(PerfSuite *suite, const char *variant) {
+    // Uncapped and at full resolution, so the scene sizes measure the same amount of work on every run
+    PresentSettings present = {.policy = PRESENT_POLICY_BENCHMARK};
+    if (!vulkan_init(suite->window, "Perf Suite", &present)) {
+        printf("ERROR: failed to initialize Vulkan\n");
+        return false;
+    }
+    vulkan_set_frame_budget(0.0);
+
+    VulkanInitStats stats;
+    vulkan_init_stats(&stats);
+    char name[PERF_MAX_NAME];
+    snprintf(name, PERF_MAX_NAME, "init_%s_ms", variant);
+    perf_add(suite, name, stats.init_ms, PERF_INIT_TOLERANCE);
+    snprintf(name, PERF_MAX_NAME, "pipeline_%s_ms", variant);
+    perf_add(suite, name, stats.pipeline_ms, PERF_INIT_TOLERANCE);
+    return true;
+}
+
+void perf_pump_events() {
+    SDL_Event event;
+    while (SDL_PollEvent(&event)) {
+    }
+}
+
+// Spheres in a square grid in front of the camera, far enough back that all of them are in view
+void perf_submit_frame(u32 mesh, u32 draw_count) {
+    u32 side = (u32) ceilf(sqrtf((float) draw_count));
+    float spacing = 2.5f;
+    float distance = (float) side * spacing * 1.2f + 5.0f;
+
+    MeshletDraw *draws = vulkan_reserve_draws(draw_count);
+    for (u32 i = 0; i < draw_count; ++i) {
+        float *transform = draws[i].transform;
+        memset(transform, 0, sizeof(draws[i].transform));
+        transform[0] = 1.0f;
+        transform[5] = 1.0f;
+        transform[10] = 1.0f;
+        transform[15] = 1.0f;
+        transform[12] = ((float) (i % side) - (float) side * 0.5f) * spacing;
+        transform[13] = ((float) (i / side) - (float) side * 0.5f) * spacing;
+        transform[14] = -distance;
+        draws[i].mesh = mesh;
+    }
+    vulkan_render();
+}
+
+// Point and spot lights scattered just in front of the sphere grid of perf_submit_frame, mostly small enough that each
+// one only reaches a few clusters
+void perf_lights_create(u32 draw_count, u32 count, Light *out) {
+    u32 side = (u32) ceilf(sqrtf((float) draw_count));
+    float spacing = 2.5f;
+    float half_width = (float) side * spacing * 0.5f;
+    float distance = (float) side * spacing * 1.2f + 5.0f;
+
+    srand(2);
+    for (u32 i = 0; i < count; ++i) {
+        Light light = {0};
+        light.type = i % 4 == 0 ? LIGHT_TYPE_SPOT : LIGHT_TYPE_POINT;
+        light.position[0] = random_range(-half_width, half_width);
+        light.position[1] = random_range(-half_width, half_width);
+        light.position[2] = -distance + random_range(1.5f, 4.0f);
+        light.direction[2] = -1.0f;
+        light.color[0] = random_range(0.2f, 1.0f);
+        light.color[1] = random_range(0.2f, 1.0f);
+        light.color[2] = random_range(0.2f, 1.0f);
+        light.intensity = 8.0f;
+        light.range = random_range(2.0f, 6.0f);
+        light.inner_angle = 0.3f;
+        light.outer_angle = 0.5f;
+        out[i] = light;
+    }
+}
+
+void perf_frames(PerfSuite *suite, u32 mesh, u32 draw_count, u32 frames) {
+    float view_projection[16];
+    float camera[3] = {0.0f, 0.0f, 0.0f};
+    perf_projection((float) PERF_WIDTH / (float) PERF_HEIGHT, view_projection);
+
+    double start = 0.0;
+    for (u32 i = 0; i < PERF_WARMUP_FRAMES + frames; ++i) {
+        if (i == PERF_WARMUP_FRAMES) {
+            start = now_seconds();
+        }
+        perf_pump_events();
+        vulkan_wait_frame_start();
+        vulkan_set_view(view_projection, camera);
+        perf_submit_frame(mesh, draw_count);
+    }
+    double elapsed = now_seconds() - start;
+
+    char name[PERF_MAX_NAME];
+    snprintf(name, PERF_MAX_NAME, "frame_%u_draws_ms", draw_count);
+    perf_add(suite, name, elapsed * 1000.0 / frames, PERF_TOLERANCE);
+}
+
+// Sphere grid shaded by light_count lights, resubmitted every frame like dynamic lights would be
+void perf_lights(PerfSuite *suite, u32 mesh, u32 light_count, u32 frames) {
+    Light *lights = malloc(sizeof(Light) * light_count);
+    perf_lights_create(PERF_LIGHT_DRAWS, light_count, lights);
+
+    float view_projection[16];
+    float camera[3] = {0.0f, 0.0f, 0.0f};
+    perf_projection((float) PERF_WIDTH / (float) PERF_HEIGHT, view_projection);
+
+    double start = 0.0;
+    for (u32 i = 0; i < PERF_WARMUP_FRAMES + frames; ++i) {
+        if (i == PERF_WARMUP_FRAMES) {
+            start = now_seconds();
+        }
+        perf_pump_events();
+        vulkan_wait_frame_start();
+        vulkan_set_view(view_projection, camera);
+        memcpy(vulkan_reserve_lights(light_count), lights, sizeof(Light) * light_count);
+        perf_submit_frame(mesh, PERF_LIGHT_DRAWS);
+    }
+    double elapsed = now_seconds() - start;
+    free(lights);
+
+    char name[PERF_MAX_NAME];
+    snprintf(name, PERF_MAX_NAME, "lights_%u_ms", light_count);
+    perf_add(suite, name, elapsed * 1000.0 / frames, PERF_TOLERANCE);
+}
+
+// Particle system at steady state with nothing else in the scene, the emission rate keeps every slot busy
+void perf_particles(PerfSuite *suite, u32 capacity, u32 frames) {
+    ParticleSettings settings = {
+            .capacity = capacity,
+            .emit_rate = (float) capacity / PERF_PARTICLE_LIFETIME,
+            .lifetime = PERF_PARTICLE_LIFETIME,
+            .origin = {0.0f, -2.0f, -20.0f},
+            .speed = 8.0f,
+            .size = 0.05f
+    };
+    if (!vulkan_set_particles(&settings)) {
+        printf("ERROR: couldn't configure %u particles\n", capacity);
+        return;
+    }
+
+    float view_projection[16];
+    float camera[3] = {0.0f, 0.0f, 0.0f};
+    perf_projection((float) PERF_WIDTH / (float) PERF_HEIGHT, view_projection);
+
+    double warmup_start = now_seconds();
+    for (u32 i = 0; i < PERF_WARMUP_FRAMES || now_seconds() - warmup_start < PERF_PARTICLE_WARMUP_SECONDS; ++i) {
+        perf_pump_events();
+        vulkan_wait_frame_start();
+        vulkan_set_view(view_projection, camera);
+        vulkan_render();
+    }
+
+    double start = now_seconds();
+    for (u32 i = 0; i < frames; ++i) {
+        perf_pump_events();
+        vulkan_wait_frame_start();
+        vulkan_set_view(view_projection, camera);
+        vulkan_render();
+    }
+    double elapsed = now_seconds() - start;
+
+    char name[PERF_MAX_NAME];
+    snprintf(name, PERF_MAX_NAME, "particles_%u_ms", capacity);
+    perf_add(suite, name, elapsed * 1000.0 / frames, PERF_TOLERANCE);
+}
+
+bool perf_renderer(PerfSuite *suite, const PerfOptions *options) {
+    if (!perf_sphere_write(PERF_MESH_PATH)) {
+        printf("ERROR: couldn't write %s\n", PERF_MESH_PATH);
+        return false;
+    }
+
+    // Cold starts without a pipeline cache, warm creates its pipelines from the one cold saved at shutdown
+    remove(PIPELINE_CACHE_PATH);
+    if (!perf_init(suite, "cold")) {
+        return false;
+    }
+
+    u32 mesh = vulkan_load_mesh(PERF_MESH_PATH);
+    bool loaded = mesh != MESH_INVALID;
+    if (loaded) {
+        u32 draw_counts[] = {1, 64, 1024};
+        for (u32 i = 0; i < sizeof(draw_counts) / sizeof(u32); ++i) {
+            perf_frames(suite, mesh, draw_counts[i], options->frames);
+        }
+
+        // Compare with frame_1024_draws_ms, the same spheres shaded without lights
+        u32 light_counts[] = {256, 1024, 4096, 16 * 1024};
+        u32 light_runs = options->hardware ? 4 : 3;
+        for (u32 i = 0; i < light_runs; ++i) {
+            perf_lights(suite, mesh, light_counts[i], options->frames);
+        }
+
+        // Each count is four times the one before, so the steps show whether the cost grows linearly. A million only
+        // runs on hardware, a CPU implementation would take minutes.
+        u32 particle_counts[] = {16 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024};
+        u32 particle_runs = options->hardware ? 4 : 3;
+        for (u32 i = 0; i < particle_runs; ++i) {
+            perf_particles(suite, particle_counts[i], options->frames);
+        }
+        ParticleSettings off = {0};
+        vulkan_set_particles(&off);
+    } else {
+        printf("ERROR: couldn't load %s\n", PERF_MESH_PATH);
+    }
+    vulkan_shutdown();
+    remove(PERF_MESH_PATH);
+
+    if (!loaded || !perf_init(suite, "warm")) {
+        return false;
+    }
+    vulkan_shutdown();
+    remove(PIPELINE_CACHE_PATH);
+    return true;
+}
+
+// Scratch allocations of mixed sizes released by one scope, the pattern every enumeration in the renderer uses
+void perf_allocator(PerfSuite *suite) {
+    double best = 0.0;
+    for (u32 i = 0; i < PERF_ALLOC_ITERATIONS; ++i) {
+        double start = now_seconds();
+        ArenaScope scratch = scratch_begin();
+        for (u32 j = 0; j < PERF_ALLOC_COUNT; ++j) {
+            u8 *memory = arena_alloc(scratch.arena, 16 + (j & 7) * 24, 16);
+            memory[0] = (u8) j;
+        }
+        scratch_end(scratch);
+        double elapsed = now_seconds() - start;
+        if (i == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    perf_add(suite, "arena_alloc_ns", best * 1e9 / PERF_ALLOC_COUNT, PERF_TOLERANCE);
+}
+
+void perf_bounds_create(u32 count, CullBounds *out) {
+    CullBounds result = {0};
+    for (u32 axis = 0; axis < 3; ++axis) {
+        result.center[axis] = malloc(sizeof(float) * count);
+        result.extent[axis] = malloc(sizeof(float) * count);
+    }
+    result.radius = malloc(sizeof(float) * count);
+    result.count = count;
+
+    srand(1);
+    for (u32 i = 0; i < count; ++i) {
+        float radius = 0.0f;
+        for (u32 axis = 0; axis < 3; ++axis) {
+            result.center[axis][i] = random_range(-500.0f, 500.0f);
+            result.extent[axis][i] = random_range(0.5f, 4.0f);
+            radius += result.extent[axis][i] * result.extent[axis][i];
+        }
+        result.radius[i] = sqrtf(radius);
+    }
+    *out = result;
+}
+
+void perf_bounds_destroy(CullBounds *bounds) {
+    for (u32 axis = 0; axis < 3; ++axis) {
+        free(bounds->center[axis]);
+        free(bounds->extent[axis]);
+    }
+    free(bounds->radius);
+}
+
+void perf_culling(PerfSuite *suite, Culler *culler) {
+    CullFrustum frustum;
+    float projection[16];
+    perf_projection(16.0f / 9.0f, projection);
+    cull_frustum_extract(projection, &frustum);
+
+    CullBounds bounds;
+    perf_bounds_create(PERF_CULL_OBJECTS, &bounds);
+    u32 *visible = malloc(sizeof(u32) * PERF_CULL_OBJECTS);
+
+    const char *names[] = {"cull_sphere_ms", "cull_box_ms", "cull_threaded_sphere_ms"};
+    for (u32 test = 0; test < 3; ++test) {
+        CullShape shape = test == 1 ? CULL_SHAPE_BOX : CULL_SHAPE_SPHERE;
+        double best = 0.0;
+        for (u32 i = 0; i < PERF_CULL_ITERATIONS; ++i) {
+            double start = now_seconds();
+            if (test == 2) {
+                culler_run(culler, &frustum, &bounds, shape, visible);
+            } else {
+                cull_range(&frustum, &bounds, shape, 0, bounds.count, visible);
+            }
+            double elapsed = now_seconds() - start;
+            if (i == 0 || elapsed < best) {
+                best = elapsed;
+            }
+        }
+        perf_add(suite, names[test], best * 1000.0, PERF_TOLERANCE);
+    }
+
+    free(visible);
+    perf_bounds_destroy(&bounds);
+}
+
+// The baseline is from a CPU implementation, so without --hardware only one of those gives comparable numbers
+bool perf_device_available(bool hardware) {
+    VkApplicationInfo application_info = {VK_STRUCTURE_TYPE_APPLICATION_INFO};
+    application_info.apiVersion = VK_API_VERSION_1_2;
+    VkInstanceCreateInfo create_info = {VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
+    create_info.pApplicationInfo = &application_info;
+    VkInstance instance;
+    if (vkCreateInstance(&create_info, NULL, &instance) != VK_SUCCESS) {
+        return false;
+    }
+
+    VkPhysicalDevice devices[16];
+    u32 count = sizeof(devices) / sizeof(VkPhysicalDevice);
+    if (vkEnumeratePhysicalDevices(instance, &count, devices) < VK_SUCCESS) {
+        count = 0;
+    }
+
+    bool available = false;
+    for (u32 i = 0; i < count && !available; ++i) {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(devices[i], &properties);
+        available = hardware || properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU;
+    }
+    vkDestroyInstance(instance, NULL);
+    return available;
+}
+
+bool perf_write_baseline(PerfSuite *suite, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        printf("ERROR: couldn't write %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "# name value tolerance\n");
+    for (u32 i = 0; i < suite->metric_count; ++i) {
+        PerfMetric *metric = &suite->metrics[i];
+        fprintf(file, "%s %.6f %.3f\n", metric->name, metric->value, metric->tolerance);
+    }
+    fclose(file);
+    printf("Baseline written to %s\n", path);
+    return true;
+}
+
+PerfMetric *perf_find(PerfSuite *suite, const char *name) {
+    for (u32 i = 0; i < suite->metric_count; ++i) {
+        if (strcmp(suite->metrics[i].name, name) == 0) {
+            return &suite->metrics[i];
+        }
+    }
+    return NULL;
+}
+
+// Returns the number of metrics in the baseline, or -1 when it can't be read
+int perf_baseline_metric_count(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        printf("ERROR: couldn't read %s\n", path);
+        return -1;
+    }
+
+    int count = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char name[PERF_MAX_NAME];
+        double baseline;
+        double tolerance;
+        if (line[0] != '#' && sscanf(line, "%63s %lf %lf", name, &baseline, &tolerance) == 3) {
+            count++;
+        }
+    }
+    fclose(file);
+    return count;
+}
+
+// Returns the number of regressions, or -1 when the baseline can't be read
+int perf_compare(PerfSuite *suite, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        printf("ERROR: couldn't read %s\n", path);
+        return -1;
+    }
+
+    printf("Against %s:\n", path);
+    int regressions = 0;
+    bool compared[PERF_MAX_METRICS] = {0};
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char name[PERF_MAX_NAME];
+        double baseline;
+        double tolerance;
+        if (line[0] == '#' || sscanf(line, "%63s %lf %lf", name, &baseline, &tolerance) != 3) {
+            continue;
+        }
+
+        PerfMetric *metric = perf_find(suite, name);
+        if (metric == NULL) {
+            printf("  %-28s missing from this run\n", name);
+            continue;
+        }
+
+        compared[metric - suite->metrics] = true;
+        double change = baseline > 0.0 ? metric->value / baseline - 1.0 : 0.0;
+        const char *verdict = "ok";
+        if (change > tolerance) {
+            verdict = "REGRESSION";
+            regressions++;
+        } else if (change < -tolerance) {
+            verdict = "faster, consider updating the baseline";
+        }
+        printf("  %-28s %12.4f  baseline %12.4f  %+7.1f%%  %s\n", name, metric->value, baseline, change * 100.0,
+               verdict);
+    }
+    fclose(file);
+
+    // New metrics can't regress yet, they show up so the baseline gets regenerated
+    for (u32 i = 0; i < suite->metric_count; ++i) {
+        if (!compared[i]) {
+            printf("  %-28s %12.4f  not in the baseline\n", suite->metrics[i].name, suite->metrics[i].value);
+        }
+    }
+
+    printf("%d regression%s\n", regressions, regressions == 1 ? "" : "s");
+    return regressions;
+}
+
+int main(int argc, char **argv) {
+    PerfOptions options;
+    if (!perf_parse_options(argc, argv, &options)) {
+        print_usage();
+        return -1;
+    }
+
+    // A baseline without metrics would pass every run, so nothing is measured until one has been written
+    if (options.baseline_path != NULL) {
+        int baseline_metrics = perf_baseline_metric_count(options.baseline_path);
+        if (baseline_metrics < 0) {
+            return -1;
+        }
+        if (baseline_metrics == 0) {
+            printf("SKIPPED: %s has no metrics, generate it with --write-baseline\n", options.baseline_path);
+            return PERF_EXIT_SKIPPED;
+        }
+    }
+
+    // Logging off the measured threads, like in the application
+    log_init();
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) < 0 || SDL_Vulkan_LoadLibrary(0) < 0) {
+        printf("SKIPPED: no display or Vulkan loader: %s\n", SDL_GetError());
+        return PERF_EXIT_SKIPPED;
+    }
+
+    if (!perf_device_available(options.hardware)) {
+        printf("SKIPPED: no %s\n", options.hardware ? "Vulkan device" : "CPU Vulkan device");
+        SDL_Quit();
+        return PERF_EXIT_SKIPPED;
+    }
+
+    PerfSuite suite = {0};
+    suite.window = SDL_CreateWindow("Perf Suite", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, PERF_WIDTH,
+                                    PERF_HEIGHT, SDL_WINDOW_VULKAN | SDL_WINDOW_HIDDEN);
+    if (suite.window == NULL) {
+        printf("SKIPPED: couldn't create a window: %s\n", SDL_GetError());
+        SDL_Quit();
+        return PERF_EXIT_SKIPPED;
+    }
+
+    int cpu_count = SDL_GetCPUCount();
+    if (!job_system_init(cpu_count > 1 ? cpu_count - 1 : 0)) {
+        printf("ERROR: failed to create the job system\n");
+        return -1;
+    }
+
+    Culler culler;
+    if (!culler_create(&culler)) {
+        return -1;
+    }
+
+    vulkan_prefer_software_device(!options.hardware);
+    printf("%u frames per scene, %u worker threads\n", options.frames, job_system_worker_count());
+    bool completed = perf_renderer(&suite, &options);
+    perf_allocator(&suite);
+    perf_culling(&suite, &culler);
+
+    int result = completed ? 0 : -1;
+    if (completed && options.write_path != NULL && !perf_write_baseline(&suite, options.write_path)) {
+        result = -1;
+    }
+    if (completed && options.baseline_path != NULL) {
+        int regressions = perf_compare(&suite, options.baseline_path);
+        result = regressions < 0 ? -1 : (regressions > 0 ? 1 : 0);
+    }
+
+    culler_destroy(&culler);
+    job_system_shutdown();
+    SDL_DestroyWindow(suite.window);
+    SDL_Vulkan_UnloadLibrary();
+    SDL_Quit();
+    log_shutdown();
+    return result;
+}
@@ -0,0 +1,377 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+#include <SDL_vulkan.h>
+#include "core/job.h"
+#include "core/latency.h"
+#include "core/log.h"
+#include "renderer/vulkan.h"
+#include "renderer/command_stream.h"
+
+// Longest mesh or texture path a stream may reference
+#define REPLAY_MAX_PATH 1024
+
+typedef struct ReplayOptions {
+    const char *path;
+    // Sleep until each frame's recorded time and keep the recorded present settings, instead of running uncapped
+    bool paced;
+    u32 max_frames;
+    const char *csv_path;
+} ReplayOptions;
+
+// Per frame wall time between submits, and the renderer's smoothed times at that point
+typedef struct ReplayFrame {
+    double frame_ms;
+    double render_ms;
+    double gpu_ms;
+} ReplayFrame;
+
+typedef struct Replay {
+    CommandStreamReader reader;
+    SDL_Window *window;
+    // Recorded mesh ids to the ones this run's loads returned, same for textures and materials
+    u32 *meshes;
+    u32 mesh_count;
+    u32 *textures;
+    u32 texture_count;
+    u32 *materials;
+    u32 material_count;
+
+    ReplayFrame *frames;
+    u32 frame_count;
+    u32 frame_capacity;
+} Replay;
+
+void print_usage() {
+    printf("Usage:\n");
+    printf("  replay <stream> [--paced] [--frames=N] [--csv=path]\n");
+}
+
+bool replay_parse_options(int argc, char **argv, ReplayOptions *out) {
+    ReplayOptions result = {0};
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--paced") == 0) {
+            result.paced = true;
+        } else if (strncmp(argv[i], "--frames=", 9) == 0) {
+            result.max_frames = (u32) strtoul(argv[i] + 9, NULL, 10);
+        } else if (strncmp(argv[i], "--csv=", 6) == 0) {
+            result.csv_path = argv[i] + 6;
+        } else if (argv[i][0] != '-' && result.path == NULL) {
+            result.path = argv[i];
+        } else {
+            return false;
+        }
+    }
+
+    *out = result;
+    return result.path != NULL;
+}
+
+// Grows the id map as needed, ids never recorded map to UINT32_MAX
+void replay_map_id(u32 **ids, u32 *count, u32 recorded, u32 id) {
+    if (recorded >= *count) {
+        u32 grown = recorded + 1;
+        *ids = realloc(*ids, sizeof(u32) * grown);
+        for (u32 i = *count; i < grown; ++i) {
+            (*ids)[i] = UINT32_MAX;
+        }
+        *count = grown;
+    }
+    (*ids)[recorded] = id;
+}
+
+bool replay_copy_path(const CommandStreamCommand *command, char *out) {
+    if (command->path_length >= REPLAY_MAX_PATH) {
+        printf("ERROR: path too long\n");
+        return false;
+    }
+    memcpy(out, command->path, command->path_length);
+    out[command->path_length] = '\0';
+    return true;
+}
+
+bool replay_load_mesh(Replay *replay, const CommandStreamCommand *command) {
+    char path[REPLAY_MAX_PATH];
+    if (!replay_copy_path(command, path)) {
+        return false;
+    }
+
+    u32 mesh = vulkan_load_mesh(path);
+    if (mesh == MESH_INVALID) {
+        printf("ERROR: couldn't load %s\n", path);
+        return false;
+    }
+    replay_map_id(&replay->meshes, &replay->mesh_count, command->mesh, mesh);
+    return true;
+}
+
+bool replay_load_texture(Replay *replay, const CommandStreamCommand *command) {
+    char path[REPLAY_MAX_PATH];
+    if (!replay_copy_path(command, path)) {
+        return false;
+    }
+
+    u32 texture = vulkan_load_texture(path);
+    if (texture == TEXTURE_INVALID) {
+        printf("ERROR: couldn't load %s\n", path);
+        return false;
+    }
+    replay_map_id(&replay->textures, &replay->texture_count, command->texture, texture);
+    return true;
+}
+
+bool replay_create_material(Replay *replay, const CommandStreamCommand *command) {
+    u32 texture = command->texture;
+    if (texture != TEXTURE_INVALID) {
+        if (texture >= replay->texture_count || replay->textures[texture] == TEXTURE_INVALID) {
+            printf("ERROR: material references texture %u that was never loaded\n", texture);
+            return false;
+        }
+        texture = replay->textures[texture];
+    }
+
+    u32 material = vulkan_create_material(command->base_color, texture);
+    if (material == MATERIAL_INVALID) {
+        printf("ERROR: couldn't create material %u\n", command->material);
+        return false;
+    }
+    replay_map_id(&replay->materials, &replay->material_count, command->material, material);
+    return true;
+}
+
+bool replay_submit_frame(Replay *replay) {
+    CommandStreamReader *reader = &replay->reader;
+    if (reader->draws.count > 0) {
+        MeshletDraw *draws = vulkan_reserve_draws(reader->draws.count);
+        memcpy(draws, reader->draws.elements, sizeof(MeshletDraw) * reader->draws.count);
+        for (u32 i = 0; i < reader->draws.count; ++i) {
+            u32 mesh = draws[i].mesh;
+            if (mesh >= replay->mesh_count || replay->meshes[mesh] == MESH_INVALID) {
+                printf("ERROR: draw references mesh %u that was never loaded\n", mesh);
+                return false;
+            }
+            draws[i].mesh = replay->meshes[mesh];
+
+            // Materials created before recording started, like the default one, have the same index in both runs
+            u32 material = draws[i].material;
+            if (material < replay->material_count && replay->materials[material] != UINT32_MAX) {
+                draws[i].material = replay->materials[material];
+            }
+        }
+    }
+    if (reader->lights.count > 0) {
+        memcpy(vulkan_reserve_lights(reader->lights.count), reader->lights.elements,
+               sizeof(Light) * reader->lights.count);
+    }
+    vulkan_render();
+    return true;
+}
+
+void replay_add_frame(Replay *replay, double frame_ms) {
+    if (replay->frame_count == replay->frame_capacity) {
+        replay->frame_capacity = replay->frame_capacity > 0 ? replay->frame_capacity * 2 : 1024;
+        replay->frames = realloc(replay->frames, sizeof(ReplayFrame) * replay->frame_capacity);
+    }
+
+    ReplayFrame *frame = &replay->frames[replay->frame_count++];
+    frame->frame_ms = frame_ms;
+    vulkan_frame_times(&frame->render_ms, &frame->gpu_ms);
+}
+
+bool replay_pump_events() {
+    SDL_Event event;
+    bool running = true;
+    while (SDL_PollEvent(&event)) {
+        if (event.type == SDL_QUIT) {
+            running = false;
+        }
+    }
+    return running;
+}
+
+bool replay_run(Replay *replay, const ReplayOptions *options) {
+    CommandStreamCommand command;
+    u64 frequency = SDL_GetPerformanceFrequency();
+    u64 start = SDL_GetPerformanceCounter();
+    u64 last_frame = start;
+
+    while (command_stream_read(&replay->reader, &command)) {
+        switch (command.type) {
+            case COMMAND_STREAM_LOAD_MESH:
+                if (!replay_load_mesh(replay, &command)) {
+                    return false;
+                }
+                // Loading isn't part of the next frame's time
+                last_frame = SDL_GetPerformanceCounter();
+                break;
+            case COMMAND_STREAM_LOAD_TEXTURE:
+                if (!replay_load_texture(replay, &command)) {
+                    return false;
+                }
+                last_frame = SDL_GetPerformanceCounter();
+                break;
+            case COMMAND_STREAM_MATERIAL:
+                if (!replay_create_material(replay, &command)) {
+                    return false;
+                }
+                last_frame = SDL_GetPerformanceCounter();
+                break;
+            case COMMAND_STREAM_VIEW:
+                vulkan_set_view(command.view_projection, command.camera);
+                break;
+            case COMMAND_STREAM_PRESENT:
+                if (options->paced) {
+                    vulkan_set_present_settings(&command.present);
+                }
+                break;
+            case COMMAND_STREAM_RESIZE:
+                SDL_SetWindowSize(replay->window, (int) command.width, (int) command.height);
+                vulkan_window_resized(replay->window);
+                break;
+            case COMMAND_STREAM_FRAME_BUDGET:
+                vulkan_set_frame_budget(command.milliseconds);
+                break;
+            case COMMAND_STREAM_PARTICLES:
+                if (!vulkan_set_particles(&command.particles)) {
+                    printf("ERROR: couldn't restart the particle system\n");
+                    return false;
+                }
+                // Restarting waits for the device to go idle, which isn't part of the next frame's time either
+                last_frame = SDL_GetPerformanceCounter();
+                break;
+            case COMMAND_STREAM_FRAME: {
+                if (!replay_pump_events()) {
+                    return true;
+                }
+                if (options->paced) {
+                    latency_sleep_until(start + (u64) ((double) command.timestamp * 1e-9 * (double) frequency));
+                }
+                vulkan_wait_frame_start();
+                if (!replay_submit_frame(replay)) {
+                    return false;
+                }
+
+                u64 now = SDL_GetPerformanceCounter();
+                replay_add_frame(replay, latency_ticks_to_ms(now - last_frame));
+                last_frame = now;
+                if (options->max_frames != 0 && replay->frame_count >= options->max_frames) {
+                    return true;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+int replay_compare_ms(const void *a, const void *b) {
+    double left = *(const double *) a;
+    double right = *(const double *) b;
+    return (left > right) - (left < right);
+}
+
+void replay_report(Replay *replay, const ReplayOptions *options) {
+    if (replay->frame_count == 0) {
+        printf("No frames replayed\n");
+        return;
+    }
+
+    double *sorted = malloc(sizeof(double) * replay->frame_count);
+    double total = 0.0;
+    double render = 0.0;
+    double gpu = 0.0;
+    for (u32 i = 0; i < replay->frame_count; ++i) {
+        sorted[i] = replay->frames[i].frame_ms;
+        total += replay->frames[i].frame_ms;
+        render += replay->frames[i].render_ms;
+        gpu += replay->frames[i].gpu_ms;
+    }
+    qsort(sorted, replay->frame_count, sizeof(double), replay_compare_ms);
+
+    u32 count = replay->frame_count;
+    printf("%u frames in %.3f s, %.1f fps%s\n", count, total / 1000.0, count * 1000.0 / total,
+           options->paced ? " (paced)" : "");
+    printf("  frame   mean %8.3f ms  p50 %8.3f ms  p95 %8.3f ms  p99 %8.3f ms  max %8.3f ms\n", total / count,
+           sorted[count / 2], sorted[(u32) (count * 0.95)], sorted[(u32) (count * 0.99)], sorted[count - 1]);
+    printf("  render mean %8.3f ms  gpu mean %8.3f ms\n", render / count, gpu / count);
+    free(sorted);
+
+    if (options->csv_path == NULL) {
+        return;
+    }
+    FILE *csv = fopen(options->csv_path, "w");
+    if (csv == NULL) {
+        printf("ERROR: couldn't write %s\n", options->csv_path);
+        return;
+    }
+    fprintf(csv, "frame,frame_ms,render_ms,gpu_ms\n");
+    for (u32 i = 0; i < count; ++i) {
+        ReplayFrame *frame = &replay->frames[i];
+        fprintf(csv, "%u,%.4f,%.4f,%.4f\n", i, frame->frame_ms, frame->render_ms, frame->gpu_ms);
+    }
+    fclose(csv);
+}
+
+int main(int argc, char **argv) {
+    ReplayOptions options;
+    if (!replay_parse_options(argc, argv, &options)) {
+        print_usage();
+        return -1;
+    }
+
+    log_init();
+    Replay replay = {0};
+    if (!command_stream_reader_open(options.path, &replay.reader)) {
+        return -1;
+    }
+
+    CommandStreamCommand init;
+    if (!command_stream_read(&replay.reader, &init) || init.type != COMMAND_STREAM_INIT) {
+        printf("ERROR: %s doesn't start with its initial state\n", options.path);
+        return -1;
+    }
+
+    // Unpaced runs go as fast as the GPU allows, recorded present changes are ignored too
+    PresentSettings present = init.present;
+    if (!options.paced) {
+        present.policy = PRESENT_POLICY_BENCHMARK;
+        present.target_fps = 0;
+    }
+
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) < 0 || SDL_Vulkan_LoadLibrary(0) < 0) {
+        printf("ERROR: failed to initialize SDL: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    replay.window = SDL_CreateWindow("Replay", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, (int) init.width,
+                                     (int) init.height, SDL_WINDOW_VULKAN | SDL_WINDOW_SHOWN);
+    int cpu_count = SDL_GetCPUCount();
+    if (replay.window == NULL || !job_system_init(cpu_count > 1 ? cpu_count - 1 : 0)) {
+        printf("ERROR: failed to create the window or job system: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    if (!vulkan_init(replay.window, "Replay", &present)) {
+        printf("ERROR: failed to initialize Vulkan\n");
+        return -1;
+    }
+
+    bool completed = replay_run(&replay, &options);
+    vulkan_shutdown();
+    replay_report(&replay, &options);
+
+    command_stream_reader_close(&replay.reader);
+    free(replay.meshes);
+    free(replay.textures);
+    free(replay.materials);
+    free(replay.frames);
+    job_system_shutdown();
+    SDL_DestroyWindow(replay.window);
+    SDL_Vulkan_UnloadLibrary();
+    SDL_Quit();
+    log_shutdown();
+    return completed ? 0 : -1;
+}